@@ -0,0 +1,113 @@
+#ifndef __consumer_core_H__
+#define __consumer_core_H__
+
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "hazard_zone.h"
+#include "message_schema.h"
+
+/* Model of the consumer: message decoding, position, satellites, boundary zone and trail state,
+ * and the events the view is told about.
+ *
+ * It does not know the message port, bundles or Elementary. Messages come in through
+ * consumer_message_s, which reads fields by key from whatever carries them. Everything shown goes
+ * out through the narrow consumer_view_s, requests to gps-service through consumer_service_s,
+ * and log lines through consumer_log_cb. The application is the adapter of all three to the
+ * platform; on a host they can be plain functions, or NULL to be skipped.
+ *
+ * Depends on the C library, POSIX shared memory of the ring transport, and the shared protocol
+ * modules only, so it builds on a plain Linux host: 'make bench' in test/ builds and runs
+ * test/consumer_core_bench.c, which drives it with synthetic messages.
+ */
+
+#define BOUNDARY_ZONE_ID 1
+#define BOUNDARY_CIRCLE_RADIUS_M 30.0 /* m */
+
+/* Fixes the service sends per track message at most */
+#define CONSUMER_TRACK_MAX_POINTS 1024
+
+/* Zone events kept, also while the view is paused */
+#define CONSUMER_ALERT_LOG_SIZE 16
+
+typedef enum
+{
+	CONSUMER_LOG_DEBUG,
+	CONSUMER_LOG_INFO,
+	CONSUMER_LOG_WARN,
+	CONSUMER_LOG_ERROR
+} consumer_log_level_e;
+
+typedef void (*consumer_log_cb)(consumer_log_level_e level, const char *format, va_list args);
+
+/* Received message. Returned fields stay valid until the handling returns. */
+typedef struct
+{
+	const void *data;
+	const char *sender;
+	bool (*get_bytes)(const void *data, const char *key, const void **bytes, size_t *size);
+	const char *(*get_str)(const void *data, const char *key);
+	bool trusted;				/* sender is signed with the same certificate */
+} consumer_message_s;
+
+/* What the view is told, any callback may be NULL */
+typedef struct
+{
+	void (*update_position)(double longitude, double latitude);
+	void (*update_message)(const char *message);
+	void (*update_satellites_count)(const char *count_str);
+	void (*show_zones)(const hazard_zone_list_s *list, size_t size);
+	void (*update_trail)(void);
+} consumer_view_s;
+
+/* Requests to gps-service, each returns false if it could not be sent */
+typedef struct
+{
+	bool (*subscribe)(bool shm_ring);
+	bool (*set_zones)(const hazard_zone_list_s *list, size_t size);
+	bool (*request_track)(int64_t from);
+} consumer_service_s;
+
+typedef struct
+{
+	unsigned int messages[MESSAGE_SCHEMA_MAX_ID];	/* handled, by id */
+	unsigned int unknown_messages;
+	unsigned int invalid_messages;		/* known id, but fields missing or damaged */
+	unsigned int fixes;					/* positions shown */
+	unsigned int alerts;				/* zone events */
+} consumer_core_stats_s;
+
+/*
+ * Start with no state, now is the start of the time to first displayed fix in seconds.
+ * view, service and log are kept and must outlive the core.
+ */
+void consumer_core_init(const consumer_view_s *view, const consumer_service_s *service, consumer_log_cb log, double now);
+
+/*
+ * Log counters, detach from the ring and release memory
+ */
+void consumer_core_destroy(void);
+
+/*
+ * Subscribe to gps-service, it answers with a state snapshot.
+ * Returns false if the request could not be sent.
+ */
+bool consumer_core_subscribe(void);
+
+/*
+ * Decode and handle message received at now seconds
+ */
+void consumer_core_handle_message(const consumer_message_s *message, double now);
+
+/*
+ * Tell whether the view is hidden. Zone events received while it was are logged when it is shown.
+ */
+void consumer_core_set_paused(bool paused);
+
+/*
+ * Get counters
+ */
+void consumer_core_get_stats(consumer_core_stats_s *stats);
+
+#endif /* __consumer_core_H__ */
@@ -0,0 +1,116 @@
+#ifndef __message_schema_H__
+#define __message_schema_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/* Message type ids sent by gpsservice, shared with gpsservice-consumer.
+ * Keep this file identical in both projects.
+ *
+ * Every message from the service carries a message_schema_s under MESSAGE_SCHEMA_KEY next to the
+ * "msg_type" string, so a client dispatches on an integer instead of comparing strings. Ids are
+ * never reused or renumbered; a new message kind gets the next free id and a newer version.
+ * A client that gets an id it does not know counts it and drops the message.
+ * Messages from older services have only the string, message_schema_id_from_name() maps it.
+ */
+
+#define MESSAGE_SCHEMA_KEY "msg_id"
+#define MESSAGE_SCHEMA_TYPE_KEY "msg_type"
+#define MESSAGE_SCHEMA_VERSION 1
+#define MESSAGE_SCHEMA_MAX_ID 64	/* size of dispatch tables, ids are below it */
+
+typedef enum
+{
+	MESSAGE_ID_UNKNOWN = 0,
+	MESSAGE_ID_POSITION_UPDATE = 1,
+	MESSAGE_ID_SATELLITES_UPDATE = 2,
+	MESSAGE_ID_POSITION_BATCH = 3,
+	MESSAGE_ID_STATE_SNAPSHOT = 4,
+	MESSAGE_ID_POWER_TIER = 5,
+	MESSAGE_ID_RING_HANDSHAKE = 6,
+	MESSAGE_ID_RING_DOORBELL = 7,
+	MESSAGE_ID_ZONE_EVENT = 8,
+	MESSAGE_ID_POSITION_HEARTBEAT = 9,
+	MESSAGE_ID_TRACK = 10,
+	MESSAGE_ID_COUNT
+} message_id_e;
+
+typedef struct __attribute__((packed))
+{
+	uint8_t version;				/* schema version of the sender */
+	uint8_t reserved;
+	uint16_t id;
+} message_schema_s;
+
+typedef char __message_schema_size_check[(sizeof(message_schema_s) == 4 && MESSAGE_ID_COUNT <= MESSAGE_SCHEMA_MAX_ID) ? 1 : -1];
+
+/*
+ * Get "msg_type" string of id, NULL if unknown
+ */
+static inline const char *
+message_schema_name(unsigned int id)
+{
+	static const char *const names[MESSAGE_ID_COUNT] = {
+		[MESSAGE_ID_POSITION_UPDATE] = "POSITION_UPDATE",
+		[MESSAGE_ID_SATELLITES_UPDATE] = "SATELLITES_UPDATE",
+		[MESSAGE_ID_POSITION_BATCH] = "POSITION_BATCH",
+		[MESSAGE_ID_STATE_SNAPSHOT] = "STATE_SNAPSHOT",
+		[MESSAGE_ID_POWER_TIER] = "POWER_TIER",
+		[MESSAGE_ID_RING_HANDSHAKE] = "RING_HANDSHAKE",
+		[MESSAGE_ID_RING_DOORBELL] = "RING_DOORBELL",
+		[MESSAGE_ID_ZONE_EVENT] = "ZONE_EVENT",
+		[MESSAGE_ID_POSITION_HEARTBEAT] = "POSITION_HEARTBEAT",
+		[MESSAGE_ID_TRACK] = "TRACK",
+	};
+
+	return id < MESSAGE_ID_COUNT ? names[id] : NULL;
+}
+
+/*
+ * Get id of an exactly matching "msg_type" string, MESSAGE_ID_UNKNOWN if there is none
+ */
+static inline unsigned int
+message_schema_id_from_name(const char *name)
+{
+	unsigned int id;
+
+	for (id = MESSAGE_ID_UNKNOWN + 1; id < MESSAGE_ID_COUNT; id++) {
+		if (!strcmp(name, message_schema_name(id)))
+			return id;
+	}
+
+	return MESSAGE_ID_UNKNOWN;
+}
+
+/*
+ * Fill schema header of message id
+ */
+static inline void
+message_schema_init(message_schema_s *schema, unsigned int id)
+{
+	schema->version = MESSAGE_SCHEMA_VERSION;
+	schema->reserved = 0;
+	schema->id = (uint16_t)id;
+}
+
+/*
+ * Get message id from received schema bytes, MESSAGE_ID_UNKNOWN if they do not hold one.
+ * Ids of newer versions are returned as they are - the caller decides whether it knows them.
+ */
+static inline unsigned int
+message_schema_decode(const void *bytes, size_t size)
+{
+	message_schema_s schema;
+
+	if (!bytes || size < sizeof(message_schema_s))
+		return MESSAGE_ID_UNKNOWN;
+
+	memcpy(&schema, bytes, sizeof(schema));
+	if (schema.version < 1)
+		return MESSAGE_ID_UNKNOWN;
+
+	return schema.id;
+}
+
+#endif /* __message_schema_H__ */
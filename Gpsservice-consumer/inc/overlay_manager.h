@@ -0,0 +1,65 @@
+#ifndef __overlay_manager_H__
+#define __overlay_manager_H__
+
+#include "gpsservice-consumer.h"
+#include "hazard_zone.h"
+
+/* Map overlays of hazard zones, materialised only where they can be seen.
+ *
+ * Zones are kept as data. Each update compares their bounding boxes with the visible map region
+ * grown by OVERLAY_VIEWPORT_MARGIN at each side and creates Elm_Map_Overlay objects only for the
+ * zones intersecting it, at most OVERLAY_MAX_SHOWN of them. The level of detail follows the zoom:
+ * full geometry from OVERLAY_DETAIL_ZOOM, polygons with vertices closer than OVERLAY_SIMPLIFY_PX
+ * pixels dropped from OVERLAY_SIMPLE_ZOOM, and a plain marker at the zone center below it.
+ *
+ * Overlays of zones leaving the viewport are recycled: markers go to a pool and are moved to the
+ * next zone that needs one, geometry overlays are hidden and shown again when the zone comes back,
+ * up to OVERLAY_MAX_CACHED of them.
+ */
+
+#define OVERLAY_VIEWPORT_MARGIN 0.5		/* of the viewport size */
+#define OVERLAY_DETAIL_ZOOM 15
+#define OVERLAY_SIMPLE_ZOOM 12
+#define OVERLAY_SIMPLIFY_PX 3.0
+#define OVERLAY_MAX_SHOWN 128
+#define OVERLAY_MAX_CACHED 64
+#define OVERLAY_MAX_MARKERS 64			/* hidden markers kept for reuse */
+
+typedef struct
+{
+	unsigned int zones;
+	unsigned int updates;
+	unsigned int shown;				/* overlays shown after the last update */
+	unsigned int culled;			/* zones outside the viewport at the last update */
+	unsigned int created;
+	unsigned int deleted;
+	unsigned int recycled;			/* pooled markers and cached geometry shown again */
+} overlay_manager_stats_s;
+
+/*
+ * Attach map the overlays are drawn on, NULL deletes all overlays
+ */
+void overlay_manager_set_map(Evas_Object *map);
+
+/*
+ * Replace displayed zones with a validated list of size bytes. Invalid zones are skipped.
+ * Returns false if memory could not be allocated, no zones are displayed then.
+ */
+bool overlay_manager_set_zones(const hazard_zone_list_s *list, size_t size);
+
+/*
+ * Create, recycle and delete overlays for the current map region and zoom
+ */
+void overlay_manager_update(void);
+
+/*
+ * Delete all overlays and zones
+ */
+void overlay_manager_destroy(void);
+
+/*
+ * Get counters
+ */
+void overlay_manager_get_stats(overlay_manager_stats_s *stats);
+
+#endif /* __overlay_manager_H__ */
@@ -0,0 +1,122 @@
+#ifndef __satellite_frame_H__
+#define __satellite_frame_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Binary per-satellite telemetry shared by gpsservice and gpsservice-consumer.
+ * Keep this file identical in both projects.
+ *
+ * A frame is a header followed by count fixed-size entries, sent as a single byte payload
+ * under SATELLITE_FRAME_KEY. Layout is packed and little-endian like position_frame_s.
+ *
+ * A key frame holds every satellite in view. Other frames are deltas against the frame with
+ * sequence base_sequence: they hold only satellites that were added or changed, and
+ * satellites that left the view as entries with SATELLITE_ENTRY_FLAG_REMOVED.
+ * A receiver that does not hold the base frame must drop deltas until the next key frame.
+ */
+
+#define SATELLITE_FRAME_KEY "satellite_frame"
+#define SATELLITE_FRAME_MAGIC 0x53 /* 'S' */
+#define SATELLITE_FRAME_VERSION 1
+#define SATELLITE_FRAME_MAX 64		/* satellites in one frame */
+
+/* frame flags */
+#define SATELLITE_FRAME_FLAG_KEY 0x01
+
+/* entry flags */
+#define SATELLITE_ENTRY_FLAG_IN_USE 0x01
+#define SATELLITE_ENTRY_FLAG_REMOVED 0x02
+
+typedef struct __attribute__((packed))
+{
+	uint8_t magic;
+	uint8_t version;
+	uint8_t flags;
+	uint8_t count;					/* entries after the header */
+	uint16_t sequence;
+	uint16_t base_sequence;			/* sequence the delta applies to */
+	int64_t timestamp;				/* seconds since epoch */
+	uint8_t num_of_active;
+	uint8_t num_of_inview;
+	uint16_t entry_size;			/* sizeof(satellite_entry_s) of the sender */
+} satellite_frame_s;
+
+typedef struct __attribute__((packed))
+{
+	uint16_t prn;
+	uint16_t azimuth;				/* degrees from north */
+	uint8_t elevation;				/* degrees above horizon */
+	uint8_t snr;					/* dB-Hz */
+	uint8_t flags;
+	uint8_t reserved;
+} satellite_entry_s;
+
+typedef char __satellite_frame_size_check[(sizeof(satellite_frame_s) == 20 && sizeof(satellite_entry_s) == 8) ? 1 : -1];
+
+/*
+ * Get entry of a validated frame
+ */
+static inline const satellite_entry_s *
+satellite_frame_entry(const satellite_frame_s *frame, unsigned int index)
+{
+	return (const satellite_entry_s *)((const char *)(frame + 1) + index * frame->entry_size);
+}
+
+/*
+ * Validate received bytes and return them as a frame, or NULL if they do not hold one.
+ * The returned pointer aliases the given buffer - no copy is made.
+ */
+static inline const satellite_frame_s *
+satellite_frame_decode(const void *bytes, size_t size)
+{
+	const satellite_frame_s *frame = (const satellite_frame_s *)bytes;
+
+	if (!bytes || size < sizeof(satellite_frame_s))
+		return NULL;
+
+	if (frame->magic != SATELLITE_FRAME_MAGIC || frame->version < 1 || frame->entry_size < sizeof(satellite_entry_s) ||
+			frame->count > SATELLITE_FRAME_MAX || sizeof(satellite_frame_s) + (size_t)frame->count * frame->entry_size > size)
+		return NULL;
+
+	return frame;
+}
+
+/*
+ * Apply frame to a table of satellites in view, *count entries of SATELLITE_FRAME_MAX.
+ * Returns false, leaving the table unchanged, if the frame is a delta to another sequence.
+ */
+static inline bool
+satellite_frame_apply(const satellite_frame_s *frame, satellite_entry_s *table, unsigned int *count, uint16_t *sequence)
+{
+	unsigned int i, j;
+
+	if (frame->flags & SATELLITE_FRAME_FLAG_KEY)
+		*count = 0;
+	else if (frame->base_sequence != *sequence)
+		return false;
+
+	for (i = 0; i < frame->count; i++) {
+		const satellite_entry_s *entry = satellite_frame_entry(frame, i);
+
+		for (j = 0; j < *count && table[j].prn != entry->prn; j++)
+			;
+
+		if (entry->flags & SATELLITE_ENTRY_FLAG_REMOVED) {
+			/* Order of the table does not matter - move the last entry in place */
+			if (j < *count)
+				table[j] = table[--*count];
+		} else if (j < *count || *count < SATELLITE_FRAME_MAX) {
+			if (j == *count)
+				(*count)++;
+			table[j] = *entry;
+		}
+	}
+
+	*sequence = frame->sequence;
+
+	return true;
+}
+
+#endif /* __satellite_frame_H__ */
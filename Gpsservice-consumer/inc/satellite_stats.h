@@ -0,0 +1,89 @@
+#ifndef __satellite_stats_H__
+#define __satellite_stats_H__
+
+#include <stdbool.h>
+
+/* Rolling statistics of satellites in view, used to detect degraded fixes, e.g. indoors.
+ * Keep this file identical in gpsservice-consumer and LocationManager.
+ *
+ * Satellites of one update are added between satellite_stats_begin() and satellite_stats_end().
+ * Adding a satellite is O(1) and ending an update is O(1), windowed values are kept as running
+ * sums over the last SATELLITE_STATS_WINDOW updates.
+ *
+ * Sky spread is 1 minus the length of the mean direction of satellites in use, as seen from
+ * above (low satellites weigh more, they improve geometry the most). It is 0 when all
+ * satellites are in one direction and close to 1 when they surround the receiver.
+ *
+ * Depends on the C library only.
+ */
+
+#define SATELLITE_STATS_WINDOW 12
+
+#define SATELLITE_STATS_DEGRADED_SNR 25.0		/* dB-Hz */
+#define SATELLITE_STATS_DEGRADED_SPREAD 0.3
+#define SATELLITE_STATS_MIN_IN_USE 4			/* satellites needed for a 3D fix */
+
+typedef struct
+{
+	/* Last update */
+	unsigned int in_view;
+	unsigned int in_use;
+	double mean_snr;			/* dB-Hz, of satellites with a signal */
+	double in_use_ratio;
+	double sky_spread;
+	unsigned int octants;		/* azimuth octants with a satellite in use */
+
+	/* Over the last SATELLITE_STATS_WINDOW updates */
+	double window_mean_snr;
+	double window_in_use_ratio;
+	double window_sky_spread;
+	unsigned int window_count;
+	unsigned int updates;
+
+	/* Update in progress */
+	unsigned int acc_in_view;
+	unsigned int acc_in_use;
+	unsigned int acc_with_signal;
+	unsigned int acc_octants;
+	double acc_snr;
+	double acc_east;
+	double acc_north;
+	double acc_weight;
+
+	/* Window ring */
+	double ring_snr[SATELLITE_STATS_WINDOW];
+	double ring_ratio[SATELLITE_STATS_WINDOW];
+	double ring_spread[SATELLITE_STATS_WINDOW];
+	double sum_snr;
+	double sum_ratio;
+	double sum_spread;
+	unsigned int ring_head;
+} satellite_stats_s;
+
+/*
+ * Reset statistics
+ */
+void satellite_stats_init(satellite_stats_s *stats);
+
+/*
+ * Start update
+ */
+void satellite_stats_begin(satellite_stats_s *stats);
+
+/*
+ * Add satellite to the update in progress
+ */
+void satellite_stats_add(satellite_stats_s *stats, unsigned int azimuth, unsigned int elevation, int snr, bool in_use);
+
+/*
+ * Finish update and refresh last update and window values
+ */
+void satellite_stats_end(satellite_stats_s *stats);
+
+/*
+ * Check if the window indicates a degraded fix: weak signals, too few satellites in use
+ * or satellites in use clustered in one part of the sky
+ */
+bool satellite_stats_is_degraded(const satellite_stats_s *stats);
+
+#endif /* __satellite_stats_H__ */
@@ -0,0 +1,95 @@
+#ifndef __track_codec_H__
+#define __track_codec_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Compact encoding of a sequence of fixes, shared by gpsservice and gpsservice-consumer.
+ * Keep this file identical in both projects.
+ *
+ * Coordinates are 1e-7 degree fixed point integers, altitude and accuracy are decimeters.
+ * Each point is stored as varints of:
+ * - zig-zag delta of the time delta to the previous point (delta-of-delta, 0 for a steady rate)
+ * - zig-zag delta of latitude, longitude and altitude to the previous point
+ * - horizontal accuracy and position_frame_s flags
+ * A fix every second while walking takes about 8 bytes instead of 56 of a position frame.
+ *
+ * A track payload is a track_codec_header_s followed by count encoded points. The streaming
+ * encoder and decoder work point by point with a track_codec_state_s, the bulk decoder decodes
+ * a whole payload and uses SSE2 or NEON for the coordinate deltas when available.
+ *
+ * Latitude and longitude deltas are computed modulo 2^32, so crossing the antimeridian does not
+ * overflow. Depends on the C library only.
+ */
+
+#define TRACK_CODEC_KEY "track"
+#define TRACK_CODEC_MAGIC 0x54	/* 'T' */
+#define TRACK_CODEC_VERSION 1
+#define TRACK_CODEC_RESOLUTION 1e-7		/* degrees per unit */
+#define TRACK_CODEC_MAX_POINT_SIZE 35	/* longest encoded point */
+
+typedef struct __attribute__((packed))
+{
+	uint8_t magic;
+	uint8_t version;
+	uint16_t reserved;
+	uint32_t count;					/* points after the header */
+} track_codec_header_s;
+
+typedef struct
+{
+	int64_t timestamp;				/* seconds since epoch */
+	double latitude;				/* degrees */
+	double longitude;				/* degrees */
+	float altitude;					/* m */
+	float horizontal_accuracy;		/* m, 0 if unknown */
+	uint32_t flags;					/* position_frame_s flags */
+} track_codec_point_s;
+
+typedef struct
+{
+	int64_t timestamp;
+	int64_t time_delta;
+	uint32_t latitude;
+	uint32_t longitude;
+	uint32_t altitude;
+} track_codec_state_s;
+
+/*
+ * Reset state before the first point of a track, for both encoding and decoding
+ */
+void track_codec_state_init(track_codec_state_s *state);
+
+/*
+ * Encode point after the previous one of state into out, which has room for
+ * TRACK_CODEC_MAX_POINT_SIZE bytes. Returns number of bytes written.
+ */
+size_t track_codec_encode_point(track_codec_state_s *state, const track_codec_point_s *point, uint8_t *out);
+
+/*
+ * Decode point following the previous one of state. Returns number of bytes consumed,
+ * or 0 if the bytes do not hold a complete point.
+ */
+size_t track_codec_decode_point(track_codec_state_s *state, const uint8_t *bytes, size_t size, track_codec_point_s *point);
+
+/*
+ * Write header and up to count points into out. Stops before a point that does not fit,
+ * the header count tells how many were written. Returns number of bytes written, 0 if
+ * not even the header fits.
+ */
+size_t track_codec_encode(const track_codec_point_s *points, unsigned int count, void *out, size_t out_size);
+
+/*
+ * Validate header of received bytes and return it, or NULL if they do not hold a track.
+ * The returned pointer aliases the given buffer - no copy is made.
+ */
+const track_codec_header_s *track_codec_decode_header(const void *bytes, size_t size);
+
+/*
+ * Decode up to max_points points of a track payload. Returns number of points decoded,
+ * less than the header count if the payload is truncated or damaged.
+ */
+unsigned int track_codec_decode(const void *bytes, size_t size, track_codec_point_s *points, unsigned int max_points);
+
+#endif /* __track_codec_H__ */
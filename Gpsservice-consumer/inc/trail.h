@@ -0,0 +1,75 @@
+#ifndef __trail_H__
+#define __trail_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Breadcrumb trail of the fixes shown, simplified for drawing at any zoom.
+ *
+ * The full track stays in memory, up to TRAIL_MAX_POINTS fixes, the oldest quarter is dropped
+ * when it is full. Every appended fix is fed to TRAIL_LEVELS streaming simplifiers. Level l keeps
+ * a fix as a vertex only when the next one can not be reached by a straight line passing within
+ * TRAIL_TOLERANCE_M * 2^l of all skipped fixes (sleeve algorithm). So the polyline of level l is
+ * within twice that of the full track. Levels simplify the full track independently, a coarse
+ * level built from the vertices of a finer one would add up the error of every level below.
+ *
+ * Appending costs an angle test per level, and the vertex lists of all levels only grow at their
+ * end. A zoom change only picks another level - nothing is
+ * simplified again. Fixes arriving out of order, e.g. a track fetched after a reconnect, are merged
+ * in and the levels are rebuilt once.
+ *
+ * Coordinates are projected to meters around the first fix. Depends on the C library only.
+ */
+
+#define TRAIL_LEVELS 10
+#define TRAIL_TOLERANCE_M 2.0			/* of level 0 */
+#define TRAIL_MAX_POINTS 65536			/* 18 hours of fixes every second */
+
+typedef struct
+{
+	double latitude;				/* degrees */
+	double longitude;				/* degrees */
+	int64_t timestamp;				/* seconds since epoch */
+} trail_point_s;
+
+/*
+ * Remove all fixes
+ */
+void trail_init(void);
+
+/*
+ * Release memory
+ */
+void trail_destroy(void);
+
+/*
+ * Append fix newer than all fixes in the trail. Older fixes are merged in with trail_merge().
+ * Returns false if it is not newer or memory could not be allocated.
+ */
+bool trail_append(double latitude, double longitude, int64_t timestamp);
+
+/*
+ * Merge count fixes sorted by time into the trail. Fixes with a timestamp already in the trail
+ * are skipped. Returns number of fixes added.
+ */
+unsigned int trail_merge(const trail_point_s *points, unsigned int count);
+
+/*
+ * Get number of fixes in the trail
+ */
+unsigned int trail_get_count(void);
+
+/*
+ * Get coarsest level within tolerance_m of the track, or a coarser one if that has more than
+ * max_vertices vertices
+ */
+unsigned int trail_select_level(double tolerance_m, unsigned int max_vertices);
+
+/*
+ * Write polyline of level to vertices, ending at the newest fix. If it has more than max_vertices
+ * vertices, the oldest are left out, in steps of a quarter of max_vertices so the start of the
+ * polyline does not move with every fix. Returns number of vertices written.
+ */
+unsigned int trail_get_vertices(unsigned int level, trail_point_s *vertices, unsigned int max_vertices);
+
+#endif /* __trail_H__ */
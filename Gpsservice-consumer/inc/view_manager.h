@@ -2,6 +2,7 @@
 #define __view_manager_H__
 
 #include "gpsservice-consumer.h"
+#include "hazard_zone.h"
 
 /*
  * Create application's window and its content
@@ -16,17 +17,34 @@ void view_manager_destroy(void);
 /*
  * Update displayed message
 */
-void view_manager_update_message(char *message);
+void view_manager_update_message(const char *message);
 
 /*
  * Update displayed satellites in view count
 */
-void view_manager_update_satellites_count(char *count_str);
+void view_manager_update_satellites_count(const char *count_str);
 
 /*
- * Create map and circle boundary overlay with given coordinates
+ * Create map at given coordinates
 */
-void view_manager_create_map_with_circle_boundary(double longitude, double latitude);
+void view_manager_create_map(double longitude, double latitude);
+
+/*
+ * Replace zones drawn on the map with a validated zone list of size bytes.
+ * Only zones within the visible map region get overlays.
+*/
+void view_manager_show_zones(const hazard_zone_list_s *list, size_t size);
+
+/*
+ * Stop or restart rendering. While paused, updates only replace the staged state,
+ * resuming renders it in one frame.
+*/
+void view_manager_set_paused(bool paused);
+
+/*
+ * Redraw trail after fixes were added to it
+*/
+void view_manager_update_trail(void);
 
 /*
  * Update displayed current position overlay to given coordinates
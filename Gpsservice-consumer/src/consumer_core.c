@@ -0,0 +1,750 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "consumer_core.h"
+#include "position_frame.h"
+#include "satellite_frame.h"
+#include "satellite_stats.h"
+#include "shm_ring.h"
+#include "track_codec.h"
+#include "trail.h"
+
+#define MESSAGE_POSITION_BATCH_STR "position_batch"
+#define MESSAGE_SATELLITES_COUNT_STR "satellites_count"
+#define MESSAGE_LATITUDE_STR "latitude"
+#define MESSAGE_LONGITUDE_STR "longitude"
+#define MESSAGE_RING_NAME_STR "ring_name"
+#define MESSAGE_POWER_TIER_STR "power_tier"
+
+#define MESSAGE_BOUNDARY_OUTSIDE "Boundary area exceeded"
+#define MESSAGE_BOUNDARY_INSIDE "Inside boundary area"
+
+static struct
+{
+	const consumer_view_s *view;
+	const consumer_service_s *service;
+	consumer_log_cb log;
+	consumer_core_stats_s stats;
+
+	satellite_entry_s satellites[SATELLITE_FRAME_MAX];
+	satellite_stats_s satellite_stats;
+	shm_ring_s *ring;
+	double start_time;
+	double now;						/* of the message being handled */
+	double boundary_latitude;
+	double boundary_longitude;
+	int64_t last_fix_timestamp;
+	unsigned int satellite_count;
+	uint16_t satellite_sequence;
+	bool fix_displayed;
+	bool live_fix_displayed;
+	bool degraded;
+	bool ring_failed;
+	bool has_boundary;
+
+	hazard_zone_event_s alerts[CONSUMER_ALERT_LOG_SIZE];
+	unsigned int alerts_at_pause;
+	bool paused;
+} s_core_data = {
+	.view = NULL,
+	.service = NULL,
+	.log = NULL,
+	.ring = NULL,
+	.start_time = 0.0,
+	.now = 0.0,
+	.boundary_latitude = 0.0,
+	.boundary_longitude = 0.0,
+	.last_fix_timestamp = 0,
+	.satellite_count = 0,
+	.satellite_sequence = 0,
+	.fix_displayed = false,
+	.live_fix_displayed = false,
+	.degraded = false,
+	.ring_failed = false,
+	.has_boundary = false,
+	.alerts_at_pause = 0,
+	.paused = false
+};
+
+static void __log(consumer_log_level_e level, const char *format, ...) __attribute__((format(printf, 2, 3)));
+static void __update_position(const char *latitude_str, const char *longitude_str);
+static void __update_position_frame(const position_frame_s *frame, bool trail_changed);
+static bool __trail_frame(const position_frame_s *frame);
+static void __update_position_batch(const void *bytes, size_t size);
+static void __update_satellites(const char *satellites_count_str);
+static void __update_satellite_frame(const consumer_message_s *message, bool resync);
+static void __update_boundary_state(bool inside);
+static void __record_first_fix(bool live);
+static void __drain_ring(void);
+static bool __push_boundary_zone(void);
+static bool __request_track(int64_t from);
+static unsigned int __get_message_id(const consumer_message_s *message);
+static const void *__get_bytes(const consumer_message_s *message, const char *key, size_t *size);
+static const char *__get_str(const consumer_message_s *message, const char *key);
+static void __handle_satellites_update(const consumer_message_s *message);
+static void __handle_position_update(const consumer_message_s *message);
+static void __handle_position_batch(const consumer_message_s *message);
+static void __handle_state_snapshot(const consumer_message_s *message);
+static void __handle_ring_handshake(const consumer_message_s *message);
+static void __handle_ring_doorbell(const consumer_message_s *message __attribute__((unused)));
+static void __handle_power_tier(const consumer_message_s *message);
+static void __handle_zone_event(const consumer_message_s *message);
+static void __handle_track(const consumer_message_s *message);
+
+typedef void (*message_handler_cb)(const consumer_message_s *message);
+
+/* Handlers indexed by message id, a new message kind only needs its line here */
+static const message_handler_cb s_message_handlers[MESSAGE_SCHEMA_MAX_ID] = {
+	[MESSAGE_ID_POSITION_UPDATE] = __handle_position_update,
+	[MESSAGE_ID_SATELLITES_UPDATE] = __handle_satellites_update,
+	[MESSAGE_ID_POSITION_BATCH] = __handle_position_batch,
+	[MESSAGE_ID_STATE_SNAPSHOT] = __handle_state_snapshot,
+	[MESSAGE_ID_RING_HANDSHAKE] = __handle_ring_handshake,
+	[MESSAGE_ID_RING_DOORBELL] = __handle_ring_doorbell,
+	[MESSAGE_ID_POWER_TIER] = __handle_power_tier,
+	[MESSAGE_ID_ZONE_EVENT] = __handle_zone_event,
+	[MESSAGE_ID_TRACK] = __handle_track,
+};
+
+
+void
+consumer_core_init(const consumer_view_s *view, const consumer_service_s *service, consumer_log_cb log, double now)
+{
+	memset(&s_core_data, 0, sizeof(s_core_data));
+
+	s_core_data.view = view;
+	s_core_data.service = service;
+	s_core_data.log = log;
+
+	/* Start of the time to first displayed fix */
+	s_core_data.start_time = now;
+	s_core_data.now = now;
+
+	satellite_stats_init(&s_core_data.satellite_stats);
+	trail_init();
+}
+
+void
+consumer_core_destroy(void)
+{
+	shm_ring_stats_s stats;
+	unsigned int id;
+
+	for (id = MESSAGE_ID_UNKNOWN + 1; id < MESSAGE_ID_COUNT; id++) {
+		if (s_core_data.stats.messages[id])
+			__log(CONSUMER_LOG_INFO, "Messages %s: %u", message_schema_name(id), s_core_data.stats.messages[id]);
+	}
+	__log(CONSUMER_LOG_INFO, "Messages of unknown type: %u", s_core_data.stats.unknown_messages);
+
+	if (s_core_data.ring) {
+		shm_ring_get_stats(s_core_data.ring, &stats);
+		__log(CONSUMER_LOG_INFO, "Shared memory ring: %u records read, latency %.0f us mean, %.0f us max",
+				stats.read, stats.mean_latency_us, stats.max_latency_us);
+
+		shm_ring_close(s_core_data.ring);
+		s_core_data.ring = NULL;
+	}
+
+	trail_destroy();
+}
+
+bool
+consumer_core_subscribe(void)
+{
+	if (!s_core_data.service || !s_core_data.service->subscribe)
+		return false;
+
+	return s_core_data.service->subscribe(!s_core_data.ring_failed);
+}
+
+void
+consumer_core_handle_message(const consumer_message_s *message, double now)
+{
+	unsigned int id = __get_message_id(message);
+
+	/* Ids of a newer service, and messages without a valid type, are counted and dropped */
+	if (id == MESSAGE_ID_UNKNOWN || id >= MESSAGE_ID_COUNT) {
+		s_core_data.stats.unknown_messages++;
+		__log(CONSUMER_LOG_WARN, "Unknown message %u from %s dropped, %u so far", id,
+				message->sender ? message->sender : "?", s_core_data.stats.unknown_messages);
+		return;
+	}
+
+	s_core_data.stats.messages[id]++;
+	s_core_data.now = now;
+
+	/* Known kinds this view does not use, e.g. heartbeats, have no handler */
+	if (s_message_handlers[id])
+		s_message_handlers[id](message);
+}
+
+void
+consumer_core_set_paused(bool paused)
+{
+	unsigned int missed = s_core_data.stats.alerts - s_core_data.alerts_at_pause;
+	unsigned int i;
+
+	if (s_core_data.paused == paused)
+		return;
+
+	s_core_data.paused = paused;
+
+	if (paused) {
+		s_core_data.alerts_at_pause = s_core_data.stats.alerts;
+		return;
+	}
+
+	for (i = missed > CONSUMER_ALERT_LOG_SIZE ? missed - CONSUMER_ALERT_LOG_SIZE : 0; i < missed; i++) {
+		const hazard_zone_event_s *alert = &s_core_data.alerts[(s_core_data.alerts_at_pause + i) % CONSUMER_ALERT_LOG_SIZE];
+
+		__log(CONSUMER_LOG_INFO, "While paused: zone %u %s at %lld", alert->id,
+				hazard_zone_transition_str(alert->transition), (long long)alert->timestamp);
+	}
+}
+
+void
+consumer_core_get_stats(consumer_core_stats_s *stats)
+{
+	*stats = s_core_data.stats;
+}
+
+static void
+__log(consumer_log_level_e level, const char *format, ...)
+{
+	va_list args;
+
+	if (!s_core_data.log)
+		return;
+
+	va_start(args, format);
+	s_core_data.log(level, format, args);
+	va_end(args);
+}
+
+static void
+__update_position(const char *latitude_str, const char *longitude_str)
+{
+	double latitude = strtod(latitude_str, NULL);
+	double longitude = strtod(longitude_str, NULL);
+
+	s_core_data.stats.fixes++;
+	if (s_core_data.view && s_core_data.view->update_position)
+		s_core_data.view->update_position(longitude, latitude);
+
+	__record_first_fix(true);
+}
+
+static void
+__update_position_frame(const position_frame_s *frame, bool trail_changed)
+{
+	/* Boundary circle is centered on the first fresh fix, the service tells when it is crossed.
+	 * A stale last known position may be far from where the device is now. */
+	if (!s_core_data.has_boundary && !(frame->flags & POSITION_FRAME_FLAG_STALE)) {
+		s_core_data.has_boundary = true;
+		s_core_data.boundary_latitude = frame->latitude;
+		s_core_data.boundary_longitude = frame->longitude;
+
+		if (!__push_boundary_zone())
+			__log(CONSUMER_LOG_ERROR, "Failed to send boundary zone to gps-service");
+	}
+
+	s_core_data.stats.fixes++;
+	if (s_core_data.view && s_core_data.view->update_position)
+		s_core_data.view->update_position(frame->longitude, frame->latitude);
+
+	__record_first_fix(!(frame->flags & POSITION_FRAME_FLAG_STALE));
+
+	/* One trail redraw per message, its older frames may have changed the trail already */
+	trail_changed = __trail_frame(frame) || trail_changed;
+	if (trail_changed && s_core_data.view && s_core_data.view->update_trail)
+		s_core_data.view->update_trail();
+
+	if (frame->timestamp > s_core_data.last_fix_timestamp)
+		s_core_data.last_fix_timestamp = frame->timestamp;
+}
+
+static bool
+__trail_frame(const position_frame_s *frame)
+{
+	/* A poor fix is shown as the position, but would put a spike into the trail */
+	if (position_frame_quality(frame) == POSITION_FRAME_QUALITY_POOR)
+		return false;
+
+	return trail_append(frame->latitude, frame->longitude, frame->timestamp);
+}
+
+static void
+__update_position_batch(const void *bytes, size_t size)
+{
+	const position_frame_s *first = position_frame_decode(bytes, size);
+	const position_frame_s *last = NULL;
+	bool trail_changed = false;
+	size_t stride, offset;
+
+	if (!first) {
+		s_core_data.stats.invalid_messages++;
+		__log(CONSUMER_LOG_ERROR, "Invalid position batch");
+		return;
+	}
+
+	/* Frames are packed back to back with the sender's frame size as stride */
+	stride = first->size;
+	for (offset = 0; offset + stride <= size; offset += stride) {
+		const position_frame_s *frame = position_frame_decode((const char *)bytes + offset, size - offset);
+		if (!frame)
+			break;
+
+		/* Every fix goes into the trail, only the newest is displayed */
+		if (last && __trail_frame(last))
+			trail_changed = true;
+
+		last = frame;
+	}
+
+	__log(CONSUMER_LOG_INFO, "Received position batch of %u fixes", (unsigned int)(offset / stride));
+
+	if (last)
+		__update_position_frame(last, trail_changed);
+}
+
+static void
+__update_satellites(const char *satellites_count_str)
+{
+	if (s_core_data.view && s_core_data.view->update_satellites_count)
+		s_core_data.view->update_satellites_count(satellites_count_str);
+}
+
+static void
+__update_satellite_frame(const consumer_message_s *message, bool resync)
+{
+	satellite_stats_s *stats = &s_core_data.satellite_stats;
+	const void *bytes;
+	size_t size = 0;
+	const satellite_frame_s *frame = NULL;
+	unsigned int i;
+
+	/* Older services and the emulator send the count only */
+	if ((bytes = __get_bytes(message, SATELLITE_FRAME_KEY, &size)))
+		frame = satellite_frame_decode(bytes, size);
+
+	if (!frame)
+		return;
+
+	if (!satellite_frame_apply(frame, s_core_data.satellites, &s_core_data.satellite_count,
+			&s_core_data.satellite_sequence)) {
+		__log(CONSUMER_LOG_WARN, "Satellite delta %u does not apply", frame->sequence);
+
+		/* Missed the base of this delta - subscribing again brings a snapshot with a key frame */
+		if (resync && !consumer_core_subscribe())
+			__log(CONSUMER_LOG_ERROR, "Failed to request state snapshot");
+		return;
+	}
+
+	satellite_stats_begin(stats);
+	for (i = 0; i < s_core_data.satellite_count; i++) {
+		const satellite_entry_s *satellite = &s_core_data.satellites[i];
+
+		satellite_stats_add(stats, satellite->azimuth, satellite->elevation, satellite->snr,
+				satellite->flags & SATELLITE_ENTRY_FLAG_IN_USE);
+	}
+	satellite_stats_end(stats);
+
+	__log(CONSUMER_LOG_DEBUG, "Satellites: %u in view, %u in use, SNR %.1f (%.1f), spread %.2f (%.2f), %u octants",
+			stats->in_view, stats->in_use, stats->mean_snr, stats->window_mean_snr,
+			stats->sky_spread, stats->window_sky_spread, stats->octants);
+
+	if (satellite_stats_is_degraded(stats) != s_core_data.degraded) {
+		s_core_data.degraded = !s_core_data.degraded;
+		__log(CONSUMER_LOG_INFO, "Position fix %s", s_core_data.degraded ? "degraded" : "recovered");
+	}
+}
+
+static void
+__update_boundary_state(bool inside)
+{
+	if (s_core_data.view && s_core_data.view->update_message)
+		s_core_data.view->update_message(inside ? MESSAGE_BOUNDARY_INSIDE : MESSAGE_BOUNDARY_OUTSIDE);
+}
+
+static void
+__record_first_fix(bool live)
+{
+	double elapsed_ms = (s_core_data.now - s_core_data.start_time) * 1000.0;
+
+	/* Time to first displayed fix is a release metric - keep the log format stable */
+	if (!s_core_data.fix_displayed) {
+		s_core_data.fix_displayed = true;
+		__log(CONSUMER_LOG_INFO, "Time to first displayed fix: %.0f ms (%s)", elapsed_ms, live ? "live" : "last known");
+	}
+
+	if (live && !s_core_data.live_fix_displayed) {
+		s_core_data.live_fix_displayed = true;
+		__log(CONSUMER_LOG_INFO, "Time to first displayed live fix: %.0f ms", elapsed_ms);
+	}
+}
+
+static void
+__drain_ring(void)
+{
+	const shm_ring_record_s *record;
+	const position_frame_s *frame;
+	position_frame_s last;
+	bool has_last = false;
+	bool trail_changed = false;
+
+	if (!s_core_data.ring)
+		return;
+
+	/* Records are validated in place. Every position goes into the trail, only the newest is
+	 * kept for display. */
+	do {
+		while ((record = shm_ring_peek(s_core_data.ring))) {
+			if (record->type == SHM_RING_RECORD_POSITION) {
+				frame = position_frame_decode(record->payload, record->size);
+				if (frame) {
+					if (has_last && __trail_frame(&last))
+						trail_changed = true;
+
+					last = *frame;
+					has_last = true;
+				}
+			}
+
+			shm_ring_release(s_core_data.ring);
+		}
+	} while (!shm_ring_arm_doorbell(s_core_data.ring));
+
+	if (has_last)
+		__update_position_frame(&last, trail_changed);
+}
+
+static bool
+__push_boundary_zone(void)
+{
+	struct __attribute__((packed)) {
+		hazard_zone_list_s list;
+		hazard_zone_s zone;
+	} zones;
+	bool sent;
+
+	memset(&zones, 0, sizeof(zones));
+	hazard_zone_list_init(&zones.list, 1);
+	zones.zone.id = BOUNDARY_ZONE_ID;
+	zones.zone.type = HAZARD_ZONE_TYPE_CIRCLE;
+	zones.zone.latitude = s_core_data.boundary_latitude;
+	zones.zone.longitude = s_core_data.boundary_longitude;
+	zones.zone.radius_m = BOUNDARY_CIRCLE_RADIUS_M;
+
+	/* Map shows exactly the zones the service evaluates */
+	if (s_core_data.view && s_core_data.view->show_zones)
+		s_core_data.view->show_zones(&zones.list, sizeof(zones));
+
+	sent = s_core_data.service && s_core_data.service->set_zones &&
+			s_core_data.service->set_zones(&zones.list, sizeof(zones));
+
+	__log(CONSUMER_LOG_INFO, "Boundary zone %.1fm at %f, %f sent", BOUNDARY_CIRCLE_RADIUS_M,
+			s_core_data.boundary_longitude, s_core_data.boundary_latitude);
+
+	return sent;
+}
+
+static bool
+__request_track(int64_t from)
+{
+	if (!s_core_data.service || !s_core_data.service->request_track)
+		return false;
+
+	return s_core_data.service->request_track(from);
+}
+
+static unsigned int
+__get_message_id(const consumer_message_s *message)
+{
+	const void *bytes;
+	size_t size = 0;
+	const char *msg_type;
+
+	if ((bytes = __get_bytes(message, MESSAGE_SCHEMA_KEY, &size)))
+		return message_schema_decode(bytes, size);
+
+	/* Services built before the schema send the type string only */
+	if (!(msg_type = __get_str(message, MESSAGE_SCHEMA_TYPE_KEY)))
+		return MESSAGE_ID_UNKNOWN;
+
+	return message_schema_id_from_name(msg_type);
+}
+
+static const void *
+__get_bytes(const consumer_message_s *message, const char *key, size_t *size)
+{
+	const void *bytes = NULL;
+
+	if (!message->get_bytes || !message->get_bytes(message->data, key, &bytes, size))
+		return NULL;
+
+	return bytes;
+}
+
+static const char *
+__get_str(const consumer_message_s *message, const char *key)
+{
+	if (!message->get_str)
+		return NULL;
+
+	return message->get_str(message->data, key);
+}
+
+static void
+__handle_satellites_update(const consumer_message_s *message)
+{
+	const char *satellites_count_str = __get_str(message, MESSAGE_SATELLITES_COUNT_STR);
+
+	if (!satellites_count_str) {
+		s_core_data.stats.invalid_messages++;
+		__log(CONSUMER_LOG_ERROR, "Failed to get message: %s", MESSAGE_SATELLITES_COUNT_STR);
+		return;
+	}
+
+	__log(CONSUMER_LOG_INFO, "Received message from %s: satellites_count %s", message->sender ? message->sender : "?",
+			satellites_count_str);
+	__update_satellites(satellites_count_str);
+	__update_satellite_frame(message, true);
+}
+
+static void
+__handle_position_update(const consumer_message_s *message)
+{
+	const char *latitude_str;
+	const char *longitude_str;
+	const void *frame_bytes;
+	size_t frame_size = 0;
+	const position_frame_s *frame = NULL;
+
+	/* Prefer the binary frame - it is read in place from the message's buffer */
+	if ((frame_bytes = __get_bytes(message, POSITION_FRAME_KEY, &frame_size)))
+		frame = position_frame_decode(frame_bytes, frame_size);
+
+	if (frame) {
+		__update_position_frame(frame, false);
+		return;
+	}
+
+	/* Fall back to string keys sent by older services */
+	latitude_str = __get_str(message, MESSAGE_LATITUDE_STR);
+	longitude_str = __get_str(message, MESSAGE_LONGITUDE_STR);
+	if (!latitude_str || !longitude_str) {
+		s_core_data.stats.invalid_messages++;
+		__log(CONSUMER_LOG_ERROR, "Failed to get message: %s", latitude_str ? MESSAGE_LONGITUDE_STR : MESSAGE_LATITUDE_STR);
+		return;
+	}
+
+	__log(CONSUMER_LOG_INFO, "Received message from %s: position data: %s %s", message->sender ? message->sender : "?",
+			latitude_str, longitude_str);
+	__update_position(latitude_str, longitude_str);
+}
+
+static void
+__handle_position_batch(const consumer_message_s *message)
+{
+	const void *frame_bytes;
+	size_t frame_size = 0;
+
+	if (!(frame_bytes = __get_bytes(message, MESSAGE_POSITION_BATCH_STR, &frame_size))) {
+		s_core_data.stats.invalid_messages++;
+		__log(CONSUMER_LOG_ERROR, "Failed to get message: %s", MESSAGE_POSITION_BATCH_STR);
+		return;
+	}
+
+	__update_position_batch(frame_bytes, frame_size);
+}
+
+static void
+__handle_state_snapshot(const consumer_message_s *message)
+{
+	const char *satellites_count_str;
+	const void *frame_bytes;
+	size_t frame_size = 0;
+	const position_frame_s *frame = NULL;
+	int64_t gap_from = s_core_data.last_fix_timestamp;
+	const void *inside_bytes;
+	size_t inside_size = 0;
+	bool had_boundary = s_core_data.has_boundary;
+	bool inside = false;
+	size_t i;
+
+	__log(CONSUMER_LOG_INFO, "Received state snapshot from %s", message->sender ? message->sender : "?");
+
+	if ((satellites_count_str = __get_str(message, MESSAGE_SATELLITES_COUNT_STR)))
+		__update_satellites(satellites_count_str);
+
+	__update_satellite_frame(message, false);
+
+	/* Service may not have any position yet */
+	if ((frame_bytes = __get_bytes(message, POSITION_FRAME_KEY, &frame_size)))
+		frame = position_frame_decode(frame_bytes, frame_size);
+
+	if (frame)
+		__update_position_frame(frame, false);
+
+	/* Fixes missed while the service was unreachable are fetched from its track journal */
+	if (gap_from > 0 && frame && frame->timestamp > gap_from + 1 && !__request_track(gap_from + 1))
+		__log(CONSUMER_LOG_ERROR, "Failed to request missed track");
+
+	if (!had_boundary)
+		return;
+
+	/* Restarted service has lost the zone, pushing it again is harmless otherwise */
+	if (!__push_boundary_zone())
+		__log(CONSUMER_LOG_ERROR, "Failed to send boundary zone to gps-service");
+
+	if ((inside_bytes = __get_bytes(message, HAZARD_ZONE_INSIDE_KEY, &inside_size))) {
+		for (i = 0; i + sizeof(uint32_t) <= inside_size; i += sizeof(uint32_t)) {
+			uint32_t id;
+
+			memcpy(&id, (const char *)inside_bytes + i, sizeof(id));
+			if (id == BOUNDARY_ZONE_ID)
+				inside = true;
+		}
+	}
+
+	__update_boundary_state(inside);
+}
+
+static void
+__handle_ring_handshake(const consumer_message_s *message)
+{
+	const char *name = __get_str(message, MESSAGE_RING_NAME_STR);
+
+	/* Ring name is a secret of the service, only accept it through the trusted port */
+	if (!message->trusted) {
+		s_core_data.stats.invalid_messages++;
+		__log(CONSUMER_LOG_WARN, "Ring handshake from %s is not trusted, ignored", message->sender ? message->sender : "?");
+		return;
+	}
+
+	if (!name) {
+		s_core_data.stats.invalid_messages++;
+		__log(CONSUMER_LOG_ERROR, "Failed to get message: %s", MESSAGE_RING_NAME_STR);
+		return;
+	}
+
+	/* Always attach again, also to the same name: a restarted service creates a new object
+	 * under it and the old mapping would never see another record */
+	if (s_core_data.ring) {
+		__drain_ring();
+		shm_ring_close(s_core_data.ring);
+	}
+
+	s_core_data.ring = shm_ring_attach(name);
+
+	if (!s_core_data.ring) {
+		__log(CONSUMER_LOG_ERROR, "Failed to attach to shared memory ring %s, falling back to bundles", name);
+
+		/* Subscription without the transport makes the service send bundles again */
+		s_core_data.ring_failed = true;
+		if (!consumer_core_subscribe())
+			__log(CONSUMER_LOG_ERROR, "Failed to subscribe to gps-service");
+		return;
+	}
+
+	__log(CONSUMER_LOG_INFO, "Attached to shared memory ring %s", name);
+
+	/* Draining arms the doorbell */
+	__drain_ring();
+}
+
+static void
+__handle_ring_doorbell(const consumer_message_s *message __attribute__((unused)))
+{
+	__drain_ring();
+}
+
+static void
+__handle_power_tier(const consumer_message_s *message)
+{
+	const char *tier = __get_str(message, MESSAGE_POWER_TIER_STR);
+
+	if (!tier) {
+		s_core_data.stats.invalid_messages++;
+		__log(CONSUMER_LOG_ERROR, "Failed to get message: %s", MESSAGE_POWER_TIER_STR);
+		return;
+	}
+
+	__log(CONSUMER_LOG_INFO, "Service switched to %s power tier", tier);
+}
+
+static void
+__handle_zone_event(const consumer_message_s *message)
+{
+	hazard_zone_event_s event;
+	const void *bytes;
+	size_t size = 0;
+
+	if (!(bytes = __get_bytes(message, HAZARD_ZONE_EVENT_KEY, &size)) || size < sizeof(event)) {
+		s_core_data.stats.invalid_messages++;
+		__log(CONSUMER_LOG_ERROR, "Invalid zone event");
+		return;
+	}
+
+	memcpy(&event, bytes, sizeof(event));
+
+	s_core_data.alerts[s_core_data.stats.alerts++ % CONSUMER_ALERT_LOG_SIZE] = event;
+
+	__log(CONSUMER_LOG_INFO, "Zone %u: %s, %.1fm from center", event.id,
+			hazard_zone_transition_str(event.transition), event.distance_m);
+
+	if (event.id != BOUNDARY_ZONE_ID)
+		return;
+
+	if (event.transition == HAZARD_ZONE_ENTER)
+		__update_boundary_state(true);
+	else if (event.transition == HAZARD_ZONE_EXIT)
+		__update_boundary_state(false);
+}
+
+static void
+__handle_track(const consumer_message_s *message)
+{
+	static track_codec_point_s points[CONSUMER_TRACK_MAX_POINTS];
+	static trail_point_s trail_points[CONSUMER_TRACK_MAX_POINTS];
+	const track_codec_header_s *header = NULL;
+	const void *bytes;
+	size_t size = 0;
+	unsigned int count, trail_count = 0;
+	unsigned int i;
+
+	if ((bytes = __get_bytes(message, TRACK_CODEC_KEY, &size)))
+		header = track_codec_decode_header(bytes, size);
+
+	if (!header) {
+		s_core_data.stats.invalid_messages++;
+		__log(CONSUMER_LOG_ERROR, "Invalid track");
+		return;
+	}
+
+	count = track_codec_decode(bytes, size, points, CONSUMER_TRACK_MAX_POINTS);
+	if (count < header->count)
+		__log(CONSUMER_LOG_WARN, "Track damaged, %u of %u fixes decoded", count, header->count);
+
+	__log(CONSUMER_LOG_INFO, "Received track of %u fixes in %u bytes", count, (unsigned int)size);
+
+	if (count == 0)
+		return;
+
+	/* Fixes missed while disconnected fill the gap of the trail */
+	for (i = 0; i < count; i++) {
+		if (((points[i].flags & POSITION_FRAME_QUALITY_MASK) >> POSITION_FRAME_QUALITY_SHIFT) == POSITION_FRAME_QUALITY_POOR)
+			continue;
+
+		trail_points[trail_count].latitude = points[i].latitude;
+		trail_points[trail_count].longitude = points[i].longitude;
+		trail_points[trail_count++].timestamp = points[i].timestamp;
+	}
+
+	if (trail_merge(trail_points, trail_count) > 0 && s_core_data.view && s_core_data.view->update_trail)
+		s_core_data.view->update_trail();
+
+	/* Full message means the service has more, ask for the rest */
+	if (header->count == CONSUMER_TRACK_MAX_POINTS && !__request_track(points[count - 1].timestamp + 1))
+		__log(CONSUMER_LOG_ERROR, "Failed to request rest of the track");
+}
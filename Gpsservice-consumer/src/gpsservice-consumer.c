@@ -1,31 +1,83 @@
+#include <time.h>
 #include <tizen.h>
 #include <message_port.h>
 #include "gpsservice-consumer.h"
 #include "view_manager.h"
+#include "consumer_core.h"
 
 #define LOCAL_PORT_NAME "gps-consumer-port"
+#define SERVICE_APP_ID "org.example.gpsservice"
+#define SERVICE_CONTROL_PORT "gps-service-control-port"
+#define MESSAGE_TYPE_SUBSCRIBE "SUBSCRIBE"
+#define MESSAGE_SUBSCRIBE_PORT_STR "port"
 #define MESSAGE_TYPE_STR "msg_type"
-#define MESSAGE_TYPE_SATELLITES_UPDATE "SATELLITES_UPDATE"
-#define MESSAGE_TYPE_POSITION_UPDATE "POSITION_UPDATE"
-#define MESSAGE_SATELLITES_COUNT_STR "satellites_count"
-#define MESSAGE_LATITUDE_STR "latitude"
-#define MESSAGE_LONGITUDE_STR "longitude"
-#define MESSAGE_CONTAINS_STR "contains"
-
-static void __update_position(char *latitude_str, char *longitude_str);
-static void __update_satellites(char *satellites_count_str);
+#define MESSAGE_TYPE_SET_ZONES "SET_ZONES"
+#define MESSAGE_TYPE_GET_TRACK "GET_TRACK"
+#define MESSAGE_TRACK_FROM_STR "from"
+#define MESSAGE_SUBSCRIBE_TRANSPORT_STR "transport"
+#define TRANSPORT_SHM_RING "shm-ring"
+
+/* Read positions from the service's shared memory ring instead of bundles */
+#define USE_SHM_RING 1
+
+/* Time, CPU time and wakeups spent in one view state */
+typedef struct
+{
+	double time;
+	double cpu_time;
+	unsigned int wakeups;			/* messages handled */
+} consumer_activity_s;
+
+static struct
+{
+	/* Index 1 while paused */
+	consumer_activity_s activity[2];
+	bool paused;
+	double state_time;
+	double state_cpu_time;
+} s_consumer_data = {
+	.paused = false,
+	.state_time = 0.0,
+	.state_cpu_time = 0.0
+};
+
+static void __log(consumer_log_level_e level, const char *format, va_list args);
+static bool __get_bytes(const void *data, const char *key, const void **bytes, size_t *size);
+static const char *__get_str(const void *data, const char *key);
+static bool __set_zones(const hazard_zone_list_s *list, size_t size);
+static bool __request_track(int64_t from);
+static void __set_paused(bool paused);
+static double __cpu_time(void);
 static void __msg_port_cb(int local_port_id,
 							 const char *remote_app_id,
 							 const char *remote_port,
 							 bool trusted, bundle *message,
 							 void *user_data);
-static bool __get_error_check(bundle *message,
-								 char *msg_type,
-								 char **message_content);
+static bool __subscribe(bool shm_ring);
+
+/* Model is kept apart from the platform, these adapt it to the view and the message port */
+static const consumer_view_s s_view = {
+	.update_position = view_manager_update_map_position,
+	.update_message = view_manager_update_message,
+	.update_satellites_count = view_manager_update_satellites_count,
+	.show_zones = view_manager_show_zones,
+	.update_trail = view_manager_update_trail,
+};
+
+static const consumer_service_s s_service = {
+	.subscribe = __subscribe,
+	.set_zones = __set_zones,
+	.request_track = __request_track,
+};
 
 static bool
 __create_app(void *data)
 {
+	/* Start of the time to first displayed fix */
+	s_consumer_data.state_time = ecore_time_get();
+	s_consumer_data.state_cpu_time = __cpu_time();
+	consumer_core_init(&s_view, &s_service, __log, s_consumer_data.state_time);
+
 	/* Create GUI */
 	if (!view_manager_create_base_gui()) {
 		dlog_print(DLOG_ERROR, LOG_TAG, "Failed to create base gui");
@@ -41,6 +93,16 @@ __create_app(void *data)
 
 	dlog_print(DLOG_INFO, LOG_TAG, "Registered local port, port id: %d", local_port_id);
 
+	/* Ring handshake comes to the trusted port of the same name */
+	local_port_id = message_port_register_trusted_local_port(LOCAL_PORT_NAME, __msg_port_cb, NULL);
+	if (local_port_id < 0)
+		dlog_print(DLOG_WARN, LOG_TAG, "Failed to register trusted port, error: %d, positions come in bundles", local_port_id);
+
+	/* Subscription announces that the port is ready, the service answers with a state snapshot.
+	 * Service also delivers to this port by default, so a failed subscription is not fatal. */
+	if (!consumer_core_subscribe())
+		dlog_print(DLOG_WARN, LOG_TAG, "Failed to subscribe to gps-service");
+
 	return true;
 }
 
@@ -53,19 +115,39 @@ __control_app(app_control_h app_control, void *data)
 static void
 __pause_app(void *data)
 {
-	/* Take necessary actions when application becomes invisible. */
+	/* Messages keep coming, they only update the staged view state and the alert log */
+	__set_paused(true);
+	consumer_core_set_paused(true);
+	view_manager_set_paused(true);
 }
 
 static void
 __resume_app(void *data)
 {
-	/* Take necessary actions when application becomes visible. */
+	__set_paused(false);
+	consumer_core_set_paused(false);
+
+	/* One catch-up frame shows the final state */
+	view_manager_set_paused(false);
 }
 
 static void
 __terminate_app(void *data)
 {
 	/* Release all resources. */
+	int i;
+
+	/* Close the current state, so both have their full time */
+	__set_paused(s_consumer_data.paused);
+	for (i = 0; i < 2; i++) {
+		const consumer_activity_s *activity = &s_consumer_data.activity[i];
+
+		dlog_print(DLOG_INFO, LOG_TAG, "%s: %.0fs, CPU %.2fs (%.2f%%), %u wakeups (%.2f/s)", i ? "Paused" : "Visible",
+				activity->time, activity->cpu_time, activity->time > 0.0 ? activity->cpu_time * 100.0 / activity->time : 0.0,
+				activity->wakeups, activity->time > 0.0 ? activity->wakeups / activity->time : 0.0);
+	}
+
+	consumer_core_destroy();
 	view_manager_destroy();
 }
 
@@ -135,63 +217,149 @@ main(int argc, char *argv[])
 }
 
 static void
-__update_position(char *latitude_str, char *longitude_str)
+__log(consumer_log_level_e level, const char *format, va_list args)
 {
-	double latitude = 70;
-	double longitude = 133;
+	static const log_priority priorities[] = {
+		[CONSUMER_LOG_DEBUG] = DLOG_DEBUG,
+		[CONSUMER_LOG_INFO] = DLOG_INFO,
+		[CONSUMER_LOG_WARN] = DLOG_WARN,
+		[CONSUMER_LOG_ERROR] = DLOG_ERROR,
+	};
 
-	if (!latitude_str || !longitude_str) {
-		dlog_print(DLOG_ERROR, LOG_TAG, "Invalid parameter");
-		return;
+	dlog_vprint(priorities[level], LOG_TAG, format, args);
+}
+
+static bool
+__get_bytes(const void *data, const char *key, const void **bytes, size_t *size)
+{
+	void *value = NULL;
+
+	if (bundle_get_byte((bundle *)data, key, &value, size) != BUNDLE_ERROR_NONE)
+		return false;
+
+	*bytes = value;
+	return true;
+}
+
+static const char *
+__get_str(const void *data, const char *key)
+{
+	char *value = NULL;
+
+	if (bundle_get_str((bundle *)data, key, &value) != BUNDLE_ERROR_NONE)
+		return NULL;
+
+	return value;
+}
+
+static bool
+__set_zones(const hazard_zone_list_s *list, size_t size)
+{
+	bundle *b = bundle_create();
+	int ret;
+
+	if (!b) {
+		dlog_print(DLOG_ERROR, LOG_TAG, "Failed to create bundle");
+		return false;
 	}
 
-	latitude = strtod(latitude_str, NULL);
-	longitude = strtod(longitude_str, NULL);
+	bundle_add_str(b, MESSAGE_TYPE_STR, MESSAGE_TYPE_SET_ZONES);
+	bundle_add_byte(b, HAZARD_ZONE_KEY, list, size);
+
+	ret = message_port_send_trusted_message(SERVICE_APP_ID, SERVICE_CONTROL_PORT, b);
+
+	bundle_free(b);
 
-	view_manager_update_map_position(longitude, latitude);
+	return ret == MESSAGE_PORT_ERROR_NONE;
 }
 
-static void
-__update_satellites(char *satellites_count_str)
+static bool
+__request_track(int64_t from)
 {
-	view_manager_update_satellites_count(satellites_count_str);
+	char from_str[32];
+	bundle *b = bundle_create();
+	int ret;
+
+	if (!b) {
+		dlog_print(DLOG_ERROR, LOG_TAG, "Failed to create bundle");
+		return false;
+	}
+
+	snprintf(from_str, sizeof(from_str), "%lld", (long long)from);
+
+	bundle_add_str(b, MESSAGE_TYPE_STR, MESSAGE_TYPE_GET_TRACK);
+	bundle_add_str(b, MESSAGE_SUBSCRIBE_PORT_STR, LOCAL_PORT_NAME);
+	bundle_add_str(b, MESSAGE_TRACK_FROM_STR, from_str);
+
+	ret = message_port_send_trusted_message(SERVICE_APP_ID, SERVICE_CONTROL_PORT, b);
+
+	bundle_free(b);
+
+	return ret == MESSAGE_PORT_ERROR_NONE;
 }
 
 static void
 __msg_port_cb(int local_port_id, const char *remote_app_id, const char *remote_port, bool trusted, bundle *message, void *user_data)
 {
-	char *msg_type = NULL;
-	char *latitude_str = NULL;
-	char *longitude_str = NULL;
-	char *satellites_count_str = NULL;
+	const consumer_message_s consumer_message = {
+		.data = message,
+		.sender = remote_app_id,
+		.get_bytes = __get_bytes,
+		.get_str = __get_str,
+		.trusted = trusted,
+	};
 
-	if (!__get_error_check(message, MESSAGE_TYPE_STR, &msg_type)) {
-		return;
-	}
+	s_consumer_data.activity[s_consumer_data.paused].wakeups++;
 
-	if (!strncmp(msg_type, MESSAGE_TYPE_SATELLITES_UPDATE, strlen(msg_type))) {
-		if (!__get_error_check(message, MESSAGE_SATELLITES_COUNT_STR, &satellites_count_str)) {
-			return;
-		}
-		dlog_print(DLOG_INFO, LOG_TAG, "Received message from %s: satellites_count %s", remote_app_id, satellites_count_str);
-		__update_satellites(satellites_count_str);
-	} else if (!strncmp(msg_type, MESSAGE_TYPE_POSITION_UPDATE, strlen(msg_type))) {
-		if (!__get_error_check(message, MESSAGE_LATITUDE_STR, &latitude_str) ||
-				!__get_error_check(message, MESSAGE_LONGITUDE_STR, &longitude_str)) {
-			return;
-		}
-		dlog_print(DLOG_INFO, LOG_TAG, "Received message from %s: position data: %s %s", remote_app_id, latitude_str, longitude_str);
-		__update_position(latitude_str, longitude_str);
-	}
+	consumer_core_handle_message(&consumer_message, ecore_time_get());
+}
+
+static void
+__set_paused(bool paused)
+{
+	consumer_activity_s *activity = &s_consumer_data.activity[s_consumer_data.paused];
+	double now = ecore_time_get();
+	double cpu_time = __cpu_time();
+
+	activity->time += now - s_consumer_data.state_time;
+	activity->cpu_time += cpu_time - s_consumer_data.state_cpu_time;
+
+	s_consumer_data.state_time = now;
+	s_consumer_data.state_cpu_time = cpu_time;
+	s_consumer_data.paused = paused;
+}
+
+static double
+__cpu_time(void)
+{
+	struct timespec ts;
+
+	if (clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts) != 0)
+		return 0.0;
+
+	return ts.tv_sec + ts.tv_nsec / 1e9;
 }
 
 static bool
-__get_error_check(bundle *message, char *msg_type, char **message_content)
+__subscribe(bool shm_ring)
 {
-	if (bundle_get_str(message, msg_type, message_content) != BUNDLE_ERROR_NONE) {
-		dlog_print(DLOG_ERROR, LOG_TAG, "Failed to get message: %s", msg_type);
+	bundle *b = bundle_create();
+
+	if (!b) {
+		dlog_print(DLOG_ERROR, LOG_TAG, "Failed to create bundle");
 		return false;
 	}
 
-	return true;
+	bundle_add_str(b, MESSAGE_TYPE_STR, MESSAGE_TYPE_SUBSCRIBE);
+	bundle_add_str(b, MESSAGE_SUBSCRIBE_PORT_STR, LOCAL_PORT_NAME);
+#if USE_SHM_RING
+	if (shm_ring)
+		bundle_add_str(b, MESSAGE_SUBSCRIBE_TRANSPORT_STR, TRANSPORT_SHM_RING);
+#endif
+
+	int ret = message_port_send_trusted_message(SERVICE_APP_ID, SERVICE_CONTROL_PORT, b);
+
+	bundle_free(b);
+
+	return ret == MESSAGE_PORT_ERROR_NONE;
 }
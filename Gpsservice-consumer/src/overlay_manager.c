@@ -0,0 +1,411 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "overlay_manager.h"
+#include "geodesy.h"
+
+#define TILE_SIZE 256
+
+typedef enum
+{
+	OVERLAY_LOD_NONE = 0,
+	OVERLAY_LOD_MARKER,
+	OVERLAY_LOD_SIMPLE,
+	OVERLAY_LOD_DETAIL
+} overlay_lod_e;
+
+typedef struct
+{
+	hazard_zone_s zone;				/* first_vertex of polygons refers to vertices */
+	double min_latitude;
+	double max_latitude;
+	double min_longitude;
+	double max_longitude;
+	Elm_Map_Overlay *overlay;
+	overlay_lod_e lod;				/* of overlay */
+	bool hidden;					/* cached geometry of a zone outside the viewport */
+	unsigned int last_shown;		/* update number */
+} overlay_zone_s;
+
+static struct
+{
+	Evas_Object *map;
+	overlay_zone_s *zones;
+	unsigned int count;
+	hazard_zone_vertex_s *vertices;
+
+	Elm_Map_Overlay *markers[OVERLAY_MAX_MARKERS];		/* hidden, free for any zone */
+	unsigned int marker_count;
+	unsigned int cached;
+
+	overlay_manager_stats_s stats;
+} s_overlay_data = {
+	.map = NULL,
+	.zones = NULL,
+	.count = 0,
+	.vertices = NULL,
+	.marker_count = 0,
+	.cached = 0
+};
+
+static void __delete_overlays(void);
+static bool __viewport(double *min_latitude, double *max_latitude, double *min_longitude, double *max_longitude);
+static overlay_lod_e __zone_lod(const overlay_zone_s *zone, int zoom);
+static void __show_zone(overlay_zone_s *zone, overlay_lod_e lod, int zoom);
+static void __hide_zone(overlay_zone_s *zone);
+static void __release_zone(overlay_zone_s *zone);
+static Elm_Map_Overlay *__add_polygon(const overlay_zone_s *zone, double tolerance);
+static void __trim_cache(void);
+
+
+void
+overlay_manager_set_map(Evas_Object *map)
+{
+	if (s_overlay_data.map == map)
+		return;
+
+	__delete_overlays();
+	s_overlay_data.map = map;
+}
+
+bool
+overlay_manager_set_zones(const hazard_zone_list_s *list, size_t size)
+{
+	const hazard_zone_vertex_s *list_vertices;
+	unsigned int list_vertex_count;
+	unsigned int vertex_count = 0;
+	unsigned int i, j;
+
+	__delete_overlays();
+
+	free(s_overlay_data.zones);
+	free(s_overlay_data.vertices);
+	s_overlay_data.zones = NULL;
+	s_overlay_data.vertices = NULL;
+	s_overlay_data.count = 0;
+	s_overlay_data.stats.zones = 0;
+
+	if (list->count == 0)
+		return true;
+
+	list_vertices = hazard_zone_list_vertices(list, size, &list_vertex_count);
+
+	s_overlay_data.zones = calloc(list->count, sizeof(overlay_zone_s));
+	s_overlay_data.vertices = malloc((list_vertex_count + 1) * sizeof(hazard_zone_vertex_s));
+	if (!s_overlay_data.zones || !s_overlay_data.vertices) {
+		dlog_print(DLOG_ERROR, LOG_TAG, "Failed to allocate %u zone overlays", (unsigned int)list->count);
+		free(s_overlay_data.zones);
+		free(s_overlay_data.vertices);
+		s_overlay_data.zones = NULL;
+		s_overlay_data.vertices = NULL;
+		return false;
+	}
+
+	memcpy(s_overlay_data.vertices, list_vertices, list_vertex_count * sizeof(hazard_zone_vertex_s));
+	vertex_count = list_vertex_count;
+
+	/* Bounding boxes are computed once, culling compares only them */
+	for (i = 0; i < list->count; i++) {
+		overlay_zone_s *zone = &s_overlay_data.zones[s_overlay_data.count];
+
+		memcpy(&zone->zone, hazard_zone_list_entry(list, i), sizeof(hazard_zone_s));
+
+		if (zone->zone.type == HAZARD_ZONE_TYPE_CIRCLE && zone->zone.radius_m > 0.0f) {
+			double half_latitude = zone->zone.radius_m / GEODESY_METERS_PER_DEG;
+			double half_longitude = geodesy_longitude_span_deg(zone->zone.radius_m, zone->zone.latitude);
+
+			zone->min_latitude = zone->zone.latitude - half_latitude;
+			zone->max_latitude = zone->zone.latitude + half_latitude;
+			zone->min_longitude = zone->zone.longitude - half_longitude;
+			zone->max_longitude = zone->zone.longitude + half_longitude;
+		} else if (zone->zone.type == HAZARD_ZONE_TYPE_POLYGON && hazard_zone_polygon_valid(&zone->zone, vertex_count)) {
+			const hazard_zone_vertex_s *vertex = &s_overlay_data.vertices[zone->zone.first_vertex];
+
+			zone->min_latitude = zone->max_latitude = vertex->latitude;
+			zone->min_longitude = zone->max_longitude = vertex->longitude;
+
+			for (j = 1; j < zone->zone.vertex_count; j++) {
+				zone->min_latitude = fmin(zone->min_latitude, vertex[j].latitude);
+				zone->max_latitude = fmax(zone->max_latitude, vertex[j].latitude);
+				zone->min_longitude = fmin(zone->min_longitude, vertex[j].longitude);
+				zone->max_longitude = fmax(zone->max_longitude, vertex[j].longitude);
+			}
+
+			/* Marker of a polygon goes to the middle of its box */
+			zone->zone.latitude = (zone->min_latitude + zone->max_latitude) / 2.0;
+			zone->zone.longitude = (zone->min_longitude + zone->max_longitude) / 2.0;
+		} else {
+			dlog_print(DLOG_WARN, LOG_TAG, "Zone %u can not be displayed", zone->zone.id);
+			continue;
+		}
+
+		s_overlay_data.count++;
+	}
+
+	s_overlay_data.stats.zones = s_overlay_data.count;
+
+	return true;
+}
+
+void
+overlay_manager_update(void)
+{
+	double min_latitude, max_latitude, min_longitude, max_longitude;
+	unsigned int shown = 0;
+	unsigned int culled = 0;
+	unsigned int i;
+	int zoom;
+
+	if (!s_overlay_data.map || s_overlay_data.count == 0)
+		return;
+
+	if (!__viewport(&min_latitude, &max_latitude, &min_longitude, &max_longitude))
+		return;
+
+	zoom = elm_map_zoom_get(s_overlay_data.map);
+	s_overlay_data.stats.updates++;
+
+	for (i = 0; i < s_overlay_data.count; i++) {
+		overlay_zone_s *zone = &s_overlay_data.zones[i];
+		bool visible = zone->max_latitude >= min_latitude && zone->min_latitude <= max_latitude &&
+				zone->max_longitude >= min_longitude && zone->min_longitude <= max_longitude;
+
+		if (!visible || shown >= OVERLAY_MAX_SHOWN) {
+			culled += !visible;
+			if (zone->overlay && !zone->hidden)
+				__hide_zone(zone);
+			continue;
+		}
+
+		__show_zone(zone, __zone_lod(zone, zoom), zoom);
+		if (zone->overlay)
+			shown++;
+	}
+
+	__trim_cache();
+
+	s_overlay_data.stats.shown = shown;
+	s_overlay_data.stats.culled = culled;
+}
+
+void
+overlay_manager_destroy(void)
+{
+	__delete_overlays();
+
+	free(s_overlay_data.zones);
+	free(s_overlay_data.vertices);
+
+	s_overlay_data.map = NULL;
+	s_overlay_data.zones = NULL;
+	s_overlay_data.vertices = NULL;
+	s_overlay_data.count = 0;
+}
+
+void
+overlay_manager_get_stats(overlay_manager_stats_s *stats)
+{
+	*stats = s_overlay_data.stats;
+}
+
+static void
+__delete_overlays(void)
+{
+	unsigned int i;
+
+	for (i = 0; i < s_overlay_data.count; i++) {
+		if (s_overlay_data.zones[i].overlay) {
+			elm_map_overlay_del(s_overlay_data.zones[i].overlay);
+			s_overlay_data.stats.deleted++;
+		}
+
+		s_overlay_data.zones[i].overlay = NULL;
+		s_overlay_data.zones[i].lod = OVERLAY_LOD_NONE;
+		s_overlay_data.zones[i].hidden = false;
+	}
+
+	for (i = 0; i < s_overlay_data.marker_count; i++)
+		elm_map_overlay_del(s_overlay_data.markers[i]);
+
+	s_overlay_data.stats.deleted += s_overlay_data.marker_count;
+	s_overlay_data.marker_count = 0;
+	s_overlay_data.cached = 0;
+}
+
+static bool
+__viewport(double *min_latitude, double *max_latitude, double *min_longitude, double *max_longitude)
+{
+	Evas_Coord x, y, w, h;
+	Evas_Coord margin_x, margin_y;
+	double longitude1, latitude1, longitude2, latitude2;
+
+	evas_object_geometry_get(s_overlay_data.map, &x, &y, &w, &h);
+	if (w <= 0 || h <= 0)
+		return false;
+
+	margin_x = (Evas_Coord)(w * OVERLAY_VIEWPORT_MARGIN);
+	margin_y = (Evas_Coord)(h * OVERLAY_VIEWPORT_MARGIN);
+
+	elm_map_canvas_to_region_convert(s_overlay_data.map, x - margin_x, y - margin_y, &longitude1, &latitude1);
+	elm_map_canvas_to_region_convert(s_overlay_data.map, x + w + margin_x, y + h + margin_y, &longitude2, &latitude2);
+
+	*min_latitude = fmin(latitude1, latitude2);
+	*max_latitude = fmax(latitude1, latitude2);
+	*min_longitude = fmin(longitude1, longitude2);
+	*max_longitude = fmax(longitude1, longitude2);
+
+	return true;
+}
+
+static overlay_lod_e
+__zone_lod(const overlay_zone_s *zone, int zoom)
+{
+	if (zoom < OVERLAY_SIMPLE_ZOOM)
+		return OVERLAY_LOD_MARKER;
+
+	/* A circle has no simpler geometry */
+	if (zoom >= OVERLAY_DETAIL_ZOOM || zone->zone.type == HAZARD_ZONE_TYPE_CIRCLE)
+		return OVERLAY_LOD_DETAIL;
+
+	return OVERLAY_LOD_SIMPLE;
+}
+
+static void
+__show_zone(overlay_zone_s *zone, overlay_lod_e lod, int zoom)
+{
+	zone->last_shown = s_overlay_data.stats.updates;
+
+	if (zone->overlay && zone->lod != lod)
+		__release_zone(zone);
+
+	if (zone->overlay) {
+		if (zone->hidden) {
+			elm_map_overlay_hide_set(zone->overlay, EINA_FALSE);
+			zone->hidden = false;
+			s_overlay_data.cached--;
+			s_overlay_data.stats.recycled++;
+		}
+		return;
+	}
+
+	if (lod == OVERLAY_LOD_MARKER && s_overlay_data.marker_count > 0) {
+		zone->overlay = s_overlay_data.markers[--s_overlay_data.marker_count];
+		elm_map_overlay_region_set(zone->overlay, zone->zone.longitude, zone->zone.latitude);
+		elm_map_overlay_hide_set(zone->overlay, EINA_FALSE);
+		zone->lod = lod;
+		s_overlay_data.stats.recycled++;
+		return;
+	}
+
+	if (lod == OVERLAY_LOD_MARKER) {
+		zone->overlay = elm_map_overlay_add(s_overlay_data.map, zone->zone.longitude, zone->zone.latitude);
+	} else if (zone->zone.type == HAZARD_ZONE_TYPE_CIRCLE) {
+		/* Radius of elm_map circle overlays is in map units, degrees of longitude, which shrink away from the equator */
+		zone->overlay = elm_map_overlay_circle_add(s_overlay_data.map, zone->zone.longitude, zone->zone.latitude,
+				geodesy_longitude_span_deg(zone->zone.radius_m, zone->zone.latitude));
+	} else {
+		/* Degrees covered by one pixel at this zoom */
+		double tolerance = lod == OVERLAY_LOD_SIMPLE ? OVERLAY_SIMPLIFY_PX * 360.0 / ((double)TILE_SIZE * (1 << zoom)) : 0.0;
+
+		zone->overlay = __add_polygon(zone, tolerance);
+	}
+
+	if (!zone->overlay) {
+		dlog_print(DLOG_ERROR, LOG_TAG, "Failed to create overlay of zone %u", zone->zone.id);
+		return;
+	}
+
+	zone->lod = lod;
+	s_overlay_data.stats.created++;
+}
+
+static void
+__hide_zone(overlay_zone_s *zone)
+{
+	/* Markers are all the same, any zone can take one over */
+	if (zone->lod == OVERLAY_LOD_MARKER) {
+		__release_zone(zone);
+		return;
+	}
+
+	elm_map_overlay_hide_set(zone->overlay, EINA_TRUE);
+	zone->hidden = true;
+	s_overlay_data.cached++;
+}
+
+static void
+__release_zone(overlay_zone_s *zone)
+{
+	if (zone->lod == OVERLAY_LOD_MARKER && s_overlay_data.marker_count < OVERLAY_MAX_MARKERS) {
+		elm_map_overlay_hide_set(zone->overlay, EINA_TRUE);
+		s_overlay_data.markers[s_overlay_data.marker_count++] = zone->overlay;
+	} else {
+		elm_map_overlay_del(zone->overlay);
+		s_overlay_data.stats.deleted++;
+	}
+
+	if (zone->hidden)
+		s_overlay_data.cached--;
+
+	zone->overlay = NULL;
+	zone->lod = OVERLAY_LOD_NONE;
+	zone->hidden = false;
+}
+
+static Elm_Map_Overlay *
+__add_polygon(const overlay_zone_s *zone, double tolerance)
+{
+	const hazard_zone_vertex_s *vertices = &s_overlay_data.vertices[zone->zone.first_vertex];
+	unsigned int count = zone->zone.vertex_count;
+	Elm_Map_Overlay *overlay = elm_map_overlay_polygon_add(s_overlay_data.map);
+	unsigned int kept = 0;
+	unsigned int last = 0;
+	unsigned int i;
+
+	if (!overlay)
+		return NULL;
+
+	/* Vertices closer than the tolerance to the last kept one are dropped,
+	 * a polygon that would collapse keeps all of them */
+	for (i = 0; i < count; i++) {
+		if (i > 0 && fabs(vertices[i].latitude - vertices[last].latitude) < tolerance &&
+				fabs(vertices[i].longitude - vertices[last].longitude) < tolerance)
+			continue;
+
+		last = i;
+		kept++;
+	}
+
+	for (i = 0, last = 0; i < count; i++) {
+		if (kept >= 3 && i > 0 && fabs(vertices[i].latitude - vertices[last].latitude) < tolerance &&
+				fabs(vertices[i].longitude - vertices[last].longitude) < tolerance)
+			continue;
+
+		last = i;
+		elm_map_overlay_polygon_region_add(overlay, vertices[i].longitude, vertices[i].latitude);
+	}
+
+	return overlay;
+}
+
+static void
+__trim_cache(void)
+{
+	/* Hidden geometry not shown for the longest time is deleted first */
+	while (s_overlay_data.cached > OVERLAY_MAX_CACHED) {
+		overlay_zone_s *oldest = NULL;
+		unsigned int i;
+
+		for (i = 0; i < s_overlay_data.count; i++) {
+			overlay_zone_s *zone = &s_overlay_data.zones[i];
+
+			if (zone->hidden && (!oldest || zone->last_shown < oldest->last_shown))
+				oldest = zone;
+		}
+
+		if (!oldest)
+			break;
+
+		__release_zone(oldest);
+	}
+}
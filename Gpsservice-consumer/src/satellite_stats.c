@@ -0,0 +1,97 @@
+#include <math.h>
+#include <string.h>
+#include "satellite_stats.h"
+
+#define DEG_TO_RAD (M_PI / 180.0)
+
+static double __window_add(double *ring, double *sum, unsigned int head, unsigned int count, double value);
+
+
+void
+satellite_stats_init(satellite_stats_s *stats)
+{
+	memset(stats, 0, sizeof(*stats));
+}
+
+void
+satellite_stats_begin(satellite_stats_s *stats)
+{
+	stats->acc_in_view = 0;
+	stats->acc_in_use = 0;
+	stats->acc_with_signal = 0;
+	stats->acc_octants = 0;
+	stats->acc_snr = 0.0;
+	stats->acc_east = 0.0;
+	stats->acc_north = 0.0;
+	stats->acc_weight = 0.0;
+}
+
+void
+satellite_stats_add(satellite_stats_s *stats, unsigned int azimuth, unsigned int elevation, int snr, bool in_use)
+{
+	stats->acc_in_view++;
+
+	if (snr > 0) {
+		stats->acc_with_signal++;
+		stats->acc_snr += snr;
+	}
+
+	if (in_use) {
+		double weight = cos((elevation > 90 ? 90 : elevation) * DEG_TO_RAD);
+
+		stats->acc_in_use++;
+		stats->acc_octants |= 1u << ((azimuth % 360) / 45);
+		stats->acc_east += weight * sin(azimuth * DEG_TO_RAD);
+		stats->acc_north += weight * cos(azimuth * DEG_TO_RAD);
+		stats->acc_weight += weight;
+	}
+}
+
+void
+satellite_stats_end(satellite_stats_s *stats)
+{
+	unsigned int octants = stats->acc_octants;
+	unsigned int count;
+
+	stats->in_view = stats->acc_in_view;
+	stats->in_use = stats->acc_in_use;
+	stats->mean_snr = stats->acc_with_signal ? stats->acc_snr / stats->acc_with_signal : 0.0;
+	stats->in_use_ratio = stats->acc_in_view ? (double)stats->acc_in_use / stats->acc_in_view : 0.0;
+
+	/* Satellites at zenith have no direction and do not change the spread */
+	stats->sky_spread = stats->acc_weight > 0.0 ?
+			1.0 - sqrt(stats->acc_east * stats->acc_east + stats->acc_north * stats->acc_north) / stats->acc_weight : 0.0;
+
+	for (stats->octants = 0; octants; octants &= octants - 1)
+		stats->octants++;
+
+	count = stats->window_count < SATELLITE_STATS_WINDOW ? ++stats->window_count : SATELLITE_STATS_WINDOW;
+
+	stats->window_mean_snr = __window_add(stats->ring_snr, &stats->sum_snr, stats->ring_head, count, stats->mean_snr);
+	stats->window_in_use_ratio = __window_add(stats->ring_ratio, &stats->sum_ratio, stats->ring_head, count, stats->in_use_ratio);
+	stats->window_sky_spread = __window_add(stats->ring_spread, &stats->sum_spread, stats->ring_head, count, stats->sky_spread);
+
+	stats->ring_head = (stats->ring_head + 1) % SATELLITE_STATS_WINDOW;
+	stats->updates++;
+}
+
+bool
+satellite_stats_is_degraded(const satellite_stats_s *stats)
+{
+	if (stats->window_count == 0)
+		return false;
+
+	return stats->window_mean_snr < SATELLITE_STATS_DEGRADED_SNR ||
+			stats->in_use < SATELLITE_STATS_MIN_IN_USE ||
+			stats->window_sky_spread < SATELLITE_STATS_DEGRADED_SPREAD;
+}
+
+static double
+__window_add(double *ring, double *sum, unsigned int head, unsigned int count, double value)
+{
+	/* Slot at head is the oldest value, or 0 while the window is filling */
+	*sum += value - ring[head];
+	ring[head] = value;
+
+	return *sum / count;
+}
@@ -0,0 +1,500 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "trail.h"
+
+#define METERS_PER_DEG 111195.0
+#define MIN_COS_LATITUDE 0.01
+#define TRAIL_INITIAL_CAPACITY 1024
+
+typedef struct
+{
+	uint32_t *vertices;				/* ids of kept fixes, ascending */
+	unsigned int count;
+	unsigned int capacity;
+
+	/* Sleeve from the last kept vertex, directions relative to reference */
+	double anchor_x;
+	double anchor_y;
+	double candidate_x;
+	double candidate_y;
+	uint32_t candidate;
+	double reach;					/* distance of the furthest fix from the anchor */
+	double reference;
+	double low;
+	double high;
+	bool has_anchor;
+	bool has_candidate;
+} trail_level_s;
+
+typedef struct
+{
+	trail_point_s *vertices;
+	unsigned int skip;
+	unsigned int max_vertices;
+	unsigned int position;
+	unsigned int written;
+} trail_output_s;
+
+static struct
+{
+	trail_point_s *points;
+	unsigned int count;
+	unsigned int capacity;
+	uint32_t base;					/* id of points[0], ids are never reused */
+
+	double reference_latitude;
+	double reference_longitude;
+	double cos_latitude;
+
+	trail_level_s levels[TRAIL_LEVELS];
+} s_trail_data = {
+	.points = NULL,
+	.count = 0,
+	.capacity = 0,
+	.base = 0
+};
+
+static bool __store(double latitude, double longitude, int64_t timestamp);
+static void __drop_oldest(void);
+static void __project(const trail_point_s *point, double *x, double *y);
+static void __feed_levels(uint32_t id, double x, double y);
+static void __feed(unsigned int level, uint32_t id, double x, double y);
+static void __keep(unsigned int level, uint32_t id);
+static void __reset_levels(void);
+static void __rebuild(void);
+static unsigned int __first_after(const trail_level_s *level, uint32_t id);
+static unsigned int __polyline_count(unsigned int level);
+static unsigned int __polyline(unsigned int level, trail_point_s *vertices, unsigned int skip, unsigned int max_vertices);
+static void __emit(trail_output_s *output, uint32_t id);
+static double __wrap(double angle);
+
+
+void
+trail_init(void)
+{
+	s_trail_data.count = 0;
+	s_trail_data.base = 0;
+	__reset_levels();
+}
+
+void
+trail_destroy(void)
+{
+	unsigned int i;
+
+	free(s_trail_data.points);
+	s_trail_data.points = NULL;
+	s_trail_data.count = 0;
+	s_trail_data.capacity = 0;
+
+	for (i = 0; i < TRAIL_LEVELS; i++) {
+		free(s_trail_data.levels[i].vertices);
+		s_trail_data.levels[i].vertices = NULL;
+		s_trail_data.levels[i].count = 0;
+		s_trail_data.levels[i].capacity = 0;
+	}
+}
+
+bool
+trail_append(double latitude, double longitude, int64_t timestamp)
+{
+	double x, y;
+
+	if (s_trail_data.count > 0 && timestamp <= s_trail_data.points[s_trail_data.count - 1].timestamp)
+		return false;
+
+	if (!__store(latitude, longitude, timestamp))
+		return false;
+
+	__project(&s_trail_data.points[s_trail_data.count - 1], &x, &y);
+	__feed_levels(s_trail_data.base + s_trail_data.count - 1, x, y);
+
+	return true;
+}
+
+unsigned int
+trail_merge(const trail_point_s *points, unsigned int count)
+{
+	trail_point_s *newer = NULL;
+	unsigned int newer_count = 0;
+	unsigned int added = 0;
+	unsigned int low = 0, high = s_trail_data.count;
+	unsigned int i = 0, j = 0;
+
+	if (count == 0)
+		return 0;
+
+	/* Fixes newer than the merged ones are moved aside and stored again after them */
+	while (low < high) {
+		unsigned int middle = (low + high) / 2;
+
+		if (s_trail_data.points[middle].timestamp < points[0].timestamp)
+			low = middle + 1;
+		else
+			high = middle;
+	}
+
+	newer_count = s_trail_data.count - low;
+	if (newer_count > 0) {
+		newer = malloc(newer_count * sizeof(trail_point_s));
+		if (!newer)
+			return 0;
+
+		memcpy(newer, &s_trail_data.points[low], newer_count * sizeof(trail_point_s));
+		s_trail_data.count = low;
+	}
+
+	while (i < count || j < newer_count) {
+		bool take_new = j >= newer_count || (i < count && points[i].timestamp < newer[j].timestamp);
+		const trail_point_s *point = take_new ? &points[i++] : &newer[j++];
+
+		if (s_trail_data.count > 0 && point->timestamp <= s_trail_data.points[s_trail_data.count - 1].timestamp)
+			continue;
+
+		if (!__store(point->latitude, point->longitude, point->timestamp))
+			break;
+
+		added += take_new;
+	}
+
+	free(newer);
+
+	/* Vertices after the merged fixes are no longer valid, rare enough to start over */
+	__rebuild();
+
+	return added;
+}
+
+unsigned int
+trail_get_count(void)
+{
+	return s_trail_data.count;
+}
+
+unsigned int
+trail_select_level(double tolerance_m, unsigned int max_vertices)
+{
+	unsigned int level = 0;
+
+	/* Level l is within 2 * TRAIL_TOLERANCE_M * 2^l of the track */
+	while (level + 1 < TRAIL_LEVELS && 2.0 * TRAIL_TOLERANCE_M * (1 << (level + 1)) <= tolerance_m)
+		level++;
+
+	while (level + 1 < TRAIL_LEVELS && __polyline_count(level) > max_vertices)
+		level++;
+
+	return level;
+}
+
+unsigned int
+trail_get_vertices(unsigned int level, trail_point_s *vertices, unsigned int max_vertices)
+{
+	unsigned int total, skip = 0;
+	unsigned int step = max_vertices / 4 > 0 ? max_vertices / 4 : 1;
+
+	if (level >= TRAIL_LEVELS || max_vertices == 0)
+		return 0;
+
+	total = __polyline_count(level);
+	if (total > max_vertices)
+		skip = (total - max_vertices + step - 1) / step * step;
+
+	return __polyline(level, vertices, skip, max_vertices);
+}
+
+static bool
+__store(double latitude, double longitude, int64_t timestamp)
+{
+	trail_point_s *point;
+
+	if (s_trail_data.count == TRAIL_MAX_POINTS)
+		__drop_oldest();
+
+	if (s_trail_data.count == s_trail_data.capacity) {
+		unsigned int capacity = s_trail_data.capacity ? s_trail_data.capacity * 2 : TRAIL_INITIAL_CAPACITY;
+		trail_point_s *points = realloc(s_trail_data.points, capacity * sizeof(trail_point_s));
+
+		if (!points)
+			return false;
+
+		s_trail_data.points = points;
+		s_trail_data.capacity = capacity;
+	}
+
+	/* Projection is centered on the first fix ever stored */
+	if (s_trail_data.count == 0 && s_trail_data.base == 0) {
+		s_trail_data.reference_latitude = latitude;
+		s_trail_data.reference_longitude = longitude;
+		s_trail_data.cos_latitude = fmax(cos(latitude * M_PI / 180.0), MIN_COS_LATITUDE);
+	}
+
+	point = &s_trail_data.points[s_trail_data.count++];
+	point->latitude = latitude;
+	point->longitude = longitude;
+	point->timestamp = timestamp;
+
+	return true;
+}
+
+static void
+__drop_oldest(void)
+{
+	unsigned int drop = TRAIL_MAX_POINTS / 4;
+	unsigned int i;
+
+	memmove(s_trail_data.points, &s_trail_data.points[drop], (s_trail_data.count - drop) * sizeof(trail_point_s));
+	s_trail_data.count -= drop;
+	s_trail_data.base += drop;
+
+	/* Sleeves keep their coordinates, only the vertex lists refer to dropped fixes.
+	 * The oldest fix left takes the place of the last dropped vertex, so every level still starts at it. */
+	for (i = 0; i < TRAIL_LEVELS; i++) {
+		trail_level_s *level = &s_trail_data.levels[i];
+		unsigned int first = __first_after(level, s_trail_data.base - 1);
+
+		if (first > 0 && (first == level->count || level->vertices[first] != s_trail_data.base))
+			level->vertices[--first] = s_trail_data.base;
+
+		memmove(level->vertices, &level->vertices[first], (level->count - first) * sizeof(uint32_t));
+		level->count -= first;
+	}
+}
+
+static void
+__project(const trail_point_s *point, double *x, double *y)
+{
+	*x = (point->longitude - s_trail_data.reference_longitude) * s_trail_data.cos_latitude * METERS_PER_DEG;
+	*y = (point->latitude - s_trail_data.reference_latitude) * METERS_PER_DEG;
+}
+
+static void
+__feed_levels(uint32_t id, double x, double y)
+{
+	unsigned int i;
+
+	/* Every level simplifies the full track. Simplifying the vertices of the level below would
+	 * add up the tolerances of all finer levels. */
+	for (i = 0; i < TRAIL_LEVELS; i++)
+		__feed(i, id, x, y);
+}
+
+static void
+__feed(unsigned int level_index, uint32_t id, double x, double y)
+{
+	trail_level_s *level = &s_trail_data.levels[level_index];
+	double tolerance = TRAIL_TOLERANCE_M * (1 << level_index);
+	double dx, dy, distance, direction, spread;
+
+	if (!level->has_anchor) {
+		level->anchor_x = x;
+		level->anchor_y = y;
+		level->has_anchor = true;
+		__keep(level_index, id);
+		return;
+	}
+
+	dx = x - level->anchor_x;
+	dy = y - level->anchor_y;
+	distance = hypot(dx, dy);
+
+	/* Too close to the anchor to change the shape */
+	if (distance <= tolerance)
+		return;
+
+	direction = atan2(dy, dx);
+	spread = asin(tolerance / distance);
+
+	if (level->has_candidate) {
+		double angle = __wrap(direction - level->reference);
+
+		/* Line from the anchor to this fix still passes all skipped ones and does not end
+		 * short of them - it becomes the candidate */
+		if (angle >= level->low && angle <= level->high && distance >= level->reach - tolerance) {
+			level->low = fmax(level->low, angle - spread);
+			level->high = fmin(level->high, angle + spread);
+			level->reach = fmax(level->reach, distance);
+			level->candidate = id;
+			level->candidate_x = x;
+			level->candidate_y = y;
+			return;
+		}
+
+		/* Fix leaves the sleeve, the candidate is kept and anchors a new one */
+		level->anchor_x = level->candidate_x;
+		level->anchor_y = level->candidate_y;
+		level->has_candidate = false;
+		__keep(level_index, level->candidate);
+
+		dx = x - level->anchor_x;
+		dy = y - level->anchor_y;
+		distance = hypot(dx, dy);
+		if (distance <= tolerance)
+			return;
+
+		direction = atan2(dy, dx);
+		spread = asin(tolerance / distance);
+	}
+
+	level->reach = distance;
+	level->reference = direction;
+	level->low = -spread;
+	level->high = spread;
+	level->candidate = id;
+	level->candidate_x = x;
+	level->candidate_y = y;
+	level->has_candidate = true;
+}
+
+static void
+__keep(unsigned int level_index, uint32_t id)
+{
+	trail_level_s *level = &s_trail_data.levels[level_index];
+
+	if (level->count == level->capacity) {
+		unsigned int capacity = level->capacity ? level->capacity * 2 : TRAIL_INITIAL_CAPACITY;
+		uint32_t *vertices = realloc(level->vertices, capacity * sizeof(uint32_t));
+
+		/* Without memory the level misses a vertex and is a little coarser */
+		if (!vertices)
+			return;
+
+		level->vertices = vertices;
+		level->capacity = capacity;
+	}
+
+	/* Candidate of a sleeve may be older than the dropped fixes */
+	if (id >= s_trail_data.base)
+		level->vertices[level->count++] = id;
+}
+
+static void
+__reset_levels(void)
+{
+	unsigned int i;
+
+	for (i = 0; i < TRAIL_LEVELS; i++) {
+		s_trail_data.levels[i].count = 0;
+		s_trail_data.levels[i].has_anchor = false;
+		s_trail_data.levels[i].has_candidate = false;
+	}
+}
+
+static void
+__rebuild(void)
+{
+	unsigned int i;
+
+	__reset_levels();
+
+	for (i = 0; i < s_trail_data.count; i++) {
+		double x, y;
+
+		__project(&s_trail_data.points[i], &x, &y);
+		__feed_levels(s_trail_data.base + i, x, y);
+	}
+}
+
+static unsigned int
+__first_after(const trail_level_s *level, uint32_t id)
+{
+	unsigned int low = 0, high = level->count;
+
+	while (low < high) {
+		unsigned int middle = (low + high) / 2;
+
+		if (level->vertices[middle] <= id)
+			low = middle + 1;
+		else
+			high = middle;
+	}
+
+	return low;
+}
+
+static unsigned int
+__polyline_count(unsigned int level_index)
+{
+	const trail_level_s *level = &s_trail_data.levels[level_index];
+	unsigned int count = level->count;
+	uint32_t last;
+	int l;
+
+	if (s_trail_data.count == 0)
+		return 0;
+
+	/* Same walk as __polyline, but the vertex lists are only searched */
+	last = level->count > 0 ? level->vertices[level->count - 1] : s_trail_data.base - 1;
+
+	for (l = (int)level_index - 1; l >= 0; l--) {
+		const trail_level_s *finer = &s_trail_data.levels[l];
+		unsigned int start = __first_after(finer, last);
+
+		count += finer->count - start;
+		if (finer->count > start)
+			last = finer->vertices[finer->count - 1];
+	}
+
+	return count + (last != s_trail_data.base + s_trail_data.count - 1);
+}
+
+static unsigned int
+__polyline(unsigned int level_index, trail_point_s *vertices, unsigned int skip, unsigned int max_vertices)
+{
+	const trail_level_s *level = &s_trail_data.levels[level_index];
+	trail_output_s output = {vertices, skip, max_vertices, 0, 0};
+	uint32_t newest = s_trail_data.base + s_trail_data.count - 1;
+	uint32_t last;
+	unsigned int i, start;
+	int l;
+
+	if (s_trail_data.count == 0)
+		return 0;
+
+	/* Skipped vertices of the level are not visited */
+	output.position = skip < level->count ? skip : level->count;
+	for (i = output.position; i < level->count; i++)
+		__emit(&output, level->vertices[i]);
+
+	/* Newest part is not decided at this level yet, finer levels have it */
+	last = level->count > 0 ? level->vertices[level->count - 1] : s_trail_data.base - 1;
+
+	for (l = (int)level_index - 1; l >= 0; l--) {
+		const trail_level_s *finer = &s_trail_data.levels[l];
+
+		start = __first_after(finer, last);
+		for (i = start; i < finer->count; i++)
+			__emit(&output, finer->vertices[i]);
+
+		if (finer->count > start)
+			last = finer->vertices[finer->count - 1];
+	}
+
+	if (last != newest)
+		__emit(&output, newest);
+
+	return output.written;
+}
+
+static void
+__emit(trail_output_s *output, uint32_t id)
+{
+	if (output->position++ < output->skip || output->written >= output->max_vertices)
+		return;
+
+	if (output->vertices)
+		output->vertices[output->written] = s_trail_data.points[id - s_trail_data.base];
+
+	output->written++;
+}
+
+static double
+__wrap(double angle)
+{
+	while (angle > M_PI)
+		angle -= 2.0 * M_PI;
+	while (angle <= -M_PI)
+		angle += 2.0 * M_PI;
+
+	return angle;
+}
@@ -1,20 +1,26 @@
+#include <math.h>
 #include <tizen.h>
-#include <locations.h>
 #include "view_manager.h"
+#include "overlay_manager.h"
+#include "trail.h"
 #include "../res/edje/edje_def.h"
 
 #define LATITUDE_TEXT "Lat:"
 #define LONGITUDE_TEXT "Long:"
 #define LABEL_WAITING_TEXT "Waiting for data from GPS service..."
 
-#define MESSAGE_BOUNDARY_OUTSIDE "Boundary area exceeded"
-#define MESSAGE_BOUNDARY_INSIDE "Inside boundary area"
-
-#define BOUNDARY_CIRCLE_RADIUS_M 30.0 /* m */
-#define BOUNDARY_CIRCLE_RADIUS_REL 0.0002604 /* 30m */
 #define ZOOM_LEVEL 18 /*maximum supported zoom level */
 
 #define CHAR_BUF_SIZE 20
+#define MESSAGE_BUF_SIZE 64
+
+/* Camera stays still while the marker is inside the map shrunk by this fraction at each edge */
+#define VIEWPORT_DEAD_ZONE 0.25
+
+/* Trail is drawn as line overlays within this many pixels of the track */
+#define TRAIL_TOLERANCE_PX 2.0
+#define TRAIL_MAX_VERTICES 256
+#define METERS_PER_PIXEL_ZOOM_0 156543.03	/* at the equator */
 
 static struct
 {
@@ -25,9 +31,38 @@ static struct
 	Evas_Object *map;
 
 	Elm_Map_Overlay *pos_overlay;
-	Elm_Map_Overlay *boundary_overlay;
-
-	location_bounds_h bounds;
+	Ecore_Animator *animator;
+
+	/* Trail vertices drawn and the line overlays between them */
+	trail_point_s trail_shown[TRAIL_MAX_VERTICES];
+	Elm_Map_Overlay *trail_lines[TRAIL_MAX_VERTICES];
+	unsigned int trail_count;
+
+	/* Newest state staged by the update functions, applied once per rendered frame */
+	double pending_longitude;
+	double pending_latitude;
+	bool position_pending;
+	char pending_message[MESSAGE_BUF_SIZE];
+	bool message_pending;
+	char pending_satellites[CHAR_BUF_SIZE];
+	bool satellites_pending;
+	bool zones_pending;				/* zones or the viewport changed */
+	bool trail_pending;				/* trail or the zoom changed */
+	bool paused;					/* window hidden, staged updates wait for resume */
+	bool catch_up;					/* next frame is the first after resume */
+
+	/* Texts currently shown, unchanged parts are not set again */
+	char shown_latitude[CHAR_BUF_SIZE];
+	char shown_longitude[CHAR_BUF_SIZE];
+	char shown_message[MESSAGE_BUF_SIZE];
+	char shown_satellites[CHAR_BUF_SIZE];
+
+	unsigned int staged_updates;
+	unsigned int applied_frames;
+	unsigned int camera_moves;
+	unsigned int trail_lines_added;
+	unsigned int paused_updates;
+	unsigned int catch_up_frames;
 } s_view_data = {
 	.win = NULL,
 	.layout = NULL,
@@ -36,7 +71,23 @@ static struct
 	.map = NULL,
 
 	.pos_overlay = NULL,
-	.boundary_overlay = NULL
+	.animator = NULL,
+	.trail_count = 0,
+
+	.position_pending = false,
+	.message_pending = false,
+	.satellites_pending = false,
+	.zones_pending = false,
+	.trail_pending = false,
+	.paused = false,
+	.catch_up = false,
+
+	.staged_updates = 0,
+	.applied_frames = 0,
+	.camera_moves = 0,
+	.trail_lines_added = 0,
+	.paused_updates = 0,
+	.catch_up_frames = 0
 };
 
 static void __delete_win_request_cb(void *data,
@@ -47,6 +98,15 @@ static void __get_app_resource(const char *edj_file_in,
 									char *edj_path_out,
 									int edj_path_max);
 static Evas_Object *__create_map(Evas_Object *parent);
+static void __map_moved_cb(void *data, Evas_Object *obj, void *event_info);
+static void __map_zoomed_cb(void *data, Evas_Object *obj, void *event_info);
+static void __schedule_apply(void);
+static Eina_Bool __apply_cb(void *data);
+static void __apply_position(double longitude, double latitude);
+static void __follow_position(double longitude, double latitude, bool first);
+static void __apply_trail(void);
+static void __delete_trail(unsigned int from);
+static void __set_text(const char *part, char *shown, size_t shown_size, const char *text);
 
 bool
 view_manager_create_base_gui(void)
@@ -95,10 +155,10 @@ view_manager_create_base_gui(void)
 		return false;
 	}
 
-	elm_object_part_text_set(s_view_data.layout, LAYOUT_PART_SATELLITE_TEXT, "");
-	elm_object_part_text_set(s_view_data.layout, LAYOUT_PART_LATITUDE_TEXT, LATITUDE_TEXT);
-	elm_object_part_text_set(s_view_data.layout, LAYOUT_PART_LONGITUDE_TEXT, LONGITUDE_TEXT);
-	elm_object_part_text_set(s_view_data.layout, LAYOUT_PART_MESSAGE_TEXT, "");
+	__set_text(LAYOUT_PART_SATELLITE_TEXT, s_view_data.shown_satellites, CHAR_BUF_SIZE, "");
+	__set_text(LAYOUT_PART_LATITUDE_TEXT, s_view_data.shown_latitude, CHAR_BUF_SIZE, LATITUDE_TEXT);
+	__set_text(LAYOUT_PART_LONGITUDE_TEXT, s_view_data.shown_longitude, CHAR_BUF_SIZE, LONGITUDE_TEXT);
+	__set_text(LAYOUT_PART_MESSAGE_TEXT, s_view_data.shown_message, MESSAGE_BUF_SIZE, "");
 
 	/* Map box */
 	s_view_data.box = elm_box_add(s_view_data.win);
@@ -137,8 +197,28 @@ view_manager_create_base_gui(void)
 void
 view_manager_destroy(void)
 {
+	overlay_manager_stats_s overlays;
+
+	if (s_view_data.animator) {
+		ecore_animator_del(s_view_data.animator);
+		s_view_data.animator = NULL;
+	}
+
+	dlog_print(DLOG_INFO, LOG_TAG, "View: %u updates applied in %u frames, camera moved %u times, %u trail lines added for %u fixes",
+			s_view_data.staged_updates, s_view_data.applied_frames, s_view_data.camera_moves,
+			s_view_data.trail_lines_added, trail_get_count());
+	dlog_print(DLOG_INFO, LOG_TAG, "View: %u updates staged while paused, %u catch-up frames",
+			s_view_data.paused_updates, s_view_data.catch_up_frames);
+
+	overlay_manager_get_stats(&overlays);
+	dlog_print(DLOG_INFO, LOG_TAG, "Zone overlays: %u zones, %u viewport updates, %u created, %u recycled, %u deleted, %u shown and %u culled last",
+			overlays.zones, overlays.updates, overlays.created, overlays.recycled, overlays.deleted,
+			overlays.shown, overlays.culled);
+
+	/* Zone and trail overlays belong to the map */
+	overlay_manager_destroy();
+	__delete_trail(0);
 	elm_map_overlay_del(s_view_data.pos_overlay);
-	elm_map_overlay_del(s_view_data.boundary_overlay);
 
 	evas_object_del(s_view_data.map);
 	evas_object_del(s_view_data.box);
@@ -146,21 +226,17 @@ view_manager_destroy(void)
 	evas_object_del(s_view_data.layout);
 	evas_object_del(s_view_data.win);
 
-	location_bounds_destroy(s_view_data.bounds);
-
 	s_view_data.win = NULL;
 	s_view_data.layout = NULL;
 	s_view_data.conform = NULL;
 	s_view_data.box = NULL;
 	s_view_data.map = NULL;
 	s_view_data.pos_overlay = NULL;
-	s_view_data.boundary_overlay = NULL;
 }
 
 void
-view_manager_create_map_with_circle_boundary(double circle_longitude, double circle_latitude)
+view_manager_create_map(double longitude, double latitude)
 {
-	location_coords_s circle_coords;
 	if (!s_view_data.box || s_view_data.map) {
 		return;
 	}
@@ -176,96 +252,90 @@ view_manager_create_map_with_circle_boundary(double circle_longitude, double cir
 
 	elm_box_pack_end(s_view_data.box, s_view_data.map);
 
-	/* Create circle boundary */
-	dlog_print(DLOG_INFO, LOG_TAG, "Circle boundary overlay at %lf, %lf", circle_longitude, circle_latitude);
+	dlog_print(DLOG_INFO, LOG_TAG, "Map created at %lf, %lf", longitude, latitude);
 
-	s_view_data.boundary_overlay = elm_map_overlay_circle_add(s_view_data.map, circle_longitude, circle_latitude, BOUNDARY_CIRCLE_RADIUS_REL);
-	if (!s_view_data.boundary_overlay) {
-		dlog_print(DLOG_ERROR, LOG_TAG, "Failed to create boundary overlay");
-		return;
-	}
-
-	elm_map_overlay_displayed_zoom_min_set(s_view_data.boundary_overlay, ZOOM_LEVEL);
-
-	/* Create location bounds - BOUNDARY_CIRCLE_RADIUS [m] circle with center defined by initial coordinates */
-	circle_coords.longitude = circle_longitude;
-	circle_coords.latitude = circle_latitude;
+	/* Zone overlays follow the viewport, every scroll or zoom re-culls them in the next frame */
+	overlay_manager_set_map(s_view_data.map);
+	evas_object_smart_callback_add(s_view_data.map, "scroll", __map_moved_cb, NULL);
+	evas_object_smart_callback_add(s_view_data.map, "zoom,change", __map_zoomed_cb, NULL);
+	s_view_data.zones_pending = true;
+	s_view_data.trail_pending = true;
+}
 
-	dlog_print(DLOG_INFO, LOG_TAG, "center: %lf %lf, radius %lf", circle_coords.longitude, circle_coords.latitude, BOUNDARY_CIRCLE_RADIUS_M);
-	int ret = location_bounds_create_circle(circle_coords, BOUNDARY_CIRCLE_RADIUS_M, &s_view_data.bounds);
-	if (ret != LOCATIONS_ERROR_NONE) {
-		dlog_print(DLOG_ERROR, LOG_TAG, "Failed to create circle bound: error %d", ret);
+void
+view_manager_show_zones(const hazard_zone_list_s *list, size_t size)
+{
+	if (!overlay_manager_set_zones(list, size))
 		return;
-	}
-	dlog_print(DLOG_INFO, LOG_TAG, "Circle bounds created - %.1fm radius, center at %f, %f", BOUNDARY_CIRCLE_RADIUS_M, circle_coords.longitude, circle_coords.latitude);
+
+	s_view_data.zones_pending = true;
+	__schedule_apply();
 }
 
 void
-view_manager_update_message(char *message)
+view_manager_update_message(const char *message)
 {
 	dlog_print(DLOG_INFO, LOG_TAG, "Update message to: %s", message);
 
-	elm_object_part_text_set(s_view_data.layout, LAYOUT_PART_MESSAGE_TEXT, message);
+	snprintf(s_view_data.pending_message, MESSAGE_BUF_SIZE, "%s", message);
+	s_view_data.message_pending = true;
+	__schedule_apply();
 }
 
 void
-view_manager_update_satellites_count(char *count_str)
+view_manager_update_satellites_count(const char *count_str)
 {
 	dlog_print(DLOG_INFO, LOG_TAG, "Update satellites count to %s", count_str);
 
-	elm_object_part_text_set(s_view_data.layout, LAYOUT_PART_SATELLITE_TEXT, count_str);
+	snprintf(s_view_data.pending_satellites, CHAR_BUF_SIZE, "%s", count_str);
+	s_view_data.satellites_pending = true;
+	__schedule_apply();
 }
 
 void
-view_manager_update_map_position(double longitude, double latitude)
+view_manager_set_paused(bool paused)
 {
-	char lat_info[CHAR_BUF_SIZE];
-	char long_info[CHAR_BUF_SIZE];
-	bool contains;
-	location_coords_s coords;
-
-	if (!s_view_data.map) {
-		/* First position update message - create map with boundary circle */
-		view_manager_create_map_with_circle_boundary(longitude, latitude);
-	}
+	if (s_view_data.paused == paused)
+		return;
 
-	/* Set position overlay to new coordinates */
-	dlog_print(DLOG_INFO, LOG_TAG, "Update position to %lf %lf", longitude, latitude);
+	s_view_data.paused = paused;
 
-	if (!s_view_data.pos_overlay) {
-		/* Create position overlay */
-		s_view_data.pos_overlay = elm_map_overlay_add(s_view_data.map, longitude, latitude);
-		if (!s_view_data.pos_overlay) {
-			dlog_print(DLOG_ERROR, LOG_TAG, "Failed to create position overlay");
-			return;
+	if (paused) {
+		/* Staged state keeps only the newest values, nothing is rendered into the hidden window */
+		if (s_view_data.animator) {
+			ecore_animator_del(s_view_data.animator);
+			s_view_data.animator = NULL;
 		}
-
-		elm_map_overlay_displayed_zoom_min_set(s_view_data.pos_overlay, ZOOM_LEVEL);
-		elm_map_overlay_show(s_view_data.pos_overlay);
-	} else {
-		/* Move position overlay */
-		elm_map_overlay_region_set(s_view_data.pos_overlay, longitude, latitude);
+		return;
 	}
 
-	/* Show current region */
-	elm_map_region_bring_in(s_view_data.map, longitude, latitude);
-
-	/* Display current position in information area */
-	snprintf(lat_info, CHAR_BUF_SIZE, "%s %lf", LATITUDE_TEXT, latitude);
-	snprintf(long_info, CHAR_BUF_SIZE, "%s %lf", LONGITUDE_TEXT, longitude);
+	if (!s_view_data.position_pending && !s_view_data.message_pending && !s_view_data.satellites_pending &&
+			!s_view_data.zones_pending && !s_view_data.trail_pending)
+		return;
 
-	elm_object_part_text_set(s_view_data.layout, LAYOUT_PART_LATITUDE_TEXT, lat_info);
-	elm_object_part_text_set(s_view_data.layout, LAYOUT_PART_LONGITUDE_TEXT, long_info);
+	s_view_data.catch_up = true;
+	s_view_data.catch_up_frames++;
+	__schedule_apply();
+}
 
-	/* Set message in message area depending on whether given coordinates are within
-	 * boundary circle or not */
-	coords.longitude = longitude;
-	coords.latitude = latitude;
+void
+view_manager_update_trail(void)
+{
+	/* Drawn with the position in the same frame */
+	s_view_data.trail_pending = true;
+	__schedule_apply();
+}
 
-	contains = location_bounds_contains_coordinates(s_view_data.bounds, coords);
+void
+view_manager_update_map_position(double longitude, double latitude)
+{
+	dlog_print(DLOG_DEBUG, LOG_TAG, "Update position to %lf %lf", longitude, latitude);
 
-	contains ? view_manager_update_message(MESSAGE_BOUNDARY_INSIDE)
-			: view_manager_update_message(MESSAGE_BOUNDARY_OUTSIDE);
+	/* A burst of positions within one frame costs one overlay move and one camera decision */
+	s_view_data.pending_longitude = longitude;
+	s_view_data.pending_latitude = latitude;
+	s_view_data.position_pending = true;
+	__schedule_apply();
 }
 
 /* Static functions */
@@ -309,3 +379,212 @@ __create_map(Evas_Object *parent)
 
 	return map;
 }
+
+static void
+__map_moved_cb(void *data, Evas_Object *obj, void *event_info)
+{
+	/* Scroll fires on every animation step, culling runs at most once per frame */
+	s_view_data.zones_pending = true;
+	__schedule_apply();
+}
+
+static void
+__map_zoomed_cb(void *data, Evas_Object *obj, void *event_info)
+{
+	/* Another zoom may need another trail level */
+	s_view_data.trail_pending = true;
+	__map_moved_cb(data, obj, event_info);
+}
+
+static void
+__schedule_apply(void)
+{
+	s_view_data.staged_updates++;
+
+	if (s_view_data.paused) {
+		s_view_data.paused_updates++;
+		return;
+	}
+
+	if (s_view_data.animator)
+		return;
+
+	s_view_data.animator = ecore_animator_add(__apply_cb, NULL);
+	if (!s_view_data.animator)
+		dlog_print(DLOG_ERROR, LOG_TAG, "Failed to add animator, view is not updated");
+}
+
+static Eina_Bool
+__apply_cb(void *data)
+{
+	s_view_data.animator = NULL;
+	s_view_data.applied_frames++;
+
+	if (s_view_data.paused)
+		return ECORE_CALLBACK_CANCEL;
+
+	if (s_view_data.position_pending) {
+		s_view_data.position_pending = false;
+		__apply_position(s_view_data.pending_longitude, s_view_data.pending_latitude);
+	}
+
+	if (s_view_data.message_pending) {
+		s_view_data.message_pending = false;
+		__set_text(LAYOUT_PART_MESSAGE_TEXT, s_view_data.shown_message, MESSAGE_BUF_SIZE, s_view_data.pending_message);
+	}
+
+	if (s_view_data.satellites_pending) {
+		s_view_data.satellites_pending = false;
+		__set_text(LAYOUT_PART_SATELLITE_TEXT, s_view_data.shown_satellites, CHAR_BUF_SIZE, s_view_data.pending_satellites);
+	}
+
+	/* After the position, which may have created the map or moved the camera */
+	if (s_view_data.zones_pending && s_view_data.map) {
+		s_view_data.zones_pending = false;
+		overlay_manager_update();
+	}
+
+	if (s_view_data.trail_pending && s_view_data.map) {
+		s_view_data.trail_pending = false;
+		__apply_trail();
+	}
+
+	s_view_data.catch_up = false;
+
+	/* Next staged update adds a new animator, nothing runs while idle */
+	return ECORE_CALLBACK_CANCEL;
+}
+
+static void
+__apply_position(double longitude, double latitude)
+{
+	char lat_info[CHAR_BUF_SIZE];
+	char long_info[CHAR_BUF_SIZE];
+	bool first = !s_view_data.map;
+
+	if (first) {
+		/* First position update message - create map, zones pushed before are drawn on it */
+		view_manager_create_map(longitude, latitude);
+		if (!s_view_data.map)
+			return;
+	}
+
+	if (!s_view_data.pos_overlay) {
+		/* Create position overlay */
+		s_view_data.pos_overlay = elm_map_overlay_add(s_view_data.map, longitude, latitude);
+		if (!s_view_data.pos_overlay) {
+			dlog_print(DLOG_ERROR, LOG_TAG, "Failed to create position overlay");
+			return;
+		}
+
+		elm_map_overlay_displayed_zoom_min_set(s_view_data.pos_overlay, ZOOM_LEVEL);
+		elm_map_overlay_show(s_view_data.pos_overlay);
+	} else {
+		/* Move position overlay */
+		elm_map_overlay_region_set(s_view_data.pos_overlay, longitude, latitude);
+	}
+
+	__follow_position(longitude, latitude, first);
+
+	/* Display current position in information area */
+	snprintf(lat_info, CHAR_BUF_SIZE, "%s %lf", LATITUDE_TEXT, latitude);
+	snprintf(long_info, CHAR_BUF_SIZE, "%s %lf", LONGITUDE_TEXT, longitude);
+
+	__set_text(LAYOUT_PART_LATITUDE_TEXT, s_view_data.shown_latitude, CHAR_BUF_SIZE, lat_info);
+	__set_text(LAYOUT_PART_LONGITUDE_TEXT, s_view_data.shown_longitude, CHAR_BUF_SIZE, long_info);
+}
+
+static void
+__follow_position(double longitude, double latitude, bool first)
+{
+	Evas_Coord map_x, map_y, map_w, map_h;
+	Evas_Coord x, y, margin_x, margin_y;
+
+	if (first) {
+		elm_map_region_show(s_view_data.map, longitude, latitude);
+		return;
+	}
+
+	/* Marker well inside the visible map - keep the camera still instead of starting a new animation */
+	evas_object_geometry_get(s_view_data.map, &map_x, &map_y, &map_w, &map_h);
+	elm_map_region_to_canvas_convert(s_view_data.map, longitude, latitude, &x, &y);
+
+	margin_x = (Evas_Coord)(map_w * VIEWPORT_DEAD_ZONE);
+	margin_y = (Evas_Coord)(map_h * VIEWPORT_DEAD_ZONE);
+
+	if (x >= map_x + margin_x && x <= map_x + map_w - margin_x &&
+			y >= map_y + margin_y && y <= map_y + map_h - margin_y)
+		return;
+
+	s_view_data.camera_moves++;
+
+	/* Nobody watched the way here after a pause, jump instead of animating */
+	if (s_view_data.catch_up)
+		elm_map_region_show(s_view_data.map, longitude, latitude);
+	else
+		elm_map_region_bring_in(s_view_data.map, longitude, latitude);
+}
+
+static void
+__apply_trail(void)
+{
+	static trail_point_s vertices[TRAIL_MAX_VERTICES];
+	double longitude, latitude, meters_per_pixel;
+	unsigned int count, same, i;
+
+	elm_map_region_get(s_view_data.map, &longitude, &latitude);
+	meters_per_pixel = METERS_PER_PIXEL_ZOOM_0 * cos(latitude * M_PI / 180.0) / (1 << elm_map_zoom_get(s_view_data.map));
+
+	count = trail_get_vertices(trail_select_level(TRAIL_TOLERANCE_PX * meters_per_pixel, TRAIL_MAX_VERTICES),
+			vertices, TRAIL_MAX_VERTICES);
+
+	/* New fixes change only the end of the polyline, lines between unchanged vertices stay */
+	for (same = 0; same < count && same < s_view_data.trail_count; same++) {
+		if (vertices[same].timestamp != s_view_data.trail_shown[same].timestamp)
+			break;
+	}
+
+	__delete_trail(same > 0 ? same - 1 : 0);
+
+	for (i = same > 0 ? same - 1 : 0; i + 1 < count; i++) {
+		s_view_data.trail_lines[i] = elm_map_overlay_line_add(s_view_data.map,
+				vertices[i].longitude, vertices[i].latitude, vertices[i + 1].longitude, vertices[i + 1].latitude);
+		if (!s_view_data.trail_lines[i]) {
+			dlog_print(DLOG_ERROR, LOG_TAG, "Failed to create trail overlay");
+			count = i + 1;
+			break;
+		}
+
+		elm_map_overlay_color_set(s_view_data.trail_lines[i], 0, 112, 224, 255);
+		s_view_data.trail_lines_added++;
+	}
+
+	memcpy(s_view_data.trail_shown, vertices, count * sizeof(trail_point_s));
+	s_view_data.trail_count = count;
+}
+
+static void
+__delete_trail(unsigned int from)
+{
+	unsigned int i;
+
+	/* Line i joins vertices i and i + 1 */
+	for (i = from; i + 1 < s_view_data.trail_count; i++) {
+		elm_map_overlay_del(s_view_data.trail_lines[i]);
+		s_view_data.trail_lines[i] = NULL;
+	}
+
+	if (s_view_data.trail_count > from)
+		s_view_data.trail_count = from;
+}
+
+static void
+__set_text(const char *part, char *shown, size_t shown_size, const char *text)
+{
+	/* Setting a text part relayouts the edje object even when the text is the same */
+	if (!strcmp(shown, text) && shown[0])
+		return;
+
+	snprintf(shown, shown_size, "%s", text);
+	elm_object_part_text_set(s_view_data.layout, part, text);
+}
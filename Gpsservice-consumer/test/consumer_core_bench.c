@@ -0,0 +1,374 @@
+/* Headless consumer core driven by synthetic messages, without a display or the service.
+ *
+ * Checks that a stale position does not anchor the boundary zone, that the core reattaches to
+ * the shared memory ring of a restarted service and that every fix of a batch or of a ring drain
+ * goes into the trail while only the newest is displayed, then pushes millions of position frames, zone
+ * events and unknown messages through consumer_core_handle_message() and reports the time per
+ * message. Messages are tables of keys, the view and the service are counters.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "consumer_core.h"
+#include "position_frame.h"
+#include "shm_ring.h"
+#include "trail.h"
+
+#define MESSAGES 2000000
+#define ZONE_EVENT_EVERY 1000
+#define UNKNOWN_EVERY 100000
+#define MESSAGE_FIELDS 2
+#define RING_NAME_KEY "ring_name"
+#define POSITION_BATCH_KEY "position_batch"
+#define BATCH_FRAMES 10
+
+typedef struct
+{
+	const char *key;
+	const void *bytes;
+	size_t size;
+	const char *str;
+} field_s;
+
+typedef struct
+{
+	field_s fields[MESSAGE_FIELDS];
+} fields_s;
+
+static struct
+{
+	unsigned int positions;
+	double longitude;
+	double latitude;
+	unsigned int messages;
+	unsigned int zone_pushes;
+	unsigned int zones_sent;
+	unsigned int subscriptions;		/* with the ring transport */
+	int64_t track_from;
+	unsigned int trail_updates;
+	char last_message[128];
+	bool untrusted;					/* next messages come from the untrusted port */
+	unsigned int failures;
+} s_bench_data;
+
+static bool
+__get_bytes(const void *data, const char *key, const void **bytes, size_t *size)
+{
+	const fields_s *fields = data;
+	int i;
+
+	for (i = 0; i < MESSAGE_FIELDS; i++) {
+		if (fields->fields[i].key && fields->fields[i].bytes && !strcmp(fields->fields[i].key, key)) {
+			*bytes = fields->fields[i].bytes;
+			*size = fields->fields[i].size;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static const char *
+__get_str(const void *data, const char *key)
+{
+	const fields_s *fields = data;
+	int i;
+
+	for (i = 0; i < MESSAGE_FIELDS; i++) {
+		if (fields->fields[i].key && fields->fields[i].str && !strcmp(fields->fields[i].key, key))
+			return fields->fields[i].str;
+	}
+
+	return NULL;
+}
+
+static void
+__update_position(double longitude, double latitude)
+{
+	s_bench_data.positions++;
+	s_bench_data.longitude = longitude;
+	s_bench_data.latitude = latitude;
+}
+
+static void
+__update_message(const char *message)
+{
+	s_bench_data.messages++;
+	snprintf(s_bench_data.last_message, sizeof(s_bench_data.last_message), "%s", message);
+}
+
+static void
+__show_zones(const hazard_zone_list_s *list, size_t size)
+{
+	if (size >= sizeof(*list) && list->count > 0)
+		s_bench_data.zone_pushes++;
+}
+
+static void
+__update_trail(void)
+{
+	s_bench_data.trail_updates++;
+}
+
+static bool
+__subscribe(bool shm_ring)
+{
+	s_bench_data.subscriptions += shm_ring;
+
+	return true;
+}
+
+static bool
+__set_zones(const hazard_zone_list_s *list, size_t size)
+{
+	if (size >= sizeof(*list))
+		s_bench_data.zones_sent += list->count;
+
+	return true;
+}
+
+static bool
+__request_track(int64_t from)
+{
+	s_bench_data.track_from = from;
+
+	return true;
+}
+
+static void
+__log(consumer_log_level_e level, const char *format, va_list args)
+{
+	/* Unknown messages are warned about, they are sent on purpose */
+	if (level < CONSUMER_LOG_ERROR)
+		return;
+
+	vprintf(format, args);
+	putchar('\n');
+}
+
+static double
+__now(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+static void
+__check(bool passed, const char *what)
+{
+	if (passed)
+		return;
+
+	printf("FAIL %s\n", what);
+	s_bench_data.failures++;
+}
+
+static void
+__send(message_id_e id, const char *key, const void *bytes, size_t size, const char *str)
+{
+	message_schema_s schema;
+	fields_s fields = {{{MESSAGE_SCHEMA_KEY, &schema, sizeof(schema), NULL}, {key, bytes, size, str}}};
+	consumer_message_s message = {&fields, "bench", __get_bytes, __get_str, !s_bench_data.untrusted};
+
+	message_schema_init(&schema, id);
+	consumer_core_handle_message(&message, 0.0);
+}
+
+static void
+__send_position(double latitude, double longitude, int64_t timestamp, uint32_t flags)
+{
+	position_frame_s frame;
+
+	position_frame_init(&frame, latitude, longitude, 0.0, timestamp);
+	position_frame_set_quality(&frame, POSITION_FRAME_QUALITY_GOOD);
+	frame.flags |= flags;
+
+	__send(MESSAGE_ID_POSITION_UPDATE, POSITION_FRAME_KEY, &frame, sizeof(frame), NULL);
+}
+
+static void
+__test_stale_anchor(void)
+{
+	__send_position(52.0, 13.0, 1000, POSITION_FRAME_FLAG_STALE);
+	__check(s_bench_data.positions == 1 && s_bench_data.zone_pushes == 0, "stale position anchored the boundary zone");
+
+	__send_position(52.1, 13.1, 1001, 0);
+	__check(s_bench_data.zone_pushes == 1 && s_bench_data.zones_sent == 1, "fresh position did not anchor the boundary zone");
+	__check(s_bench_data.latitude == 52.1 && s_bench_data.longitude == 13.1, "fresh position not shown");
+}
+
+static bool
+__write_ring_position(shm_ring_s *ring, int64_t timestamp)
+{
+	position_frame_s frame;
+	bool doorbell;
+
+	position_frame_init(&frame, 52.1, 13.1, 0.0, timestamp);
+	position_frame_set_quality(&frame, POSITION_FRAME_QUALITY_GOOD);
+
+	if (!shm_ring_write(ring, SHM_RING_RECORD_POSITION, &frame, sizeof(frame), &doorbell))
+		return false;
+
+	__send(MESSAGE_ID_RING_DOORBELL, NULL, NULL, 0, NULL);
+
+	return true;
+}
+
+static void
+__test_ring_trail(shm_ring_s *ring)
+{
+	position_frame_s frame;
+	unsigned int positions = s_bench_data.positions;
+	unsigned int trail_updates = s_bench_data.trail_updates;
+	unsigned int trail_count = trail_get_count();
+	bool doorbell;
+	int i;
+
+	/* Records written before one doorbell are drained together */
+	for (i = 0; i < BATCH_FRAMES; i++) {
+		position_frame_init(&frame, 52.1 + i * 1e-4, 13.1, 0.0, 2100 + i);
+		position_frame_set_quality(&frame, POSITION_FRAME_QUALITY_GOOD);
+		shm_ring_write(ring, SHM_RING_RECORD_POSITION, &frame, sizeof(frame), &doorbell);
+	}
+	__send(MESSAGE_ID_RING_DOORBELL, NULL, NULL, 0, NULL);
+
+	__check(trail_get_count() == trail_count + BATCH_FRAMES, "not every position from the ring in the trail");
+	__check(s_bench_data.positions == positions + 1 && s_bench_data.trail_updates == trail_updates + 1,
+			"ring drain not shown once");
+}
+
+static void
+__test_batch_trail(void)
+{
+	position_frame_s frames[BATCH_FRAMES];
+	unsigned int positions = s_bench_data.positions;
+	unsigned int trail_updates = s_bench_data.trail_updates;
+	unsigned int trail_count = trail_get_count();
+	int i;
+
+	for (i = 0; i < BATCH_FRAMES; i++) {
+		position_frame_init(&frames[i], 52.2 + i * 1e-4, 13.2, 0.0, 3000 + i);
+		position_frame_set_quality(&frames[i], i == BATCH_FRAMES / 2 ? POSITION_FRAME_QUALITY_POOR : POSITION_FRAME_QUALITY_GOOD);
+	}
+
+	__send(MESSAGE_ID_POSITION_BATCH, POSITION_BATCH_KEY, frames, sizeof(frames), NULL);
+
+	/* The poor fix is left out of the trail */
+	__check(trail_get_count() == trail_count + BATCH_FRAMES - 1, "not every fix of the batch in the trail");
+	__check(s_bench_data.positions == positions + 1 && s_bench_data.trail_updates == trail_updates + 1,
+			"batch not shown once");
+	__check(s_bench_data.latitude == frames[BATCH_FRAMES - 1].latitude, "newest fix of the batch not shown");
+}
+
+static void
+__test_ring_restart(void)
+{
+	char name[64];
+	shm_ring_s *ring;
+	unsigned int positions;
+
+	snprintf(name, sizeof(name), "/gps_consumer_bench_%d", (int)getpid());
+
+	ring = shm_ring_create(name);
+	if (!ring) {
+		printf("Shared memory not available, ring restart not checked\n");
+		return;
+	}
+
+	/* Another app that learnt the name cannot redirect the consumer */
+	s_bench_data.untrusted = true;
+	__send(MESSAGE_ID_RING_HANDSHAKE, RING_NAME_KEY, NULL, 0, name);
+	s_bench_data.untrusted = false;
+	positions = s_bench_data.positions;
+	__check(__write_ring_position(ring, 1999) && s_bench_data.positions == positions, "untrusted ring handshake accepted");
+
+	__send(MESSAGE_ID_RING_HANDSHAKE, RING_NAME_KEY, NULL, 0, name);
+	positions = s_bench_data.positions;
+	__check(__write_ring_position(ring, 2000) && s_bench_data.positions == positions + 1, "position from the ring not shown");
+
+	/* Restarted service creates a new ring under the same name */
+	shm_ring_close(ring);
+	ring = shm_ring_create(name);
+	if (!ring) {
+		__check(false, "ring could not be created again");
+		return;
+	}
+
+	__send(MESSAGE_ID_RING_HANDSHAKE, RING_NAME_KEY, NULL, 0, name);
+	positions = s_bench_data.positions;
+	__check(__write_ring_position(ring, 2001) && s_bench_data.positions == positions + 1,
+			"position from the ring of the restarted service not shown");
+
+	__test_ring_trail(ring);
+
+	shm_ring_close(ring);
+}
+
+static void
+__bench(void)
+{
+	hazard_zone_event_s event;
+	consumer_core_stats_s before, after;
+	unsigned int zone_events = 0, unknown = 0;
+	double start, elapsed;
+	int i;
+
+	memset(&event, 0, sizeof(event));
+	event.id = BOUNDARY_ZONE_ID;
+
+	consumer_core_get_stats(&before);
+	start = __now();
+
+	for (i = 0; i < MESSAGES; i++) {
+		__send_position(52.0 + 1e-5 * (i % 1000), 13.0 + 1e-7 * i, 10000 + i, 0);
+
+		if (i % ZONE_EVENT_EVERY == ZONE_EVENT_EVERY - 1) {
+			event.transition = zone_events++ % 2 ? HAZARD_ZONE_EXIT : HAZARD_ZONE_ENTER;
+			__send(MESSAGE_ID_ZONE_EVENT, HAZARD_ZONE_EVENT_KEY, &event, sizeof(event), NULL);
+		}
+
+		if (i % UNKNOWN_EVERY == 0) {
+			__send(MESSAGE_ID_UNKNOWN, MESSAGE_SCHEMA_TYPE_KEY, NULL, 0, "NOT_A_MESSAGE");
+			unknown++;
+		}
+	}
+
+	elapsed = __now() - start;
+	consumer_core_get_stats(&after);
+
+	__check(after.fixes - before.fixes == MESSAGES, "not every position shown");
+	__check(after.alerts - before.alerts == zone_events, "not every zone event alerted");
+	__check(after.unknown_messages - before.unknown_messages == unknown, "unknown messages not counted");
+
+	printf("%d positions, %u zone events, %u unknown messages in %.3f s: %.0f ns per message\n", MESSAGES, zone_events,
+			unknown, elapsed, elapsed * 1e9 / (MESSAGES + zone_events + unknown));
+	printf("view: %u positions, %u messages, last \"%s\", %u trail updates\n", s_bench_data.positions,
+			s_bench_data.messages, s_bench_data.last_message, s_bench_data.trail_updates);
+	printf("service: %u zones sent, %u subscriptions, track requested from %lld\n", s_bench_data.zones_sent,
+			s_bench_data.subscriptions, (long long)s_bench_data.track_from);
+}
+
+int
+main(void)
+{
+	const consumer_view_s view = {__update_position, __update_message, NULL, __show_zones, __update_trail};
+	const consumer_service_s service = {__subscribe, __set_zones, __request_track};
+
+	consumer_core_init(&view, &service, __log, __now());
+
+	__test_stale_anchor();
+	__test_ring_restart();
+	__test_batch_trail();
+	__bench();
+
+	consumer_core_destroy();
+
+	printf("consumer_core_bench: %s\n", s_bench_data.failures ? "FAILED" : "passed");
+
+	return s_bench_data.failures ? 1 : 0;
+}
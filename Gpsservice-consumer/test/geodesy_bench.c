@@ -0,0 +1,199 @@
+/* Accuracy and throughput of the geodesy batch functions.
+ *
+ * Batch results are compared with the scalar reference on random points around three origins
+ * (mid latitude, near the south pole, at the antimeridian) against the bounds in geodesy.h.
+ * Throughput is measured on GEODESY_BENCH_POINTS points, small enough to stay in cache, for the
+ * instruction set the batch functions were compiled for, e.g. make bench CFLAGS="-O2 -mavx2".
+ */
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "geodesy.h"
+
+#define ACCURACY_POINTS 1000000
+#define GEODESY_BENCH_POINTS 4096
+#define GEODESY_BENCH_ROUNDS 2000
+#define NEAR_RANGE_DEG 0.05
+#define ANTIPODE_EXCLUDED_M 10000.0
+
+#define MAX_HAVERSINE_RELATIVE 1e-12
+#define MAX_BEARING_DEG 1e-7
+#define MAX_EQUIRECTANGULAR_RELATIVE 1e-4	/* below 100 km and |latitude| 70 degrees */
+
+typedef enum
+{
+	KERNEL_HAVERSINE,
+	KERNEL_EQUIRECTANGULAR,
+	KERNEL_BEARING,
+	KERNEL_COUNT
+} kernel_e;
+
+static struct
+{
+	double latitudes[ACCURACY_POINTS];
+	double longitudes[ACCURACY_POINTS];
+	double distances[ACCURACY_POINTS];
+	double flat_distances[ACCURACY_POINTS];
+	double bearings[ACCURACY_POINTS];
+	unsigned int failures;
+} s_bench_data;
+
+static double
+__now(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+static double
+__random(double low, double high)
+{
+	return low + (high - low) * (rand() / (double)RAND_MAX);
+}
+
+static void
+__check(bool passed, const char *what, double value, double bound)
+{
+	printf("  %-40s %.2e (bound %.0e)\n", what, value, bound);
+
+	if (!passed) {
+		printf("FAIL %s\n", what);
+		s_bench_data.failures++;
+	}
+}
+
+static void
+__test_accuracy(void)
+{
+	static const double origins[][2] = {{52.5, 13.4}, {-89.9, 13.4}, {0.0, 179.99}};
+	double worst_relative = 0.0, worst_bearing = 0.0, worst_flat = 0.0, worst_flat_model = 0.0;
+	unsigned int o, i;
+
+	srand(1);
+	for (o = 0; o < sizeof(origins) / sizeof(origins[0]); o++) {
+		double latitude = origins[o][0];
+		double longitude = origins[o][1];
+
+		/* A third of the points near the origin, the rest anywhere, longitudes also off [-180, 180] */
+		for (i = 0; i < ACCURACY_POINTS; i++) {
+			if (i % 3 == 0) {
+				s_bench_data.latitudes[i] = fmax(-90.0, fmin(90.0, latitude + __random(-NEAR_RANGE_DEG, NEAR_RANGE_DEG)));
+				s_bench_data.longitudes[i] = longitude + __random(-NEAR_RANGE_DEG, NEAR_RANGE_DEG);
+			} else {
+				s_bench_data.latitudes[i] = __random(-90.0, 90.0);
+				s_bench_data.longitudes[i] = __random(-540.0, 540.0);
+			}
+		}
+		s_bench_data.latitudes[0] = latitude;
+		s_bench_data.longitudes[0] = longitude;
+
+		geodesy_haversine_batch(latitude, longitude, s_bench_data.latitudes, s_bench_data.longitudes, ACCURACY_POINTS,
+				s_bench_data.distances);
+		geodesy_equirectangular_batch(latitude, longitude, s_bench_data.latitudes, s_bench_data.longitudes, ACCURACY_POINTS,
+				s_bench_data.flat_distances);
+		geodesy_bearing_batch(latitude, longitude, s_bench_data.latitudes, s_bench_data.longitudes, ACCURACY_POINTS,
+				s_bench_data.bearings);
+
+		for (i = 0; i < ACCURACY_POINTS; i++) {
+			double distance = geodesy_haversine_m(latitude, longitude, s_bench_data.latitudes[i], s_bench_data.longitudes[i]);
+			double bearing = geodesy_bearing_deg(latitude, longitude, s_bench_data.latitudes[i], s_bench_data.longitudes[i]);
+			double flat = geodesy_equirectangular_m(latitude, longitude, s_bench_data.latitudes[i], s_bench_data.longitudes[i]);
+			double bearing_error = fabs(s_bench_data.bearings[i] - bearing);
+
+			if (s_bench_data.bearings[i] < 0.0 || s_bench_data.bearings[i] >= 360.0) {
+				printf("FAIL bearing %f out of range\n", s_bench_data.bearings[i]);
+				s_bench_data.failures++;
+			}
+
+			if (distance > M_PI * GEODESY_EARTH_RADIUS_M - ANTIPODE_EXCLUDED_M)
+				continue;
+
+			if (distance > 1.0)
+				worst_relative = fmax(worst_relative, fabs(s_bench_data.distances[i] - distance) / distance);
+
+			if (bearing_error > 180.0)
+				bearing_error = 360.0 - bearing_error;
+			if (distance > 1e-3)
+				worst_bearing = fmax(worst_bearing, bearing_error);
+
+			if (distance > 1.0)
+				worst_flat = fmax(worst_flat, fabs(s_bench_data.flat_distances[i] - flat) / distance);
+
+			if (distance > 1.0 && distance < 100000.0 && fabs(latitude) < 70.0 && fabs(s_bench_data.latitudes[i]) < 70.0)
+				worst_flat_model = fmax(worst_flat_model, fabs(flat - distance) / distance);
+		}
+	}
+
+	printf("Batch functions (%s) against the scalar ones, %u points per origin:\n", geodesy_batch_isa(), ACCURACY_POINTS);
+	__check(worst_relative <= MAX_HAVERSINE_RELATIVE, "haversine, relative", worst_relative, MAX_HAVERSINE_RELATIVE);
+	__check(worst_bearing <= MAX_BEARING_DEG, "bearing, degrees", worst_bearing, MAX_BEARING_DEG);
+	__check(worst_flat <= MAX_HAVERSINE_RELATIVE, "equirectangular, relative", worst_flat, MAX_HAVERSINE_RELATIVE);
+	__check(worst_flat_model <= MAX_EQUIRECTANGULAR_RELATIVE, "equirectangular vs haversine, relative", worst_flat_model,
+			MAX_EQUIRECTANGULAR_RELATIVE);
+}
+
+static double
+__measure(kernel_e kernel, bool batch)
+{
+	double *out = s_bench_data.distances;
+	double start = __now();
+	unsigned int round, i;
+
+	for (round = 0; round < GEODESY_BENCH_ROUNDS; round++) {
+		const double *latitudes = s_bench_data.latitudes;
+		const double *longitudes = s_bench_data.longitudes;
+
+		if (batch) {
+			if (kernel == KERNEL_HAVERSINE)
+				geodesy_haversine_batch(52.5, 13.4, latitudes, longitudes, GEODESY_BENCH_POINTS, out);
+			else if (kernel == KERNEL_EQUIRECTANGULAR)
+				geodesy_equirectangular_batch(52.5, 13.4, latitudes, longitudes, GEODESY_BENCH_POINTS, out);
+			else
+				geodesy_bearing_batch(52.5, 13.4, latitudes, longitudes, GEODESY_BENCH_POINTS, out);
+			continue;
+		}
+
+		for (i = 0; i < GEODESY_BENCH_POINTS; i++) {
+			if (kernel == KERNEL_HAVERSINE)
+				out[i] = geodesy_haversine_m(52.5, 13.4, latitudes[i], longitudes[i]);
+			else if (kernel == KERNEL_EQUIRECTANGULAR)
+				out[i] = geodesy_equirectangular_m(52.5, 13.4, latitudes[i], longitudes[i]);
+			else
+				out[i] = geodesy_bearing_deg(52.5, 13.4, latitudes[i], longitudes[i]);
+		}
+	}
+
+	return (double)GEODESY_BENCH_POINTS * GEODESY_BENCH_ROUNDS / (__now() - start) / 1e6;
+}
+
+static void
+__bench(void)
+{
+	static const char *const names[KERNEL_COUNT] = {"haversine", "equirectangular", "bearing"};
+	kernel_e kernel;
+
+	printf("Million points per second, scalar / %s:\n", geodesy_batch_isa());
+	for (kernel = 0; kernel < KERNEL_COUNT; kernel++) {
+		double scalar = __measure(kernel, false);
+		double batch = __measure(kernel, true);
+
+		printf("  %-16s %6.1f / %6.1f (x%.1f)\n", names[kernel], scalar, batch, batch / scalar);
+	}
+}
+
+int
+main(void)
+{
+	__test_accuracy();
+	__bench();
+
+	printf("geodesy_bench: %s\n", s_bench_data.failures ? "FAILED" : "passed");
+
+	return s_bench_data.failures ? 1 : 0;
+}
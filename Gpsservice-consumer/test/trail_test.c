@@ -0,0 +1,174 @@
+/* Error bound of the trail levels on long random walks.
+ *
+ * Every fix of the track must be within 2 * TRAIL_TOLERANCE_M * 2^l of the segment of the level l
+ * polyline spanning its time, trail_select_level() must respect the tolerance it is given, and
+ * merging a gap back must give the same trail. The second walk is longer than TRAIL_MAX_POINTS,
+ * so dropping the oldest fixes is covered too.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "trail.h"
+
+#define METERS_PER_DEG 111195.0
+#define START_LATITUDE 23.8103
+#define START_LONGITUDE 90.4125
+#define STEP_M 1.4						/* walking, one fix per second */
+#define GAP_START 20000
+#define GAP_FIXES 300
+
+static struct
+{
+	trail_point_s *track;
+	trail_point_s *vertices;
+	double cos_latitude;
+	unsigned int failures;
+} s_test_data;
+
+static void
+__generate(unsigned int count, unsigned int seed)
+{
+	double latitude = START_LATITUDE;
+	double longitude = START_LONGITUDE;
+	double heading = 0.0;
+	unsigned int i;
+
+	srand(seed);
+	for (i = 0; i < count; i++) {
+		/* Wandering heading and a little GPS noise */
+		heading += (rand() / (double)RAND_MAX - 0.5) * 0.6;
+		latitude += cos(heading) * STEP_M / METERS_PER_DEG;
+		longitude += sin(heading) * STEP_M / (METERS_PER_DEG * s_test_data.cos_latitude);
+
+		s_test_data.track[i].latitude = latitude + (rand() % 101 - 50) * 1e-7;
+		s_test_data.track[i].longitude = longitude;
+		s_test_data.track[i].timestamp = 1700000000 + i;
+	}
+}
+
+static double
+__segment_distance(const trail_point_s *point, const trail_point_s *a, const trail_point_s *b)
+{
+	double px = point->longitude * s_test_data.cos_latitude * METERS_PER_DEG;
+	double py = point->latitude * METERS_PER_DEG;
+	double ax = a->longitude * s_test_data.cos_latitude * METERS_PER_DEG;
+	double ay = a->latitude * METERS_PER_DEG;
+	double ex = b->longitude * s_test_data.cos_latitude * METERS_PER_DEG - ax;
+	double ey = b->latitude * METERS_PER_DEG - ay;
+	double length = ex * ex + ey * ey;
+	double t = length > 0.0 ? ((px - ax) * ex + (py - ay) * ey) / length : 0.0;
+
+	t = t < 0.0 ? 0.0 : t > 1.0 ? 1.0 : t;
+
+	return hypot(ax + t * ex - px, ay + t * ey - py);
+}
+
+static double
+__level_error(unsigned int level, unsigned int count)
+{
+	unsigned int first = count - trail_get_count();
+	unsigned int n = trail_get_vertices(level, s_test_data.vertices, TRAIL_MAX_POINTS);
+	unsigned int i, s = 0;
+	double worst = 0.0;
+
+	if (n == 0 || s_test_data.vertices[0].timestamp != s_test_data.track[first].timestamp ||
+			s_test_data.vertices[n - 1].timestamp != s_test_data.track[count - 1].timestamp) {
+		printf("FAIL level %u does not span the trail\n", level);
+		s_test_data.failures++;
+		return INFINITY;
+	}
+
+	for (i = first; i < count; i++) {
+		const trail_point_s *point = &s_test_data.track[i];
+		double distance;
+
+		while (s + 2 < n && s_test_data.vertices[s + 1].timestamp <= point->timestamp)
+			s++;
+
+		distance = __segment_distance(point, &s_test_data.vertices[s], &s_test_data.vertices[n > 1 ? s + 1 : s]);
+		if (distance > worst)
+			worst = distance;
+	}
+
+	printf("  level %u: %5u vertices, worst %7.1f m, bound %7.1f m\n", level, n, worst,
+			2.0 * TRAIL_TOLERANCE_M * (1 << level));
+
+	return worst;
+}
+
+static void
+__test_walk(unsigned int count, unsigned int seed)
+{
+	double errors[TRAIL_LEVELS];
+	unsigned int level, added;
+	double tolerance;
+
+	__generate(count, seed);
+
+	trail_init();
+	for (level = 0; level < count; level++)
+		trail_append(s_test_data.track[level].latitude, s_test_data.track[level].longitude, s_test_data.track[level].timestamp);
+
+	printf("%u fix random walk, %u fixes kept\n", count, trail_get_count());
+
+	for (level = 0; level < TRAIL_LEVELS; level++) {
+		errors[level] = __level_error(level, count);
+		if (errors[level] > 2.0 * TRAIL_TOLERANCE_M * (1 << level)) {
+			printf("FAIL level %u is further from the track than its bound\n", level);
+			s_test_data.failures++;
+		}
+	}
+
+	for (tolerance = 1.0; tolerance <= 4096.0; tolerance *= 2.0) {
+		level = trail_select_level(tolerance, TRAIL_MAX_POINTS);
+		if (level > 0 && errors[level] > tolerance) {
+			printf("FAIL level %u selected for %.0f m is %.1f m from the track\n", level, tolerance, errors[level]);
+			s_test_data.failures++;
+		}
+	}
+
+	/* A track fetched after a reconnect fills a gap */
+	if (count > TRAIL_MAX_POINTS)
+		return;
+
+	trail_init();
+	for (level = 0; level < count; level++) {
+		if (level < GAP_START || level >= GAP_START + GAP_FIXES)
+			trail_append(s_test_data.track[level].latitude, s_test_data.track[level].longitude, s_test_data.track[level].timestamp);
+	}
+
+	added = trail_merge(&s_test_data.track[GAP_START], GAP_FIXES);
+	if (added != GAP_FIXES || trail_get_count() != count) {
+		printf("FAIL merge added %u of %u fixes\n", added, GAP_FIXES);
+		s_test_data.failures++;
+	}
+
+	for (level = 0; level < TRAIL_LEVELS; level++) {
+		if (__level_error(level, count) > 2.0 * TRAIL_TOLERANCE_M * (1 << level)) {
+			printf("FAIL level %u after merge is further from the track than its bound\n", level);
+			s_test_data.failures++;
+		}
+	}
+}
+
+int
+main(void)
+{
+	s_test_data.cos_latitude = cos(START_LATITUDE * M_PI / 180.0);
+	s_test_data.track = malloc(2 * TRAIL_MAX_POINTS * sizeof(trail_point_s));
+	s_test_data.vertices = malloc(TRAIL_MAX_POINTS * sizeof(trail_point_s));
+	if (!s_test_data.track || !s_test_data.vertices)
+		return 1;
+
+	__test_walk(60000, 3);
+	__test_walk(100000, 7);
+
+	trail_destroy();
+	free(s_test_data.track);
+	free(s_test_data.vertices);
+
+	printf("trail_test: %s\n", s_test_data.failures ? "FAILED" : "passed");
+
+	return s_test_data.failures ? 1 : 0;
+}
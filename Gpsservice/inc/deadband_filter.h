@@ -0,0 +1,60 @@
+#ifndef __deadband_filter_H__
+#define __deadband_filter_H__
+
+#include <stdbool.h>
+#include "position_frame.h"
+
+/* Suppresses outgoing fixes that carry no new information.
+ *
+ * A fix passes when it is the first one, when it moved further than the distance threshold
+ * from the last passed fix, when heading changed by more than the heading threshold while
+ * moving, or when nothing has been passed for heartbeat_s seconds. Distance threshold is
+ * max(min_distance_m, accuracy_factor * combined horizontal accuracy of both fixes), so
+ * GPS noise of an inaccurate fix is not mistaken for movement.
+ */
+
+typedef enum
+{
+	DEADBAND_PASS_FIRST = 0,
+	DEADBAND_PASS_MOVED,
+	DEADBAND_PASS_HEADING,
+	DEADBAND_PASS_HEARTBEAT,
+	DEADBAND_SUPPRESSED,
+	DEADBAND_DECISION_COUNT
+} deadband_decision_e;
+
+typedef struct
+{
+	double min_distance_m;
+	double accuracy_factor;
+	double max_heading_change_deg;
+	double min_heading_speed_kmh;		/* heading is ignored below this speed */
+	double heartbeat_s;
+} deadband_filter_config_s;
+
+/*
+ * Reset filter state and counters and apply config. NULL config applies defaults.
+ */
+void deadband_filter_init(const deadband_filter_config_s *config);
+
+/*
+ * Get default configuration
+ */
+void deadband_filter_default_config(deadband_filter_config_s *config);
+
+/*
+ * Decide whether frame should be sent. Passed frames become the new reference.
+ */
+deadband_decision_e deadband_filter_check(const position_frame_s *frame);
+
+/*
+ * Get number of decisions of given kind
+ */
+unsigned int deadband_filter_get_count(deadband_decision_e decision);
+
+/*
+ * Get decision name for logging
+ */
+const char *deadband_filter_decision_str(deadband_decision_e decision);
+
+#endif /* __deadband_filter_H__ */
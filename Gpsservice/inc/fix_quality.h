@@ -0,0 +1,84 @@
+#ifndef __fix_quality_H__
+#define __fix_quality_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "position_frame.h"
+
+/* Accepts or rejects raw fixes before they enter the pipeline, and classifies accepted ones.
+ *
+ * A fix is rejected when it is too old, when its horizontal or vertical accuracy is worse than
+ * the threshold, or when fewer satellites than required were used for it. Network fixes, which
+ * have no satellites, are checked against their own horizontal threshold. Receiver fixes for
+ * which the satellite count is not known yet are checked against the receiver threshold.
+ * Accepted fixes get a quality class from their horizontal accuracy. Every verdict is counted,
+ * so thresholds can be tuned from field logs.
+ */
+
+#define FIX_QUALITY_SATELLITES_NONE -1		/* source without satellites, e.g. network positioning */
+#define FIX_QUALITY_SATELLITES_UNKNOWN -2	/* receiver fix, satellites not reported yet */
+
+typedef enum
+{
+	FIX_ACCEPTED = 0,
+	FIX_REJECTED_AGE,
+	FIX_REJECTED_HORIZONTAL,
+	FIX_REJECTED_VERTICAL,
+	FIX_REJECTED_SATELLITES,
+	FIX_VERDICT_COUNT
+} fix_quality_verdict_e;
+
+typedef struct
+{
+	double max_age_s;
+	double max_horizontal_m;
+	double max_network_horizontal_m;	/* fixes of sources without satellites */
+	double max_vertical_m;				/* 0 - not checked */
+	int min_satellites;
+	double good_horizontal_m;			/* class boundaries of accepted fixes */
+	double fair_horizontal_m;
+} fix_quality_config_s;
+
+/*
+ * Reset counters and apply config. NULL config applies defaults.
+ */
+void fix_quality_init(const fix_quality_config_s *config);
+
+/*
+ * Get default configuration
+ */
+void fix_quality_default_config(fix_quality_config_s *config);
+
+/*
+ * Check raw fix taken at time now. satellites is the number used for the fix, or one of
+ * FIX_QUALITY_SATELLITES_NONE and FIX_QUALITY_SATELLITES_UNKNOWN.
+ * Accepted frames are tagged with their quality class.
+ */
+fix_quality_verdict_e fix_quality_check(position_frame_s *frame, int satellites, int64_t now);
+
+/*
+ * Get quality class for horizontal accuracy, 0 meaning unknown
+ */
+unsigned int fix_quality_classify(double horizontal_accuracy);
+
+/*
+ * Get number of verdicts of given kind
+ */
+unsigned int fix_quality_get_count(fix_quality_verdict_e verdict);
+
+/*
+ * Get number of accepted fixes of given quality class
+ */
+unsigned int fix_quality_get_class_count(unsigned int quality);
+
+/*
+ * Get verdict name for logging
+ */
+const char *fix_quality_verdict_str(fix_quality_verdict_e verdict);
+
+/*
+ * Get quality class name for logging
+ */
+const char *fix_quality_class_str(unsigned int quality);
+
+#endif /* __fix_quality_H__ */
@@ -0,0 +1,89 @@
+#ifndef __geofence_H__
+#define __geofence_H__
+
+#include <stdbool.h>
+#include "position_frame.h"
+#include "hazard_zone.h"
+
+/* Hazard zones pushed by client applications, evaluated against every fix in the service.
+ *
+ * Each client owns its zone list, pushing a new list replaces only the zones of that client.
+ * A fix produces an event only when it changes the state of a zone: enter when the position
+ * is within the zone, exit when it is more than GEOFENCE_EXIT_MARGIN_M outside of it, so
+ * a fix jittering at the edge does not flap, and dwell once per stay after dwell_s seconds.
+ *
+ * Zones of all owners are kept in one zone_index, so a fix tests only the zones near it and the
+ * zones it is in, not the whole table - thousands of circles and polygons cost about as much per
+ * fix as a few. Transitions that do not fit the events buffer are not applied and come with the
+ * next fix.
+ */
+
+#define GEOFENCE_MAX_ZONES 16384
+#define GEOFENCE_MAX_OWNERS 16
+#define GEOFENCE_MAX_POLYGON_VERTICES 1024
+#define GEOFENCE_MAX_EVENTS 64		/* per evaluated fix */
+#define GEOFENCE_MAX_INSIDE 256		/* zones of one owner reported as containing the position */
+#define GEOFENCE_OWNER_SIZE 128
+#define GEOFENCE_EXIT_MARGIN_M 10.0
+
+typedef struct
+{
+	char owner[GEOFENCE_OWNER_SIZE];
+	hazard_zone_event_s event;
+} geofence_event_s;
+
+typedef struct
+{
+	unsigned int zones;
+	unsigned int vertices;
+	unsigned int updates;
+	unsigned int enters;
+	unsigned int exits;
+	unsigned int dwells;
+} geofence_stats_s;
+
+/*
+ * Remove all zones and clear statistics
+ */
+void geofence_init(void);
+
+/*
+ * Remove all zones and release memory
+ */
+void geofence_destroy(void);
+
+/*
+ * Replace zones of owner with the validated list of size bytes. State of zones with an unchanged
+ * id is kept. Returns number of zones stored, less than in the list if the table is full or
+ * a zone is invalid.
+ */
+unsigned int geofence_set_zones(const char *owner, const hazard_zone_list_s *list, size_t size);
+
+/*
+ * Get number of zones of all owners
+ */
+unsigned int geofence_zone_count(void);
+
+/*
+ * Evaluate fix against all zones. Up to max_events transitions are written to events.
+ * Returns number of events written.
+ */
+unsigned int geofence_update(const position_frame_s *frame, geofence_event_s *events, unsigned int max_events);
+
+/*
+ * Get distance in meters from the last evaluated fix to the nearest zone edge, 0 when inside
+ * a zone, negative if there are no zones or no fix was evaluated yet
+ */
+double geofence_distance_m(void);
+
+/*
+ * Get ids of zones of owner the last evaluated fix is in. Returns number of ids written.
+ */
+unsigned int geofence_get_inside(const char *owner, uint32_t *ids, unsigned int max_ids);
+
+/*
+ * Get counters
+ */
+void geofence_get_stats(geofence_stats_s *stats);
+
+#endif /* __geofence_H__ */
@@ -1,14 +1,90 @@
 #ifndef __location_manager_H__
 #define __location_manager_H__
 
+#include "sampling_scheduler.h"
+#include "deadband_filter.h"
+#include "fix_quality.h"
+#include "power_policy.h"
+#include "outbound_queue.h"
+
 #define REMOTE_APP_ID "org.tizen.gpsservice-consumer"
 #define REMOTE_PORT "gps-consumer-port"
 
+/* Trusted local port receiving control requests (SUBSCRIBE, SET_ZONES, GET_TRACK...) from client
+ * applications. Only applications signed with the same certificate as the service can send to it. */
+#define CONTROL_PORT "gps-service-control-port"
+
 /*
  * Initialize location manager and set callback for position and satellite data updates
  */
 bool geolocation_manager_init(void);
 
+/*
+ * Configure position batching. Fixes are buffered and sent as one message when flush_count
+ * fixes are collected or deadline seconds have passed since the first buffered fix.
+ * flush_count of 1 disables batching. flush_count of 0 and deadline <= 0 keep current values.
+ */
+void geolocation_manager_set_batching(unsigned int flush_count, double deadline);
+
+/*
+ * Send all buffered fixes immediately, e.g. on a geofence-relevant event
+ */
+bool geolocation_manager_flush_positions(void);
+
+/*
+ * Set distance in meters to the nearest active hazard zone, used to choose GPS sampling rate.
+ * SAMPLING_DISTANCE_UNKNOWN keeps the fastest rate.
+ */
+void geolocation_manager_set_hazard_distance(double distance_m);
+
+/*
+ * Do not use a power tier above floor until the device is charged, e.g. POWER_TIER_NETWORK
+ * on a critical battery event
+ */
+void geolocation_manager_set_power_floor(power_tier_e floor);
+
+/*
+ * Use percent instead of the real battery level to choose the power tier, to replay a
+ * battery drain scenario. Negative percent goes back to the real level.
+ */
+void geolocation_manager_set_battery_override(int percent);
+
+/*
+ * Choose which queued messages are dropped when a subscriber does not keep up
+ */
+void geolocation_manager_set_queue_policy(outbound_policy_e policy);
+
+/*
+ * Get outbound queue depth and drop counters
+ */
+void geolocation_manager_get_queue_stats(outbound_queue_stats_s *stats);
+
+/*
+ * Configure dead-band filter for outgoing position updates. NULL restores defaults.
+ */
+void geolocation_manager_set_deadband(const deadband_filter_config_s *config);
+
+/*
+ * Configure acceptance thresholds for raw fixes. NULL restores defaults.
+ */
+void geolocation_manager_set_fix_quality(const fix_quality_config_s *config);
+
+/*
+ * Enable or disable Kalman smoothing of outgoing positions (enabled by default)
+ */
+void geolocation_manager_set_smoothing(bool enable);
+
+/*
+ * Get sampling scheduler counters
+ */
+void geolocation_manager_get_sampling_stats(sampling_scheduler_stats_s *stats);
+
+/*
+ * Replace location manager with replay of a GPX, NMEA or CSV track file.
+ * Speed 1.0 is real time, N is N times faster, 0 is as fast as possible.
+ */
+bool geolocation_manager_start_replay(const char *path, double speed);
+
 /*
  * Stop geolocation service
  */
@@ -19,6 +19,25 @@
  * is within initial circle boundary or not. It is sent every one second.
  * 2. Satellites update - it contains number of satellites in view. It is send every 5 seconds.
  *
+ * Every message also carries its integer type id (see message_schema.h), which clients dispatch on.
+ *
+ * Besides the default consumer, other applications can subscribe on the "gps-service-control-port"
+ * port with their own message types, update interval and minimal displacement.
+ * Subscribing is also the readiness announcement: the subscriber gets a state snapshot message with
+ * the satellites count and the last known position right away.
+ * A subscriber asking for the "shm-ring" transport gets positions as records in a shared memory ring
+ * instead of bundles. The message port then only carries the ring handshake and a wakeup doorbell.
+ * Subscribers may push hazard zones, circles or polygons, with a "SET_ZONES" message. The service checks
+ * every fix against a spatial index of them and sends a zone event to the owner only on enter, exit or dwell,
+ * plus a position heartbeat every few minutes.
+ * A "GET_TRACK" message returns the journaled fixes since a given time in a compact delta encoded track,
+ * which a subscriber uses to fill the gap after it was disconnected.
+ * Raw fixes that are too old, too inaccurate or computed from too few satellites are dropped. Every position
+ * sent carries a quality class in its frame flags, and poor fixes never cause a zone transition.
+ *
+ * On low battery the service does not stop. It falls back to reduced rate GPS, network positioning and
+ * finally to a single network fix on significant motion, and sends a power tier message on every change.
+ *
  * Note that satellite data is not supported on Tizen Emulator.
  */
 
@@ -0,0 +1,162 @@
+#ifndef __hazard_zone_H__
+#define __hazard_zone_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Binary hazard zone list and geofence event shared by gpsservice and gpsservice-consumer.
+ * Keep this file identical in both projects.
+ *
+ * A client pushes its zones to the service as one byte payload under HAZARD_ZONE_KEY: a header,
+ * count fixed-size zones and the vertex table of polygon zones, which takes the rest of the payload.
+ * A polygon zone refers to vertex_count vertices starting at first_vertex, its center and radius are
+ * not used, radius_m of its events is 0. Polygons are simple, not closed explicitly and must not
+ * cross the antimeridian. The list replaces all zones the client pushed before, an empty list
+ * removes them. The service evaluates every fix against the zones and sends only transitions,
+ * each as a hazard_zone_event_s under HAZARD_ZONE_EVENT_KEY.
+ * Layout is packed and little-endian like position_frame_s.
+ */
+
+#define HAZARD_ZONE_KEY "hazard_zones"
+#define HAZARD_ZONE_EVENT_KEY "hazard_zone_event"
+#define HAZARD_ZONE_INSIDE_KEY "hazard_zones_inside"	/* uint32_t ids of zones the position is in */
+#define HAZARD_ZONE_MAGIC 0x5a /* 'Z' */
+#define HAZARD_ZONE_VERSION 2
+
+/* zone types */
+#define HAZARD_ZONE_TYPE_CIRCLE 1
+#define HAZARD_ZONE_TYPE_POLYGON 2
+
+/* transitions */
+#define HAZARD_ZONE_ENTER 1
+#define HAZARD_ZONE_EXIT 2
+#define HAZARD_ZONE_DWELL 3		/* still inside dwell_s seconds after entering */
+
+typedef struct __attribute__((packed))
+{
+	uint8_t magic;
+	uint8_t version;
+	uint16_t count;					/* zones after the header */
+	uint16_t entry_size;			/* sizeof(hazard_zone_s) of the sender */
+	uint16_t reserved;
+} hazard_zone_list_s;
+
+typedef struct __attribute__((packed))
+{
+	uint32_t id;
+	uint8_t type;
+	uint8_t reserved;
+	uint16_t dwell_s;				/* 0 - no dwell event */
+	double latitude;				/* degrees, center */
+	double longitude;				/* degrees, center */
+	float radius_m;
+	uint32_t first_vertex;			/* polygon only */
+	uint32_t vertex_count;			/* polygon only, at least 3 */
+} hazard_zone_s;
+
+typedef struct __attribute__((packed))
+{
+	double latitude;				/* degrees */
+	double longitude;				/* degrees */
+} hazard_zone_vertex_s;
+
+typedef struct __attribute__((packed))
+{
+	uint32_t id;
+	uint8_t transition;
+	uint8_t reserved[3];
+	int64_t timestamp;				/* time of the fix that caused it, seconds since epoch */
+	double latitude;				/* degrees */
+	double longitude;				/* degrees */
+	float distance_m;				/* from zone center, from the nearest edge for polygons */
+	float radius_m;
+} hazard_zone_event_s;
+
+typedef char __hazard_zone_size_check[(sizeof(hazard_zone_list_s) == 8 && sizeof(hazard_zone_s) == 36 &&
+		sizeof(hazard_zone_vertex_s) == 16 &&
+		sizeof(hazard_zone_event_s) == 40) ? 1 : -1];
+
+/*
+ * Fill list header, zones are written by the caller after it
+ */
+static inline void
+hazard_zone_list_init(hazard_zone_list_s *list, unsigned int count)
+{
+	list->magic = HAZARD_ZONE_MAGIC;
+	list->version = HAZARD_ZONE_VERSION;
+	list->count = (uint16_t)count;
+	list->entry_size = (uint16_t)sizeof(hazard_zone_s);
+	list->reserved = 0;
+}
+
+/*
+ * Validate received bytes and return them as a zone list, or NULL if they do not hold one.
+ * The returned pointer aliases the given buffer - no copy is made.
+ */
+static inline const hazard_zone_list_s *
+hazard_zone_list_decode(const void *bytes, size_t size)
+{
+	const hazard_zone_list_s *list = (const hazard_zone_list_s *)bytes;
+
+	if (!bytes || size < sizeof(hazard_zone_list_s))
+		return NULL;
+
+	if (list->magic != HAZARD_ZONE_MAGIC || list->version < 1 || list->entry_size < sizeof(hazard_zone_s) ||
+			sizeof(hazard_zone_list_s) + (size_t)list->count * list->entry_size > size)
+		return NULL;
+
+	return list;
+}
+
+/*
+ * Get zone of a validated list
+ */
+static inline const hazard_zone_s *
+hazard_zone_list_entry(const hazard_zone_list_s *list, unsigned int index)
+{
+	return (const hazard_zone_s *)((const char *)list + sizeof(hazard_zone_list_s) + (size_t)index * list->entry_size);
+}
+
+/*
+ * Get vertex table of a validated list of size bytes and the number of vertices in it
+ */
+static inline const hazard_zone_vertex_s *
+hazard_zone_list_vertices(const hazard_zone_list_s *list, size_t size, unsigned int *count)
+{
+	size_t offset = sizeof(hazard_zone_list_s) + (size_t)list->count * list->entry_size;
+
+	*count = (unsigned int)((size - offset) / sizeof(hazard_zone_vertex_s));
+
+	return (const hazard_zone_vertex_s *)((const char *)list + offset);
+}
+
+/*
+ * Check that a polygon zone refers to vertices within the vertex table
+ */
+static inline bool
+hazard_zone_polygon_valid(const hazard_zone_s *zone, unsigned int vertex_count)
+{
+	return zone->vertex_count >= 3 && zone->first_vertex <= vertex_count &&
+			zone->vertex_count <= vertex_count - zone->first_vertex;
+}
+
+/*
+ * Get transition name
+ */
+static inline const char *
+hazard_zone_transition_str(unsigned int transition)
+{
+	switch (transition) {
+	case HAZARD_ZONE_ENTER:
+		return "enter";
+	case HAZARD_ZONE_EXIT:
+		return "exit";
+	case HAZARD_ZONE_DWELL:
+		return "dwell";
+	default:
+		return "unknown";
+	}
+}
+
+#endif /* __hazard_zone_H__ */
@@ -0,0 +1,78 @@
+#ifndef __kalman_filter_H__
+#define __kalman_filter_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Constant-velocity Kalman filter for raw GPS fixes.
+ *
+ * Fixes are projected to a local tangent plane (east/north meters) around an origin that is
+ * re-anchored when the track moves too far from it. State is position and velocity on each
+ * axis, the process model is a constant velocity disturbed by white acceleration noise and the
+ * measurement is position with variance equal to squared horizontal accuracy. Since measurement
+ * noise is isotropic, east and north axes are independent 2-state filters, so every fix costs a
+ * fixed handful of floating point operations. Longitudes are taken the short way around, so a
+ * track crossing the antimeridian stays continuous; estimated longitudes are in [-180, 180).
+ *
+ * This unit depends only on the C library and libm.
+ */
+
+typedef struct
+{
+	double position;		/* m from origin */
+	double velocity;		/* m/s */
+	double p_pp;			/* position variance */
+	double p_pv;			/* position-velocity covariance */
+	double p_vv;			/* velocity variance */
+} kalman_axis_s;
+
+typedef struct
+{
+	double origin_latitude;
+	double origin_longitude;
+	double meters_per_deg_lon;
+	double process_noise;	/* acceleration spectral density, m^2/s^3 */
+	int64_t timestamp;
+
+	bool initialized;
+	kalman_axis_s east;
+	kalman_axis_s north;
+} kalman_filter_s;
+
+typedef struct
+{
+	double latitude;
+	double longitude;
+	double velocity_east;	/* m/s */
+	double velocity_north;	/* m/s */
+	double speed;			/* m/s */
+	double heading;			/* degrees from north */
+	double var_east;		/* position variance, m^2 */
+	double var_north;
+	double cov_east;		/* position-velocity covariance, m^2/s */
+	double cov_north;
+	double var_velocity_east;
+	double var_velocity_north;
+} kalman_estimate_s;
+
+/*
+ * Initialize filter. process_noise <= 0 selects a default suited for pedestrian and vehicle tracks.
+ */
+void kalman_filter_init(kalman_filter_s *kf, double process_noise);
+
+/*
+ * Ingest a fix and write smoothed estimate. Accuracy is 1-sigma horizontal error in meters,
+ * non-positive accuracy is replaced by a conservative default. A gap longer than
+ * KALMAN_MAX_GAP_S or a timestamp going backwards restarts the filter at the fix.
+ */
+void kalman_filter_update(kalman_filter_s *kf, double latitude, double longitude, double accuracy,
+		int64_t timestamp, kalman_estimate_s *estimate);
+
+/*
+ * Write current estimate without ingesting a fix
+ */
+void kalman_filter_get_estimate(const kalman_filter_s *kf, kalman_estimate_s *estimate);
+
+#define KALMAN_MAX_GAP_S 60
+
+#endif /* __kalman_filter_H__ */
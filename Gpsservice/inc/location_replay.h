@@ -0,0 +1,61 @@
+#ifndef __location_replay_H__
+#define __location_replay_H__
+
+#include <stdbool.h>
+#include "location_source.h"
+#include "track_file.h"
+
+/* Location source that replays a recorded track file (see track_file.h).
+ *
+ * Replay does not own a timer - the caller drives it with location_replay_poll(), which
+ * dispatches every fix that is due and tells when the next one is. This keeps replay free
+ * of the main loop, so the same code runs inside the service and in a plain host program.
+ *
+ * Delivered timestamps are the time of the poll that dispatched the fix, counted from the
+ * wall clock time of the first poll. At 1x they keep the recorded spacing; faster replay
+ * compresses it, so fixes are never stamped in the future and pass the age check.
+ * Fixes closer than the position callback interval are skipped, like the receiver does.
+ *
+ * Depends on the C library only.
+ */
+
+#define LOCATION_REPLAY_AS_FAST 0.0
+
+typedef struct
+{
+	unsigned int fixes_read;
+	unsigned int fixes_delivered;
+	unsigned int fixes_skipped;		/* closer than the position callback interval */
+	unsigned int parse_errors;
+	double elapsed_s;				/* since the first poll */
+	double fixes_per_second;		/* delivered */
+} location_replay_stats_s;
+
+/*
+ * Open track file for replay. Speed 1.0 is real time, N is N times faster and
+ * LOCATION_REPLAY_AS_FAST delivers fixes as fast as they are polled.
+ */
+bool location_replay_open(const char *path, double speed);
+
+/*
+ * Dispatch fixes due at time now (monotonic seconds). Returns seconds until the next fix,
+ * 0 if more fixes are due immediately or -1 at the end of the track.
+ */
+double location_replay_poll(double now);
+
+/*
+ * Get replay statistics
+ */
+void location_replay_get_stats(location_replay_stats_s *stats, double now);
+
+/*
+ * Close track file, also done by the destroy operation of the source
+ */
+void location_replay_close(void);
+
+/*
+ * Location source backed by the opened track file
+ */
+extern const location_source_ops_s location_replay_source;
+
+#endif /* __location_replay_H__ */
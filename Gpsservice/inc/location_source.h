@@ -0,0 +1,68 @@
+#ifndef __location_source_H__
+#define __location_source_H__
+
+#include <stdbool.h>
+#include <time.h>
+
+/* Source of position and satellite updates used by the geolocation manager.
+ *
+ * The default source is the Tizen location manager. A source is a table of operations, so
+ * the manager can be switched to another one (e.g. replay of a recorded track) at run time.
+ * Callback signatures match the Tizen location API.
+ */
+
+typedef void (*location_source_position_cb)(double latitude, double longitude, double altitude, time_t timestamp, void *user_data);
+typedef void (*location_source_satellite_cb)(int num_of_active, int num_of_inview, time_t timestamp, void *user_data);
+typedef bool (*location_source_satellite_info_cb)(unsigned int azimuth, unsigned int elevation, unsigned int prn,
+		int snr, bool is_in_use, void *user_data);
+
+typedef struct
+{
+	double latitude;
+	double longitude;
+	double altitude;
+	double speed;					/* km/h */
+	double heading;					/* degrees */
+	double horizontal_accuracy;		/* m */
+	double vertical_accuracy;		/* m */
+	time_t timestamp;
+} location_source_fix_s;
+
+typedef struct
+{
+	const char *name;
+
+	bool (*create)(void);
+	void (*destroy)(void);
+	bool (*start)(void);
+	void (*stop)(void);
+
+	/* Setting a callback again replaces the previous one and its interval */
+	bool (*set_position_cb)(location_source_position_cb cb, int interval, void *user_data);
+	void (*unset_position_cb)(void);
+	bool (*set_satellite_cb)(location_source_satellite_cb cb, int interval, void *user_data);
+	void (*unset_satellite_cb)(void);
+
+	/* Details of the last fix, valid in the position callback */
+	bool (*get_last_fix)(location_source_fix_s *fix);
+	bool (*get_velocity)(double *speed, double *heading);
+	bool (*get_accuracy)(double *horizontal, double *vertical);
+	bool (*get_satellites)(int *num_of_active, int *num_of_inview);
+
+	/* Details of every satellite in view, valid in the satellite callback. NULL if the source
+	 * does not have them. */
+	bool (*foreach_satellite)(location_source_satellite_info_cb cb, void *user_data);
+} location_source_ops_s;
+
+/*
+ * Location source backed by the Tizen location manager, GPS method
+ */
+extern const location_source_ops_s location_source_tizen;
+
+/*
+ * Location source backed by the Tizen location manager, WPS method, or hybrid when WPS is disabled.
+ * Satellite data is usually not available from this source.
+ */
+extern const location_source_ops_s location_source_tizen_network;
+
+#endif /* __location_source_H__ */
@@ -0,0 +1,30 @@
+#ifndef __motion_detector_H__
+#define __motion_detector_H__
+
+#include <stdbool.h>
+
+/* One-shot significant motion detection on the linear acceleration sensor.
+ *
+ * Motion is significant when acceleration magnitude exceeds MOTION_THRESHOLD in at least
+ * MOTION_HITS of the last MOTION_WINDOW samples, so a single bump of the device is ignored.
+ * The detector disarms itself before calling the callback.
+ */
+
+typedef void (*motion_detector_cb)(void *user_data);
+
+/*
+ * Arm detector. Returns false if the sensor is not available.
+ */
+bool motion_detector_start(motion_detector_cb cb, void *user_data);
+
+/*
+ * Disarm detector
+ */
+void motion_detector_stop(void);
+
+/*
+ * Check if detector is armed
+ */
+bool motion_detector_is_armed(void);
+
+#endif /* __motion_detector_H__ */
@@ -0,0 +1,94 @@
+#ifndef __outbound_queue_H__
+#define __outbound_queue_H__
+
+#include <stdbool.h>
+#include <bundle.h>
+
+/* Bounded queue of messages a subscriber did not accept, retried with jittered exponential backoff.
+ *
+ * Messages to a subscriber that has queued messages are queued behind them, so each subscriber
+ * gets its messages in order. Ordinary messages use at most OUTBOUND_QUEUE_NORMAL_MAX entries and
+ * are dropped by the queue policy when it is full. Critical messages (safety relevant transitions)
+ * are never dropped: they can use the whole OUTBOUND_QUEUE_CAPACITY and push ordinary messages out.
+ * If even that is not enough, everything queued for the subscriber is replaced by a single resync
+ * marker, and the subscriber gets the full current state instead once it accepts messages again.
+ *
+ * Like the other queues, time is a parameter.
+ */
+
+#define OUTBOUND_QUEUE_CAPACITY 64
+#define OUTBOUND_QUEUE_NORMAL_MAX 48
+
+typedef enum
+{
+	OUTBOUND_DROP_OLDEST = 0,		/* full queue drops its oldest ordinary message */
+	OUTBOUND_KEEP_LATEST			/* new message replaces a queued one of the same type, then drop oldest */
+} outbound_policy_e;
+
+typedef struct
+{
+	unsigned int depth;
+	unsigned int max_depth;
+	unsigned int critical_depth;
+	unsigned int queued;
+	unsigned int delivered;
+	unsigned int retries;
+	unsigned int dropped;			/* ordinary messages dropped when the queue was full */
+	unsigned int replaced;			/* ordinary messages replaced by a newer one of the same type */
+	unsigned int resyncs;			/* subscribers that overflowed with critical messages */
+} outbound_queue_stats_s;
+
+/*
+ * Send queued message, b is NULL for a resync marker. Returns true if the subscriber accepted it.
+ */
+typedef bool (*outbound_queue_send_cb)(const char *app_id, const char *port, bundle *b, void *user_data);
+
+/*
+ * Drop all queued messages, set policy and clear statistics
+ */
+void outbound_queue_init(outbound_policy_e policy);
+
+/*
+ * Change policy, keeping queued messages
+ */
+void outbound_queue_set_policy(outbound_policy_e policy);
+
+/*
+ * Get policy name
+ */
+const char *outbound_queue_policy_str(outbound_policy_e policy);
+
+/*
+ * Check if the subscriber has queued messages. New messages to it have to be queued too.
+ */
+bool outbound_queue_pending(const char *app_id, const char *port);
+
+/*
+ * Queue copy of the message for the subscriber. type is a SUBSCRIBER_MSG_* value.
+ * Returns false if the subscriber overflowed and will be resynced instead.
+ */
+bool outbound_queue_push(const char *app_id, const char *port, unsigned int type, bool critical,
+		bundle *b, double now);
+
+/*
+ * Get seconds until the next retry is due, 0 if it is due now and negative if the queue is empty
+ */
+double outbound_queue_next_retry(double now);
+
+/*
+ * Send due messages in order. A subscriber that fails is backed off and its remaining messages wait.
+ * Returns number of messages delivered.
+ */
+unsigned int outbound_queue_retry(outbound_queue_send_cb cb, void *user_data, double now);
+
+/*
+ * Drop all messages queued for the subscriber, e.g. when it is removed
+ */
+void outbound_queue_drop(const char *app_id, const char *port);
+
+/*
+ * Get queue depth and counters
+ */
+void outbound_queue_get_stats(outbound_queue_stats_s *stats);
+
+#endif /* __outbound_queue_H__ */
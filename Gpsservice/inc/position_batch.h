@@ -0,0 +1,44 @@
+#ifndef __position_batch_H__
+#define __position_batch_H__
+
+#include <stdbool.h>
+#include "position_frame.h"
+
+#define POSITION_BATCH_CAPACITY 64
+
+/*
+ * Fixed-capacity ring buffer of position frames waiting to be sent as one batch.
+ * flush_count is the number of buffered frames that triggers a flush, clamped to
+ * [1, POSITION_BATCH_CAPACITY]. A flush_count of 1 disables batching.
+ */
+void position_batch_init(unsigned int flush_count);
+
+/*
+ * Change flush count, keeping buffered frames
+ */
+void position_batch_set_flush_count(unsigned int flush_count);
+
+/*
+ * Get flush count
+ */
+unsigned int position_batch_get_flush_count(void);
+
+/*
+ * Append frame to the buffer. If the buffer is full the oldest frame is overwritten,
+ * which can only happen if the caller ignores the return value.
+ * Returns true when the buffer has reached flush count and should be drained.
+ */
+bool position_batch_push(const position_frame_s *frame);
+
+/*
+ * Get number of buffered frames
+ */
+unsigned int position_batch_count(void);
+
+/*
+ * Move up to max_frames buffered frames, oldest first, into a contiguous array.
+ * Returns number of frames copied.
+ */
+unsigned int position_batch_drain(position_frame_s *out, unsigned int max_frames);
+
+#endif /* __position_batch_H__ */
@@ -0,0 +1,110 @@
+#ifndef __position_frame_H__
+#define __position_frame_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Binary position record shared by gpsservice and gpsservice-consumer.
+ * Keep this file identical in both projects.
+ *
+ * The record is sent as a single byte payload under POSITION_FRAME_KEY. Its layout is packed
+ * and little-endian (all supported targets are little-endian), so the receiver can read it
+ * in place from the buffer returned by bundle_get_byte() without copying or parsing.
+ *
+ * Versioning: fields are only ever appended. A newer sender increases version and size,
+ * an older receiver accepts any frame that is at least as large as the layout it knows.
+ */
+
+#define POSITION_FRAME_KEY "position_frame"
+#define POSITION_FRAME_MAGIC 0x50 /* 'P' */
+#define POSITION_FRAME_VERSION 1
+
+/* flags */
+#define POSITION_FRAME_FLAG_SMOOTHED 0x01	/* position is a filtered estimate, not a raw fix */
+#define POSITION_FRAME_FLAG_STALE 0x02		/* last known position, older than a live fix can be */
+#define POSITION_FRAME_QUALITY_MASK 0x30	/* quality class of the raw fix, see position_frame_quality() */
+#define POSITION_FRAME_QUALITY_SHIFT 4
+
+/* quality classes */
+#define POSITION_FRAME_QUALITY_UNKNOWN 0	/* source did not report accuracy */
+#define POSITION_FRAME_QUALITY_GOOD 1
+#define POSITION_FRAME_QUALITY_FAIR 2
+#define POSITION_FRAME_QUALITY_POOR 3		/* accepted, but not trusted for zone transitions */
+
+typedef struct __attribute__((packed))
+{
+	uint8_t magic;
+	uint8_t version;
+	uint16_t size;					/* sizeof(position_frame_s) of the sender */
+	uint32_t flags;
+	int64_t timestamp;				/* fix time, seconds since epoch */
+	double latitude;				/* degrees */
+	double longitude;				/* degrees */
+	double altitude;				/* m */
+	float horizontal_accuracy;		/* m */
+	float vertical_accuracy;		/* m */
+	float speed;					/* km/h */
+	float heading;					/* degrees from north */
+} position_frame_s;
+
+typedef char __position_frame_size_check[(sizeof(position_frame_s) == 56) ? 1 : -1];
+
+/*
+ * Fill frame header and fields
+ */
+static inline void
+position_frame_init(position_frame_s *frame, double latitude, double longitude, double altitude, int64_t timestamp)
+{
+	frame->magic = POSITION_FRAME_MAGIC;
+	frame->version = POSITION_FRAME_VERSION;
+	frame->size = (uint16_t)sizeof(position_frame_s);
+	frame->flags = 0;
+	frame->timestamp = timestamp;
+	frame->latitude = latitude;
+	frame->longitude = longitude;
+	frame->altitude = altitude;
+	frame->horizontal_accuracy = 0.0f;
+	frame->vertical_accuracy = 0.0f;
+	frame->speed = 0.0f;
+	frame->heading = 0.0f;
+}
+
+/*
+ * Get quality class of frame
+ */
+static inline unsigned int
+position_frame_quality(const position_frame_s *frame)
+{
+	return (frame->flags & POSITION_FRAME_QUALITY_MASK) >> POSITION_FRAME_QUALITY_SHIFT;
+}
+
+/*
+ * Set quality class of frame
+ */
+static inline void
+position_frame_set_quality(position_frame_s *frame, unsigned int quality)
+{
+	frame->flags = (frame->flags & ~POSITION_FRAME_QUALITY_MASK) |
+			((quality << POSITION_FRAME_QUALITY_SHIFT) & POSITION_FRAME_QUALITY_MASK);
+}
+
+/*
+ * Validate received bytes and return them as a frame, or NULL if they do not hold one.
+ * The returned pointer aliases the given buffer - no copy is made.
+ */
+static inline const position_frame_s *
+position_frame_decode(const void *bytes, size_t size)
+{
+	const position_frame_s *frame = (const position_frame_s *)bytes;
+
+	if (!bytes || size < sizeof(position_frame_s))
+		return NULL;
+
+	if (frame->magic != POSITION_FRAME_MAGIC || frame->version < 1 || frame->size > size || frame->size < sizeof(position_frame_s))
+		return NULL;
+
+	return frame;
+}
+
+#endif /* __position_frame_H__ */
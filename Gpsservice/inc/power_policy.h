@@ -0,0 +1,82 @@
+#ifndef __power_policy_H__
+#define __power_policy_H__
+
+#include <stdbool.h>
+
+/* Chooses how positions are acquired as the battery drains, instead of stopping the service.
+ *
+ * Tiers from the most to the least power hungry:
+ * - GPS at the rate chosen by the sampling scheduler (1 Hz near hazards)
+ * - GPS limited to one fix per POWER_REDUCED_INTERVAL seconds
+ * - network positioning (WPS, or hybrid when WPS is off) limited to POWER_NETWORK_INTERVAL
+ * - positioning off, a single network fix is taken when significant motion is detected
+ *
+ * The tier follows the battery level with a hysteresis margin when going back up. A low
+ * battery event from the platform sets a floor the tier can not go above until the
+ * device is charged.
+ *
+ * Time spent, fixes, observed battery drop and modeled energy are accounted per tier, so the
+ * cost of each tier can be compared in a replayed scenario. Like the sampling scheduler, the
+ * policy takes time as a parameter and has no platform dependency.
+ */
+
+typedef enum
+{
+	POWER_TIER_GPS = 0,
+	POWER_TIER_GPS_REDUCED,
+	POWER_TIER_NETWORK,
+	POWER_TIER_MOTION,
+	POWER_TIER_COUNT
+} power_tier_e;
+
+typedef struct
+{
+	unsigned int transitions;
+	double seconds_in_tier[POWER_TIER_COUNT];
+	unsigned int fixes_in_tier[POWER_TIER_COUNT];
+	unsigned int battery_used_in_tier[POWER_TIER_COUNT];	/* percent drop observed while not charging */
+	double energy_in_tier[POWER_TIER_COUNT];				/* J, from nominal power of the tier */
+} power_policy_stats_s;
+
+/*
+ * Reset policy to the GPS tier and clear statistics
+ */
+void power_policy_init(double now);
+
+/*
+ * Feed battery state and return tier to use. battery_percent is 0-100 or negative when unknown.
+ */
+power_tier_e power_policy_update(int battery_percent, bool charging, double now);
+
+/*
+ * Set lowest allowed tier, e.g. POWER_TIER_NETWORK on a critical battery event.
+ * Cleared when charging starts. Returns tier to use.
+ */
+power_tier_e power_policy_set_floor(power_tier_e floor, double now);
+
+/*
+ * Get current tier
+ */
+power_tier_e power_policy_get_tier(void);
+
+/*
+ * Get shortest position update interval allowed in given tier, in seconds, 0 if positioning is off
+ */
+int power_policy_min_interval(power_tier_e tier);
+
+/*
+ * Count fix acquired in the current tier
+ */
+void power_policy_count_fix(void);
+
+/*
+ * Get tier name
+ */
+const char *power_policy_tier_str(power_tier_e tier);
+
+/*
+ * Get statistics accumulated up to now
+ */
+void power_policy_get_stats(power_policy_stats_s *stats, double now);
+
+#endif /* __power_policy_H__ */
@@ -0,0 +1,61 @@
+#ifndef __sampling_scheduler_H__
+#define __sampling_scheduler_H__
+
+#include <stdbool.h>
+
+/* Chooses the GPS position update interval from distance to the nearest hazard zone,
+ * current speed and battery level.
+ *
+ * The target interval is the time the device needs to cover SAMPLING_TRAVEL_FRACTION of the
+ * distance to the nearest hazard, stretched when the battery is low. It is then mapped to one
+ * of the fixed tiers below. Moving to a faster tier happens immediately, moving to a slower
+ * tier happens one tier at a time and only after the slower target has been seen for
+ * SAMPLING_HOLD_DECISIONS consecutive decisions, so the rate does not oscillate on jittery input.
+ *
+ * The scheduler takes time as a parameter and has no platform dependency, so it can be driven
+ * by a simulated location source.
+ */
+
+#define SAMPLING_TIER_COUNT 6
+#define SAMPLING_DISTANCE_UNKNOWN -1.0
+
+typedef struct
+{
+	unsigned int decisions;
+	unsigned int faster_changes;
+	unsigned int slower_changes;
+	unsigned int held_changes;			/* slower changes postponed by hysteresis */
+	double seconds_in_tier[SAMPLING_TIER_COUNT];
+	double fixes_requested;				/* sum of seconds_in_tier / tier interval */
+	double fixes_at_fastest;			/* fixes a constant fastest tier would have requested */
+} sampling_scheduler_stats_s;
+
+/*
+ * Reset scheduler to the fastest tier and clear statistics
+ */
+void sampling_scheduler_init(double now);
+
+/*
+ * Feed new inputs and return position update interval to use, in seconds.
+ * distance_m is the distance to the nearest active hazard zone, SAMPLING_DISTANCE_UNKNOWN when
+ * hazard zones are not known (fastest tier is used), or a very large value when there are none.
+ * speed_kmh is the current speed, battery_percent is 0-100 or negative when unknown.
+ */
+int sampling_scheduler_update(double distance_m, double speed_kmh, int battery_percent, double now);
+
+/*
+ * Get currently selected interval in seconds
+ */
+int sampling_scheduler_get_interval(void);
+
+/*
+ * Get interval of given tier in seconds, or 0 for invalid tier
+ */
+int sampling_scheduler_tier_interval(int tier);
+
+/*
+ * Get statistics accumulated up to now
+ */
+void sampling_scheduler_get_stats(sampling_scheduler_stats_s *stats, double now);
+
+#endif /* __sampling_scheduler_H__ */
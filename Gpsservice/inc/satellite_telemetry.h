@@ -0,0 +1,63 @@
+#ifndef __satellite_telemetry_H__
+#define __satellite_telemetry_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "satellite_frame.h"
+
+/* Encoder of per-satellite telemetry frames (see satellite_frame.h).
+ *
+ * Satellites of one update are collected between satellite_telemetry_begin() and
+ * satellite_telemetry_encode(), which writes a delta against the previously encoded update,
+ * or a key frame every SATELLITE_TELEMETRY_KEY_INTERVAL frames and whenever the delta would
+ * have as many entries as the update.
+ *
+ * Depends on the C library only.
+ */
+
+#define SATELLITE_TELEMETRY_KEY_INTERVAL 12
+#define SATELLITE_TELEMETRY_BUFFER_SIZE (sizeof(satellite_frame_s) + SATELLITE_FRAME_MAX * sizeof(satellite_entry_s))
+
+typedef struct
+{
+	unsigned int frames;
+	unsigned int key_frames;
+	unsigned int entries_sent;
+	unsigned int entries_in_view;	/* sum over frames - what key frames only would send */
+	unsigned int bytes;
+} satellite_telemetry_stats_s;
+
+/*
+ * Reset encoder, the next frame is a key frame
+ */
+void satellite_telemetry_init(void);
+
+/*
+ * Start collecting satellites of an update
+ */
+void satellite_telemetry_begin(int num_of_active, int num_of_inview, int64_t timestamp);
+
+/*
+ * Add satellite to the update. Satellites over SATELLITE_FRAME_MAX are ignored.
+ */
+void satellite_telemetry_add(unsigned int prn, unsigned int azimuth, unsigned int elevation, int snr, bool in_use);
+
+/*
+ * Encode collected update into buffer of SATELLITE_TELEMETRY_BUFFER_SIZE bytes.
+ * Returns encoded size.
+ */
+size_t satellite_telemetry_encode(void *buffer);
+
+/*
+ * Encode key frame of the last encoded update, with its sequence number, for a receiver
+ * that joins the stream. Returns encoded size, or 0 if nothing has been encoded yet.
+ */
+size_t satellite_telemetry_encode_key_frame(void *buffer);
+
+/*
+ * Get encoder counters
+ */
+void satellite_telemetry_get_stats(satellite_telemetry_stats_s *stats);
+
+#endif /* __satellite_telemetry_H__ */
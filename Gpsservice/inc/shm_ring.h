@@ -0,0 +1,122 @@
+#ifndef __shm_ring_H__
+#define __shm_ring_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Single-producer single-consumer ring of fixed-size records in POSIX shared memory,
+ * shared by gpsservice and gpsservice-consumer. Keep this file identical in both projects.
+ *
+ * The service creates the ring and writes records, the consumer attaches by name and reads them
+ * in place. Head and tail are free running counters on separate cache lines, published with
+ * release/acquire ordering, so neither side takes a lock or makes a system call per record.
+ *
+ * Message port is only used for the handshake carrying the ring name and for a doorbell. The
+ * consumer arms the doorbell when it has drained the ring, and the producer sends a doorbell only
+ * for the first record written after that, so a burst of records costs one wakeup.
+ */
+
+#define SHM_RING_MAGIC 0x52535047	/* "GPSR" */
+#define SHM_RING_VERSION 1
+#define SHM_RING_CAPACITY 256		/* records, power of two */
+#define SHM_RING_PAYLOAD_SIZE 112
+#define SHM_RING_NAME_SIZE 64
+
+/* record types */
+#define SHM_RING_RECORD_POSITION 1	/* payload is a position_frame_s */
+
+#define SHM_RING_CACHE_LINE 64
+
+typedef struct __attribute__((packed))
+{
+	uint32_t sequence;
+	uint16_t type;
+	uint16_t size;				/* payload bytes used */
+	int64_t written_ns;			/* CLOCK_MONOTONIC time the record was written */
+	uint8_t payload[SHM_RING_PAYLOAD_SIZE];
+} shm_ring_record_s;
+
+typedef char __shm_ring_record_size_check[(sizeof(shm_ring_record_s) == 128) ? 1 : -1];
+
+typedef struct
+{
+	uint32_t magic;
+	uint16_t version;
+	uint16_t record_size;
+	uint32_t capacity;
+	uint32_t dropped;			/* records not written because the ring was full */
+	uint8_t pad0[SHM_RING_CACHE_LINE - 16];
+
+	uint32_t head;				/* written by producer */
+	uint8_t pad1[SHM_RING_CACHE_LINE - 4];
+
+	uint32_t tail;				/* written by consumer */
+	uint32_t doorbell_armed;	/* set by consumer, cleared by producer */
+	uint8_t pad2[SHM_RING_CACHE_LINE - 8];
+} shm_ring_header_s;
+
+typedef struct
+{
+	unsigned int written;
+	unsigned int read;
+	unsigned int dropped;
+	unsigned int doorbells;
+	double mean_latency_us;		/* write to read, consumer side only */
+	double max_latency_us;
+} shm_ring_stats_s;
+
+typedef struct _shm_ring_s shm_ring_s;
+
+/*
+ * Create ring in shared memory object name, e.g. "/gpsservice-ring". An existing object with the
+ * same name is replaced. Returns NULL on failure.
+ */
+shm_ring_s *shm_ring_create(const char *name);
+
+/*
+ * Attach to ring created by the producer. Records written before are skipped, the consumer gets
+ * the current state in the state snapshot. Returns NULL if the ring does not exist or has an
+ * unknown layout.
+ */
+shm_ring_s *shm_ring_attach(const char *name);
+
+/*
+ * Unmap ring. The producer also removes the shared memory object.
+ */
+void shm_ring_close(shm_ring_s *ring);
+
+/*
+ * Get name of the shared memory object
+ */
+const char *shm_ring_name(const shm_ring_s *ring);
+
+/*
+ * Write record. Returns false if the ring is full or size exceeds SHM_RING_PAYLOAD_SIZE.
+ * doorbell is set when the consumer is waiting and has to be woken up.
+ */
+bool shm_ring_write(shm_ring_s *ring, uint16_t type, const void *payload, size_t size, bool *doorbell);
+
+/*
+ * Get oldest unread record in place, or NULL if the ring is empty. The record stays valid
+ * until shm_ring_release().
+ */
+const shm_ring_record_s *shm_ring_peek(shm_ring_s *ring);
+
+/*
+ * Release record returned by shm_ring_peek()
+ */
+void shm_ring_release(shm_ring_s *ring);
+
+/*
+ * Arm doorbell after draining the ring. Returns false if records arrived meanwhile - the
+ * caller has to drain again instead of waiting.
+ */
+bool shm_ring_arm_doorbell(shm_ring_s *ring);
+
+/*
+ * Get counters of this side of the ring
+ */
+void shm_ring_get_stats(const shm_ring_s *ring, shm_ring_stats_s *stats);
+
+#endif /* __shm_ring_H__ */
@@ -0,0 +1,92 @@
+#ifndef __subscriber_registry_H__
+#define __subscriber_registry_H__
+
+#include <stdbool.h>
+#include "position_frame.h"
+
+/* Registry of applications receiving messages from the GPS service.
+ *
+ * Clients subscribe over the service control port with the message types they want,
+ * the minimal interval between position updates and the minimal displacement between
+ * position updates. Every message is encoded once and sent to each interested subscriber.
+ * Subscribers whose port disappeared, or that failed SUBSCRIBER_MAX_FAILURES sends in a row,
+ * are removed unless they are persistent.
+ */
+
+#define SUBSCRIBER_MAX 8
+#define SUBSCRIBER_APP_ID_SIZE 128
+#define SUBSCRIBER_PORT_SIZE 64
+#define SUBSCRIBER_MAX_FAILURES 5
+
+/* Message types, combined as a bit mask */
+#define SUBSCRIBER_MSG_POSITION 0x01
+#define SUBSCRIBER_MSG_SATELLITES 0x02
+#define SUBSCRIBER_MSG_STATUS 0x04
+#define SUBSCRIBER_MSG_ZONE_EVENT 0x08
+#define SUBSCRIBER_MSG_HEARTBEAT 0x10
+#define SUBSCRIBER_MSG_ALL 0xffffffffu
+
+typedef struct
+{
+	char app_id[SUBSCRIBER_APP_ID_SIZE];
+	char port[SUBSCRIBER_PORT_SIZE];
+	unsigned int types;
+	double min_interval_s;
+	double min_displacement_m;
+	bool persistent;
+	bool ring;						/* positions are written to the shared memory ring */
+
+	/* delivery state */
+	bool has_last;
+	int64_t last_timestamp;
+	double last_latitude;
+	double last_longitude;
+	unsigned int failures;
+	unsigned int delivered;
+	unsigned int decimated;
+} subscriber_s;
+
+/*
+ * Remove all subscribers
+ */
+void subscriber_registry_init(void);
+
+/*
+ * Add subscriber or update parameters of an existing one with the same app id and port.
+ * Returns the subscriber, or NULL if the registry is full.
+ */
+subscriber_s *subscriber_registry_add(const char *app_id, const char *port, unsigned int types,
+		double min_interval_s, double min_displacement_m, bool persistent);
+
+/*
+ * Remove subscriber. Persistent subscribers are only removed when force is set.
+ */
+bool subscriber_registry_remove(const char *app_id, const char *port, bool force);
+
+/*
+ * Find subscriber by app id and port. Returns NULL if it is not registered.
+ */
+subscriber_s *subscriber_registry_find(const char *app_id, const char *port);
+
+/*
+ * Get number of subscribers
+ */
+int subscriber_registry_count(void);
+
+/*
+ * Get subscriber by index, 0 <= index < subscriber_registry_count()
+ */
+subscriber_s *subscriber_registry_get(int index);
+
+/*
+ * Check whether the subscriber wants a message of given type. For position messages frame is the
+ * newest fix and the subscriber's interval and displacement limits are applied.
+ */
+bool subscriber_registry_wants(subscriber_s *subscriber, unsigned int type, const position_frame_s *frame);
+
+/*
+ * Record outcome of a send. Returns false if the subscriber should be pruned.
+ */
+bool subscriber_registry_report(subscriber_s *subscriber, bool delivered, const position_frame_s *frame);
+
+#endif /* __subscriber_registry_H__ */
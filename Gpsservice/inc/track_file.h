@@ -0,0 +1,63 @@
+#ifndef __track_file_H__
+#define __track_file_H__
+
+#include <stdbool.h>
+
+/* Streaming reader of recorded tracks. Supported formats, detected from file content:
+ * - GPX: <trkpt lat lon> with optional <ele>, <time>, <speed> (m/s), <course>, <hdop>, <sat>
+ * - NMEA 0183: RMC and GGA sentences of any talker, checksums are verified when present
+ * - CSV: time,latitude,longitude[,altitude[,speed_kmh[,heading[,accuracy]]]] where time is
+ *   seconds since epoch or ISO 8601, lines starting with '#' and a header line are skipped
+ *
+ * Depends on the C library only.
+ */
+
+typedef enum
+{
+	TRACK_FILE_UNKNOWN = 0,
+	TRACK_FILE_GPX,
+	TRACK_FILE_NMEA,
+	TRACK_FILE_CSV
+} track_file_format_e;
+
+typedef struct
+{
+	double timestamp;				/* seconds since epoch, may be fractional */
+	double latitude;
+	double longitude;
+	double altitude;				/* m, 0 if unknown */
+	double speed;					/* km/h, 0 if unknown */
+	double heading;					/* degrees, 0 if unknown */
+	double horizontal_accuracy;		/* m, 0 if unknown */
+	double vertical_accuracy;		/* m, 0 if unknown */
+	int satellites;					/* satellites in use, 0 if unknown */
+} track_file_fix_s;
+
+typedef struct track_file_s track_file_s;
+
+/*
+ * Open track file. Returns NULL if the file can not be read or its format is unknown.
+ */
+track_file_s *track_file_open(const char *path);
+
+/*
+ * Read next fix. Returns false at end of file.
+ */
+bool track_file_next(track_file_s *file, track_file_fix_s *fix);
+
+/*
+ * Get detected format
+ */
+track_file_format_e track_file_get_format(const track_file_s *file);
+
+/*
+ * Get number of lines or elements that could not be parsed
+ */
+unsigned int track_file_get_errors(const track_file_s *file);
+
+/*
+ * Close track file
+ */
+void track_file_close(track_file_s *file);
+
+#endif /* __track_file_H__ */
@@ -0,0 +1,85 @@
+#ifndef __track_journal_H__
+#define __track_journal_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "position_frame.h"
+
+/* Append-only binary journal of every position fix.
+ *
+ * Fixes are stored as fixed-size records in segment files of a fixed size that are written
+ * through a shared memory mapping. A segment is a header followed by blocks of
+ * TRACK_BLOCK_RECORDS records. Each block header keeps the number of valid records and the
+ * CRC-32 of those records in a single 64-bit word that is stored after the record itself,
+ * so after a crash a block is either consistent or detected as damaged by its CRC.
+ * Appending is a copy into the mapping and a CRC update - no allocation and no system call,
+ * except when a full segment is rotated.
+ *
+ * Closed segments can be compacted into zlib-compressed archives, which is safe to do from
+ * a worker thread because only segments older than the one being written are touched.
+ * Records are kept in time order, so a range scan skips whole segments, archives and blocks
+ * by their time range without reading them.
+ *
+ * Depends on the C library, POSIX file API and zlib.
+ */
+
+#define TRACK_BLOCK_RECORDS 64
+#define TRACK_SEGMENT_BLOCKS 256
+
+typedef struct __attribute__((packed))
+{
+	int64_t timestamp;			/* seconds since epoch */
+	double latitude;
+	double longitude;
+	float altitude;
+	float horizontal_accuracy;
+	float speed;				/* km/h */
+	float heading;				/* degrees */
+	uint32_t flags;				/* position_frame_s flags */
+	uint32_t reserved;
+} track_record_s;
+
+/*
+ * Return false to stop scanning
+ */
+typedef bool (*track_journal_record_cb)(const track_record_s *record, void *user_data);
+
+/*
+ * Open journal in given directory, creating it if needed, and continue after the last valid record
+ */
+bool track_journal_open(const char *dir);
+
+/*
+ * Flush and close journal
+ */
+void track_journal_close(void);
+
+/*
+ * Append fix. Fixes older than the last appended one are dropped to keep the journal sorted.
+ */
+bool track_journal_append(const position_frame_s *frame);
+
+/*
+ * Get sequence number of the segment being written, or 0 if the journal is closed
+ */
+unsigned int track_journal_current_segment(void);
+
+/*
+ * Get number of dropped out-of-order fixes
+ */
+unsigned int track_journal_dropped_count(void);
+
+/*
+ * Compress segments with sequence number lower than before_segment - keep_segments into archives
+ * and remove them. Does not use journal state, so it can run in a worker thread.
+ * Returns number of compacted segments or -1 on error.
+ */
+int track_journal_compact(const char *dir, unsigned int before_segment, unsigned int keep_segments);
+
+/*
+ * Call cb for every valid record with from <= timestamp <= to, oldest first, reading archives
+ * and segments of given directory. Returns number of records passed to cb or -1 on error.
+ */
+int track_journal_scan(const char *dir, int64_t from, int64_t to, track_journal_record_cb cb, void *user_data);
+
+#endif /* __track_journal_H__ */
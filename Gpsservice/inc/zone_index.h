@@ -0,0 +1,65 @@
+#ifndef __zone_index_H__
+#define __zone_index_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "hazard_zone.h"
+
+/* Spatial index over circle and polygon hazard zones.
+ *
+ * The index is a hash of a uniform grid of ZONE_INDEX_CELL_DEG degree cells. Each zone is entered
+ * in every cell its bounding box overlaps, so a containment query hashes the cell of the point and
+ * tests only the zones entered there. Zones covering more than ZONE_INDEX_MAX_CELLS cells are kept
+ * in a separate list that every query tests. The index is built once from a zone array and does
+ * not change until it is built again - zones are replaced as a whole by their owner.
+ *
+ * Distances are computed in a local equirectangular projection around the point, which is within
+ * a fraction of a percent for zones up to tens of kilometers. Depends on the C library only.
+ */
+
+#define ZONE_INDEX_CELL_DEG 0.01		/* about 1.1 km of latitude */
+#define ZONE_INDEX_MAX_CELLS 256
+
+typedef struct zone_index_s zone_index_s;
+
+/*
+ * Create empty index
+ */
+zone_index_s *zone_index_create(void);
+
+/*
+ * Destroy index
+ */
+void zone_index_destroy(zone_index_s *index);
+
+/*
+ * Build index over count zones. Polygon zones refer to vertices. Both arrays are used in place
+ * and must not change until the next build. Returns false if memory could not be allocated,
+ * the index is empty then.
+ */
+bool zone_index_build(zone_index_s *index, const hazard_zone_s *zones, unsigned int count,
+		const hazard_zone_vertex_s *vertices);
+
+/*
+ * Write indices of up to max_zones zones containing the point to out. Returns number written.
+ */
+unsigned int zone_index_query(const zone_index_s *index, double latitude, double longitude,
+		uint32_t *out, unsigned int max_zones);
+
+/*
+ * Get distance in meters from the point to the edge of zone, negative inside it
+ */
+double zone_index_edge_distance_m(const zone_index_s *index, unsigned int zone, double latitude, double longitude);
+
+/*
+ * Get distance in meters from the point to the center of a circle zone, or to the edge of a polygon
+ */
+double zone_index_event_distance_m(const zone_index_s *index, unsigned int zone, double latitude, double longitude);
+
+/*
+ * Get distance in meters from the point to the nearest zone edge, 0 inside a zone. Zones further
+ * than a few cells are not searched, the result is then a lower bound. Negative if there are no zones.
+ */
+double zone_index_nearest_m(const zone_index_s *index, double latitude, double longitude);
+
+#endif /* __zone_index_H__ */
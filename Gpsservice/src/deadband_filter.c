@@ -0,0 +1,141 @@
+#include <math.h>
+#include "deadband_filter.h"
+
+#define DEADBAND_MIN_DISTANCE_M 10.0
+#define DEADBAND_ACCURACY_FACTOR 1.0
+#define DEADBAND_MAX_HEADING_CHANGE_DEG 30.0
+#define DEADBAND_MIN_HEADING_SPEED_KMH 3.0
+#define DEADBAND_HEARTBEAT_S 60.0
+
+#define EARTH_RADIUS_M 6371008.8
+#define DEG_TO_RAD (M_PI / 180.0)
+
+static struct
+{
+	deadband_filter_config_s config;
+	position_frame_s last;
+
+	bool has_last;
+	unsigned int counts[DEADBAND_DECISION_COUNT];
+} s_deadband_data = {
+	.has_last = false
+};
+
+static double __distance_m(const position_frame_s *a, const position_frame_s *b);
+static double __heading_change_deg(double from, double to);
+static deadband_decision_e __decide(const position_frame_s *frame);
+
+
+void
+deadband_filter_default_config(deadband_filter_config_s *config)
+{
+	config->min_distance_m = DEADBAND_MIN_DISTANCE_M;
+	config->accuracy_factor = DEADBAND_ACCURACY_FACTOR;
+	config->max_heading_change_deg = DEADBAND_MAX_HEADING_CHANGE_DEG;
+	config->min_heading_speed_kmh = DEADBAND_MIN_HEADING_SPEED_KMH;
+	config->heartbeat_s = DEADBAND_HEARTBEAT_S;
+}
+
+void
+deadband_filter_init(const deadband_filter_config_s *config)
+{
+	int i;
+
+	if (config)
+		s_deadband_data.config = *config;
+	else
+		deadband_filter_default_config(&s_deadband_data.config);
+
+	s_deadband_data.has_last = false;
+	for (i = 0; i < DEADBAND_DECISION_COUNT; i++)
+		s_deadband_data.counts[i] = 0;
+}
+
+deadband_decision_e
+deadband_filter_check(const position_frame_s *frame)
+{
+	deadband_decision_e decision = __decide(frame);
+
+	s_deadband_data.counts[decision]++;
+
+	if (decision != DEADBAND_SUPPRESSED) {
+		s_deadband_data.last = *frame;
+		s_deadband_data.has_last = true;
+	}
+
+	return decision;
+}
+
+unsigned int
+deadband_filter_get_count(deadband_decision_e decision)
+{
+	if (decision < 0 || decision >= DEADBAND_DECISION_COUNT)
+		return 0;
+
+	return s_deadband_data.counts[decision];
+}
+
+const char *
+deadband_filter_decision_str(deadband_decision_e decision)
+{
+	switch (decision) {
+	case DEADBAND_PASS_FIRST:
+		return "first";
+	case DEADBAND_PASS_MOVED:
+		return "moved";
+	case DEADBAND_PASS_HEADING:
+		return "heading";
+	case DEADBAND_PASS_HEARTBEAT:
+		return "heartbeat";
+	case DEADBAND_SUPPRESSED:
+		return "suppressed";
+	default:
+		return "unknown";
+	}
+}
+
+static deadband_decision_e
+__decide(const position_frame_s *frame)
+{
+	const deadband_filter_config_s *config = &s_deadband_data.config;
+	const position_frame_s *last = &s_deadband_data.last;
+	double threshold;
+
+	if (!s_deadband_data.has_last)
+		return DEADBAND_PASS_FIRST;
+
+	threshold = config->accuracy_factor * hypot(last->horizontal_accuracy, frame->horizontal_accuracy);
+	if (threshold < config->min_distance_m)
+		threshold = config->min_distance_m;
+
+	if (__distance_m(last, frame) > threshold)
+		return DEADBAND_PASS_MOVED;
+
+	if (frame->speed >= config->min_heading_speed_kmh && last->speed >= config->min_heading_speed_kmh &&
+			__heading_change_deg(last->heading, frame->heading) > config->max_heading_change_deg)
+		return DEADBAND_PASS_HEADING;
+
+	if (frame->timestamp - last->timestamp >= config->heartbeat_s)
+		return DEADBAND_PASS_HEARTBEAT;
+
+	return DEADBAND_SUPPRESSED;
+}
+
+static double
+__distance_m(const position_frame_s *a, const position_frame_s *b)
+{
+	double dlat = (b->latitude - a->latitude) * DEG_TO_RAD;
+	double dlon = (b->longitude - a->longitude) * DEG_TO_RAD;
+	double h = sin(dlat / 2) * sin(dlat / 2) +
+			cos(a->latitude * DEG_TO_RAD) * cos(b->latitude * DEG_TO_RAD) * sin(dlon / 2) * sin(dlon / 2);
+
+	return 2.0 * EARTH_RADIUS_M * asin(sqrt(h));
+}
+
+static double
+__heading_change_deg(double from, double to)
+{
+	double change = fabs(fmod(to - from, 360.0));
+
+	return change > 180.0 ? 360.0 - change : change;
+}
@@ -0,0 +1,160 @@
+#include "fix_quality.h"
+
+#define FIX_QUALITY_MAX_AGE_S 15.0
+#define FIX_QUALITY_MAX_HORIZONTAL_M 100.0
+#define FIX_QUALITY_MAX_NETWORK_HORIZONTAL_M 2000.0
+#define FIX_QUALITY_MAX_VERTICAL_M 0.0
+#define FIX_QUALITY_MIN_SATELLITES 4
+#define FIX_QUALITY_GOOD_HORIZONTAL_M 10.0
+#define FIX_QUALITY_FAIR_HORIZONTAL_M 30.0
+
+#define FIX_QUALITY_CLASS_COUNT 4
+
+static struct
+{
+	fix_quality_config_s config;
+
+	unsigned int counts[FIX_VERDICT_COUNT];
+	unsigned int class_counts[FIX_QUALITY_CLASS_COUNT];
+} s_fix_quality_data;
+
+static fix_quality_verdict_e __judge(const position_frame_s *frame, int satellites, int64_t now);
+
+
+void
+fix_quality_default_config(fix_quality_config_s *config)
+{
+	config->max_age_s = FIX_QUALITY_MAX_AGE_S;
+	config->max_horizontal_m = FIX_QUALITY_MAX_HORIZONTAL_M;
+	config->max_network_horizontal_m = FIX_QUALITY_MAX_NETWORK_HORIZONTAL_M;
+	config->max_vertical_m = FIX_QUALITY_MAX_VERTICAL_M;
+	config->min_satellites = FIX_QUALITY_MIN_SATELLITES;
+	config->good_horizontal_m = FIX_QUALITY_GOOD_HORIZONTAL_M;
+	config->fair_horizontal_m = FIX_QUALITY_FAIR_HORIZONTAL_M;
+}
+
+void
+fix_quality_init(const fix_quality_config_s *config)
+{
+	int i;
+
+	if (config)
+		s_fix_quality_data.config = *config;
+	else
+		fix_quality_default_config(&s_fix_quality_data.config);
+
+	for (i = 0; i < FIX_VERDICT_COUNT; i++)
+		s_fix_quality_data.counts[i] = 0;
+	for (i = 0; i < FIX_QUALITY_CLASS_COUNT; i++)
+		s_fix_quality_data.class_counts[i] = 0;
+}
+
+fix_quality_verdict_e
+fix_quality_check(position_frame_s *frame, int satellites, int64_t now)
+{
+	fix_quality_verdict_e verdict = __judge(frame, satellites, now);
+	unsigned int quality;
+
+	s_fix_quality_data.counts[verdict]++;
+
+	if (verdict != FIX_ACCEPTED)
+		return verdict;
+
+	quality = fix_quality_classify(frame->horizontal_accuracy);
+	position_frame_set_quality(frame, quality);
+	s_fix_quality_data.class_counts[quality]++;
+
+	return verdict;
+}
+
+unsigned int
+fix_quality_classify(double horizontal_accuracy)
+{
+	const fix_quality_config_s *config = &s_fix_quality_data.config;
+
+	if (horizontal_accuracy <= 0.0)
+		return POSITION_FRAME_QUALITY_UNKNOWN;
+
+	if (horizontal_accuracy <= config->good_horizontal_m)
+		return POSITION_FRAME_QUALITY_GOOD;
+
+	if (horizontal_accuracy <= config->fair_horizontal_m)
+		return POSITION_FRAME_QUALITY_FAIR;
+
+	return POSITION_FRAME_QUALITY_POOR;
+}
+
+unsigned int
+fix_quality_get_count(fix_quality_verdict_e verdict)
+{
+	if ((unsigned int)verdict >= FIX_VERDICT_COUNT)
+		return 0;
+
+	return s_fix_quality_data.counts[verdict];
+}
+
+unsigned int
+fix_quality_get_class_count(unsigned int quality)
+{
+	if (quality >= FIX_QUALITY_CLASS_COUNT)
+		return 0;
+
+	return s_fix_quality_data.class_counts[quality];
+}
+
+const char *
+fix_quality_verdict_str(fix_quality_verdict_e verdict)
+{
+	switch (verdict) {
+	case FIX_ACCEPTED:
+		return "accepted";
+	case FIX_REJECTED_AGE:
+		return "too old";
+	case FIX_REJECTED_HORIZONTAL:
+		return "horizontal accuracy";
+	case FIX_REJECTED_VERTICAL:
+		return "vertical accuracy";
+	case FIX_REJECTED_SATELLITES:
+		return "too few satellites";
+	default:
+		return "unknown";
+	}
+}
+
+const char *
+fix_quality_class_str(unsigned int quality)
+{
+	switch (quality) {
+	case POSITION_FRAME_QUALITY_GOOD:
+		return "good";
+	case POSITION_FRAME_QUALITY_FAIR:
+		return "fair";
+	case POSITION_FRAME_QUALITY_POOR:
+		return "poor";
+	default:
+		return "unknown";
+	}
+}
+
+static fix_quality_verdict_e
+__judge(const position_frame_s *frame, int satellites, int64_t now)
+{
+	const fix_quality_config_s *config = &s_fix_quality_data.config;
+	double max_horizontal = satellites == FIX_QUALITY_SATELLITES_NONE ? config->max_network_horizontal_m : config->max_horizontal_m;
+
+	if (now - frame->timestamp >= config->max_age_s)
+		return FIX_REJECTED_AGE;
+
+	/* Accuracy of 0 means the source did not report it - such fixes are classified as unknown */
+	if (frame->horizontal_accuracy > max_horizontal)
+		return FIX_REJECTED_HORIZONTAL;
+
+	if (config->max_vertical_m > 0.0 && frame->vertical_accuracy > config->max_vertical_m)
+		return FIX_REJECTED_VERTICAL;
+
+	/* An unknown count is not held against the fix, the accuracy threshold still applies */
+	if (satellites >= 0 && satellites < config->min_satellites)
+		return FIX_REJECTED_SATELLITES;
+
+	return FIX_ACCEPTED;
+}
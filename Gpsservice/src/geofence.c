@@ -0,0 +1,417 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "geofence.h"
+#include "zone_index.h"
+
+#define GEOFENCE_MAX_HITS 64		/* zones containing one position that are checked for enter */
+
+typedef struct
+{
+	unsigned int owner;				/* slot in owners */
+	int64_t enter_time;
+	bool inside;
+	bool dwell_sent;
+} geofence_state_s;
+
+typedef struct
+{
+	uint32_t id;
+	unsigned int zone;
+} geofence_previous_s;
+
+static struct
+{
+	/* Parallel arrays, zones is what the index is built over */
+	hazard_zone_s *zones;			/* first_vertex of polygons refers to vertices */
+	geofence_state_s *states;
+	unsigned int count;
+	hazard_zone_vertex_s *vertices;
+	unsigned int vertex_count;
+	zone_index_s *index;
+
+	uint32_t *inside;				/* zones the last fix is in, room for count */
+	unsigned int inside_count;
+
+	char owners[GEOFENCE_MAX_OWNERS][GEOFENCE_OWNER_SIZE];	/* empty - free slot */
+	unsigned int owner_zones[GEOFENCE_MAX_OWNERS];
+	double distance_m;
+
+	geofence_stats_s stats;
+} s_geofence_data = {
+	.zones = NULL,
+	.states = NULL,
+	.count = 0,
+	.vertices = NULL,
+	.vertex_count = 0,
+	.index = NULL,
+	.inside = NULL,
+	.inside_count = 0,
+	.distance_m = -1.0
+};
+
+static void __free_zones(void);
+static int __owner_slot(const char *owner, bool add);
+static bool __zone_valid(const hazard_zone_s *zone, unsigned int vertex_count);
+static int __compare_previous(const void *a, const void *b);
+static void __event(geofence_event_s *event, unsigned int zone, unsigned int transition, const position_frame_s *frame);
+
+
+void
+geofence_init(void)
+{
+	__free_zones();
+	memset(&s_geofence_data.stats, 0, sizeof(s_geofence_data.stats));
+}
+
+void
+geofence_destroy(void)
+{
+	__free_zones();
+}
+
+unsigned int
+geofence_set_zones(const char *owner, const hazard_zone_list_s *list, size_t size)
+{
+	const hazard_zone_vertex_s *list_vertices;
+	unsigned int list_vertex_count;
+	hazard_zone_s *zones;
+	geofence_state_s *states;
+	hazard_zone_vertex_s *vertices;
+	uint32_t *inside;
+	geofence_previous_s *previous;
+	zone_index_s *index;
+	unsigned int capacity, vertex_capacity;
+	unsigned int count = 0, vertex_count = 0, previous_count = 0, stored = 0;
+	int slot = __owner_slot(owner, list->count > 0);
+	unsigned int i;
+
+	/* Owner without zones removes nothing, a new owner needs a free slot */
+	if (slot < 0)
+		return 0;
+
+	list_vertices = hazard_zone_list_vertices(list, size, &list_vertex_count);
+
+	capacity = s_geofence_data.count - s_geofence_data.owner_zones[slot];
+	capacity += list->count < GEOFENCE_MAX_ZONES - capacity ? list->count : GEOFENCE_MAX_ZONES - capacity;
+	vertex_capacity = s_geofence_data.vertex_count;
+
+	/* Polygons may share vertices of the list, each gets its own copy */
+	for (i = 0; i < list->count; i++) {
+		const hazard_zone_s *zone = hazard_zone_list_entry(list, i);
+
+		if (zone->type == HAZARD_ZONE_TYPE_POLYGON && __zone_valid(zone, list_vertex_count))
+			vertex_capacity += zone->vertex_count;
+	}
+
+	/* New tables are built next to the old ones, which stay in use if memory runs out */
+	zones = malloc((capacity + 1) * sizeof(hazard_zone_s));
+	states = malloc((capacity + 1) * sizeof(geofence_state_s));
+	inside = malloc((capacity + 1) * sizeof(uint32_t));
+	vertices = malloc((vertex_capacity + 1) * sizeof(hazard_zone_vertex_s));
+	previous = malloc((s_geofence_data.owner_zones[slot] + 1) * sizeof(geofence_previous_s));
+	index = zone_index_create();
+
+	if (!zones || !states || !inside || !vertices || !previous || !index) {
+		stored = 0;
+		goto out;
+	}
+
+	/* Zones of other owners are copied, zones of the owner are only remembered by id */
+	for (i = 0; i < s_geofence_data.count; i++) {
+		const hazard_zone_s *zone = &s_geofence_data.zones[i];
+
+		if (s_geofence_data.states[i].owner == (unsigned int)slot) {
+			previous[previous_count].id = zone->id;
+			previous[previous_count++].zone = i;
+			continue;
+		}
+
+		zones[count] = *zone;
+		states[count] = s_geofence_data.states[i];
+
+		if (zone->type == HAZARD_ZONE_TYPE_POLYGON) {
+			memcpy(&vertices[vertex_count], &s_geofence_data.vertices[zone->first_vertex],
+					zone->vertex_count * sizeof(hazard_zone_vertex_s));
+			zones[count].first_vertex = vertex_count;
+			vertex_count += zone->vertex_count;
+		}
+
+		count++;
+	}
+
+	qsort(previous, previous_count, sizeof(geofence_previous_s), __compare_previous);
+
+	for (i = 0; i < list->count && count < capacity; i++) {
+		const hazard_zone_s *zone = hazard_zone_list_entry(list, i);
+		geofence_previous_s key = {zone->id, 0};
+		const geofence_previous_s *found;
+
+		if (!__zone_valid(zone, list_vertex_count))
+			continue;
+
+		memcpy(&zones[count], zone, sizeof(hazard_zone_s));
+
+		if (zone->type == HAZARD_ZONE_TYPE_POLYGON) {
+			memcpy(&vertices[vertex_count], &list_vertices[zone->first_vertex],
+					zone->vertex_count * sizeof(hazard_zone_vertex_s));
+			zones[count].first_vertex = vertex_count;
+			vertex_count += zone->vertex_count;
+		} else {
+			zones[count].first_vertex = 0;
+			zones[count].vertex_count = 0;
+		}
+
+		found = bsearch(&key, previous, previous_count, sizeof(geofence_previous_s), __compare_previous);
+		if (found) {
+			states[count] = s_geofence_data.states[found->zone];
+		} else {
+			memset(&states[count], 0, sizeof(geofence_state_s));
+			states[count].owner = (unsigned int)slot;
+		}
+
+		count++;
+		stored++;
+	}
+
+	if (!zone_index_build(index, zones, count, vertices)) {
+		stored = 0;
+		goto out;
+	}
+
+	/* Swap the new tables in */
+	zone_index_destroy(s_geofence_data.index);
+	free(s_geofence_data.zones);
+	free(s_geofence_data.states);
+	free(s_geofence_data.inside);
+	free(s_geofence_data.vertices);
+
+	s_geofence_data.zones = zones;
+	s_geofence_data.states = states;
+	s_geofence_data.inside = inside;
+	s_geofence_data.vertices = vertices;
+	s_geofence_data.index = index;
+	s_geofence_data.count = count;
+	s_geofence_data.vertex_count = vertex_count;
+	zones = NULL;
+	states = NULL;
+	inside = NULL;
+	vertices = NULL;
+	index = NULL;
+
+	s_geofence_data.inside_count = 0;
+	for (i = 0; i < count; i++) {
+		if (s_geofence_data.states[i].inside)
+			s_geofence_data.inside[s_geofence_data.inside_count++] = i;
+	}
+
+	s_geofence_data.owner_zones[slot] = stored;
+	s_geofence_data.stats.zones = count;
+	s_geofence_data.stats.vertices = vertex_count;
+
+	if (count == 0)
+		s_geofence_data.distance_m = -1.0;
+
+out:
+	/* Slot of a new owner is released again if nothing was stored */
+	if (s_geofence_data.owner_zones[slot] == 0)
+		s_geofence_data.owners[slot][0] = '\0';
+
+	zone_index_destroy(index);
+	free(zones);
+	free(states);
+	free(inside);
+	free(vertices);
+	free(previous);
+
+	return stored;
+}
+
+unsigned int
+geofence_zone_count(void)
+{
+	return s_geofence_data.count;
+}
+
+unsigned int
+geofence_update(const position_frame_s *frame, geofence_event_s *events, unsigned int max_events)
+{
+	uint32_t hits[GEOFENCE_MAX_HITS];
+	unsigned int hit_count;
+	unsigned int written = 0;
+	unsigned int kept = 0;
+	unsigned int i;
+
+	s_geofence_data.stats.updates++;
+
+	if (s_geofence_data.count == 0) {
+		s_geofence_data.distance_m = -1.0;
+		return 0;
+	}
+
+	/* Zones the position was in can only be left or dwelt in */
+	for (i = 0; i < s_geofence_data.inside_count; i++) {
+		unsigned int zone = s_geofence_data.inside[i];
+		geofence_state_s *state = &s_geofence_data.states[zone];
+		uint16_t dwell_s = s_geofence_data.zones[zone].dwell_s;
+
+		if (written >= max_events) {
+			s_geofence_data.inside[kept++] = zone;
+			continue;
+		}
+
+		if (zone_index_edge_distance_m(s_geofence_data.index, zone, frame->latitude, frame->longitude) > GEOFENCE_EXIT_MARGIN_M) {
+			state->inside = false;
+			__event(&events[written++], zone, HAZARD_ZONE_EXIT, frame);
+			s_geofence_data.stats.exits++;
+			continue;
+		}
+
+		if (!state->dwell_sent && dwell_s > 0 && frame->timestamp - state->enter_time >= dwell_s) {
+			state->dwell_sent = true;
+			__event(&events[written++], zone, HAZARD_ZONE_DWELL, frame);
+			s_geofence_data.stats.dwells++;
+		}
+
+		s_geofence_data.inside[kept++] = zone;
+	}
+	s_geofence_data.inside_count = kept;
+
+	/* Only zones around the position are tested for enter */
+	hit_count = zone_index_query(s_geofence_data.index, frame->latitude, frame->longitude, hits, GEOFENCE_MAX_HITS);
+
+	for (i = 0; i < hit_count && written < max_events; i++) {
+		geofence_state_s *state = &s_geofence_data.states[hits[i]];
+
+		if (state->inside)
+			continue;
+
+		state->inside = true;
+		state->dwell_sent = false;
+		state->enter_time = frame->timestamp;
+		s_geofence_data.inside[s_geofence_data.inside_count++] = hits[i];
+		__event(&events[written++], hits[i], HAZARD_ZONE_ENTER, frame);
+		s_geofence_data.stats.enters++;
+	}
+
+	s_geofence_data.distance_m = zone_index_nearest_m(s_geofence_data.index, frame->latitude, frame->longitude);
+
+	return written;
+}
+
+double
+geofence_distance_m(void)
+{
+	return s_geofence_data.distance_m;
+}
+
+unsigned int
+geofence_get_inside(const char *owner, uint32_t *ids, unsigned int max_ids)
+{
+	int slot = __owner_slot(owner, false);
+	unsigned int written = 0;
+	unsigned int i;
+
+	if (slot < 0)
+		return 0;
+
+	for (i = 0; i < s_geofence_data.inside_count && written < max_ids; i++) {
+		unsigned int zone = s_geofence_data.inside[i];
+
+		if (s_geofence_data.states[zone].owner == (unsigned int)slot)
+			ids[written++] = s_geofence_data.zones[zone].id;
+	}
+
+	return written;
+}
+
+void
+geofence_get_stats(geofence_stats_s *stats)
+{
+	*stats = s_geofence_data.stats;
+}
+
+static void
+__free_zones(void)
+{
+	zone_index_destroy(s_geofence_data.index);
+	free(s_geofence_data.zones);
+	free(s_geofence_data.states);
+	free(s_geofence_data.inside);
+	free(s_geofence_data.vertices);
+
+	s_geofence_data.index = NULL;
+	s_geofence_data.zones = NULL;
+	s_geofence_data.states = NULL;
+	s_geofence_data.inside = NULL;
+	s_geofence_data.vertices = NULL;
+	s_geofence_data.count = 0;
+	s_geofence_data.vertex_count = 0;
+	s_geofence_data.inside_count = 0;
+	s_geofence_data.distance_m = -1.0;
+
+	memset(s_geofence_data.owners, 0, sizeof(s_geofence_data.owners));
+	memset(s_geofence_data.owner_zones, 0, sizeof(s_geofence_data.owner_zones));
+}
+
+static int
+__owner_slot(const char *owner, bool add)
+{
+	int free_slot = -1;
+	int i;
+
+	for (i = 0; i < GEOFENCE_MAX_OWNERS; i++) {
+		if (!s_geofence_data.owners[i][0]) {
+			if (free_slot < 0)
+				free_slot = i;
+		} else if (!strncmp(s_geofence_data.owners[i], owner, GEOFENCE_OWNER_SIZE - 1)) {
+			return i;
+		}
+	}
+
+	if (!add || free_slot < 0)
+		return -1;
+
+	strncpy(s_geofence_data.owners[free_slot], owner, GEOFENCE_OWNER_SIZE - 1);
+
+	return free_slot;
+}
+
+static bool
+__zone_valid(const hazard_zone_s *zone, unsigned int vertex_count)
+{
+	switch (zone->type) {
+	case HAZARD_ZONE_TYPE_CIRCLE:
+		return zone->radius_m > 0.0f && isfinite(zone->latitude) && isfinite(zone->longitude);
+	case HAZARD_ZONE_TYPE_POLYGON:
+		return zone->vertex_count <= GEOFENCE_MAX_POLYGON_VERTICES && hazard_zone_polygon_valid(zone, vertex_count);
+	default:
+		return false;
+	}
+}
+
+static int
+__compare_previous(const void *a, const void *b)
+{
+	uint32_t id_a = ((const geofence_previous_s *)a)->id;
+	uint32_t id_b = ((const geofence_previous_s *)b)->id;
+
+	return id_a < id_b ? -1 : id_a > id_b;
+}
+
+static void
+__event(geofence_event_s *event, unsigned int zone, unsigned int transition, const position_frame_s *frame)
+{
+	const hazard_zone_s *entry = &s_geofence_data.zones[zone];
+
+	memset(event, 0, sizeof(*event));
+	strncpy(event->owner, s_geofence_data.owners[s_geofence_data.states[zone].owner], GEOFENCE_OWNER_SIZE - 1);
+
+	event->event.id = entry->id;
+	event->event.transition = (uint8_t)transition;
+	event->event.timestamp = frame->timestamp;
+	event->event.latitude = frame->latitude;
+	event->event.longitude = frame->longitude;
+	event->event.distance_m = (float)zone_index_event_distance_m(s_geofence_data.index, zone, frame->latitude, frame->longitude);
+	event->event.radius_m = entry->type == HAZARD_ZONE_TYPE_CIRCLE ? entry->radius_m : 0.0f;
+}
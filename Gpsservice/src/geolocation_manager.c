@@ -1,65 +1,299 @@
 #include <tizen.h>
 #include <stdio.h>
-#include <locations.h>
+#include <math.h>
+#include <pthread.h>
 #include <bundle.h>
+#include <app_common.h>
 #include <message_port.h>
 #include <efl_extension.h>
+#include <device/battery.h>
+#include <device/callback.h>
 #include "gpsservice.h"
 #include "geolocation_manager.h"
+#include "position_frame.h"
+#include "position_batch.h"
+#include "sampling_scheduler.h"
+#include "deadband_filter.h"
+#include "fix_quality.h"
+#include "kalman_filter.h"
+#include "subscriber_registry.h"
+#include "track_journal.h"
+#include "track_codec.h"
+#include "message_schema.h"
+#include "location_source.h"
+#include "location_replay.h"
+#include "satellite_telemetry.h"
+#include "power_policy.h"
+#include "motion_detector.h"
+#include "outbound_queue.h"
+#include "shm_ring.h"
+#include "geofence.h"
 
 #define POSITION_UPDATE_INTERVAL 1
 #define SATELLITE_UPDATE_INTERVAL 5
 #define CHAR_BUFF_SIZE 20
 #define MAX_TIME_DIFF 15
-#define SEND_DATA_INTERVAL 5.0
 
-#define MESSAGE_TYPE_POSITION_UPDATE "POSITION_UPDATE"
-#define MESSAGE_TYPE_SATELLITES_UPDATE "SATELLITES_UPDATE"
+/* Longest wait for the single network fix taken on significant motion in the lowest power tier */
+#define MOTION_FIX_TIMEOUT 60.0
+
+/* Also send position as the "latitude"/"longitude" string keys for consumers that do not
+ * understand POSITION_FRAME_KEY yet. Set to 0 once all consumers are updated. */
+#define LEGACY_POSITION_KEYS 1
+
+/* Batching is off by default - every fix is sent as soon as it arrives */
+#define POSITION_BATCH_COUNT 1
+#define POSITION_BATCH_DEADLINE 10.0
+#define POSITION_BATCH_KEY "position_batch"
+
+/* Seconds of fix time between positions sent to heartbeat subscribers, zone events are sent at once */
+#define HEARTBEAT_INTERVAL 300
+
+#define TRACK_JOURNAL_DIR "track"
+#define TRACK_KEEP_SEGMENTS 2
+#define TRACK_MAX_POINTS 1024	/* per TRACK message, the client asks again for the rest */
+#define TRACK_FROM_KEY "from"
+#define TRACK_TO_KEY "to"
+
 #define MESSAGE_TYPE_CIRCLE_INIT "CIRCLE_INIT"
+#define MESSAGE_TYPE_SET_ZONES "SET_ZONES"
+#define MESSAGE_TYPE_GET_TRACK "GET_TRACK"
+#define MESSAGE_TYPE_SUBSCRIBE "SUBSCRIBE"
+#define MESSAGE_TYPE_UNSUBSCRIBE "UNSUBSCRIBE"
+
+#define SUBSCRIBE_PORT_KEY "port"
+#define SUBSCRIBE_TYPES_KEY "types"
+#define SUBSCRIBE_MIN_INTERVAL_KEY "min_interval"
+#define SUBSCRIBE_MIN_DISTANCE_KEY "min_distance"
+#define SUBSCRIBE_TRANSPORT_KEY "transport"
+
+/* Positions are written to a shared memory ring instead of bundles for a subscriber asking for it.
+ * Every app can open a shared memory object it knows the name of, so the name gets a random
+ * suffix and is only sent in a trusted handshake. */
+#define TRANSPORT_SHM_RING "shm-ring"
+#define SHM_RING_OBJECT_PREFIX "/gpsservice-ring-"
+#define RANDOM_DEVICE "/dev/urandom"
+#define RING_NAME_KEY "ring_name"
+
+#define POWER_TIER_KEY "power_tier"
+#define BATTERY_KEY "battery"
+
+/* GET_TRACK request, scanned and encoded in a worker thread and sent from the main loop */
+typedef struct track_job
+{
+	struct track_job *next;
+	Ecore_Thread *thread;
+	Ecore_Thread *worker;			/* same thread, as seen by the worker itself */
+	char *remote_app_id;
+	char *port;
+	int64_t from;
+	int64_t to;
+	unsigned int count;
+	size_t size;
+	bool failed;
+	track_codec_point_s points[TRACK_MAX_POINTS];
+	unsigned char track[sizeof(track_codec_header_s) + TRACK_MAX_POINTS * TRACK_CODEC_MAX_POINT_SIZE];
+} track_job_s;
 
 static struct
 {
-	location_manager_h manager;
+	const location_source_ops_s *source;
+	Ecore_Timer *batch_timer;
+	Ecore_Timer *replay_timer;
+	Ecore_Timer *retry_timer;
+	Ecore_Thread *compact_thread;
+	track_job_s *track_jobs;
+	pthread_mutex_t journal_lock;		/* one worker at a time on the journal files */
+	Ecore_Timer *motion_timer;
+	Ecore_Job *motion_job;
+	kalman_filter_s kalman;
+	shm_ring_s *ring;
+	position_frame_s last_frame;
+	char track_dir[PATH_MAX];
 
+	double start_time;
+	double batch_deadline;
+	double hazard_distance;
+	double zone_time;				/* seconds spent evaluating zones */
+	unsigned int zone_evaluations;
+	int64_t last_heartbeat;
+	int position_interval;
+	int battery_percent;
+	int battery_override;
+	power_tier_e power_tier;
+	int satellites_inview;
+	int satellites_active;
+	int control_port_id;
+	unsigned int track_segment;
+	unsigned int compact_before;
+	bool smoothing;
+	bool charging;
+	bool source_running;
+	bool ring_doorbell_pending;
+	bool motion_fix_pending;
+	bool has_last_frame;
 	bool init_data_sent;
 } s_geolocation_data = {
-	.manager = NULL,
+	.source = &location_source_tizen,
+	.batch_timer = NULL,
+	.replay_timer = NULL,
+	.retry_timer = NULL,
+	.compact_thread = NULL,
+	.track_jobs = NULL,
+	.journal_lock = PTHREAD_MUTEX_INITIALIZER,
+	.ring = NULL,
+	.motion_timer = NULL,
+	.motion_job = NULL,
+	.track_dir = "",
 
+	.batch_deadline = POSITION_BATCH_DEADLINE,
+	.hazard_distance = SAMPLING_DISTANCE_UNKNOWN,
+	.last_heartbeat = 0,
+	.position_interval = POSITION_UPDATE_INTERVAL,
+	.battery_percent = -1,
+	.battery_override = -1,
+	.power_tier = POWER_TIER_GPS,
+	.satellites_inview = -1,
+	.satellites_active = -1,
+	.control_port_id = -1,
+	.track_segment = 0,
+	.compact_before = 0,
+	.smoothing = true,
+	.charging = false,
+	.source_running = false,
+	.ring_doorbell_pending = false,
+	.motion_fix_pending = false,
+	.has_last_frame = false,
 	.init_data_sent = false
 };
-static bool __send_message(bundle *b);
-static bool __send_position_coords(location_coords_s coords);
-static bool __send_satellites_count(int s_count);
+static void __add_message_type(bundle *b, unsigned int id);
+static bool __send_message(bundle *b, unsigned int type, bool critical, const position_frame_s *frame);
+static bool __send_message_to(bundle *b, unsigned int type, bool critical, const position_frame_s *frame,
+		const char *app_id);
+static void __queue_message(const subscriber_s *subscriber, unsigned int type, bool critical, bundle *b);
+static void __schedule_retry(void);
+static Eina_Bool __retry_timer_cb(void *data);
+static bool __retry_send_cb(const char *app_id, const char *port, bundle *b, void *user_data);
+static void __remove_subscriber(const char *app_id, const char *port);
+static bool __remote_port_exists(const subscriber_s *subscriber);
+static void __control_port_cb(int local_port_id, const char *remote_app_id, const char *remote_port,
+		bool trusted, bundle *message, void *user_data);
+static void __handle_subscribe(const char *remote_app_id, bundle *message);
+static void __handle_set_zones(const char *remote_app_id, bundle *message);
+static void __handle_get_track(const char *remote_app_id, bundle *message);
+static void __track_thread_cb(void *data, Ecore_Thread *thread);
+static void __track_end_cb(void *data, Ecore_Thread *thread);
+static void __track_cancel_cb(void *data, Ecore_Thread *thread);
+static void __free_track_job(track_job_s *job);
+static bool __track_record_cb(const track_record_s *record, void *user_data);
+static void __clear_zones(const char *app_id);
+static unsigned int __evaluate_zones(const position_frame_s *frame, geofence_event_s *events);
+static void __send_zone_events(const geofence_event_s *events, unsigned int count);
+static void __send_heartbeat(const position_frame_s *frame);
+static bool __setup_ring(subscriber_s *subscriber);
+static bool __random_ring_name(char *name, size_t size);
+static subscriber_s *__ring_subscriber(void);
+static bool __ring_write(const position_frame_s *frames, unsigned int count);
+static bool __ring_doorbell(const subscriber_s *subscriber);
+static bool __has_bundle_subscriber(unsigned int type);
+static bool __send_position_frame(const position_frame_s *frame);
+static bool __send_position_batch(const position_frame_s *frames, unsigned int count);
+static bool __queue_position_frame(const position_frame_s *frame, bool urgent);
+static Eina_Bool __batch_deadline_cb(void *data);
+static void __schedule_sampling(const position_frame_s *frame);
+static bool __set_update_intervals(int position_interval);
+static int __tier_interval(int interval);
+static void __battery_changed_cb(device_callback_e type, void *value, void *user_data);
+static void __charging_changed_cb(device_callback_e type, void *value, void *user_data);
+static void __update_power_tier(power_tier_e tier);
+static bool __send_power_tier(void);
+static void __leave_motion_tier(void);
+static void __motion_detected_cb(void *user_data);
+static Eina_Bool __motion_timeout_cb(void *data);
+static void __motion_fix_job_cb(void *data);
+static void __end_motion_fix(void);
+static void __log_power_stats(void);
+static bool __send_satellites_count(int s_count, const void *satellite_frame, size_t frame_size);
 static void __position_updated_cb(double latitude, double longitude, double altitude, time_t timestamp, void *data);
 static void __satellite_updated_cb(int num_of_active, int num_of_inview, time_t timestamp, void *data);
-static Eina_Bool __init_data_send_cb(void *data);
-static Eina_Bool __init_data_send(void);
-static bool __init_data(location_coords_s *init_coords, int *satellites_count);
+static bool __satellite_info_cb(unsigned int azimuth, unsigned int elevation, unsigned int prn,
+		int snr, bool is_in_use, void *data);
+static bool __send_state_snapshot(const char *app_id, const char *port);
+static bool __snapshot_frame(position_frame_s *frame);
+static int __snapshot_satellites(void);
+static int __fix_satellites(void);
+static void __fill_frame_details(position_frame_s *frame);
+static void __smooth_frame(position_frame_s *frame);
+static void __open_track_journal(void);
+static void __journal_frame(const position_frame_s *frame);
+static void __compact_thread_cb(void *data, Ecore_Thread *thread);
+static void __compact_end_cb(void *data, Ecore_Thread *thread);
+static void __stop_journal_threads(void);
+static bool __start_source(void);
+static void __stop_source(void);
+static Eina_Bool __replay_timer_cb(void *data);
+static void __log_replay_stats(void);
 
 
 bool
 geolocation_manager_init(void)
 {
 	bool exists;
+	power_tier_e tier;
+
+	s_geolocation_data.start_time = ecore_time_get();
+	position_batch_init(POSITION_BATCH_COUNT);
+	sampling_scheduler_init(ecore_time_get());
+	deadband_filter_init(NULL);
+	fix_quality_init(NULL);
+	kalman_filter_init(&s_geolocation_data.kalman, 0.0);
+	satellite_telemetry_init();
+	outbound_queue_init(OUTBOUND_DROP_OLDEST);
+	geofence_init();
+	__open_track_journal();
+
+	/* Battery level is one of the sampling scheduler inputs */
+	if (device_battery_get_percent(&s_geolocation_data.battery_percent) != 0)
+		s_geolocation_data.battery_percent = -1;
+
+	device_add_callback(DEVICE_CALLBACK_BATTERY_CAPACITY, __battery_changed_cb, NULL);
+
+	/* Battery level and charging state choose the power tier, and with it the location source */
+	if (device_battery_is_charging(&s_geolocation_data.charging) != 0)
+		s_geolocation_data.charging = false;
+
+	device_add_callback(DEVICE_CALLBACK_BATTERY_CHARGING, __charging_changed_cb, NULL);
+
+	power_policy_init(ecore_time_get());
+	tier = power_policy_update(s_geolocation_data.battery_percent, s_geolocation_data.charging, ecore_time_get());
+
+	/* Motion tier is entered after the start, it only needs the network source for a moment */
+	s_geolocation_data.power_tier = tier < POWER_TIER_MOTION ? tier : POWER_TIER_NETWORK;
+	if (s_geolocation_data.power_tier >= POWER_TIER_NETWORK)
+		s_geolocation_data.source = &location_source_tizen_network;
+	s_geolocation_data.position_interval = __tier_interval(s_geolocation_data.position_interval);
 
 	/* Create location manager handle */
-	if (location_manager_create(LOCATIONS_METHOD_GPS, &s_geolocation_data.manager) != LOCATIONS_ERROR_NONE) {
+	if (!s_geolocation_data.source->create()) {
 		dlog_print(DLOG_ERROR, LOG_TAG, "Failed to create location manager");
 		return false;
 	}
+	s_geolocation_data.source_running = true;
 
 	/* Register callbacks for position and satellites data update */
-	location_error_e pos_cb = location_manager_set_position_updated_cb(s_geolocation_data.manager, __position_updated_cb, POSITION_UPDATE_INTERVAL, NULL);
-	location_error_e sat_cb = gps_status_set_satellite_updated_cb(s_geolocation_data.manager, __satellite_updated_cb, SATELLITE_UPDATE_INTERVAL, NULL);
-
-	if (pos_cb != LOCATIONS_ERROR_NONE) {
+	if (!__set_update_intervals(s_geolocation_data.position_interval)) {
 		dlog_print(DLOG_ERROR, LOG_TAG, "Failed to register callbacks for location manager");
 		geolocation_manager_destroy_service();
 		return false;
 	}
 
-	if (sat_cb != LOCATIONS_ERROR_NONE)
-		dlog_print(DLOG_WARN, LOG_TAG, "Failed to get satellites number. Probably you run this sample on the emulator.");
+	/* Legacy consumer always receives messages, other clients subscribe over the control port */
+	subscriber_registry_init();
+	subscriber_registry_add(REMOTE_APP_ID, REMOTE_PORT, SUBSCRIBER_MSG_ALL, 0.0, 0.0, true);
+
+	s_geolocation_data.control_port_id = message_port_register_trusted_local_port(CONTROL_PORT, __control_port_cb, NULL);
+	if (s_geolocation_data.control_port_id < 0)
+		dlog_print(DLOG_WARN, LOG_TAG, "Failed to register control port, error: %d", s_geolocation_data.control_port_id);
 
 	/* Check state of remote port from gps-consumer */
 	if (message_port_check_remote_port(REMOTE_APP_ID, REMOTE_PORT, &exists) != MESSAGE_PORT_ERROR_NONE) {
@@ -68,17 +302,18 @@ geolocation_manager_init(void)
 		return false;
 	}
 
-	if (!exists)
-		dlog_print(DLOG_ERROR, LOG_TAG, "Remote port is not registered");
-
 	/* Start location service */
-	location_manager_start(s_geolocation_data.manager);
+	s_geolocation_data.source->start();
 
-	/* Send initial data to gps-consumer port */
-	 if (!__init_data_send()) {
-		 dlog_print(DLOG_ERROR, LOG_TAG, "Failed to send init data - create timer to periodically try to send data");
-		 ecore_timer_add(SEND_DATA_INTERVAL, __init_data_send_cb, NULL);
-	 }
+	dlog_print(DLOG_INFO, LOG_TAG, "Starting in %s power tier with %s location source",
+			power_policy_tier_str(tier), s_geolocation_data.source->name);
+	__update_power_tier(tier);
+
+	/* Consumer that is already running gets the state now, one that starts later subscribes */
+	if (!exists)
+		dlog_print(DLOG_INFO, LOG_TAG, "Remote port is not registered - waiting for consumer to subscribe");
+	else if (!__send_state_snapshot(REMOTE_APP_ID, REMOTE_PORT))
+		dlog_print(DLOG_ERROR, LOG_TAG, "Failed to send init data - waiting for consumer to subscribe");
 
 	return true;
 }
@@ -87,192 +322,1653 @@ geolocation_manager_init(void)
 void
 geolocation_manager_stop_service(void)
 {
-	location_manager_stop(s_geolocation_data.manager);
+	geolocation_manager_flush_positions();
+
+	if (s_geolocation_data.source_running)
+		s_geolocation_data.source->stop();
 }
 
 
 void
 geolocation_manager_destroy_service(void)
 {
-	location_manager_unset_position_updated_cb(s_geolocation_data.manager);
-	gps_status_unset_satellite_updated_cb(s_geolocation_data.manager);
-	location_manager_stop(s_geolocation_data.manager);
-	location_manager_destroy(s_geolocation_data.manager);
+	sampling_scheduler_stats_s stats;
+	satellite_telemetry_stats_s telemetry;
+	geofence_stats_s geofence;
+	outbound_queue_stats_s queue;
+	shm_ring_stats_s ring_stats;
+
+	geolocation_manager_flush_positions();
+
+	geofence_get_stats(&geofence);
+	dlog_print(DLOG_INFO, LOG_TAG, "Geofence: %u zones, %u vertices, %u fixes evaluated in %.3fms on average, %u enter, %u exit, %u dwell",
+			geofence.zones, geofence.vertices, geofence.updates,
+			s_geolocation_data.zone_evaluations > 0 ? s_geolocation_data.zone_time * 1000.0 / s_geolocation_data.zone_evaluations : 0.0,
+			geofence.enters, geofence.exits, geofence.dwells);
+	geofence_destroy();
+
+	geolocation_manager_get_sampling_stats(&stats);
+	dlog_print(DLOG_INFO, LOG_TAG, "Sampling: %u decisions, %u faster, %u slower, %u held, %.0f of %.0f fixes requested",
+			stats.decisions, stats.faster_changes, stats.slower_changes, stats.held_changes,
+			stats.fixes_requested, stats.fixes_at_fastest);
+
+	dlog_print(DLOG_INFO, LOG_TAG, "Dead-band: %u first, %u moved, %u heading, %u heartbeat, %u suppressed",
+			deadband_filter_get_count(DEADBAND_PASS_FIRST), deadband_filter_get_count(DEADBAND_PASS_MOVED),
+			deadband_filter_get_count(DEADBAND_PASS_HEADING), deadband_filter_get_count(DEADBAND_PASS_HEARTBEAT),
+			deadband_filter_get_count(DEADBAND_SUPPRESSED));
+
+	dlog_print(DLOG_INFO, LOG_TAG, "Fix quality: %u good, %u fair, %u poor, %u unknown accepted, rejected %u too old, %u horizontal, %u vertical, %u satellites",
+			fix_quality_get_class_count(POSITION_FRAME_QUALITY_GOOD), fix_quality_get_class_count(POSITION_FRAME_QUALITY_FAIR),
+			fix_quality_get_class_count(POSITION_FRAME_QUALITY_POOR), fix_quality_get_class_count(POSITION_FRAME_QUALITY_UNKNOWN),
+			fix_quality_get_count(FIX_REJECTED_AGE), fix_quality_get_count(FIX_REJECTED_HORIZONTAL),
+			fix_quality_get_count(FIX_REJECTED_VERTICAL), fix_quality_get_count(FIX_REJECTED_SATELLITES));
+
+	satellite_telemetry_get_stats(&telemetry);
+	dlog_print(DLOG_INFO, LOG_TAG, "Satellite telemetry: %u frames, %u key frames, %u of %u entries sent, %u bytes",
+			telemetry.frames, telemetry.key_frames, telemetry.entries_sent, telemetry.entries_in_view, telemetry.bytes);
+
+	__log_power_stats();
+
+	outbound_queue_get_stats(&queue);
+	dlog_print(DLOG_INFO, LOG_TAG, "Outbound queue: %u queued, %u delivered in %u retries, %u dropped, %u replaced, %u resyncs, max depth %u, %u left",
+			queue.queued, queue.delivered, queue.retries, queue.dropped, queue.replaced, queue.resyncs,
+			queue.max_depth, queue.depth);
+
+	if (s_geolocation_data.retry_timer) {
+		ecore_timer_del(s_geolocation_data.retry_timer);
+		s_geolocation_data.retry_timer = NULL;
+	}
+	outbound_queue_init(OUTBOUND_DROP_OLDEST);
+
+	if (s_geolocation_data.ring) {
+		shm_ring_get_stats(s_geolocation_data.ring, &ring_stats);
+		dlog_print(DLOG_INFO, LOG_TAG, "Shared memory ring: %u records written, %u dropped, %u doorbells",
+				ring_stats.written, ring_stats.dropped, ring_stats.doorbells);
+
+		shm_ring_close(s_geolocation_data.ring);
+		s_geolocation_data.ring = NULL;
+	}
+
+	device_remove_callback(DEVICE_CALLBACK_BATTERY_CAPACITY, __battery_changed_cb);
+	device_remove_callback(DEVICE_CALLBACK_BATTERY_CHARGING, __charging_changed_cb);
+
+	__leave_motion_tier();
+
+	/* Workers read the journal files, let them finish before it is closed */
+	__stop_journal_threads();
+	track_journal_close();
+
+	if (s_geolocation_data.control_port_id >= 0) {
+		message_port_unregister_trusted_local_port(s_geolocation_data.control_port_id);
+		s_geolocation_data.control_port_id = -1;
+	}
+
+	__stop_source();
+}
+
+bool
+geolocation_manager_start_replay(const char *path, double speed)
+{
+	/* Replay replaces the current source until the service is destroyed, the power tier only limits its rate */
+	__leave_motion_tier();
+	__stop_source();
+
+	if (!location_replay_open(path, speed)) {
+		dlog_print(DLOG_ERROR, LOG_TAG, "Failed to open track %s for replay", path);
+		s_geolocation_data.source = &location_source_tizen;
+		return __start_source();
+	}
+
+	s_geolocation_data.source = &location_replay_source;
+	if (!__start_source())
+		return false;
+
+	if (speed > 0.0)
+		dlog_print(DLOG_INFO, LOG_TAG, "Replaying %s at %.1fx", path, speed);
+	else
+		dlog_print(DLOG_INFO, LOG_TAG, "Replaying %s as fast as possible", path);
+
+	/* First fix is delivered at once and is the initial position for the consumer */
+	location_replay_poll(ecore_time_get());
+	if (!s_geolocation_data.init_data_sent)
+		__send_state_snapshot(REMOTE_APP_ID, REMOTE_PORT);
+
+	s_geolocation_data.replay_timer = ecore_timer_add(0.0, __replay_timer_cb, NULL);
+
+	return true;
+}
+
+void
+geolocation_manager_set_batching(unsigned int flush_count, double deadline)
+{
+	if (flush_count > 0)
+		position_batch_set_flush_count(flush_count);
+
+	if (deadline > 0.0)
+		s_geolocation_data.batch_deadline = deadline;
+
+	dlog_print(DLOG_INFO, LOG_TAG, "Position batching: flush count %u, deadline %.1fs",
+			position_batch_get_flush_count(), s_geolocation_data.batch_deadline);
+
+	/* Buffered frames may already satisfy the new flush count */
+	if (position_batch_count() >= position_batch_get_flush_count())
+		geolocation_manager_flush_positions();
+}
+
+bool
+geolocation_manager_flush_positions(void)
+{
+	static position_frame_s frames[POSITION_BATCH_CAPACITY];
+	unsigned int count;
+
+	if (s_geolocation_data.batch_timer) {
+		ecore_timer_del(s_geolocation_data.batch_timer);
+		s_geolocation_data.batch_timer = NULL;
+	}
+
+	count = position_batch_drain(frames, POSITION_BATCH_CAPACITY);
+	if (count == 0)
+		return true;
+
+	if (count == 1)
+		return __send_position_frame(&frames[0]);
+
+	return __send_position_batch(frames, count);
+}
+
+void
+geolocation_manager_set_hazard_distance(double distance_m)
+{
+	s_geolocation_data.hazard_distance = distance_m;
+}
+
+void
+geolocation_manager_set_power_floor(power_tier_e floor)
+{
+	__update_power_tier(power_policy_set_floor(floor, ecore_time_get()));
+}
+
+void
+geolocation_manager_set_battery_override(int percent)
+{
+	s_geolocation_data.battery_override = percent;
+
+	/* Negative percent goes back to the real battery level */
+	if (percent >= 0)
+		s_geolocation_data.battery_percent = percent;
+	else if (device_battery_get_percent(&s_geolocation_data.battery_percent) != 0)
+		s_geolocation_data.battery_percent = -1;
+
+	__update_power_tier(power_policy_update(s_geolocation_data.battery_percent, s_geolocation_data.charging,
+			ecore_time_get()));
+}
+
+void
+geolocation_manager_set_queue_policy(outbound_policy_e policy)
+{
+	outbound_queue_set_policy(policy);
+	dlog_print(DLOG_INFO, LOG_TAG, "Outbound queue policy: %s", outbound_queue_policy_str(policy));
+}
+
+void
+geolocation_manager_get_queue_stats(outbound_queue_stats_s *stats)
+{
+	outbound_queue_get_stats(stats);
+}
+
+void
+geolocation_manager_set_deadband(const deadband_filter_config_s *config)
+{
+	/* Restarts the filter - the next fix is always sent */
+	deadband_filter_init(config);
+}
+
+void
+geolocation_manager_set_fix_quality(const fix_quality_config_s *config)
+{
+	fix_quality_init(config);
+}
+
+void
+geolocation_manager_set_smoothing(bool enable)
+{
+	s_geolocation_data.smoothing = enable;
+
+	/* Do not continue from a stale state when smoothing is enabled again */
+	kalman_filter_init(&s_geolocation_data.kalman, 0.0);
+}
+
+void
+geolocation_manager_get_sampling_stats(sampling_scheduler_stats_s *stats)
+{
+	sampling_scheduler_get_stats(stats, ecore_time_get());
+}
+
+static void
+__add_message_type(bundle *b, unsigned int id)
+{
+	message_schema_s schema;
 
+	message_schema_init(&schema, id);
 
-	s_geolocation_data.manager = NULL;
+	/* String is kept for clients built before the schema */
+	bundle_add_str(b, MESSAGE_SCHEMA_TYPE_KEY, message_schema_name(id));
+	bundle_add_byte(b, MESSAGE_SCHEMA_KEY, &schema, sizeof(schema));
+}
+
+static bool
+__send_message(bundle *b, unsigned int type, bool critical, const position_frame_s *frame)
+{
+	return __send_message_to(b, type, critical, frame, NULL);
 }
 
 static bool
-__send_message(bundle *b)
+__send_message_to(bundle *b, unsigned int type, bool critical, const position_frame_s *frame,
+		const char *app_id)
 {
+	int delivered = 0;
+	int queued = 0;
+	int i;
+
 	if (!b) {
 		dlog_print(DLOG_ERROR, LOG_TAG, "Can not send message, the bundle is NULL");
 		return false;
 	}
 
-	/* Send message to specified remote port */
-	int ret = message_port_send_message(REMOTE_APP_ID, REMOTE_PORT, b);
+	/* Send the same bundle to every interested subscriber. Iterate backwards, so pruning
+	 * a subscriber does not skip the next one. */
+	for (i = subscriber_registry_count() - 1; i >= 0; i--) {
+		subscriber_s *subscriber = subscriber_registry_get(i);
 
-	if (ret != MESSAGE_PORT_ERROR_NONE) {
-		dlog_print(DLOG_ERROR, LOG_TAG, "Failed to send message: error %d", ret);
-		return false;
+		/* Ring subscriber reads positions from shared memory */
+		if (subscriber->ring && type == SUBSCRIBER_MSG_POSITION)
+			continue;
+
+		if (app_id && strcmp(subscriber->app_id, app_id))
+			continue;
+
+		if (!subscriber_registry_wants(subscriber, type, frame))
+			continue;
+
+		/* Keep order - the message waits behind the ones not delivered yet */
+		if (outbound_queue_pending(subscriber->app_id, subscriber->port)) {
+			__queue_message(subscriber, type, critical, b);
+			queued++;
+			continue;
+		}
+
+		int ret = message_port_send_message(subscriber->app_id, subscriber->port, b);
+
+		if (ret == MESSAGE_PORT_ERROR_NONE) {
+			delivered++;
+		} else {
+			dlog_print(DLOG_ERROR, LOG_TAG, "Failed to send message to %s: error %d, queued for retry", subscriber->app_id, ret);
+			__queue_message(subscriber, type, critical, b);
+			queued++;
+		}
+
+		if (!subscriber_registry_report(subscriber, ret == MESSAGE_PORT_ERROR_NONE, frame) ||
+				(ret != MESSAGE_PORT_ERROR_NONE && !subscriber->persistent && !__remote_port_exists(subscriber)))
+			__remove_subscriber(subscriber->app_id, subscriber->port);
 	}
 
-	return true;
+	/* Queued messages are delivered later, they are not lost */
+	return delivered + queued > 0;
 }
 
-static bool
-__send_position_coords(location_coords_s coords)
+static void
+__queue_message(const subscriber_s *subscriber, unsigned int type, bool critical, bundle *b)
 {
-	bundle *b = bundle_create();
-	char latitude_str[CHAR_BUFF_SIZE], longitude_str[CHAR_BUFF_SIZE];
+	if (!outbound_queue_push(subscriber->app_id, subscriber->port, type, critical, b, ecore_time_get()))
+		dlog_print(DLOG_WARN, LOG_TAG, "Outbound queue overflow for %s:%s, it will get a state snapshot instead",
+				subscriber->app_id, subscriber->port);
 
-	if (!b) {
-		dlog_print(DLOG_ERROR, LOG_TAG, "Failed to create bundle, the coords will not be sent");
-		return false;
+	__schedule_retry();
+}
+
+static void
+__schedule_retry(void)
+{
+	double delay = outbound_queue_next_retry(ecore_time_get());
+
+	if (s_geolocation_data.retry_timer) {
+		ecore_timer_del(s_geolocation_data.retry_timer);
+		s_geolocation_data.retry_timer = NULL;
 	}
 
-	snprintf(latitude_str, CHAR_BUFF_SIZE, "%f", coords.latitude);
-	snprintf(longitude_str, CHAR_BUFF_SIZE, "%f", coords.longitude);
+	if (delay >= 0.0)
+		s_geolocation_data.retry_timer = ecore_timer_add(delay, __retry_timer_cb, NULL);
+}
 
-	bundle_add_str(b, "msg_type", MESSAGE_TYPE_POSITION_UPDATE);
-	bundle_add_str(b, "latitude", latitude_str);
-	bundle_add_str(b, "longitude", longitude_str);
+static Eina_Bool
+__retry_timer_cb(void *data)
+{
+	unsigned int delivered;
 
-	bool ret = __send_message(b);
+	s_geolocation_data.retry_timer = NULL;
 
-	bundle_free(b);
+	delivered = outbound_queue_retry(__retry_send_cb, NULL, ecore_time_get());
+	if (delivered > 0)
+		dlog_print(DLOG_INFO, LOG_TAG, "%u queued messages delivered", delivered);
 
-	return ret;
+	__schedule_retry();
+
+	return ECORE_CALLBACK_CANCEL;
 }
 
 static bool
-__send_satellites_count(int s_count)
+__retry_send_cb(const char *app_id, const char *port, bundle *b, void *user_data)
 {
-	bundle *b = bundle_create();
-	char count_str[CHAR_BUFF_SIZE];
+	subscriber_s *subscriber = subscriber_registry_find(app_id, port);
+	int ret;
 
-	if (!b) {
-		dlog_print(DLOG_ERROR, LOG_TAG, "Failed to create bundle, the satellites will not be sent");
+	if (!subscriber) {
+		outbound_queue_drop(app_id, port);
 		return false;
 	}
 
-	snprintf(count_str, CHAR_BUFF_SIZE, "%d", s_count);
-
-	bundle_add_str(b, "msg_type", MESSAGE_TYPE_SATELLITES_UPDATE);
-	bundle_add_str(b, "satellites_count", count_str);
+	/* Queue overflowed - the current state replaces everything that was lost */
+	if (!b)
+		return __send_state_snapshot(app_id, port);
 
-	bool ret = __send_message(b);
+	ret = message_port_send_message(app_id, port, b);
 
-	bundle_free(b);
+	if (!subscriber_registry_report(subscriber, ret == MESSAGE_PORT_ERROR_NONE, NULL) ||
+			(ret != MESSAGE_PORT_ERROR_NONE && !subscriber->persistent && !__remote_port_exists(subscriber)))
+		__remove_subscriber(app_id, port);
 
-	return ret;
+	return ret == MESSAGE_PORT_ERROR_NONE;
 }
 
 static void
-__position_updated_cb(double latitude, double longitude, double altitude, time_t timestamp, void *data)
+__remove_subscriber(const char *app_id, const char *port)
 {
-	location_coords_s coords;
+	dlog_print(DLOG_INFO, LOG_TAG, "Removing subscriber %s:%s", app_id, port);
 
-	coords.latitude = latitude;
-	coords.longitude = longitude;
+	/* Strings may belong to the removed subscriber */
+	outbound_queue_drop(app_id, port);
+	__clear_zones(app_id);
+	subscriber_registry_remove(app_id, port, false);
+}
 
-	time_t curr_timestamp;
+static bool
+__remote_port_exists(const subscriber_s *subscriber)
+{
+	bool exists = false;
 
-	/* Get current time to compare to the last position timestamp */
-	time(&curr_timestamp);
+	if (message_port_check_remote_port(subscriber->app_id, subscriber->port, &exists) != MESSAGE_PORT_ERROR_NONE)
+		return false;
 
+	return exists;
+}
 
-	/* Send updated position only if init data has been sent and position update
-	 * was registered less than MAX_TIME_DIFF seconds ago */
-	if (s_geolocation_data.init_data_sent && curr_timestamp-timestamp < MAX_TIME_DIFF) {
+static void
+__control_port_cb(int local_port_id, const char *remote_app_id, const char *remote_port,
+		bool trusted, bundle *message, void *user_data)
+{
+	char *msg_type = NULL;
+	char *port = NULL;
 
-		/* Send position update via message port */
-		if (__send_position_coords(coords)) {
-			dlog_print(DLOG_INFO, LOG_TAG, "Position updated to %f, %f", latitude, longitude);
-		} else {
-			dlog_print(DLOG_ERROR, LOG_TAG, "Failed to send position update");
+	if (bundle_get_str(message, MESSAGE_SCHEMA_TYPE_KEY, &msg_type) != BUNDLE_ERROR_NONE) {
+		dlog_print(DLOG_ERROR, LOG_TAG, "Control message from %s without type", remote_app_id);
+		return;
+	}
+
+	if (!strcmp(msg_type, MESSAGE_TYPE_SUBSCRIBE)) {
+		__handle_subscribe(remote_app_id, message);
+	} else if (!strcmp(msg_type, MESSAGE_TYPE_UNSUBSCRIBE)) {
+		if (bundle_get_str(message, SUBSCRIBE_PORT_KEY, &port) == BUNDLE_ERROR_NONE &&
+				subscriber_registry_remove(remote_app_id, port, false)) {
+			outbound_queue_drop(remote_app_id, port);
+			__clear_zones(remote_app_id);
+			dlog_print(DLOG_INFO, LOG_TAG, "Unsubscribed %s:%s", remote_app_id, port);
 		}
+	} else if (!strcmp(msg_type, MESSAGE_TYPE_SET_ZONES)) {
+		__handle_set_zones(remote_app_id, message);
+	} else if (!strcmp(msg_type, MESSAGE_TYPE_GET_TRACK)) {
+		__handle_get_track(remote_app_id, message);
+	} else {
+		dlog_print(DLOG_WARN, LOG_TAG, "Unknown control message %s from %s", msg_type, remote_app_id);
 	}
 }
 
+static void
+__handle_subscribe(const char *remote_app_id, bundle *message)
+{
+	char *port = NULL;
+	char *value = NULL;
+	subscriber_s *subscriber;
+	bool ring = false;
+	unsigned int types = SUBSCRIBER_MSG_ALL;
+	double min_interval = 0.0;
+	double min_distance = 0.0;
+
+	if (bundle_get_str(message, SUBSCRIBE_PORT_KEY, &port) != BUNDLE_ERROR_NONE) {
+		dlog_print(DLOG_ERROR, LOG_TAG, "Subscription from %s without port", remote_app_id);
+		return;
+	}
+
+	if (bundle_get_str(message, SUBSCRIBE_TYPES_KEY, &value) == BUNDLE_ERROR_NONE)
+		types = (unsigned int)strtoul(value, NULL, 0);
+
+	if (bundle_get_str(message, SUBSCRIBE_MIN_INTERVAL_KEY, &value) == BUNDLE_ERROR_NONE)
+		min_interval = strtod(value, NULL);
+
+	if (bundle_get_str(message, SUBSCRIBE_MIN_DISTANCE_KEY, &value) == BUNDLE_ERROR_NONE)
+		min_distance = strtod(value, NULL);
+
+	if (bundle_get_str(message, SUBSCRIBE_TRANSPORT_KEY, &value) == BUNDLE_ERROR_NONE)
+		ring = !strcmp(value, TRANSPORT_SHM_RING);
+
+	subscriber = subscriber_registry_add(remote_app_id, port, types, min_interval, min_distance, false);
+	if (!subscriber) {
+		dlog_print(DLOG_ERROR, LOG_TAG, "Subscriber limit reached, %s:%s rejected", remote_app_id, port);
+		return;
+	}
+
+	/* Handshake goes before the snapshot, positions after the snapshot are in the ring */
+	subscriber->ring = ring && __setup_ring(subscriber);
+
+	dlog_print(DLOG_INFO, LOG_TAG, "Subscribed %s:%s types 0x%x, interval %.1fs, distance %.1fm, %s transport",
+			remote_app_id, port, types, min_interval, min_distance, subscriber->ring ? TRANSPORT_SHM_RING : "bundle");
+
+	/* Subscription is the readiness announcement - the new subscriber gets the current state at once */
+	if (!__send_state_snapshot(remote_app_id, port))
+		dlog_print(DLOG_ERROR, LOG_TAG, "Failed to send state snapshot to %s:%s", remote_app_id, port);
+}
 
 static void
-__satellite_updated_cb(int num_of_active, int num_of_inview, time_t timestamp, void *data)
+__handle_set_zones(const char *remote_app_id, bundle *message)
 {
-	/* Send update satellite count only if init data has been sent*/
-	if (s_geolocation_data.init_data_sent) {
-		/* Send satellite count update via message port */
-		if (__send_satellites_count(num_of_inview)) {
-			dlog_print(DLOG_INFO, LOG_TAG, "Satellite count updated: inview %d", num_of_inview);
-		} else {
-			dlog_print(DLOG_ERROR, LOG_TAG, "Failed to send satellite count update");
-		}
+	static geofence_event_s events[GEOFENCE_MAX_EVENTS];
+	const hazard_zone_list_s *list = NULL;
+	void *bytes = NULL;
+	size_t size = 0;
+	unsigned int stored;
+
+	if (bundle_get_byte(message, HAZARD_ZONE_KEY, &bytes, &size) == BUNDLE_ERROR_NONE)
+		list = hazard_zone_list_decode(bytes, size);
+
+	if (!list) {
+		dlog_print(DLOG_ERROR, LOG_TAG, "Invalid zone list from %s", remote_app_id);
+		return;
 	}
+
+	stored = geofence_set_zones(remote_app_id, list, size);
+	if (stored < list->count)
+		dlog_print(DLOG_WARN, LOG_TAG, "%u of %u zones from %s stored", stored, (unsigned int)list->count, remote_app_id);
+	else
+		dlog_print(DLOG_INFO, LOG_TAG, "%u zones from %s stored", stored, remote_app_id);
+
+	/* New zones may already contain the current position */
+	if (s_geolocation_data.has_last_frame)
+		__send_zone_events(events, __evaluate_zones(&s_geolocation_data.last_frame, events));
 }
 
-static Eina_Bool
-__init_data_send_cb(void *data)
+static void
+__handle_get_track(const char *remote_app_id, bundle *message)
 {
-	if (__init_data_send())
-		return ECORE_CALLBACK_CANCEL;
+	Ecore_Thread *thread;
+	track_job_s *job;
+	char *port = NULL;
+	char *value = NULL;
 
-	return ECORE_CALLBACK_RENEW;
+	if (bundle_get_str(message, SUBSCRIBE_PORT_KEY, &port) != BUNDLE_ERROR_NONE) {
+		dlog_print(DLOG_ERROR, LOG_TAG, "Track request from %s without port", remote_app_id);
+		return;
+	}
+
+	/* Track is location history, it goes only to a port that already receives positions */
+	if (!subscriber_registry_find(remote_app_id, port)) {
+		dlog_print(DLOG_WARN, LOG_TAG, "Track request from %s:%s, which is not subscribed", remote_app_id, port);
+		return;
+	}
+
+	if (!s_geolocation_data.track_dir[0]) {
+		dlog_print(DLOG_ERROR, LOG_TAG, "Track journal is not open, the track will not be sent");
+		return;
+	}
+
+	job = calloc(1, sizeof(track_job_s));
+	if (!job) {
+		dlog_print(DLOG_ERROR, LOG_TAG, "Failed to allocate track request");
+		return;
+	}
+
+	job->remote_app_id = strdup(remote_app_id);
+	job->port = strdup(port);
+	job->from = 0;
+	job->to = INT64_MAX;
+
+	if (bundle_get_str(message, TRACK_FROM_KEY, &value) == BUNDLE_ERROR_NONE)
+		job->from = strtoll(value, NULL, 10);
+
+	if (bundle_get_str(message, TRACK_TO_KEY, &value) == BUNDLE_ERROR_NONE)
+		job->to = strtoll(value, NULL, 10);
+
+	if (!job->remote_app_id || !job->port) {
+		dlog_print(DLOG_ERROR, LOG_TAG, "Failed to allocate track request");
+		__free_track_job(job);
+		return;
+	}
+
+	/* Scanning reads and inflates whole archives, which must not stall the main loop */
+	job->next = s_geolocation_data.track_jobs;
+	s_geolocation_data.track_jobs = job;
+
+	/* On failure the cancel callback has already freed the job */
+	thread = ecore_thread_run(__track_thread_cb, __track_end_cb, __track_cancel_cb, job);
+	if (!thread) {
+		dlog_print(DLOG_ERROR, LOG_TAG, "Failed to start track request from %s", remote_app_id);
+		return;
+	}
+
+	job->thread = thread;
 }
 
-static Eina_Bool
-__init_data_send(void)
+static void
+__track_thread_cb(void *data, Ecore_Thread *thread)
+{
+	track_job_s *job = data;
+
+	job->worker = thread;
+
+	/* Compaction replaces segments by archives, a scan running at the same time could miss both */
+	pthread_mutex_lock(&s_geolocation_data.journal_lock);
+	job->failed = track_journal_scan(s_geolocation_data.track_dir, job->from, job->to, __track_record_cb, job) < 0;
+	pthread_mutex_unlock(&s_geolocation_data.journal_lock);
+
+	job->size = track_codec_encode(job->points, job->count, job->track, sizeof(job->track));
+}
+
+static void
+__track_end_cb(void *data, Ecore_Thread *thread)
 {
-	location_coords_s init_coords;
-	int satellites_count = 0;
+	track_job_s *job = data;
+	bundle *b;
+	int ret;
 
-	/* Get initial position and satellites count */
-	if (!__init_data(&init_coords, &satellites_count)) {
-		dlog_print(DLOG_ERROR, LOG_TAG, "Failed to initialize geolocation data");
-		return EINA_FALSE;
+	if (job->failed)
+		dlog_print(DLOG_ERROR, LOG_TAG, "Failed to read track journal");
+
+	b = bundle_create();
+	if (!b) {
+		dlog_print(DLOG_ERROR, LOG_TAG, "Failed to create bundle, the track will not be sent");
+		__free_track_job(job);
+		return;
 	}
 
-	/* Send initial data to consumer application */
-	if (!__send_satellites_count(satellites_count) || !__send_position_coords(init_coords))
-		return EINA_FALSE;
+	__add_message_type(b, MESSAGE_ID_TRACK);
+	bundle_add_byte(b, TRACK_CODEC_KEY, job->track, job->size);
+
+	ret = message_port_send_message(job->remote_app_id, job->port, b);
+
+	bundle_free(b);
+
+	if (ret != MESSAGE_PORT_ERROR_NONE)
+		dlog_print(DLOG_ERROR, LOG_TAG, "Failed to send track to %s: error %d", job->remote_app_id, ret);
+	else
+		dlog_print(DLOG_INFO, LOG_TAG, "Track of %u fixes sent to %s in %u bytes, %.1f bytes per fix", job->count,
+				job->remote_app_id, (unsigned int)job->size,
+				job->count > 0 ? (double)(job->size - sizeof(track_codec_header_s)) / job->count : 0.0);
+
+	__free_track_job(job);
+}
+
+static void
+__track_cancel_cb(void *data, Ecore_Thread *thread)
+{
+	track_job_s *job = data;
+
+	dlog_print(DLOG_INFO, LOG_TAG, "Track request from %s cancelled", job->remote_app_id);
+	__free_track_job(job);
+}
+
+static void
+__free_track_job(track_job_s *job)
+{
+	track_job_s **link = &s_geolocation_data.track_jobs;
+
+	while (*link && *link != job)
+		link = &(*link)->next;
 
-	s_geolocation_data.init_data_sent = true;
+	if (*link)
+		*link = job->next;
 
-	return EINA_TRUE;
+	free(job->remote_app_id);
+	free(job->port);
+	free(job);
 }
 
 static bool
-__init_data(location_coords_s *init_coords, int *satellites_count)
+__track_record_cb(const track_record_s *record, void *user_data)
 {
-	/* Additional variables have to be declared to ensure proper local_manager and gps_status functions execution */
-	double altitude;
-	time_t timestamp;
-	time_t curr_timestamp;
-	int num_of_active;
+	track_job_s *job = user_data;
+	track_codec_point_s *point;
 
-	/* Get last location information*/
-	if (location_manager_get_last_position(s_geolocation_data.manager, &altitude, &init_coords->latitude, &init_coords->longitude, &timestamp) != LOCATIONS_ERROR_NONE) {
-		dlog_print(DLOG_ERROR, LOG_TAG, "Failed to get last location");
+	/* Service is going down */
+	if (ecore_thread_check(job->worker))
 		return false;
-	}
-	dlog_print(DLOG_INFO, LOG_TAG, "Initial position: latitude %f, longitude %f", init_coords->latitude, init_coords->longitude);
 
-	/* Get current time and compare it to the last position timestamp */
-	time(&curr_timestamp);
-
-	if (curr_timestamp-timestamp > MAX_TIME_DIFF) {
-		dlog_print(DLOG_ERROR, LOG_TAG, "Last position updated over 15 seconds ago - no longer valid");
+	if (job->count >= TRACK_MAX_POINTS)
 		return false;
-	}
 
-	/* Get initial count of satellites in view */
-	location_error_e ret = gps_status_get_satellite(s_geolocation_data.manager, &num_of_active, satellites_count, &timestamp);
-	if (ret != LOCATIONS_ERROR_NONE) {
-		dlog_print(DLOG_ERROR, LOG_TAG, "Failed to get satellite data [%d]", ret);
-		/* Satellite data is not supported on Tizen Emulator - satellites count remains at 0 */
-	}
-	dlog_print(DLOG_INFO, LOG_TAG, "Initial satelite data: number of satellites inview: %d", *satellites_count);
+	point = &job->points[job->count++];
+	point->timestamp = record->timestamp;
+	point->latitude = record->latitude;
+	point->longitude = record->longitude;
+	point->altitude = record->altitude;
+	point->horizontal_accuracy = record->horizontal_accuracy;
+	point->flags = record->flags;
 
 	return true;
 }
+
+static void
+__clear_zones(const char *app_id)
+{
+	hazard_zone_list_s empty;
+
+	hazard_zone_list_init(&empty, 0);
+	geofence_set_zones(app_id, &empty, sizeof(empty));
+}
+
+static unsigned int
+__evaluate_zones(const position_frame_s *frame, geofence_event_s *events)
+{
+	double start;
+	unsigned int count;
+
+	if (geofence_zone_count() == 0)
+		return 0;
+
+	start = ecore_time_get();
+	count = geofence_update(frame, events, GEOFENCE_MAX_EVENTS);
+	s_geolocation_data.zone_time += ecore_time_get() - start;
+	s_geolocation_data.zone_evaluations++;
+
+	return count;
+}
+
+static void
+__send_zone_events(const geofence_event_s *events, unsigned int count)
+{
+	unsigned int i;
+
+	for (i = 0; i < count; i++) {
+		const hazard_zone_event_s *event = &events[i].event;
+		bundle *b = bundle_create();
+
+		dlog_print(DLOG_INFO, LOG_TAG, "Zone %u of %s: %s, %.0fm from %s", event->id, events[i].owner,
+				hazard_zone_transition_str(event->transition), event->distance_m, event->radius_m > 0.0f ? "center" : "edge");
+
+		if (!b) {
+			dlog_print(DLOG_ERROR, LOG_TAG, "Failed to create bundle, the zone event will not be sent");
+			continue;
+		}
+
+		__add_message_type(b, MESSAGE_ID_ZONE_EVENT);
+		bundle_add_byte(b, HAZARD_ZONE_EVENT_KEY, event, sizeof(*event));
+
+		/* Transitions are never dropped by the outbound queue */
+		if (!__send_message_to(b, SUBSCRIBER_MSG_ZONE_EVENT, true, NULL, events[i].owner))
+			dlog_print(DLOG_WARN, LOG_TAG, "Zone event not delivered, %s is not subscribed", events[i].owner);
+
+		bundle_free(b);
+	}
+}
+
+static void
+__send_heartbeat(const position_frame_s *frame)
+{
+	bundle *b;
+
+	if (frame->timestamp - s_geolocation_data.last_heartbeat < HEARTBEAT_INTERVAL)
+		return;
+
+	s_geolocation_data.last_heartbeat = frame->timestamp;
+
+	b = bundle_create();
+	if (!b) {
+		dlog_print(DLOG_ERROR, LOG_TAG, "Failed to create bundle, the heartbeat will not be sent");
+		return;
+	}
+
+	__add_message_type(b, MESSAGE_ID_POSITION_HEARTBEAT);
+	bundle_add_byte(b, POSITION_FRAME_KEY, frame, sizeof(*frame));
+
+	__send_message(b, SUBSCRIBER_MSG_HEARTBEAT, false, NULL);
+
+	bundle_free(b);
+}
+
+static bool
+__setup_ring(subscriber_s *subscriber)
+{
+	subscriber_s *owner = __ring_subscriber();
+	bundle *b;
+	int ret;
+
+	/* Ring has a single reader */
+	if (owner && owner != subscriber) {
+		dlog_print(DLOG_WARN, LOG_TAG, "Shared memory ring is used by %s, %s gets bundles", owner->app_id, subscriber->app_id);
+		return false;
+	}
+
+	if (!s_geolocation_data.ring) {
+		char name[SHM_RING_NAME_SIZE];
+
+		if (!__random_ring_name(name, sizeof(name))) {
+			dlog_print(DLOG_ERROR, LOG_TAG, "Failed to read %s, shared memory ring is not created", RANDOM_DEVICE);
+			return false;
+		}
+
+		s_geolocation_data.ring = shm_ring_create(name);
+		if (!s_geolocation_data.ring) {
+			dlog_print(DLOG_ERROR, LOG_TAG, "Failed to create shared memory ring %s", name);
+			return false;
+		}
+	}
+
+	b = bundle_create();
+	if (!b) {
+		dlog_print(DLOG_ERROR, LOG_TAG, "Failed to create bundle, the ring handshake will not be sent");
+		return false;
+	}
+
+	__add_message_type(b, MESSAGE_ID_RING_HANDSHAKE);
+	bundle_add_str(b, RING_NAME_KEY, shm_ring_name(s_geolocation_data.ring));
+
+	/* Trusted port is only reachable by apps signed with the same certificate */
+	ret = message_port_send_trusted_message(subscriber->app_id, subscriber->port, b);
+
+	bundle_free(b);
+
+	if (ret != MESSAGE_PORT_ERROR_NONE) {
+		dlog_print(DLOG_ERROR, LOG_TAG, "Failed to send ring handshake to %s: error %d", subscriber->app_id, ret);
+		return false;
+	}
+
+	/* Consumer arms the doorbell once it has attached and drained the ring */
+	s_geolocation_data.ring_doorbell_pending = false;
+
+	return true;
+}
+
+static bool
+__random_ring_name(char *name, size_t size)
+{
+	unsigned long long suffix;
+	FILE *random = fopen(RANDOM_DEVICE, "rb");
+	bool ok;
+
+	if (!random)
+		return false;
+
+	ok = fread(&suffix, sizeof(suffix), 1, random) == 1;
+	fclose(random);
+
+	if (ok)
+		snprintf(name, size, SHM_RING_OBJECT_PREFIX "%016llx", suffix);
+
+	return ok;
+}
+
+static subscriber_s *
+__ring_subscriber(void)
+{
+	int i;
+
+	for (i = 0; i < subscriber_registry_count(); i++) {
+		subscriber_s *subscriber = subscriber_registry_get(i);
+
+		if (subscriber->ring)
+			return subscriber;
+	}
+
+	return NULL;
+}
+
+static bool
+__ring_write(const position_frame_s *frames, unsigned int count)
+{
+	subscriber_s *subscriber = __ring_subscriber();
+	bool doorbell = false;
+	bool wake = false;
+	unsigned int i;
+
+	if (!subscriber || !s_geolocation_data.ring)
+		return false;
+
+	/* Fixes in a batch are not decimated, like for bundle subscribers */
+	if (count == 1 && !subscriber_registry_wants(subscriber, SUBSCRIBER_MSG_POSITION, &frames[0]))
+		return false;
+
+	for (i = 0; i < count; i++) {
+		if (!shm_ring_write(s_geolocation_data.ring, SHM_RING_RECORD_POSITION, &frames[i], sizeof(position_frame_s), &wake)) {
+			dlog_print(DLOG_WARN, LOG_TAG, "Shared memory ring is full, position dropped");
+			break;
+		}
+
+		doorbell = doorbell || wake;
+	}
+
+	if (i == 0)
+		return false;
+
+	subscriber_registry_report(subscriber, true, count == 1 ? &frames[0] : NULL);
+
+	if (doorbell || s_geolocation_data.ring_doorbell_pending)
+		s_geolocation_data.ring_doorbell_pending = !__ring_doorbell(subscriber);
+
+	return true;
+}
+
+static bool
+__ring_doorbell(const subscriber_s *subscriber)
+{
+	bundle *b = bundle_create();
+	int ret;
+
+	if (!b)
+		return false;
+
+	__add_message_type(b, MESSAGE_ID_RING_DOORBELL);
+
+	ret = message_port_send_message(subscriber->app_id, subscriber->port, b);
+
+	bundle_free(b);
+
+	/* Doorbell was disarmed by the write - ring again with the next record */
+	if (ret != MESSAGE_PORT_ERROR_NONE) {
+		dlog_print(DLOG_WARN, LOG_TAG, "Failed to ring doorbell of %s: error %d", subscriber->app_id, ret);
+		return false;
+	}
+
+	return true;
+}
+
+static bool
+__has_bundle_subscriber(unsigned int type)
+{
+	int i;
+
+	for (i = 0; i < subscriber_registry_count(); i++) {
+		subscriber_s *subscriber = subscriber_registry_get(i);
+
+		if ((subscriber->types & type) && !(subscriber->ring && type == SUBSCRIBER_MSG_POSITION))
+			return true;
+	}
+
+	return false;
+}
+
+static bool
+__send_position_frame(const position_frame_s *frame)
+{
+	bool ring = __ring_write(frame, 1);
+	bundle *b;
+
+	/* No bundle is built when the ring subscriber is the only one */
+	if (!__has_bundle_subscriber(SUBSCRIBER_MSG_POSITION))
+		return ring;
+
+	b = bundle_create();
+	if (!b) {
+		dlog_print(DLOG_ERROR, LOG_TAG, "Failed to create bundle, the coords will not be sent");
+		return false;
+	}
+
+	__add_message_type(b, MESSAGE_ID_POSITION_UPDATE);
+	bundle_add_byte(b, POSITION_FRAME_KEY, frame, sizeof(*frame));
+
+#if LEGACY_POSITION_KEYS
+	char latitude_str[CHAR_BUFF_SIZE], longitude_str[CHAR_BUFF_SIZE];
+
+	snprintf(latitude_str, CHAR_BUFF_SIZE, "%f", frame->latitude);
+	snprintf(longitude_str, CHAR_BUFF_SIZE, "%f", frame->longitude);
+
+	bundle_add_str(b, "latitude", latitude_str);
+	bundle_add_str(b, "longitude", longitude_str);
+#endif
+
+	bool ret = __send_message(b, SUBSCRIBER_MSG_POSITION, false, frame);
+
+	bundle_free(b);
+
+	return ret || ring;
+}
+
+static bool
+__send_position_batch(const position_frame_s *frames, unsigned int count)
+{
+	bool ring = __ring_write(frames, count);
+	bundle *b;
+
+	if (!__has_bundle_subscriber(SUBSCRIBER_MSG_POSITION))
+		return ring;
+
+	b = bundle_create();
+	if (!b) {
+		dlog_print(DLOG_ERROR, LOG_TAG, "Failed to create bundle, %u batched positions will not be sent", count);
+		return false;
+	}
+
+	/* Frames are sent back to back, the consumer walks them in place */
+	__add_message_type(b, MESSAGE_ID_POSITION_BATCH);
+	bundle_add_byte(b, POSITION_BATCH_KEY, frames, count * sizeof(position_frame_s));
+
+	/* Fixes in a batch are not decimated per subscriber */
+	bool ret = __send_message(b, SUBSCRIBER_MSG_POSITION, false, NULL);
+
+	bundle_free(b);
+
+	return ret || ring;
+}
+
+static bool
+__queue_position_frame(const position_frame_s *frame, bool urgent)
+{
+	/* Nothing is buffered and batching is off - skip the ring buffer */
+	if (position_batch_get_flush_count() == 1 && position_batch_count() == 0)
+		return __send_position_frame(frame);
+
+	/* An urgent frame is geofence-relevant, it leads to a zone transition. Its batch leaves
+	 * right away, so the consumer has the track up to the event before the event itself. */
+	if (position_batch_push(frame) || urgent)
+		return geolocation_manager_flush_positions();
+
+	/* First frame of a new batch - make sure it does not wait longer than the deadline */
+	if (!s_geolocation_data.batch_timer)
+		s_geolocation_data.batch_timer = ecore_timer_add(s_geolocation_data.batch_deadline, __batch_deadline_cb, NULL);
+
+	return true;
+}
+
+static Eina_Bool
+__batch_deadline_cb(void *data)
+{
+	s_geolocation_data.batch_timer = NULL;
+
+	if (!geolocation_manager_flush_positions())
+		dlog_print(DLOG_ERROR, LOG_TAG, "Failed to send position batch");
+
+	return ECORE_CALLBACK_CANCEL;
+}
+
+static void
+__schedule_sampling(const position_frame_s *frame)
+{
+	/* Pushed zones replace the distance given by the launching application */
+	double hazard_distance = geofence_zone_count() > 0 ? geofence_distance_m() : s_geolocation_data.hazard_distance;
+	int interval = sampling_scheduler_update(hazard_distance, frame->speed,
+			s_geolocation_data.battery_percent, ecore_time_get());
+
+	/* Single fixes in the motion tier have no rate */
+	if (s_geolocation_data.power_tier == POWER_TIER_MOTION)
+		return;
+
+	interval = __tier_interval(interval);
+	if (interval == s_geolocation_data.position_interval)
+		return;
+
+	dlog_print(DLOG_INFO, LOG_TAG, "Position update interval %ds -> %ds (hazard %.0fm, speed %.1fkm/h, battery %d%%)",
+			s_geolocation_data.position_interval, interval, hazard_distance,
+			frame->speed, s_geolocation_data.battery_percent);
+
+	if (__set_update_intervals(interval))
+		s_geolocation_data.position_interval = interval;
+}
+
+static bool
+__set_update_intervals(int position_interval)
+{
+	const location_source_ops_s *source = s_geolocation_data.source;
+	int satellite_interval = position_interval > SATELLITE_UPDATE_INTERVAL ? position_interval : SATELLITE_UPDATE_INTERVAL;
+
+	if (!source->set_position_cb(__position_updated_cb, position_interval, NULL)) {
+		dlog_print(DLOG_ERROR, LOG_TAG, "Failed to change position update interval to %ds", position_interval);
+		source->set_position_cb(__position_updated_cb, s_geolocation_data.position_interval, NULL);
+		return false;
+	}
+
+	if (!source->set_satellite_cb(__satellite_updated_cb, satellite_interval, NULL))
+		dlog_print(DLOG_WARN, LOG_TAG, "Failed to get satellites number. Probably you run this sample on the emulator.");
+
+	return true;
+}
+
+static int
+__tier_interval(int interval)
+{
+	int min_interval = power_policy_min_interval(s_geolocation_data.power_tier);
+
+	return interval < min_interval ? min_interval : interval;
+}
+
+static void
+__battery_changed_cb(device_callback_e type, void *value, void *user_data)
+{
+	/* Simulated level of a replayed scenario wins over the real one */
+	if (s_geolocation_data.battery_override >= 0)
+		return;
+
+	s_geolocation_data.battery_percent = (int)(intptr_t)value;
+	__update_power_tier(power_policy_update(s_geolocation_data.battery_percent, s_geolocation_data.charging,
+			ecore_time_get()));
+}
+
+static void
+__charging_changed_cb(device_callback_e type, void *value, void *user_data)
+{
+	s_geolocation_data.charging = (bool)(intptr_t)value;
+	__update_power_tier(power_policy_update(s_geolocation_data.battery_percent, s_geolocation_data.charging,
+			ecore_time_get()));
+}
+
+static void
+__update_power_tier(power_tier_e tier)
+{
+	power_tier_e old_tier = s_geolocation_data.power_tier;
+	const location_source_ops_s *source;
+	int interval;
+
+	if (tier == old_tier)
+		return;
+
+	dlog_print(DLOG_INFO, LOG_TAG, "Power tier %s -> %s (battery %d%%%s)", power_policy_tier_str(old_tier),
+			power_policy_tier_str(tier), s_geolocation_data.battery_percent, s_geolocation_data.charging ? ", charging" : "");
+
+	s_geolocation_data.power_tier = tier;
+	__send_power_tier();
+
+	if (old_tier == POWER_TIER_MOTION)
+		__leave_motion_tier();
+
+	/* Replayed track stays the source, the tier only limits how often it is sampled */
+	if (s_geolocation_data.source == &location_replay_source) {
+		if (__set_update_intervals(__tier_interval(s_geolocation_data.position_interval)))
+			s_geolocation_data.position_interval = __tier_interval(s_geolocation_data.position_interval);
+		return;
+	}
+
+	if (tier == POWER_TIER_MOTION) {
+		__stop_source();
+		geolocation_manager_flush_positions();
+
+		if (!motion_detector_start(__motion_detected_cb, NULL))
+			dlog_print(DLOG_WARN, LOG_TAG, "Motion detection is not available, positioning is off until the tier changes");
+		return;
+	}
+
+	source = tier >= POWER_TIER_NETWORK ? &location_source_tizen_network : &location_source_tizen;
+	interval = __tier_interval(tier < old_tier ? POSITION_UPDATE_INTERVAL : s_geolocation_data.position_interval);
+
+	/* GPS and reduced GPS share the receiver, only its interval changes */
+	if (source == s_geolocation_data.source && s_geolocation_data.source_running) {
+		if (__set_update_intervals(interval))
+			s_geolocation_data.position_interval = interval;
+		return;
+	}
+
+	__stop_source();
+	s_geolocation_data.source = source;
+	s_geolocation_data.position_interval = interval;
+
+	if (!__start_source())
+		dlog_print(DLOG_ERROR, LOG_TAG, "Failed to switch to %s location source", source->name);
+}
+
+static bool
+__send_power_tier(void)
+{
+	bundle *b = bundle_create();
+	char battery_str[CHAR_BUFF_SIZE];
+
+	if (!b) {
+		dlog_print(DLOG_ERROR, LOG_TAG, "Failed to create bundle, the power tier will not be sent");
+		return false;
+	}
+
+	snprintf(battery_str, CHAR_BUFF_SIZE, "%d", s_geolocation_data.battery_percent);
+
+	__add_message_type(b, MESSAGE_ID_POWER_TIER);
+	bundle_add_str(b, POWER_TIER_KEY, power_policy_tier_str(s_geolocation_data.power_tier));
+	bundle_add_str(b, BATTERY_KEY, battery_str);
+
+	bool ret = __send_message(b, SUBSCRIBER_MSG_STATUS, false, NULL);
+
+	bundle_free(b);
+
+	return ret;
+}
+
+static void
+__leave_motion_tier(void)
+{
+	motion_detector_stop();
+
+	if (s_geolocation_data.motion_job) {
+		ecore_job_del(s_geolocation_data.motion_job);
+		s_geolocation_data.motion_job = NULL;
+	}
+
+	if (s_geolocation_data.motion_timer) {
+		ecore_timer_del(s_geolocation_data.motion_timer);
+		s_geolocation_data.motion_timer = NULL;
+	}
+
+	if (s_geolocation_data.motion_fix_pending) {
+		s_geolocation_data.motion_fix_pending = false;
+		__stop_source();
+	}
+}
+
+static void
+__motion_detected_cb(void *user_data)
+{
+	dlog_print(DLOG_INFO, LOG_TAG, "Significant motion detected, taking a network fix");
+
+	s_geolocation_data.source = &location_source_tizen_network;
+	if (!__start_source()) {
+		motion_detector_start(__motion_detected_cb, NULL);
+		return;
+	}
+
+	s_geolocation_data.motion_fix_pending = true;
+	s_geolocation_data.motion_timer = ecore_timer_add(MOTION_FIX_TIMEOUT, __motion_timeout_cb, NULL);
+}
+
+static Eina_Bool
+__motion_timeout_cb(void *data)
+{
+	s_geolocation_data.motion_timer = NULL;
+
+	dlog_print(DLOG_WARN, LOG_TAG, "No fix within %.0fs after motion", MOTION_FIX_TIMEOUT);
+	__end_motion_fix();
+
+	return ECORE_CALLBACK_CANCEL;
+}
+
+static void
+__motion_fix_job_cb(void *data)
+{
+	s_geolocation_data.motion_job = NULL;
+	__end_motion_fix();
+}
+
+static void
+__end_motion_fix(void)
+{
+	if (s_geolocation_data.motion_timer) {
+		ecore_timer_del(s_geolocation_data.motion_timer);
+		s_geolocation_data.motion_timer = NULL;
+	}
+
+	if (!s_geolocation_data.motion_fix_pending)
+		return;
+
+	s_geolocation_data.motion_fix_pending = false;
+	__stop_source();
+	geolocation_manager_flush_positions();
+
+	/* Wait for the next motion */
+	if (s_geolocation_data.power_tier == POWER_TIER_MOTION)
+		motion_detector_start(__motion_detected_cb, NULL);
+}
+
+static void
+__log_power_stats(void)
+{
+	power_policy_stats_s stats;
+	int i;
+
+	power_policy_get_stats(&stats, ecore_time_get());
+	dlog_print(DLOG_INFO, LOG_TAG, "Power tiers: %u transitions", stats.transitions);
+
+	for (i = 0; i < POWER_TIER_COUNT; i++) {
+		dlog_print(DLOG_INFO, LOG_TAG, "Power tier %s: %.0fs, %u fixes, %u%% battery used, %.1f J modeled",
+				power_policy_tier_str(i), stats.seconds_in_tier[i], stats.fixes_in_tier[i],
+				stats.battery_used_in_tier[i], stats.energy_in_tier[i]);
+	}
+}
+
+static bool
+__send_satellites_count(int s_count, const void *satellite_frame, size_t frame_size)
+{
+	bundle *b = bundle_create();
+	char count_str[CHAR_BUFF_SIZE];
+
+	if (!b) {
+		dlog_print(DLOG_ERROR, LOG_TAG, "Failed to create bundle, the satellites will not be sent");
+		return false;
+	}
+
+	snprintf(count_str, CHAR_BUFF_SIZE, "%d", s_count);
+
+	__add_message_type(b, MESSAGE_ID_SATELLITES_UPDATE);
+	bundle_add_str(b, "satellites_count", count_str);
+	if (satellite_frame)
+		bundle_add_byte(b, SATELLITE_FRAME_KEY, satellite_frame, frame_size);
+
+	bool ret = __send_message(b, SUBSCRIBER_MSG_SATELLITES, false, NULL);
+
+	bundle_free(b);
+
+	return ret;
+}
+
+static void
+__position_updated_cb(double latitude, double longitude, double altitude, time_t timestamp, void *data)
+{
+	static geofence_event_s events[GEOFENCE_MAX_EVENTS];
+	unsigned int event_count;
+	fix_quality_verdict_e verdict;
+	position_frame_s frame;
+	time_t curr_timestamp;
+	int satellites;
+
+	/* Get current time to compare to the last position timestamp */
+	time(&curr_timestamp);
+
+	position_frame_init(&frame, latitude, longitude, altitude, timestamp);
+	__fill_frame_details(&frame);
+
+	/* Old and inaccurate fixes never reach the filters, the zones or the subscribers.
+	 * Satellites are queried once, the log shows the count the verdict was made on. */
+	satellites = __fix_satellites();
+	verdict = fix_quality_check(&frame, satellites, curr_timestamp);
+	if (verdict != FIX_ACCEPTED) {
+		dlog_print(DLOG_DEBUG, LOG_TAG, "Fix rejected: %s, accuracy %.0fm/%.0fm, %d satellites",
+				fix_quality_verdict_str(verdict), frame.horizontal_accuracy, frame.vertical_accuracy, satellites);
+		return;
+	}
+
+	/* Every accepted raw fix is kept in the track journal, even before the consumer is connected.
+	 * Replayed fixes are already recorded and would mix a past track into the real one. */
+	if (s_geolocation_data.source != &location_replay_source)
+		__journal_frame(&frame);
+
+	__smooth_frame(&frame);
+	power_policy_count_fix();
+
+	/* Newest position is the one a new subscriber gets in its state snapshot */
+	s_geolocation_data.last_frame = frame;
+	s_geolocation_data.has_last_frame = true;
+
+	/* Zones are evaluated here on every fix, only transitions leave the service.
+	 * A poor fix is still shown, but can not raise or clear a boundary alert. */
+	event_count = position_frame_quality(&frame) != POSITION_FRAME_QUALITY_POOR ? __evaluate_zones(&frame, events) : 0;
+
+	/* Send updated position only if init data has been sent */
+	if (s_geolocation_data.init_data_sent) {
+		/* Skip fixes that carry no new information - stationary user costs no IPC */
+		deadband_decision_e decision = deadband_filter_check(&frame);
+
+		if (decision == DEADBAND_SUPPRESSED && event_count == 0) {
+			dlog_print(DLOG_DEBUG, LOG_TAG, "Position update suppressed by dead-band");
+		} else if (__queue_position_frame(&frame, event_count > 0)) {
+			/* Send position update via message port, possibly as part of a batch */
+			dlog_print(DLOG_INFO, LOG_TAG, "Position updated to %f, %f (%s)", latitude, longitude,
+					deadband_filter_decision_str(decision));
+		} else {
+			dlog_print(DLOG_ERROR, LOG_TAG, "Failed to send position update");
+		}
+
+		__schedule_sampling(&frame);
+	}
+
+	/* Positions leading to a transition were flushed before it */
+	__send_zone_events(events, event_count);
+	__send_heartbeat(&frame);
+
+	/* Source can not be stopped from its own callback */
+	if (s_geolocation_data.motion_fix_pending && !s_geolocation_data.motion_job)
+		s_geolocation_data.motion_job = ecore_job_add(__motion_fix_job_cb, NULL);
+}
+
+
+static void
+__satellite_updated_cb(int num_of_active, int num_of_inview, time_t timestamp, void *data)
+{
+	static unsigned char satellite_frame[SATELLITE_TELEMETRY_BUFFER_SIZE];
+	size_t frame_size = 0;
+
+	s_geolocation_data.satellites_inview = num_of_inview;
+	s_geolocation_data.satellites_active = num_of_active;
+
+	/* Encode details even before the consumer is ready - a state snapshot starts from the last update */
+	satellite_telemetry_begin(num_of_active, num_of_inview, timestamp);
+	if (num_of_inview > 0 && s_geolocation_data.source->foreach_satellite &&
+			s_geolocation_data.source->foreach_satellite(__satellite_info_cb, NULL))
+		frame_size = satellite_telemetry_encode(satellite_frame);
+
+	/* Send update satellite count only if init data has been sent*/
+	if (s_geolocation_data.init_data_sent) {
+		/* Send satellite count update via message port */
+		if (__send_satellites_count(num_of_inview, frame_size ? satellite_frame : NULL, frame_size)) {
+			dlog_print(DLOG_INFO, LOG_TAG, "Satellite count updated: inview %d", num_of_inview);
+		} else {
+			dlog_print(DLOG_ERROR, LOG_TAG, "Failed to send satellite count update");
+		}
+	}
+}
+
+static bool
+__satellite_info_cb(unsigned int azimuth, unsigned int elevation, unsigned int prn,
+		int snr, bool is_in_use, void *data)
+{
+	satellite_telemetry_add(prn, azimuth, elevation, snr, is_in_use);
+
+	return true;
+}
+
+static bool
+__send_state_snapshot(const char *app_id, const char *port)
+{
+	static unsigned char satellite_frame[SATELLITE_TELEMETRY_BUFFER_SIZE];
+	position_frame_s frame;
+	char count_str[CHAR_BUFF_SIZE];
+	bool has_frame = __snapshot_frame(&frame);
+	size_t frame_size = satellite_telemetry_encode_key_frame(satellite_frame);
+	uint32_t inside[GEOFENCE_MAX_INSIDE];
+	unsigned int inside_count = geofence_get_inside(app_id, inside, GEOFENCE_MAX_INSIDE);
+	bundle *b = bundle_create();
+
+	if (!b) {
+		dlog_print(DLOG_ERROR, LOG_TAG, "Failed to create bundle, the state snapshot will not be sent");
+		return false;
+	}
+
+	snprintf(count_str, CHAR_BUFF_SIZE, "%d", __snapshot_satellites());
+
+	/* Whole state in one message, so the consumer never shows a half-initialized view */
+	__add_message_type(b, MESSAGE_ID_STATE_SNAPSHOT);
+	bundle_add_str(b, "satellites_count", count_str);
+	bundle_add_str(b, POWER_TIER_KEY, power_policy_tier_str(s_geolocation_data.power_tier));
+	/* No key means the position is in none of the zones of the subscriber */
+	if (inside_count > 0)
+		bundle_add_byte(b, HAZARD_ZONE_INSIDE_KEY, inside, inside_count * sizeof(uint32_t));
+	if (has_frame)
+		bundle_add_byte(b, POSITION_FRAME_KEY, &frame, sizeof(frame));
+	if (frame_size)
+		bundle_add_byte(b, SATELLITE_FRAME_KEY, satellite_frame, frame_size);
+
+	int ret = message_port_send_message(app_id, port, b);
+
+	bundle_free(b);
+
+	if (ret != MESSAGE_PORT_ERROR_NONE) {
+		dlog_print(DLOG_ERROR, LOG_TAG, "Failed to send state snapshot to %s: error %d", app_id, ret);
+		return false;
+	}
+
+	dlog_print(DLOG_INFO, LOG_TAG, "State snapshot sent to %s %.0f ms after start, position: %s", app_id,
+			(ecore_time_get() - s_geolocation_data.start_time) * 1000.0,
+			!has_frame ? "none" : (frame.flags & POSITION_FRAME_FLAG_STALE) ? "last known" : "live");
+
+	if (!s_geolocation_data.init_data_sent) {
+		/* Live position the consumer now shows is the dead-band filter reference */
+		if (has_frame && !(frame.flags & POSITION_FRAME_FLAG_STALE))
+			deadband_filter_check(&frame);
+
+		s_geolocation_data.init_data_sent = true;
+	}
+
+	return true;
+}
+
+static bool
+__snapshot_frame(position_frame_s *frame)
+{
+	location_source_fix_s fix;
+	time_t curr_timestamp;
+
+	if (s_geolocation_data.has_last_frame) {
+		*frame = s_geolocation_data.last_frame;
+	} else if (s_geolocation_data.source->get_last_fix(&fix)) {
+		position_frame_init(frame, fix.latitude, fix.longitude, fix.altitude, fix.timestamp);
+		frame->horizontal_accuracy = (float)fix.horizontal_accuracy;
+		frame->vertical_accuracy = (float)fix.vertical_accuracy;
+		frame->speed = (float)fix.speed;
+		frame->heading = (float)fix.heading;
+		position_frame_set_quality(frame, fix_quality_classify(fix.horizontal_accuracy));
+	} else {
+		dlog_print(DLOG_WARN, LOG_TAG, "No position for state snapshot yet");
+		return false;
+	}
+
+	/* Old position is still shown at once instead of nothing, the first live fix replaces it */
+	time(&curr_timestamp);
+	if (curr_timestamp - frame->timestamp > MAX_TIME_DIFF)
+		frame->flags |= POSITION_FRAME_FLAG_STALE;
+
+	return true;
+}
+
+static int
+__snapshot_satellites(void)
+{
+	int num_of_active, num_of_inview;
+
+	if (s_geolocation_data.satellites_inview >= 0)
+		return s_geolocation_data.satellites_inview;
+
+	/* Satellite data is not supported on Tizen Emulator - satellites count remains at 0 */
+	if (!s_geolocation_data.source->get_satellites(&num_of_active, &num_of_inview))
+		return 0;
+
+	return num_of_inview;
+}
+
+static int
+__fix_satellites(void)
+{
+	int num_of_active;
+	int num_of_inview;
+
+	/* Only the receiver reports satellites, network and replayed fixes are checked without */
+	if (s_geolocation_data.source != &location_source_tizen)
+		return FIX_QUALITY_SATELLITES_NONE;
+
+	/* Fixes can come before the first satellite callback - ask the receiver */
+	if (s_geolocation_data.satellites_active < 0) {
+		if (!s_geolocation_data.source->get_satellites(&num_of_active, &num_of_inview))
+			return FIX_QUALITY_SATELLITES_UNKNOWN;
+
+		s_geolocation_data.satellites_active = num_of_active;
+		s_geolocation_data.satellites_inview = num_of_inview;
+	}
+
+	return s_geolocation_data.satellites_active;
+}
+
+static void
+__fill_frame_details(position_frame_s *frame)
+{
+	double direction, speed, horizontal, vertical;
+
+	/* Velocity and accuracy are cached by location manager for the current fix - fields stay 0 if unavailable */
+	if (s_geolocation_data.source->get_velocity(&speed, &direction)) {
+		frame->speed = (float)speed;
+		frame->heading = (float)direction;
+	}
+
+	if (s_geolocation_data.source->get_accuracy(&horizontal, &vertical)) {
+		frame->horizontal_accuracy = (float)horizontal;
+		frame->vertical_accuracy = (float)vertical;
+	}
+}
+
+static void
+__smooth_frame(position_frame_s *frame)
+{
+	kalman_estimate_s estimate;
+
+	if (!s_geolocation_data.smoothing)
+		return;
+
+	kalman_filter_update(&s_geolocation_data.kalman, frame->latitude, frame->longitude,
+			frame->horizontal_accuracy, frame->timestamp, &estimate);
+
+	/* Speed and heading stay as reported by the receiver, which measures them from Doppler shift */
+	frame->latitude = estimate.latitude;
+	frame->longitude = estimate.longitude;
+	frame->horizontal_accuracy = (float)sqrt(estimate.var_east > estimate.var_north ? estimate.var_east : estimate.var_north);
+	frame->flags |= POSITION_FRAME_FLAG_SMOOTHED;
+}
+
+static void
+__open_track_journal(void)
+{
+	char *data_path = app_get_data_path();
+
+	if (!data_path) {
+		dlog_print(DLOG_ERROR, LOG_TAG, "Failed to get data path, track journal disabled");
+		return;
+	}
+
+	snprintf(s_geolocation_data.track_dir, PATH_MAX, "%s%s", data_path, TRACK_JOURNAL_DIR);
+	free(data_path);
+
+	if (!track_journal_open(s_geolocation_data.track_dir)) {
+		dlog_print(DLOG_ERROR, LOG_TAG, "Failed to open track journal in %s", s_geolocation_data.track_dir);
+		return;
+	}
+
+	s_geolocation_data.track_segment = track_journal_current_segment();
+	dlog_print(DLOG_INFO, LOG_TAG, "Track journal opened at segment %u", s_geolocation_data.track_segment);
+}
+
+static void
+__journal_frame(const position_frame_s *frame)
+{
+	unsigned int segment;
+
+	if (!track_journal_append(frame))
+		return;
+
+	segment = track_journal_current_segment();
+	if (segment == s_geolocation_data.track_segment)
+		return;
+
+	/* Segment was rotated - compress old segments in the background */
+	s_geolocation_data.track_segment = segment;
+
+	if (s_geolocation_data.compact_thread)
+		return;
+
+	s_geolocation_data.compact_before = segment;
+	s_geolocation_data.compact_thread = ecore_thread_run(__compact_thread_cb, __compact_end_cb, __compact_end_cb, NULL);
+}
+
+static void
+__compact_thread_cb(void *data, Ecore_Thread *thread)
+{
+	int compacted;
+
+	pthread_mutex_lock(&s_geolocation_data.journal_lock);
+	compacted = track_journal_compact(s_geolocation_data.track_dir, s_geolocation_data.compact_before, TRACK_KEEP_SEGMENTS);
+	pthread_mutex_unlock(&s_geolocation_data.journal_lock);
+
+	dlog_print(DLOG_INFO, LOG_TAG, "Track journal: %d segments compacted", compacted);
+}
+
+static void
+__compact_end_cb(void *data, Ecore_Thread *thread)
+{
+	s_geolocation_data.compact_thread = NULL;
+}
+
+static void
+__stop_journal_threads(void)
+{
+	track_job_s *job;
+
+	/* A thread that has not started yet is cancelled at once and its cancel callback has run.
+	 * A running one finishes, its end or cancel callback is called from the main loop. */
+	if (s_geolocation_data.compact_thread && !ecore_thread_cancel(s_geolocation_data.compact_thread)) {
+		while (s_geolocation_data.compact_thread)
+			ecore_main_loop_iterate();
+	}
+
+	while ((job = s_geolocation_data.track_jobs)) {
+		if (ecore_thread_cancel(job->thread))
+			continue;
+
+		while (s_geolocation_data.track_jobs == job)
+			ecore_main_loop_iterate();
+	}
+}
+
+static bool
+__start_source(void)
+{
+	const location_source_ops_s *source = s_geolocation_data.source;
+
+	if (!source->create()) {
+		dlog_print(DLOG_ERROR, LOG_TAG, "Failed to create %s location source", source->name);
+		return false;
+	}
+
+	if (!__set_update_intervals(s_geolocation_data.position_interval) || !source->start()) {
+		dlog_print(DLOG_ERROR, LOG_TAG, "Failed to start %s location source", source->name);
+		source->destroy();
+		return false;
+	}
+
+	s_geolocation_data.source_running = true;
+
+	return true;
+}
+
+static void
+__stop_source(void)
+{
+	const location_source_ops_s *source = s_geolocation_data.source;
+
+	if (s_geolocation_data.replay_timer) {
+		ecore_timer_del(s_geolocation_data.replay_timer);
+		s_geolocation_data.replay_timer = NULL;
+		__log_replay_stats();
+	}
+
+	if (!s_geolocation_data.source_running)
+		return;
+
+	s_geolocation_data.source_running = false;
+	source->unset_position_cb();
+	source->unset_satellite_cb();
+	source->stop();
+	source->destroy();
+}
+
+static Eina_Bool
+__replay_timer_cb(void *data)
+{
+	double delay = location_replay_poll(ecore_time_get());
+
+	if (delay < 0.0) {
+		dlog_print(DLOG_INFO, LOG_TAG, "Replay finished");
+		__log_replay_stats();
+		geolocation_manager_flush_positions();
+		s_geolocation_data.replay_timer = NULL;
+		return ECORE_CALLBACK_CANCEL;
+	}
+
+	/* Interval of the running timer applies from its next expiry */
+	ecore_timer_interval_set(s_geolocation_data.replay_timer, delay);
+
+	return ECORE_CALLBACK_RENEW;
+}
+
+static void
+__log_replay_stats(void)
+{
+	location_replay_stats_s stats;
+
+	location_replay_get_stats(&stats, ecore_time_get());
+	dlog_print(DLOG_INFO, LOG_TAG, "Replay: %u fixes read, %u delivered, %u skipped, %u errors, %.1fs, %.1f fixes/s",
+			stats.fixes_read, stats.fixes_delivered, stats.fixes_skipped, stats.parse_errors,
+			stats.elapsed_s, stats.fixes_per_second);
+}
@@ -4,6 +4,15 @@
 #include "gpsservice.h"
 #include "geolocation_manager.h"
 
+#define EXTRA_BATCH_COUNT "batch_count"
+#define EXTRA_BATCH_DEADLINE "batch_deadline"
+#define EXTRA_HAZARD_DISTANCE "hazard_distance"
+#define EXTRA_REPLAY_FILE "replay_file"
+#define EXTRA_REPLAY_SPEED "replay_speed"
+#define EXTRA_BATTERY_LEVEL "battery_level"
+#define EXTRA_QUEUE_POLICY "queue_policy"
+#define EXTRA_MAX_ACCURACY "max_accuracy"
+
 bool
 __create_service_app(void *data)
 {
@@ -21,7 +30,60 @@ __terminate_service_app(void *data)
 void
 __control_service_app(app_control_h app_control, void *data)
 {
-    return;
+	char *count_str = NULL;
+	char *deadline_str = NULL;
+	char *distance_str = NULL;
+	char *replay_file = NULL;
+	char *replay_speed_str = NULL;
+	char *battery_str = NULL;
+	char *policy_str = NULL;
+	char *accuracy_str = NULL;
+	fix_quality_config_s quality;
+
+	/* Position batching can be configured by the launching application */
+	app_control_get_extra_data(app_control, EXTRA_BATCH_COUNT, &count_str);
+	app_control_get_extra_data(app_control, EXTRA_BATCH_DEADLINE, &deadline_str);
+
+	if (count_str || deadline_str) {
+		geolocation_manager_set_batching(count_str ? (unsigned int)strtoul(count_str, NULL, 10) : 0,
+				deadline_str ? strtod(deadline_str, NULL) : 0.0);
+	}
+
+	/* Distance to the nearest hazard, sent by the alerting application */
+	if (app_control_get_extra_data(app_control, EXTRA_HAZARD_DISTANCE, &distance_str) == APP_CONTROL_ERROR_NONE && distance_str)
+		geolocation_manager_set_hazard_distance(strtod(distance_str, NULL));
+
+	/* Recorded track replaces the GPS receiver, for testing and reproducing field reports */
+	if (app_control_get_extra_data(app_control, EXTRA_REPLAY_FILE, &replay_file) == APP_CONTROL_ERROR_NONE && replay_file) {
+		app_control_get_extra_data(app_control, EXTRA_REPLAY_SPEED, &replay_speed_str);
+		geolocation_manager_start_replay(replay_file, replay_speed_str ? strtod(replay_speed_str, NULL) : 1.0);
+	}
+
+	/* Simulated battery level, to drive the power tiers through a drain scenario */
+	if (app_control_get_extra_data(app_control, EXTRA_BATTERY_LEVEL, &battery_str) == APP_CONTROL_ERROR_NONE && battery_str)
+		geolocation_manager_set_battery_override((int)strtol(battery_str, NULL, 10));
+
+	/* "keep-latest" keeps only the newest queued message of a type for a slow subscriber */
+	if (app_control_get_extra_data(app_control, EXTRA_QUEUE_POLICY, &policy_str) == APP_CONTROL_ERROR_NONE && policy_str) {
+		geolocation_manager_set_queue_policy(!strcmp(policy_str, outbound_queue_policy_str(OUTBOUND_KEEP_LATEST)) ?
+				OUTBOUND_KEEP_LATEST : OUTBOUND_DROP_OLDEST);
+	}
+
+	/* Horizontal accuracy threshold for receiver fixes, other thresholds keep their defaults */
+	if (app_control_get_extra_data(app_control, EXTRA_MAX_ACCURACY, &accuracy_str) == APP_CONTROL_ERROR_NONE && accuracy_str) {
+		fix_quality_default_config(&quality);
+		quality.max_horizontal_m = strtod(accuracy_str, NULL);
+		geolocation_manager_set_fix_quality(&quality);
+	}
+
+	free(count_str);
+	free(deadline_str);
+	free(distance_str);
+	free(replay_file);
+	free(replay_speed_str);
+	free(battery_str);
+	free(policy_str);
+	free(accuracy_str);
 }
 
 
@@ -50,7 +112,16 @@ static void
 __service_app_low_battery(app_event_info_h event_info, void *user_data)
 {
 	/*APP_EVENT_LOW_BATTERY*/
-	geolocation_manager_stop_service();
+	app_event_low_battery_status_e status;
+
+	if (app_event_get_low_battery_status(event_info, &status) != APP_ERROR_NONE)
+		return;
+
+	/* Positioning degrades instead of stopping - a user in a hazard zone still needs alerts */
+	if (status == APP_EVENT_LOW_BATTERY_POWER_OFF)
+		geolocation_manager_set_power_floor(POWER_TIER_MOTION);
+	else if (status == APP_EVENT_LOW_BATTERY_CRITICAL_LOW)
+		geolocation_manager_set_power_floor(POWER_TIER_NETWORK);
 }
 
 
@@ -0,0 +1,165 @@
+#include <math.h>
+#include "kalman_filter.h"
+
+#define KALMAN_DEFAULT_PROCESS_NOISE 1.0	/* m^2/s^3 */
+#define KALMAN_DEFAULT_ACCURACY_M 50.0
+#define KALMAN_INITIAL_VELOCITY_VAR 100.0	/* (10 m/s)^2 */
+#define KALMAN_REANCHOR_M 5000.0
+
+#define EARTH_RADIUS_M 6371008.8
+#define DEG_TO_RAD (M_PI / 180.0)
+#define RAD_TO_DEG (180.0 / M_PI)
+#define METERS_PER_DEG_LAT (EARTH_RADIUS_M * DEG_TO_RAD)
+
+static void __set_origin(kalman_filter_s *kf, double latitude, double longitude);
+static void __reset_axis(kalman_axis_s *axis, double position, double variance);
+static void __predict_axis(kalman_axis_s *axis, double dt, double q);
+static void __correct_axis(kalman_axis_s *axis, double measurement, double variance);
+static void __reanchor(kalman_filter_s *kf);
+static double __wrap_longitude(double longitude);
+
+
+void
+kalman_filter_init(kalman_filter_s *kf, double process_noise)
+{
+	kf->process_noise = process_noise > 0.0 ? process_noise : KALMAN_DEFAULT_PROCESS_NOISE;
+	kf->timestamp = 0;
+	kf->initialized = false;
+	__set_origin(kf, 0.0, 0.0);
+	__reset_axis(&kf->east, 0.0, 0.0);
+	__reset_axis(&kf->north, 0.0, 0.0);
+}
+
+void
+kalman_filter_update(kalman_filter_s *kf, double latitude, double longitude, double accuracy,
+		int64_t timestamp, kalman_estimate_s *estimate)
+{
+	double variance;
+	double dt;
+
+	if (accuracy <= 0.0)
+		accuracy = KALMAN_DEFAULT_ACCURACY_M;
+
+	variance = accuracy * accuracy;
+	dt = (double)(timestamp - kf->timestamp);
+
+	if (!kf->initialized || dt < 0.0 || dt > KALMAN_MAX_GAP_S) {
+		/* Start from the measurement itself, velocity unknown */
+		__set_origin(kf, latitude, longitude);
+		__reset_axis(&kf->east, 0.0, variance);
+		__reset_axis(&kf->north, 0.0, variance);
+		kf->timestamp = timestamp;
+		kf->initialized = true;
+
+		kalman_filter_get_estimate(kf, estimate);
+		return;
+	}
+
+	if (dt > 0.0) {
+		__predict_axis(&kf->east, dt, kf->process_noise);
+		__predict_axis(&kf->north, dt, kf->process_noise);
+	}
+
+	/* Shorter way around, a track crossing the antimeridian is not 360 degrees away */
+	__correct_axis(&kf->east, __wrap_longitude(longitude - kf->origin_longitude) * kf->meters_per_deg_lon, variance);
+	__correct_axis(&kf->north, (latitude - kf->origin_latitude) * METERS_PER_DEG_LAT, variance);
+	kf->timestamp = timestamp;
+
+	/* Equirectangular projection error grows with distance from origin */
+	if (fabs(kf->east.position) > KALMAN_REANCHOR_M || fabs(kf->north.position) > KALMAN_REANCHOR_M)
+		__reanchor(kf);
+
+	kalman_filter_get_estimate(kf, estimate);
+}
+
+void
+kalman_filter_get_estimate(const kalman_filter_s *kf, kalman_estimate_s *estimate)
+{
+	double heading;
+
+	estimate->latitude = kf->origin_latitude + kf->north.position / METERS_PER_DEG_LAT;
+	estimate->longitude = __wrap_longitude(kf->origin_longitude + kf->east.position / kf->meters_per_deg_lon);
+	estimate->velocity_east = kf->east.velocity;
+	estimate->velocity_north = kf->north.velocity;
+	estimate->speed = hypot(kf->east.velocity, kf->north.velocity);
+
+	heading = atan2(kf->east.velocity, kf->north.velocity) * RAD_TO_DEG;
+	estimate->heading = heading < 0.0 ? heading + 360.0 : heading;
+
+	estimate->var_east = kf->east.p_pp;
+	estimate->var_north = kf->north.p_pp;
+	estimate->cov_east = kf->east.p_pv;
+	estimate->cov_north = kf->north.p_pv;
+	estimate->var_velocity_east = kf->east.p_vv;
+	estimate->var_velocity_north = kf->north.p_vv;
+}
+
+static void
+__set_origin(kalman_filter_s *kf, double latitude, double longitude)
+{
+	kf->origin_latitude = latitude;
+	kf->origin_longitude = __wrap_longitude(longitude);
+	kf->meters_per_deg_lon = METERS_PER_DEG_LAT * cos(latitude * DEG_TO_RAD);
+
+	/* Avoid division by zero at the poles */
+	if (kf->meters_per_deg_lon < 1.0)
+		kf->meters_per_deg_lon = 1.0;
+}
+
+static void
+__reset_axis(kalman_axis_s *axis, double position, double variance)
+{
+	axis->position = position;
+	axis->velocity = 0.0;
+	axis->p_pp = variance;
+	axis->p_pv = 0.0;
+	axis->p_vv = KALMAN_INITIAL_VELOCITY_VAR;
+}
+
+static void
+__predict_axis(kalman_axis_s *axis, double dt, double q)
+{
+	double dt2 = dt * dt;
+
+	/* x' = F x, P' = F P F^T + Q for F = [1 dt; 0 1] and white acceleration noise */
+	axis->position += axis->velocity * dt;
+	axis->p_pp += 2.0 * dt * axis->p_pv + dt2 * axis->p_vv + q * dt2 * dt / 3.0;
+	axis->p_pv += dt * axis->p_vv + q * dt2 / 2.0;
+	axis->p_vv += q * dt;
+}
+
+static void
+__correct_axis(kalman_axis_s *axis, double measurement, double variance)
+{
+	double s = axis->p_pp + variance;
+	double k_p = axis->p_pp / s;
+	double k_v = axis->p_pv / s;
+	double innovation = measurement - axis->position;
+
+	axis->position += k_p * innovation;
+	axis->velocity += k_v * innovation;
+
+	/* P = (I - K H) P */
+	axis->p_vv -= k_v * axis->p_pv;
+	axis->p_pp *= (1.0 - k_p);
+	axis->p_pv *= (1.0 - k_p);
+}
+
+static void
+__reanchor(kalman_filter_s *kf)
+{
+	double latitude = kf->origin_latitude + kf->north.position / METERS_PER_DEG_LAT;
+	double longitude = __wrap_longitude(kf->origin_longitude + kf->east.position / kf->meters_per_deg_lon);
+
+	/* Velocities and covariances are unchanged by a translation of the plane */
+	__set_origin(kf, latitude, longitude);
+	kf->east.position = 0.0;
+	kf->north.position = 0.0;
+}
+
+static double
+__wrap_longitude(double longitude)
+{
+	/* Into [-180, 180) */
+	return longitude - 360.0 * floor((longitude + 180.0) / 360.0);
+}
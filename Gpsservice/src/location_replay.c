@@ -0,0 +1,339 @@
+#include <string.h>
+#include "location_replay.h"
+
+/* Fixes delivered by one poll when replaying as fast as possible, so the caller's
+ * main loop keeps running between bursts */
+#define REPLAY_BURST 64
+
+static struct
+{
+	track_file_s *file;
+	double speed;
+
+	location_source_position_cb position_cb;
+	void *position_data;
+	int position_interval;
+	location_source_satellite_cb satellite_cb;
+	void *satellite_data;
+	int satellite_interval;
+
+	track_file_fix_s next;
+	track_file_fix_s last;
+	bool has_next;
+	bool has_last;
+	bool has_satellites;
+	bool started;
+
+	double track_start;			/* track time of the first fix */
+	double poll_start;			/* poll time of the first poll */
+	double epoch_start;			/* wall clock time of the first poll */
+	double poll_now;			/* poll time of the current poll */
+	time_t last_delivered;		/* delivered timestamp of the last fix */
+	double last_position_time;
+	double last_satellite_time;
+	bool clock_started;
+
+	location_replay_stats_s stats;
+} s_replay_data = {
+	.file = NULL,
+	.started = false
+};
+
+static bool __read_next(void);
+static void __deliver(const track_file_fix_s *fix);
+static time_t __delivered_time(void);
+static bool __create(void);
+static void __destroy(void);
+static bool __start(void);
+static void __stop(void);
+static bool __set_position_cb(location_source_position_cb cb, int interval, void *user_data);
+static void __unset_position_cb(void);
+static bool __set_satellite_cb(location_source_satellite_cb cb, int interval, void *user_data);
+static void __unset_satellite_cb(void);
+static bool __get_last_fix(location_source_fix_s *fix);
+static bool __get_velocity(double *speed, double *heading);
+static bool __get_accuracy(double *horizontal, double *vertical);
+static bool __get_satellites(int *num_of_active, int *num_of_inview);
+
+
+const location_source_ops_s location_replay_source = {
+	.name = "replay",
+	.create = __create,
+	.destroy = __destroy,
+	.start = __start,
+	.stop = __stop,
+	.set_position_cb = __set_position_cb,
+	.unset_position_cb = __unset_position_cb,
+	.set_satellite_cb = __set_satellite_cb,
+	.unset_satellite_cb = __unset_satellite_cb,
+	.get_last_fix = __get_last_fix,
+	.get_velocity = __get_velocity,
+	.get_accuracy = __get_accuracy,
+	.get_satellites = __get_satellites,
+	/* Track files do not record satellite details */
+	.foreach_satellite = NULL
+};
+
+bool
+location_replay_open(const char *path, double speed)
+{
+	location_replay_close();
+
+	s_replay_data.file = track_file_open(path);
+	if (!s_replay_data.file)
+		return false;
+
+	s_replay_data.speed = speed > 0.0 ? speed : LOCATION_REPLAY_AS_FAST;
+	s_replay_data.has_last = false;
+	s_replay_data.has_satellites = false;
+	s_replay_data.clock_started = false;
+	memset(&s_replay_data.stats, 0, sizeof(s_replay_data.stats));
+
+	if (!__read_next()) {
+		location_replay_close();
+		return false;
+	}
+
+	s_replay_data.track_start = s_replay_data.next.timestamp;
+
+	return true;
+}
+
+double
+location_replay_poll(double now)
+{
+	int burst = 0;
+
+	if (!s_replay_data.file || !s_replay_data.has_next)
+		return -1.0;
+
+	if (!s_replay_data.started)
+		return 0.0;
+
+	if (!s_replay_data.clock_started) {
+		s_replay_data.poll_start = now;
+		s_replay_data.epoch_start = (double)time(NULL);
+		s_replay_data.clock_started = true;
+	}
+
+	s_replay_data.poll_now = now;
+
+	while (s_replay_data.has_next) {
+		double offset = s_replay_data.next.timestamp - s_replay_data.track_start;
+
+		if (s_replay_data.speed == LOCATION_REPLAY_AS_FAST) {
+			if (burst++ == REPLAY_BURST)
+				return 0.0;
+		} else {
+			double due = s_replay_data.poll_start + offset / s_replay_data.speed;
+
+			if (due > now)
+				return due - now;
+		}
+
+		__deliver(&s_replay_data.next);
+		__read_next();
+
+		/* Callbacks may stop the replay */
+		if (!s_replay_data.started)
+			break;
+	}
+
+	return s_replay_data.has_next ? 0.0 : -1.0;
+}
+
+void
+location_replay_get_stats(location_replay_stats_s *stats, double now)
+{
+	*stats = s_replay_data.stats;
+
+	if (s_replay_data.file)
+		stats->parse_errors = track_file_get_errors(s_replay_data.file);
+
+	stats->elapsed_s = s_replay_data.clock_started ? now - s_replay_data.poll_start : 0.0;
+	stats->fixes_per_second = stats->elapsed_s > 0.0 ? stats->fixes_delivered / stats->elapsed_s : 0.0;
+}
+
+void
+location_replay_close(void)
+{
+	if (!s_replay_data.file)
+		return;
+
+	/* Keep the final error count for statistics */
+	s_replay_data.stats.parse_errors = track_file_get_errors(s_replay_data.file);
+
+	track_file_close(s_replay_data.file);
+	s_replay_data.file = NULL;
+	s_replay_data.has_next = false;
+	s_replay_data.started = false;
+}
+
+static bool
+__read_next(void)
+{
+	s_replay_data.has_next = track_file_next(s_replay_data.file, &s_replay_data.next);
+
+	/* Out of order fixes are replayed at once, not held back */
+	if (s_replay_data.has_next) {
+		s_replay_data.stats.fixes_read++;
+		if (s_replay_data.has_last && s_replay_data.next.timestamp < s_replay_data.last.timestamp)
+			s_replay_data.next.timestamp = s_replay_data.last.timestamp;
+	}
+
+	return s_replay_data.has_next;
+}
+
+static void
+__deliver(const track_file_fix_s *fix)
+{
+	bool first = !s_replay_data.has_last;
+
+	s_replay_data.last = *fix;
+	s_replay_data.last_delivered = __delivered_time();
+	s_replay_data.has_last = true;
+
+	if (fix->satellites > 0)
+		s_replay_data.has_satellites = true;
+
+	if (s_replay_data.position_cb) {
+		if (first || fix->timestamp - s_replay_data.last_position_time >= s_replay_data.position_interval) {
+			s_replay_data.last_position_time = fix->timestamp;
+			s_replay_data.stats.fixes_delivered++;
+			s_replay_data.position_cb(fix->latitude, fix->longitude, fix->altitude,
+					s_replay_data.last_delivered, s_replay_data.position_data);
+		} else {
+			s_replay_data.stats.fixes_skipped++;
+		}
+	}
+
+	if (s_replay_data.satellite_cb && fix->satellites > 0 &&
+			(first || fix->timestamp - s_replay_data.last_satellite_time >= s_replay_data.satellite_interval)) {
+		s_replay_data.last_satellite_time = fix->timestamp;
+		s_replay_data.satellite_cb(fix->satellites, fix->satellites,
+				s_replay_data.last_delivered, s_replay_data.satellite_data);
+	}
+}
+
+static time_t
+__delivered_time(void)
+{
+	/* Follow the poll clock, so sped up fixes never get timestamps ahead of the wall clock */
+	return (time_t)(s_replay_data.epoch_start + (s_replay_data.poll_now - s_replay_data.poll_start));
+}
+
+static bool
+__create(void)
+{
+	return s_replay_data.file != NULL;
+}
+
+static void
+__destroy(void)
+{
+	location_replay_close();
+}
+
+static bool
+__start(void)
+{
+	if (!s_replay_data.file)
+		return false;
+
+	s_replay_data.started = true;
+
+	return true;
+}
+
+static void
+__stop(void)
+{
+	s_replay_data.started = false;
+}
+
+static bool
+__set_position_cb(location_source_position_cb cb, int interval, void *user_data)
+{
+	s_replay_data.position_cb = cb;
+	s_replay_data.position_data = user_data;
+	s_replay_data.position_interval = interval;
+
+	return true;
+}
+
+static void
+__unset_position_cb(void)
+{
+	s_replay_data.position_cb = NULL;
+}
+
+static bool
+__set_satellite_cb(location_source_satellite_cb cb, int interval, void *user_data)
+{
+	s_replay_data.satellite_cb = cb;
+	s_replay_data.satellite_data = user_data;
+	s_replay_data.satellite_interval = interval;
+
+	return true;
+}
+
+static void
+__unset_satellite_cb(void)
+{
+	s_replay_data.satellite_cb = NULL;
+}
+
+static bool
+__get_last_fix(location_source_fix_s *fix)
+{
+	if (!s_replay_data.has_last)
+		return false;
+
+	fix->latitude = s_replay_data.last.latitude;
+	fix->longitude = s_replay_data.last.longitude;
+	fix->altitude = s_replay_data.last.altitude;
+	fix->speed = s_replay_data.last.speed;
+	fix->heading = s_replay_data.last.heading;
+	fix->horizontal_accuracy = s_replay_data.last.horizontal_accuracy;
+	fix->vertical_accuracy = s_replay_data.last.vertical_accuracy;
+	fix->timestamp = s_replay_data.last_delivered;
+
+	return true;
+}
+
+static bool
+__get_velocity(double *speed, double *heading)
+{
+	if (!s_replay_data.has_last)
+		return false;
+
+	*speed = s_replay_data.last.speed;
+	*heading = s_replay_data.last.heading;
+
+	return true;
+}
+
+static bool
+__get_accuracy(double *horizontal, double *vertical)
+{
+	if (!s_replay_data.has_last)
+		return false;
+
+	*horizontal = s_replay_data.last.horizontal_accuracy;
+	*vertical = s_replay_data.last.vertical_accuracy;
+
+	return true;
+}
+
+static bool
+__get_satellites(int *num_of_active, int *num_of_inview)
+{
+	/* Like on the emulator, satellites are not available if the track does not have them */
+	if (!s_replay_data.has_satellites)
+		return false;
+
+	*num_of_active = s_replay_data.last.satellites;
+	*num_of_inview = s_replay_data.last.satellites;
+
+	return true;
+}
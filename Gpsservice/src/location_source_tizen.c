@@ -0,0 +1,177 @@
+#include <locations.h>
+#include "location_source.h"
+
+static struct
+{
+	location_manager_h manager;
+} s_tizen_source_data = {
+	.manager = NULL
+};
+
+static bool __create(location_method_e method);
+static bool __create_gps(void);
+static bool __create_network(void);
+static void __destroy(void);
+static bool __start(void);
+static void __stop(void);
+static bool __set_position_cb(location_source_position_cb cb, int interval, void *user_data);
+static void __unset_position_cb(void);
+static bool __set_satellite_cb(location_source_satellite_cb cb, int interval, void *user_data);
+static void __unset_satellite_cb(void);
+static bool __get_last_fix(location_source_fix_s *fix);
+static bool __get_velocity(double *speed, double *heading);
+static bool __get_accuracy(double *horizontal, double *vertical);
+static bool __get_satellites(int *num_of_active, int *num_of_inview);
+static bool __foreach_satellite(location_source_satellite_info_cb cb, void *user_data);
+
+
+const location_source_ops_s location_source_tizen = {
+	.name = "tizen",
+	.create = __create_gps,
+	.destroy = __destroy,
+	.start = __start,
+	.stop = __stop,
+	.set_position_cb = __set_position_cb,
+	.unset_position_cb = __unset_position_cb,
+	.set_satellite_cb = __set_satellite_cb,
+	.unset_satellite_cb = __unset_satellite_cb,
+	.get_last_fix = __get_last_fix,
+	.get_velocity = __get_velocity,
+	.get_accuracy = __get_accuracy,
+	.get_satellites = __get_satellites,
+	.foreach_satellite = __foreach_satellite
+};
+
+const location_source_ops_s location_source_tizen_network = {
+	.name = "tizen-network",
+	.create = __create_network,
+	.destroy = __destroy,
+	.start = __start,
+	.stop = __stop,
+	.set_position_cb = __set_position_cb,
+	.unset_position_cb = __unset_position_cb,
+	.set_satellite_cb = __set_satellite_cb,
+	.unset_satellite_cb = __unset_satellite_cb,
+	.get_last_fix = __get_last_fix,
+	.get_velocity = __get_velocity,
+	.get_accuracy = __get_accuracy,
+	.get_satellites = __get_satellites,
+	.foreach_satellite = __foreach_satellite
+};
+
+static bool
+__create(location_method_e method)
+{
+	return location_manager_create(method, &s_tizen_source_data.manager) == LOCATIONS_ERROR_NONE;
+}
+
+static bool
+__create_gps(void)
+{
+	return __create(LOCATIONS_METHOD_GPS);
+}
+
+static bool
+__create_network(void)
+{
+	bool enabled = false;
+
+	/* WPS alone does not wake the GPS receiver, hybrid may fall back to it */
+	if (location_manager_is_enabled_method(LOCATIONS_METHOD_WPS, &enabled) == LOCATIONS_ERROR_NONE && enabled)
+		return __create(LOCATIONS_METHOD_WPS);
+
+	return __create(LOCATIONS_METHOD_HYBRID);
+}
+
+static void
+__destroy(void)
+{
+	if (!s_tizen_source_data.manager)
+		return;
+
+	location_manager_destroy(s_tizen_source_data.manager);
+	s_tizen_source_data.manager = NULL;
+}
+
+static bool
+__start(void)
+{
+	return location_manager_start(s_tizen_source_data.manager) == LOCATIONS_ERROR_NONE;
+}
+
+static void
+__stop(void)
+{
+	location_manager_stop(s_tizen_source_data.manager);
+}
+
+static bool
+__set_position_cb(location_source_position_cb cb, int interval, void *user_data)
+{
+	/* Interval can only be changed by registering the callback again */
+	location_manager_unset_position_updated_cb(s_tizen_source_data.manager);
+
+	return location_manager_set_position_updated_cb(s_tizen_source_data.manager, cb, interval, user_data) == LOCATIONS_ERROR_NONE;
+}
+
+static void
+__unset_position_cb(void)
+{
+	location_manager_unset_position_updated_cb(s_tizen_source_data.manager);
+}
+
+static bool
+__set_satellite_cb(location_source_satellite_cb cb, int interval, void *user_data)
+{
+	gps_status_unset_satellite_updated_cb(s_tizen_source_data.manager);
+
+	return gps_status_set_satellite_updated_cb(s_tizen_source_data.manager, cb, interval, user_data) == LOCATIONS_ERROR_NONE;
+}
+
+static void
+__unset_satellite_cb(void)
+{
+	gps_status_unset_satellite_updated_cb(s_tizen_source_data.manager);
+}
+
+static bool
+__get_last_fix(location_source_fix_s *fix)
+{
+	double climb;
+	location_accuracy_level_e level;
+
+	return location_manager_get_last_location(s_tizen_source_data.manager, &fix->altitude, &fix->latitude, &fix->longitude,
+			&climb, &fix->heading, &fix->speed, &level, &fix->horizontal_accuracy, &fix->vertical_accuracy,
+			&fix->timestamp) == LOCATIONS_ERROR_NONE;
+}
+
+static bool
+__get_velocity(double *speed, double *heading)
+{
+	double climb;
+	time_t timestamp;
+
+	return location_manager_get_velocity(s_tizen_source_data.manager, &climb, heading, speed, &timestamp) == LOCATIONS_ERROR_NONE;
+}
+
+static bool
+__get_accuracy(double *horizontal, double *vertical)
+{
+	location_accuracy_level_e level;
+
+	return location_manager_get_accuracy(s_tizen_source_data.manager, &level, horizontal, vertical) == LOCATIONS_ERROR_NONE;
+}
+
+static bool
+__get_satellites(int *num_of_active, int *num_of_inview)
+{
+	time_t timestamp;
+
+	return gps_status_get_satellite(s_tizen_source_data.manager, num_of_active, num_of_inview, &timestamp) == LOCATIONS_ERROR_NONE;
+}
+
+static bool
+__foreach_satellite(location_source_satellite_info_cb cb, void *user_data)
+{
+	return gps_status_foreach_satellites_in_view(s_tizen_source_data.manager, cb, user_data) == LOCATIONS_ERROR_NONE;
+}
@@ -0,0 +1,111 @@
+#include <tizen.h>
+#include <math.h>
+#include <sensor.h>
+#include "gpsservice.h"
+#include "motion_detector.h"
+
+#define MOTION_INTERVAL_MS 500
+#define MOTION_THRESHOLD 1.5		/* m/s^2, walking is well above it */
+#define MOTION_WINDOW 6
+#define MOTION_HITS 4
+
+static struct
+{
+	sensor_listener_h listener;
+	motion_detector_cb cb;
+	void *user_data;
+	unsigned int history;		/* bit per sample, newest in bit 0 */
+} s_motion_data = {
+	.listener = NULL,
+	.cb = NULL,
+	.user_data = NULL,
+	.history = 0
+};
+
+static void __sensor_event_cb(sensor_h sensor, sensor_event_s *event, void *data);
+
+
+bool
+motion_detector_start(motion_detector_cb cb, void *user_data)
+{
+	sensor_h sensor;
+	bool supported = false;
+
+	if (s_motion_data.listener)
+		motion_detector_stop();
+
+	if (sensor_is_supported(SENSOR_LINEAR_ACCELERATION, &supported) != SENSOR_ERROR_NONE || !supported) {
+		dlog_print(DLOG_WARN, LOG_TAG, "Linear acceleration sensor is not supported");
+		return false;
+	}
+
+	if (sensor_get_default_sensor(SENSOR_LINEAR_ACCELERATION, &sensor) != SENSOR_ERROR_NONE ||
+			sensor_create_listener(sensor, &s_motion_data.listener) != SENSOR_ERROR_NONE) {
+		dlog_print(DLOG_ERROR, LOG_TAG, "Failed to create motion sensor listener");
+		s_motion_data.listener = NULL;
+		return false;
+	}
+
+	s_motion_data.cb = cb;
+	s_motion_data.user_data = user_data;
+	s_motion_data.history = 0;
+
+	/* Keep detecting with the screen off - that is when the device is in a pocket */
+	sensor_listener_set_option(s_motion_data.listener, SENSOR_OPTION_ALWAYS_ON);
+
+	if (sensor_listener_set_event_cb(s_motion_data.listener, MOTION_INTERVAL_MS, __sensor_event_cb, NULL) != SENSOR_ERROR_NONE ||
+			sensor_listener_start(s_motion_data.listener) != SENSOR_ERROR_NONE) {
+		dlog_print(DLOG_ERROR, LOG_TAG, "Failed to start motion sensor listener");
+		motion_detector_stop();
+		return false;
+	}
+
+	return true;
+}
+
+void
+motion_detector_stop(void)
+{
+	if (!s_motion_data.listener)
+		return;
+
+	sensor_listener_stop(s_motion_data.listener);
+	sensor_listener_unset_event_cb(s_motion_data.listener);
+	sensor_destroy_listener(s_motion_data.listener);
+	s_motion_data.listener = NULL;
+}
+
+bool
+motion_detector_is_armed(void)
+{
+	return s_motion_data.listener != NULL;
+}
+
+static void
+__sensor_event_cb(sensor_h sensor, sensor_event_s *event, void *data)
+{
+	motion_detector_cb cb = s_motion_data.cb;
+	unsigned int hits = 0;
+	unsigned int bits;
+	double magnitude;
+
+	if (event->value_count < 3)
+		return;
+
+	magnitude = sqrt(event->values[0] * event->values[0] + event->values[1] * event->values[1] +
+			event->values[2] * event->values[2]);
+
+	s_motion_data.history = ((s_motion_data.history << 1) | (magnitude > MOTION_THRESHOLD)) & ((1u << MOTION_WINDOW) - 1);
+
+	for (bits = s_motion_data.history; bits; bits &= bits - 1)
+		hits++;
+
+	if (hits < MOTION_HITS)
+		return;
+
+	/* One shot - the owner arms the detector again when it wants the next motion */
+	motion_detector_stop();
+
+	if (cb)
+		cb(s_motion_data.user_data);
+}
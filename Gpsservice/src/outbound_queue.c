@@ -0,0 +1,419 @@
+#include <stdlib.h>
+#include <string.h>
+#include "subscriber_registry.h"
+#include "outbound_queue.h"
+
+#define OUTBOUND_RETRY_BASE 0.5
+#define OUTBOUND_RETRY_MAX 30.0
+
+typedef struct
+{
+	bundle *b;
+	unsigned int sequence;
+	unsigned int type;
+	int destination;
+	bool critical;
+	bool used;
+} outbound_entry_s;
+
+typedef struct
+{
+	char app_id[SUBSCRIBER_APP_ID_SIZE];
+	char port[SUBSCRIBER_PORT_SIZE];
+	unsigned int count;
+	unsigned int attempts;
+	double next_try;
+	bool resync;
+	bool used;
+} outbound_destination_s;
+
+static const char *s_policy_names[] = { "drop-oldest", "keep-latest" };
+
+static struct
+{
+	outbound_entry_s entries[OUTBOUND_QUEUE_CAPACITY];
+	outbound_destination_s destinations[SUBSCRIBER_MAX];
+	outbound_policy_e policy;
+	unsigned int sequence;
+	unsigned int critical_count;
+	unsigned int normal_count;
+
+	outbound_queue_stats_s stats;
+} s_queue_data = {
+	.policy = OUTBOUND_DROP_OLDEST,
+	.sequence = 0,
+	.critical_count = 0,
+	.normal_count = 0
+};
+
+static int __find_destination(const char *app_id, const char *port);
+static int __add_destination(const char *app_id, const char *port, double now);
+static int __oldest(int destination, bool any_critical);
+static int __latest_of_type(int destination, unsigned int type);
+static int __free_entry(void);
+static void __remove(int index);
+static void __clear_destination(int destination);
+static void __back_off(outbound_destination_s *destination, double now);
+
+
+void
+outbound_queue_init(outbound_policy_e policy)
+{
+	int i;
+
+	for (i = 0; i < OUTBOUND_QUEUE_CAPACITY; i++) {
+		if (s_queue_data.entries[i].used)
+			__remove(i);
+	}
+
+	memset(s_queue_data.destinations, 0, sizeof(s_queue_data.destinations));
+	memset(&s_queue_data.stats, 0, sizeof(s_queue_data.stats));
+	s_queue_data.policy = policy;
+}
+
+void
+outbound_queue_set_policy(outbound_policy_e policy)
+{
+	s_queue_data.policy = policy;
+}
+
+const char *
+outbound_queue_policy_str(outbound_policy_e policy)
+{
+	if (policy > OUTBOUND_KEEP_LATEST)
+		return "unknown";
+
+	return s_policy_names[policy];
+}
+
+bool
+outbound_queue_pending(const char *app_id, const char *port)
+{
+	return __find_destination(app_id, port) >= 0;
+}
+
+bool
+outbound_queue_push(const char *app_id, const char *port, unsigned int type, bool critical,
+		bundle *b, double now)
+{
+	int destination = __find_destination(app_id, port);
+	int index;
+
+	if (destination < 0)
+		destination = __add_destination(app_id, port, now);
+
+	/* More subscribers failing than can be registered, can only happen briefly after removals */
+	if (destination < 0) {
+		s_queue_data.stats.dropped++;
+		return !critical;
+	}
+
+	/* State snapshot sent on resync will cover it */
+	if (s_queue_data.destinations[destination].resync) {
+		s_queue_data.stats.replaced++;
+		return true;
+	}
+
+	if (!critical && s_queue_data.policy == OUTBOUND_KEEP_LATEST) {
+		index = __latest_of_type(destination, type);
+		if (index >= 0) {
+			__remove(index);
+			s_queue_data.stats.replaced++;
+		}
+	}
+
+	if (!critical && (s_queue_data.normal_count >= OUTBOUND_QUEUE_NORMAL_MAX ||
+			s_queue_data.critical_count + s_queue_data.normal_count >= OUTBOUND_QUEUE_CAPACITY)) {
+		s_queue_data.stats.dropped++;
+
+		/* Queue full of critical messages has no room for this one */
+		index = __oldest(-1, false);
+		if (index < 0) {
+			if (s_queue_data.destinations[destination].count == 0)
+				s_queue_data.destinations[destination].used = false;
+			return true;
+		}
+
+		__remove(index);
+	}
+
+	if (critical && s_queue_data.critical_count + s_queue_data.normal_count >= OUTBOUND_QUEUE_CAPACITY) {
+		index = __oldest(-1, false);
+		if (index < 0) {
+			/* Whole queue holds critical messages - this subscriber gets the current state instead */
+			__clear_destination(destination);
+			s_queue_data.destinations[destination].used = true;
+			s_queue_data.destinations[destination].resync = true;
+			s_queue_data.stats.resyncs++;
+			return false;
+		}
+
+		__remove(index);
+		s_queue_data.stats.dropped++;
+	}
+
+	/* Destination may have been freed by the removals above */
+	if (!s_queue_data.destinations[destination].used) {
+		destination = __add_destination(app_id, port, now);
+		if (destination < 0)
+			return !critical;
+	}
+
+	index = __free_entry();
+	s_queue_data.entries[index].b = bundle_dup(b);
+	s_queue_data.entries[index].sequence = s_queue_data.sequence++;
+	s_queue_data.entries[index].type = type;
+	s_queue_data.entries[index].destination = destination;
+	s_queue_data.entries[index].critical = critical;
+	s_queue_data.entries[index].used = true;
+
+	s_queue_data.destinations[destination].count++;
+	if (critical)
+		s_queue_data.critical_count++;
+	else
+		s_queue_data.normal_count++;
+
+	s_queue_data.stats.queued++;
+	if (s_queue_data.critical_count + s_queue_data.normal_count > s_queue_data.stats.max_depth)
+		s_queue_data.stats.max_depth = s_queue_data.critical_count + s_queue_data.normal_count;
+
+	return true;
+}
+
+double
+outbound_queue_next_retry(double now)
+{
+	double next = 0.0;
+	bool found = false;
+	int i;
+
+	for (i = 0; i < SUBSCRIBER_MAX; i++) {
+		outbound_destination_s *destination = &s_queue_data.destinations[i];
+
+		if (destination->used && (!found || destination->next_try < next)) {
+			next = destination->next_try;
+			found = true;
+		}
+	}
+
+	if (!found)
+		return -1.0;
+
+	return next > now ? next - now : 0.0;
+}
+
+unsigned int
+outbound_queue_retry(outbound_queue_send_cb cb, void *user_data, double now)
+{
+	unsigned int delivered = 0;
+	int i, index;
+
+	for (i = 0; i < SUBSCRIBER_MAX; i++) {
+		outbound_destination_s *destination = &s_queue_data.destinations[i];
+
+		if (!destination->used || destination->next_try > now)
+			continue;
+
+		if (destination->resync) {
+			s_queue_data.stats.retries++;
+			if (!cb(destination->app_id, destination->port, NULL, user_data)) {
+				__back_off(destination, now);
+				continue;
+			}
+
+			/* Current state supersedes everything queued before it was sent */
+			delivered++;
+			__clear_destination(i);
+			continue;
+		}
+
+		while ((index = __oldest(i, true)) >= 0) {
+			s_queue_data.stats.retries++;
+			if (!cb(destination->app_id, destination->port, s_queue_data.entries[index].b, user_data)) {
+				/* Callback may have dropped the subscriber */
+				if (destination->used)
+					__back_off(destination, now);
+				break;
+			}
+
+			delivered++;
+			destination->attempts = 0;
+			if (s_queue_data.entries[index].used)
+				__remove(index);
+		}
+
+		if (destination->used && destination->count == 0 && !destination->resync)
+			destination->used = false;
+	}
+
+	s_queue_data.stats.delivered += delivered;
+
+	return delivered;
+}
+
+void
+outbound_queue_drop(const char *app_id, const char *port)
+{
+	int destination = __find_destination(app_id, port);
+
+	if (destination >= 0)
+		__clear_destination(destination);
+}
+
+void
+outbound_queue_get_stats(outbound_queue_stats_s *stats)
+{
+	*stats = s_queue_data.stats;
+	stats->depth = s_queue_data.critical_count + s_queue_data.normal_count;
+	stats->critical_depth = s_queue_data.critical_count;
+}
+
+static int
+__find_destination(const char *app_id, const char *port)
+{
+	int i;
+
+	for (i = 0; i < SUBSCRIBER_MAX; i++) {
+		outbound_destination_s *destination = &s_queue_data.destinations[i];
+
+		if (destination->used && !strcmp(destination->app_id, app_id) && !strcmp(destination->port, port))
+			return i;
+	}
+
+	return -1;
+}
+
+static int
+__add_destination(const char *app_id, const char *port, double now)
+{
+	int i;
+
+	for (i = 0; i < SUBSCRIBER_MAX; i++) {
+		outbound_destination_s *destination = &s_queue_data.destinations[i];
+
+		if (destination->used)
+			continue;
+
+		memset(destination, 0, sizeof(*destination));
+		strncpy(destination->app_id, app_id, SUBSCRIBER_APP_ID_SIZE - 1);
+		strncpy(destination->port, port, SUBSCRIBER_PORT_SIZE - 1);
+		destination->used = true;
+
+		/* The message being queued has just failed - do not retry at once */
+		__back_off(destination, now);
+
+		return i;
+	}
+
+	return -1;
+}
+
+static int
+__oldest(int destination, bool any_critical)
+{
+	int oldest = -1;
+	int i;
+
+	/* Sequence numbers are compared by difference, so wrapping around does not change the order */
+	for (i = 0; i < OUTBOUND_QUEUE_CAPACITY; i++) {
+		outbound_entry_s *entry = &s_queue_data.entries[i];
+
+		if (!entry->used || (destination >= 0 && entry->destination != destination) ||
+				(!any_critical && entry->critical))
+			continue;
+
+		if (oldest < 0 || (int)(entry->sequence - s_queue_data.entries[oldest].sequence) < 0)
+			oldest = i;
+	}
+
+	return oldest;
+}
+
+static int
+__latest_of_type(int destination, unsigned int type)
+{
+	int latest = -1;
+	int i;
+
+	for (i = 0; i < OUTBOUND_QUEUE_CAPACITY; i++) {
+		outbound_entry_s *entry = &s_queue_data.entries[i];
+
+		if (!entry->used || entry->critical || entry->destination != destination || entry->type != type)
+			continue;
+
+		if (latest < 0 || (int)(entry->sequence - s_queue_data.entries[latest].sequence) > 0)
+			latest = i;
+	}
+
+	return latest;
+}
+
+static int
+__free_entry(void)
+{
+	int i;
+
+	/* Callers make room first, so there is always one */
+	for (i = 0; i < OUTBOUND_QUEUE_CAPACITY; i++) {
+		if (!s_queue_data.entries[i].used)
+			return i;
+	}
+
+	return -1;
+}
+
+static void
+__remove(int index)
+{
+	outbound_entry_s *entry = &s_queue_data.entries[index];
+	outbound_destination_s *destination = &s_queue_data.destinations[entry->destination];
+
+	if (entry->b)
+		bundle_free(entry->b);
+
+	entry->b = NULL;
+	entry->used = false;
+
+	if (entry->critical)
+		s_queue_data.critical_count--;
+	else
+		s_queue_data.normal_count--;
+
+	/* Subscriber that has nothing queued sends directly again */
+	if (--destination->count == 0 && !destination->resync)
+		destination->used = false;
+}
+
+static void
+__clear_destination(int destination)
+{
+	int i;
+
+	s_queue_data.destinations[destination].resync = false;
+
+	for (i = 0; i < OUTBOUND_QUEUE_CAPACITY; i++) {
+		if (s_queue_data.entries[i].used && s_queue_data.entries[i].destination == destination)
+			__remove(i);
+	}
+
+	s_queue_data.destinations[destination].used = false;
+}
+
+static void
+__back_off(outbound_destination_s *destination, double now)
+{
+	double delay = OUTBOUND_RETRY_BASE;
+	unsigned int i;
+
+	for (i = 0; i < destination->attempts && delay < OUTBOUND_RETRY_MAX; i++)
+		delay *= 2.0;
+
+	if (delay > OUTBOUND_RETRY_MAX)
+		delay = OUTBOUND_RETRY_MAX;
+
+	/* Random half of the delay, so subscribers that failed together do not retry together */
+	delay *= 0.5 + 0.5 * rand() / (double)RAND_MAX;
+
+	destination->attempts++;
+	destination->next_try = now + delay;
+}
@@ -0,0 +1,90 @@
+#include <string.h>
+#include "position_batch.h"
+
+static struct
+{
+	position_frame_s frames[POSITION_BATCH_CAPACITY];
+
+	unsigned int head;
+	unsigned int count;
+	unsigned int flush_count;
+} s_batch_data = {
+	.head = 0,
+	.count = 0,
+	.flush_count = 1
+};
+
+static unsigned int __clamp_flush_count(unsigned int flush_count);
+
+
+void
+position_batch_init(unsigned int flush_count)
+{
+	s_batch_data.head = 0;
+	s_batch_data.count = 0;
+	s_batch_data.flush_count = __clamp_flush_count(flush_count);
+}
+
+void
+position_batch_set_flush_count(unsigned int flush_count)
+{
+	s_batch_data.flush_count = __clamp_flush_count(flush_count);
+}
+
+unsigned int
+position_batch_get_flush_count(void)
+{
+	return s_batch_data.flush_count;
+}
+
+bool
+position_batch_push(const position_frame_s *frame)
+{
+	unsigned int tail = (s_batch_data.head + s_batch_data.count) % POSITION_BATCH_CAPACITY;
+
+	s_batch_data.frames[tail] = *frame;
+
+	if (s_batch_data.count < POSITION_BATCH_CAPACITY)
+		s_batch_data.count++;
+	else
+		s_batch_data.head = (s_batch_data.head + 1) % POSITION_BATCH_CAPACITY;
+
+	return s_batch_data.count >= s_batch_data.flush_count;
+}
+
+unsigned int
+position_batch_count(void)
+{
+	return s_batch_data.count;
+}
+
+unsigned int
+position_batch_drain(position_frame_s *out, unsigned int max_frames)
+{
+	unsigned int n = s_batch_data.count < max_frames ? s_batch_data.count : max_frames;
+	unsigned int first = POSITION_BATCH_CAPACITY - s_batch_data.head;
+
+	/* Copy at most two contiguous runs - up to the end of the array and the wrapped part */
+	if (first > n)
+		first = n;
+
+	memcpy(out, &s_batch_data.frames[s_batch_data.head], first * sizeof(position_frame_s));
+	memcpy(out + first, &s_batch_data.frames[0], (n - first) * sizeof(position_frame_s));
+
+	s_batch_data.head = (s_batch_data.head + n) % POSITION_BATCH_CAPACITY;
+	s_batch_data.count -= n;
+
+	return n;
+}
+
+static unsigned int
+__clamp_flush_count(unsigned int flush_count)
+{
+	if (flush_count < 1)
+		return 1;
+
+	if (flush_count > POSITION_BATCH_CAPACITY)
+		return POSITION_BATCH_CAPACITY;
+
+	return flush_count;
+}
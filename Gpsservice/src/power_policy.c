@@ -0,0 +1,169 @@
+#include <string.h>
+#include "power_policy.h"
+
+#define POWER_REDUCED_INTERVAL 10
+#define POWER_NETWORK_INTERVAL 30
+
+/* Battery level below which a tier is entered, and margin above it to leave it */
+#define POWER_REDUCED_PERCENT 30
+#define POWER_NETWORK_PERCENT 15
+#define POWER_MOTION_PERCENT 5
+#define POWER_HYSTERESIS_PERCENT 3
+
+static const int s_tier_min_intervals[POWER_TIER_COUNT] = { 1, POWER_REDUCED_INTERVAL, POWER_NETWORK_INTERVAL, 0 };
+static const int s_tier_enter_percent[POWER_TIER_COUNT] = { 101, POWER_REDUCED_PERCENT, POWER_NETWORK_PERCENT, POWER_MOTION_PERCENT };
+
+/* Nominal average power of a tier in mW, used for the energy estimate only */
+static const double s_tier_power_mw[POWER_TIER_COUNT] = { 120.0, 45.0, 20.0, 2.0 };
+
+static const char *s_tier_names[POWER_TIER_COUNT] = { "gps", "gps-reduced", "network", "motion" };
+
+static struct
+{
+	power_tier_e tier;
+	power_tier_e battery_tier;
+	power_tier_e floor;
+	int last_battery;
+	bool charging;
+	double last_time;
+
+	power_policy_stats_s stats;
+} s_power_data = {
+	.tier = POWER_TIER_GPS,
+	.battery_tier = POWER_TIER_GPS,
+	.floor = POWER_TIER_GPS,
+	.last_battery = -1,
+	.charging = false,
+	.last_time = 0.0
+};
+
+static power_tier_e __battery_tier(int battery_percent);
+static power_tier_e __select(void);
+static void __account_time(double now);
+
+
+void
+power_policy_init(double now)
+{
+	s_power_data.tier = POWER_TIER_GPS;
+	s_power_data.battery_tier = POWER_TIER_GPS;
+	s_power_data.floor = POWER_TIER_GPS;
+	s_power_data.last_battery = -1;
+	s_power_data.charging = false;
+	s_power_data.last_time = now;
+
+	memset(&s_power_data.stats, 0, sizeof(s_power_data.stats));
+}
+
+power_tier_e
+power_policy_update(int battery_percent, bool charging, double now)
+{
+	__account_time(now);
+
+	if (battery_percent >= 0) {
+		/* Level drop is charged to the tier that was active while it happened */
+		if (!charging && s_power_data.last_battery > battery_percent)
+			s_power_data.stats.battery_used_in_tier[s_power_data.tier] += s_power_data.last_battery - battery_percent;
+
+		s_power_data.last_battery = battery_percent;
+		s_power_data.battery_tier = __battery_tier(battery_percent);
+	}
+
+	if (charging) {
+		s_power_data.floor = POWER_TIER_GPS;
+		s_power_data.battery_tier = POWER_TIER_GPS;
+	}
+	s_power_data.charging = charging;
+
+	return __select();
+}
+
+power_tier_e
+power_policy_set_floor(power_tier_e floor, double now)
+{
+	__account_time(now);
+
+	if (!s_power_data.charging && floor > s_power_data.floor && floor < POWER_TIER_COUNT)
+		s_power_data.floor = floor;
+
+	return __select();
+}
+
+power_tier_e
+power_policy_get_tier(void)
+{
+	return s_power_data.tier;
+}
+
+int
+power_policy_min_interval(power_tier_e tier)
+{
+	if (tier >= POWER_TIER_COUNT)
+		return 0;
+
+	return s_tier_min_intervals[tier];
+}
+
+void
+power_policy_count_fix(void)
+{
+	s_power_data.stats.fixes_in_tier[s_power_data.tier]++;
+}
+
+const char *
+power_policy_tier_str(power_tier_e tier)
+{
+	if (tier >= POWER_TIER_COUNT)
+		return "unknown";
+
+	return s_tier_names[tier];
+}
+
+void
+power_policy_get_stats(power_policy_stats_s *stats, double now)
+{
+	int i;
+
+	__account_time(now);
+	*stats = s_power_data.stats;
+
+	for (i = 0; i < POWER_TIER_COUNT; i++)
+		stats->energy_in_tier[i] = stats->seconds_in_tier[i] * s_tier_power_mw[i] / 1000.0;
+}
+
+static power_tier_e
+__battery_tier(int battery_percent)
+{
+	power_tier_e tier = s_power_data.battery_tier;
+
+	/* Go down as soon as the level is below the threshold, go up only with a margin above it */
+	while (tier + 1 < POWER_TIER_COUNT && battery_percent < s_tier_enter_percent[tier + 1])
+		tier++;
+
+	while (tier > POWER_TIER_GPS && battery_percent >= s_tier_enter_percent[tier] + POWER_HYSTERESIS_PERCENT)
+		tier--;
+
+	return tier;
+}
+
+static power_tier_e
+__select(void)
+{
+	power_tier_e tier = s_power_data.battery_tier > s_power_data.floor ? s_power_data.battery_tier : s_power_data.floor;
+
+	if (tier != s_power_data.tier) {
+		s_power_data.tier = tier;
+		s_power_data.stats.transitions++;
+	}
+
+	return tier;
+}
+
+static void
+__account_time(double now)
+{
+	if (now > s_power_data.last_time)
+		s_power_data.stats.seconds_in_tier[s_power_data.tier] += now - s_power_data.last_time;
+
+	s_power_data.last_time = now;
+}
@@ -0,0 +1,161 @@
+#include "sampling_scheduler.h"
+
+#define SAMPLING_TRAVEL_FRACTION 0.1		/* part of distance to hazard allowed between fixes */
+#define SAMPLING_MIN_SPEED_MS 1.4			/* walking speed, used when standing still */
+#define SAMPLING_NEAR_HAZARD_M 100.0		/* always fastest tier when closer than this */
+#define SAMPLING_SLOWER_MARGIN 1.25			/* target must exceed slower tier by this factor */
+#define SAMPLING_HOLD_DECISIONS 3
+
+#define BATTERY_MEDIUM_PERCENT 50
+#define BATTERY_LOW_PERCENT 20
+#define BATTERY_MEDIUM_FACTOR 2.0
+#define BATTERY_LOW_FACTOR 4.0
+
+static const int s_tier_intervals[SAMPLING_TIER_COUNT] = { 1, 2, 5, 10, 30, 60 };
+
+static struct
+{
+	int tier;
+	int pending_tier;
+	unsigned int pending_count;
+	double last_time;
+
+	sampling_scheduler_stats_s stats;
+} s_scheduler_data = {
+	.tier = 0,
+	.pending_tier = 0,
+	.pending_count = 0,
+	.last_time = 0.0
+};
+
+static double __target_interval(double distance_m, double speed_kmh, int battery_percent);
+static int __tier_for_interval(double interval);
+static void __account_time(double now);
+
+
+void
+sampling_scheduler_init(double now)
+{
+	int i;
+
+	s_scheduler_data.tier = 0;
+	s_scheduler_data.pending_tier = 0;
+	s_scheduler_data.pending_count = 0;
+	s_scheduler_data.last_time = now;
+
+	s_scheduler_data.stats.decisions = 0;
+	s_scheduler_data.stats.faster_changes = 0;
+	s_scheduler_data.stats.slower_changes = 0;
+	s_scheduler_data.stats.held_changes = 0;
+	s_scheduler_data.stats.fixes_requested = 0.0;
+	s_scheduler_data.stats.fixes_at_fastest = 0.0;
+	for (i = 0; i < SAMPLING_TIER_COUNT; i++)
+		s_scheduler_data.stats.seconds_in_tier[i] = 0.0;
+}
+
+int
+sampling_scheduler_update(double distance_m, double speed_kmh, int battery_percent, double now)
+{
+	double target = __target_interval(distance_m, speed_kmh, battery_percent);
+	int faster_tier = __tier_for_interval(target);
+	int slower_tier = __tier_for_interval(target / SAMPLING_SLOWER_MARGIN);
+
+	__account_time(now);
+	s_scheduler_data.stats.decisions++;
+
+	if (faster_tier < s_scheduler_data.tier) {
+		/* Speed up immediately - the user is approaching a hazard */
+		s_scheduler_data.tier = faster_tier;
+		s_scheduler_data.pending_count = 0;
+		s_scheduler_data.stats.faster_changes++;
+	} else if (slower_tier > s_scheduler_data.tier) {
+		/* Slow down one tier at a time once the slower target is stable */
+		if (s_scheduler_data.pending_tier != slower_tier) {
+			s_scheduler_data.pending_tier = slower_tier;
+			s_scheduler_data.pending_count = 0;
+		}
+
+		if (++s_scheduler_data.pending_count >= SAMPLING_HOLD_DECISIONS) {
+			s_scheduler_data.tier++;
+			s_scheduler_data.pending_count = 0;
+			s_scheduler_data.stats.slower_changes++;
+		} else {
+			s_scheduler_data.stats.held_changes++;
+		}
+	} else {
+		s_scheduler_data.pending_count = 0;
+	}
+
+	return s_tier_intervals[s_scheduler_data.tier];
+}
+
+int
+sampling_scheduler_get_interval(void)
+{
+	return s_tier_intervals[s_scheduler_data.tier];
+}
+
+int
+sampling_scheduler_tier_interval(int tier)
+{
+	if (tier < 0 || tier >= SAMPLING_TIER_COUNT)
+		return 0;
+
+	return s_tier_intervals[tier];
+}
+
+void
+sampling_scheduler_get_stats(sampling_scheduler_stats_s *stats, double now)
+{
+	__account_time(now);
+
+	*stats = s_scheduler_data.stats;
+}
+
+static double
+__target_interval(double distance_m, double speed_kmh, int battery_percent)
+{
+	double speed_ms = speed_kmh / 3.6;
+	double interval;
+
+	if (distance_m < 0.0 || distance_m < SAMPLING_NEAR_HAZARD_M)
+		return s_tier_intervals[0];
+
+	if (speed_ms < SAMPLING_MIN_SPEED_MS)
+		speed_ms = SAMPLING_MIN_SPEED_MS;
+
+	interval = SAMPLING_TRAVEL_FRACTION * distance_m / speed_ms;
+
+	if (battery_percent >= 0 && battery_percent < BATTERY_LOW_PERCENT)
+		interval *= BATTERY_LOW_FACTOR;
+	else if (battery_percent >= 0 && battery_percent < BATTERY_MEDIUM_PERCENT)
+		interval *= BATTERY_MEDIUM_FACTOR;
+
+	return interval;
+}
+
+static int
+__tier_for_interval(double interval)
+{
+	int tier = 0;
+
+	/* Slowest tier that still samples at least as often as requested */
+	while (tier + 1 < SAMPLING_TIER_COUNT && s_tier_intervals[tier + 1] <= interval)
+		tier++;
+
+	return tier;
+}
+
+static void
+__account_time(double now)
+{
+	double elapsed = now - s_scheduler_data.last_time;
+
+	if (elapsed <= 0.0)
+		return;
+
+	s_scheduler_data.stats.seconds_in_tier[s_scheduler_data.tier] += elapsed;
+	s_scheduler_data.stats.fixes_requested += elapsed / s_tier_intervals[s_scheduler_data.tier];
+	s_scheduler_data.stats.fixes_at_fastest += elapsed / s_tier_intervals[0];
+	s_scheduler_data.last_time = now;
+}
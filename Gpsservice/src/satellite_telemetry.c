@@ -0,0 +1,189 @@
+#include <string.h>
+#include "satellite_telemetry.h"
+
+static struct
+{
+	/* Tables are kept sorted by PRN, so a delta is a single merge pass */
+	satellite_entry_s current[SATELLITE_FRAME_MAX];
+	satellite_entry_s previous[SATELLITE_FRAME_MAX];
+	unsigned int current_count;
+	unsigned int previous_count;
+
+	int64_t timestamp;
+	int64_t previous_timestamp;
+	uint8_t num_of_active;
+	uint8_t num_of_inview;
+	uint8_t previous_active;
+	uint8_t previous_inview;
+	uint16_t sequence;
+	unsigned int since_key_frame;
+	bool encoded;
+
+	satellite_telemetry_stats_s stats;
+} s_telemetry_data = {
+	.current_count = 0,
+	.previous_count = 0,
+	.sequence = 0,
+	.since_key_frame = 0,
+	.encoded = false
+};
+
+static void __write_header(satellite_frame_s *frame, uint8_t flags, uint8_t count, int64_t timestamp,
+		uint8_t num_of_active, uint8_t num_of_inview);
+static uint8_t __clamp_u8(int value);
+static bool __encode_delta(satellite_entry_s *out, unsigned int *count);
+
+
+void
+satellite_telemetry_init(void)
+{
+	memset(&s_telemetry_data, 0, sizeof(s_telemetry_data));
+}
+
+void
+satellite_telemetry_begin(int num_of_active, int num_of_inview, int64_t timestamp)
+{
+	s_telemetry_data.current_count = 0;
+	s_telemetry_data.timestamp = timestamp;
+	s_telemetry_data.num_of_active = __clamp_u8(num_of_active);
+	s_telemetry_data.num_of_inview = __clamp_u8(num_of_inview);
+}
+
+void
+satellite_telemetry_add(unsigned int prn, unsigned int azimuth, unsigned int elevation, int snr, bool in_use)
+{
+	satellite_entry_s *table = s_telemetry_data.current;
+	unsigned int i;
+
+	if (s_telemetry_data.current_count >= SATELLITE_FRAME_MAX)
+		return;
+
+	/* Insertion sort - receivers report a few dozen satellites at most */
+	for (i = s_telemetry_data.current_count; i > 0 && table[i - 1].prn > prn; i--)
+		table[i] = table[i - 1];
+
+	table[i].prn = (uint16_t)prn;
+	table[i].azimuth = (uint16_t)(azimuth % 360);
+	table[i].elevation = (uint8_t)(elevation > 90 ? 90 : elevation);
+	table[i].snr = __clamp_u8(snr);
+	table[i].flags = in_use ? SATELLITE_ENTRY_FLAG_IN_USE : 0;
+	table[i].reserved = 0;
+
+	s_telemetry_data.current_count++;
+}
+
+size_t
+satellite_telemetry_encode(void *buffer)
+{
+	satellite_frame_s *frame = (satellite_frame_s *)buffer;
+	satellite_entry_s *out = (satellite_entry_s *)(frame + 1);
+	const satellite_entry_s *current = s_telemetry_data.current;
+	unsigned int count = 0;
+	bool key = !s_telemetry_data.encoded || s_telemetry_data.since_key_frame + 1 >= SATELLITE_TELEMETRY_KEY_INTERVAL;
+
+	/* A delta as long as the update itself, e.g. after the receiver switched constellations, is sent as a key frame */
+	if (!key && !__encode_delta(out, &count))
+		key = true;
+
+	if (key) {
+		memcpy(out, current, s_telemetry_data.current_count * sizeof(satellite_entry_s));
+		count = s_telemetry_data.current_count;
+		s_telemetry_data.since_key_frame = 0;
+		s_telemetry_data.stats.key_frames++;
+	} else {
+		s_telemetry_data.since_key_frame++;
+	}
+
+	s_telemetry_data.sequence++;
+	__write_header(frame, key ? SATELLITE_FRAME_FLAG_KEY : 0, (uint8_t)count, s_telemetry_data.timestamp,
+			s_telemetry_data.num_of_active, s_telemetry_data.num_of_inview);
+
+	/* Encoded update is the base of the next delta */
+	memcpy(s_telemetry_data.previous, current, s_telemetry_data.current_count * sizeof(satellite_entry_s));
+	s_telemetry_data.previous_count = s_telemetry_data.current_count;
+	s_telemetry_data.previous_timestamp = s_telemetry_data.timestamp;
+	s_telemetry_data.previous_active = s_telemetry_data.num_of_active;
+	s_telemetry_data.previous_inview = s_telemetry_data.num_of_inview;
+	s_telemetry_data.encoded = true;
+
+	s_telemetry_data.stats.frames++;
+	s_telemetry_data.stats.entries_sent += count;
+	s_telemetry_data.stats.entries_in_view += s_telemetry_data.current_count;
+	s_telemetry_data.stats.bytes += sizeof(satellite_frame_s) + count * sizeof(satellite_entry_s);
+
+	return sizeof(satellite_frame_s) + count * sizeof(satellite_entry_s);
+}
+
+size_t
+satellite_telemetry_encode_key_frame(void *buffer)
+{
+	satellite_frame_s *frame = (satellite_frame_s *)buffer;
+
+	if (!s_telemetry_data.encoded)
+		return 0;
+
+	memcpy(frame + 1, s_telemetry_data.previous, s_telemetry_data.previous_count * sizeof(satellite_entry_s));
+	__write_header(frame, SATELLITE_FRAME_FLAG_KEY, (uint8_t)s_telemetry_data.previous_count,
+			s_telemetry_data.previous_timestamp, s_telemetry_data.previous_active, s_telemetry_data.previous_inview);
+
+	return sizeof(satellite_frame_s) + s_telemetry_data.previous_count * sizeof(satellite_entry_s);
+}
+
+void
+satellite_telemetry_get_stats(satellite_telemetry_stats_s *stats)
+{
+	*stats = s_telemetry_data.stats;
+}
+
+static void
+__write_header(satellite_frame_s *frame, uint8_t flags, uint8_t count, int64_t timestamp,
+		uint8_t num_of_active, uint8_t num_of_inview)
+{
+	frame->magic = SATELLITE_FRAME_MAGIC;
+	frame->version = SATELLITE_FRAME_VERSION;
+	frame->flags = flags;
+	frame->count = count;
+	frame->sequence = s_telemetry_data.sequence;
+	frame->base_sequence = (uint16_t)(s_telemetry_data.sequence - 1);
+	frame->timestamp = timestamp;
+	frame->num_of_active = num_of_active;
+	frame->num_of_inview = num_of_inview;
+	frame->entry_size = (uint16_t)sizeof(satellite_entry_s);
+}
+
+static bool
+__encode_delta(satellite_entry_s *out, unsigned int *count)
+{
+	const satellite_entry_s *current = s_telemetry_data.current;
+	const satellite_entry_s *previous = s_telemetry_data.previous;
+	unsigned int i = 0, j = 0, n = 0;
+
+	/* Merge both sorted tables: new or changed satellites are sent, missing ones are removed */
+	while (i < s_telemetry_data.current_count || j < s_telemetry_data.previous_count) {
+		/* Also keeps out within SATELLITE_FRAME_MAX entries */
+		if (n == s_telemetry_data.current_count)
+			return false;
+
+		if (j == s_telemetry_data.previous_count || (i < s_telemetry_data.current_count && current[i].prn < previous[j].prn)) {
+			out[n++] = current[i++];
+		} else if (i == s_telemetry_data.current_count || previous[j].prn < current[i].prn) {
+			out[n] = previous[j++];
+			out[n++].flags = SATELLITE_ENTRY_FLAG_REMOVED;
+		} else {
+			if (memcmp(&current[i], &previous[j], sizeof(satellite_entry_s)))
+				out[n++] = current[i];
+			i++;
+			j++;
+		}
+	}
+
+	*count = n;
+
+	return true;
+}
+
+static uint8_t
+__clamp_u8(int value)
+{
+	return (uint8_t)(value < 0 ? 0 : value > 255 ? 255 : value);
+}
@@ -0,0 +1,245 @@
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "shm_ring.h"
+
+#define SHM_RING_MAP_SIZE (sizeof(shm_ring_header_s) + SHM_RING_CAPACITY * sizeof(shm_ring_record_s))
+
+struct _shm_ring_s
+{
+	shm_ring_header_s *header;
+	shm_ring_record_s *records;
+	char name[SHM_RING_NAME_SIZE];
+	bool producer;
+
+	/* local copies of the index owned by this side */
+	uint32_t head;
+	uint32_t tail;
+
+	unsigned int written;
+	unsigned int read;
+	unsigned int doorbells;
+	double latency_sum_us;
+	double max_latency_us;
+};
+
+static shm_ring_s *__map(const char *name, int fd, bool producer);
+static int64_t __monotonic_ns(void);
+
+
+shm_ring_s *
+shm_ring_create(const char *name)
+{
+	shm_ring_s *ring;
+	int fd;
+
+	shm_unlink(name);
+
+	fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, S_IRUSR | S_IWUSR);
+	if (fd < 0)
+		return NULL;
+
+	if (ftruncate(fd, SHM_RING_MAP_SIZE) != 0) {
+		close(fd);
+		shm_unlink(name);
+		return NULL;
+	}
+
+	ring = __map(name, fd, true);
+	close(fd);
+
+	if (!ring) {
+		shm_unlink(name);
+		return NULL;
+	}
+
+	/* Magic is written last - an attaching consumer never sees a half-initialized header */
+	ring->header->version = SHM_RING_VERSION;
+	ring->header->record_size = sizeof(shm_ring_record_s);
+	ring->header->capacity = SHM_RING_CAPACITY;
+	__atomic_store_n(&ring->header->magic, SHM_RING_MAGIC, __ATOMIC_RELEASE);
+
+	return ring;
+}
+
+shm_ring_s *
+shm_ring_attach(const char *name)
+{
+	shm_ring_s *ring;
+	struct stat st;
+	int fd = shm_open(name, O_RDWR, 0);
+
+	if (fd < 0)
+		return NULL;
+
+	if (fstat(fd, &st) != 0 || (size_t)st.st_size < SHM_RING_MAP_SIZE) {
+		close(fd);
+		return NULL;
+	}
+
+	ring = __map(name, fd, false);
+	close(fd);
+
+	if (!ring)
+		return NULL;
+
+	if (__atomic_load_n(&ring->header->magic, __ATOMIC_ACQUIRE) != SHM_RING_MAGIC ||
+			ring->header->version != SHM_RING_VERSION ||
+			ring->header->record_size != sizeof(shm_ring_record_s) ||
+			ring->header->capacity != SHM_RING_CAPACITY) {
+		shm_ring_close(ring);
+		return NULL;
+	}
+
+	/* Backlog of a previous consumer is not replayed */
+	ring->tail = __atomic_load_n(&ring->header->head, __ATOMIC_ACQUIRE);
+	__atomic_store_n(&ring->header->tail, ring->tail, __ATOMIC_RELEASE);
+
+	return ring;
+}
+
+void
+shm_ring_close(shm_ring_s *ring)
+{
+	if (!ring)
+		return;
+
+	munmap(ring->header, SHM_RING_MAP_SIZE);
+
+	if (ring->producer)
+		shm_unlink(ring->name);
+
+	free(ring);
+}
+
+const char *
+shm_ring_name(const shm_ring_s *ring)
+{
+	return ring->name;
+}
+
+bool
+shm_ring_write(shm_ring_s *ring, uint16_t type, const void *payload, size_t size, bool *doorbell)
+{
+	uint32_t tail = __atomic_load_n(&ring->header->tail, __ATOMIC_ACQUIRE);
+	shm_ring_record_s *record;
+
+	*doorbell = false;
+
+	if (size > SHM_RING_PAYLOAD_SIZE)
+		return false;
+
+	if (ring->head - tail >= SHM_RING_CAPACITY) {
+		__atomic_add_fetch(&ring->header->dropped, 1, __ATOMIC_RELAXED);
+		return false;
+	}
+
+	record = &ring->records[ring->head & (SHM_RING_CAPACITY - 1)];
+	record->sequence = ring->head;
+	record->type = type;
+	record->size = (uint16_t)size;
+	record->written_ns = __monotonic_ns();
+	memcpy(record->payload, payload, size);
+
+	/* Record contents become visible before the new head */
+	ring->head++;
+	__atomic_store_n(&ring->header->head, ring->head, __ATOMIC_RELEASE);
+	ring->written++;
+
+	/* Exchange pairs with the consumer's arm and re-check, so a wakeup is never lost */
+	if (__atomic_exchange_n(&ring->header->doorbell_armed, 0, __ATOMIC_SEQ_CST)) {
+		ring->doorbells++;
+		*doorbell = true;
+	}
+
+	return true;
+}
+
+const shm_ring_record_s *
+shm_ring_peek(shm_ring_s *ring)
+{
+	if (__atomic_load_n(&ring->header->head, __ATOMIC_ACQUIRE) == ring->tail)
+		return NULL;
+
+	return &ring->records[ring->tail & (SHM_RING_CAPACITY - 1)];
+}
+
+void
+shm_ring_release(shm_ring_s *ring)
+{
+	const shm_ring_record_s *record = &ring->records[ring->tail & (SHM_RING_CAPACITY - 1)];
+	double latency_us = (__monotonic_ns() - record->written_ns) / 1000.0;
+
+	ring->latency_sum_us += latency_us;
+	if (latency_us > ring->max_latency_us)
+		ring->max_latency_us = latency_us;
+
+	/* Record may be overwritten as soon as the producer sees the new tail */
+	ring->tail++;
+	ring->read++;
+	__atomic_store_n(&ring->header->tail, ring->tail, __ATOMIC_RELEASE);
+}
+
+bool
+shm_ring_arm_doorbell(shm_ring_s *ring)
+{
+	__atomic_store_n(&ring->header->doorbell_armed, 1, __ATOMIC_SEQ_CST);
+
+	if (__atomic_load_n(&ring->header->head, __ATOMIC_SEQ_CST) == ring->tail)
+		return true;
+
+	/* Producer wrote before seeing the doorbell armed - it will not ring */
+	__atomic_store_n(&ring->header->doorbell_armed, 0, __ATOMIC_SEQ_CST);
+
+	return false;
+}
+
+void
+shm_ring_get_stats(const shm_ring_s *ring, shm_ring_stats_s *stats)
+{
+	memset(stats, 0, sizeof(*stats));
+
+	stats->written = ring->written;
+	stats->read = ring->read;
+	stats->dropped = __atomic_load_n(&ring->header->dropped, __ATOMIC_RELAXED);
+	stats->doorbells = ring->doorbells;
+	stats->mean_latency_us = ring->read > 0 ? ring->latency_sum_us / ring->read : 0.0;
+	stats->max_latency_us = ring->max_latency_us;
+}
+
+static shm_ring_s *
+__map(const char *name, int fd, bool producer)
+{
+	shm_ring_s *ring = calloc(1, sizeof(shm_ring_s));
+	void *address;
+
+	if (!ring)
+		return NULL;
+
+	address = mmap(NULL, SHM_RING_MAP_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (address == MAP_FAILED) {
+		free(ring);
+		return NULL;
+	}
+
+	ring->header = (shm_ring_header_s *)address;
+	ring->records = (shm_ring_record_s *)((char *)address + sizeof(shm_ring_header_s));
+	strncpy(ring->name, name, SHM_RING_NAME_SIZE - 1);
+	ring->producer = producer;
+
+	return ring;
+}
+
+static int64_t
+__monotonic_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
@@ -0,0 +1,156 @@
+#include <math.h>
+#include <string.h>
+#include "subscriber_registry.h"
+
+#define METERS_PER_DEG_LAT 111195.0
+#define DEG_TO_RAD (M_PI / 180.0)
+
+static struct
+{
+	subscriber_s subscribers[SUBSCRIBER_MAX];
+	int count;
+} s_registry_data = {
+	.count = 0
+};
+
+static int __find(const char *app_id, const char *port);
+static double __displacement_m(const subscriber_s *subscriber, const position_frame_s *frame);
+
+
+void
+subscriber_registry_init(void)
+{
+	s_registry_data.count = 0;
+}
+
+subscriber_s *
+subscriber_registry_add(const char *app_id, const char *port, unsigned int types,
+		double min_interval_s, double min_displacement_m, bool persistent)
+{
+	subscriber_s *subscriber;
+	int index = __find(app_id, port);
+
+	if (index < 0) {
+		if (s_registry_data.count >= SUBSCRIBER_MAX)
+			return NULL;
+
+		index = s_registry_data.count++;
+		subscriber = &s_registry_data.subscribers[index];
+		memset(subscriber, 0, sizeof(*subscriber));
+
+		strncpy(subscriber->app_id, app_id, SUBSCRIBER_APP_ID_SIZE - 1);
+		strncpy(subscriber->port, port, SUBSCRIBER_PORT_SIZE - 1);
+	} else {
+		subscriber = &s_registry_data.subscribers[index];
+	}
+
+	/* A persistent subscriber stays persistent when it subscribes again */
+	subscriber->types = types;
+	subscriber->min_interval_s = min_interval_s;
+	subscriber->min_displacement_m = min_displacement_m;
+	subscriber->persistent = subscriber->persistent || persistent;
+	subscriber->failures = 0;
+
+	return subscriber;
+}
+
+bool
+subscriber_registry_remove(const char *app_id, const char *port, bool force)
+{
+	int index = __find(app_id, port);
+
+	if (index < 0 || (s_registry_data.subscribers[index].persistent && !force))
+		return false;
+
+	s_registry_data.count--;
+	memmove(&s_registry_data.subscribers[index], &s_registry_data.subscribers[index + 1],
+			(s_registry_data.count - index) * sizeof(subscriber_s));
+
+	return true;
+}
+
+subscriber_s *
+subscriber_registry_find(const char *app_id, const char *port)
+{
+	int index = __find(app_id, port);
+
+	if (index < 0)
+		return NULL;
+
+	return &s_registry_data.subscribers[index];
+}
+
+int
+subscriber_registry_count(void)
+{
+	return s_registry_data.count;
+}
+
+subscriber_s *
+subscriber_registry_get(int index)
+{
+	if (index < 0 || index >= s_registry_data.count)
+		return NULL;
+
+	return &s_registry_data.subscribers[index];
+}
+
+bool
+subscriber_registry_wants(subscriber_s *subscriber, unsigned int type, const position_frame_s *frame)
+{
+	if (!(subscriber->types & type))
+		return false;
+
+	if (!frame || !subscriber->has_last)
+		return true;
+
+	if (frame->timestamp - subscriber->last_timestamp < subscriber->min_interval_s ||
+			__displacement_m(subscriber, frame) < subscriber->min_displacement_m) {
+		subscriber->decimated++;
+		return false;
+	}
+
+	return true;
+}
+
+bool
+subscriber_registry_report(subscriber_s *subscriber, bool delivered, const position_frame_s *frame)
+{
+	if (!delivered)
+		return ++subscriber->failures < SUBSCRIBER_MAX_FAILURES || subscriber->persistent;
+
+	subscriber->failures = 0;
+	subscriber->delivered++;
+
+	if (frame) {
+		subscriber->has_last = true;
+		subscriber->last_timestamp = frame->timestamp;
+		subscriber->last_latitude = frame->latitude;
+		subscriber->last_longitude = frame->longitude;
+	}
+
+	return true;
+}
+
+static int
+__find(const char *app_id, const char *port)
+{
+	int i;
+
+	for (i = 0; i < s_registry_data.count; i++) {
+		if (!strcmp(s_registry_data.subscribers[i].app_id, app_id) && !strcmp(s_registry_data.subscribers[i].port, port))
+			return i;
+	}
+
+	return -1;
+}
+
+static double
+__displacement_m(const subscriber_s *subscriber, const position_frame_s *frame)
+{
+	/* Equirectangular approximation is sufficient for displacement thresholds */
+	double dy = (frame->latitude - subscriber->last_latitude) * METERS_PER_DEG_LAT;
+	double dx = (frame->longitude - subscriber->last_longitude) * METERS_PER_DEG_LAT * cos(frame->latitude * DEG_TO_RAD);
+
+	return sqrt(dx * dx + dy * dy);
+}
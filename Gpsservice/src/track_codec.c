@@ -0,0 +1,367 @@
+#include <math.h>
+#include <string.h>
+#include "track_codec.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define TRACK_CODEC_SSE2 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define TRACK_CODEC_NEON 1
+#endif
+
+/* Points decoded per pass of the bulk decoder */
+#define TRACK_CODEC_CHUNK 64
+
+#define TRACK_CODEC_MAX_VARINT_SIZE 10
+
+static size_t __put_varint(uint8_t *out, uint64_t value);
+static size_t __get_varint(const uint8_t *bytes, size_t size, uint64_t *value);
+static size_t __get_varint32(const uint8_t *bytes, size_t size, uint32_t *value);
+static uint64_t __zigzag64(int64_t value);
+static int64_t __unzigzag64(uint64_t value);
+static uint32_t __zigzag32(int32_t value);
+static int32_t __unzigzag32(uint32_t value);
+static uint32_t __to_fixed(double value, double scale);
+static size_t __decode_fields(track_codec_state_s *state, const uint8_t *bytes, size_t size,
+		track_codec_point_s *point, uint32_t *latitude, uint32_t *longitude);
+static void __accumulate(const uint32_t *deltas, unsigned int count, uint32_t *base, double *out);
+
+
+void
+track_codec_state_init(track_codec_state_s *state)
+{
+	memset(state, 0, sizeof(*state));
+}
+
+size_t
+track_codec_encode_point(track_codec_state_s *state, const track_codec_point_s *point, uint8_t *out)
+{
+	int64_t time_delta = point->timestamp - state->timestamp;
+	uint32_t latitude = __to_fixed(point->latitude, 1.0 / TRACK_CODEC_RESOLUTION);
+	uint32_t longitude = __to_fixed(point->longitude, 1.0 / TRACK_CODEC_RESOLUTION);
+	uint32_t altitude = __to_fixed(point->altitude, 10.0);
+	uint32_t accuracy = point->horizontal_accuracy > 0.0f ? __to_fixed(point->horizontal_accuracy, 10.0) : 0;
+	size_t size = 0;
+
+	size += __put_varint(out + size, __zigzag64(time_delta - state->time_delta));
+	size += __put_varint(out + size, __zigzag32((int32_t)(latitude - state->latitude)));
+	size += __put_varint(out + size, __zigzag32((int32_t)(longitude - state->longitude)));
+	size += __put_varint(out + size, __zigzag32((int32_t)(altitude - state->altitude)));
+	size += __put_varint(out + size, accuracy);
+	size += __put_varint(out + size, point->flags);
+
+	state->timestamp = point->timestamp;
+	state->time_delta = time_delta;
+	state->latitude = latitude;
+	state->longitude = longitude;
+	state->altitude = altitude;
+
+	return size;
+}
+
+size_t
+track_codec_decode_point(track_codec_state_s *state, const uint8_t *bytes, size_t size, track_codec_point_s *point)
+{
+	uint32_t latitude, longitude;
+	size_t used = __decode_fields(state, bytes, size, point, &latitude, &longitude);
+
+	if (!used)
+		return 0;
+
+	state->latitude += (uint32_t)__unzigzag32(latitude);
+	state->longitude += (uint32_t)__unzigzag32(longitude);
+	point->latitude = (int32_t)state->latitude * TRACK_CODEC_RESOLUTION;
+	point->longitude = (int32_t)state->longitude * TRACK_CODEC_RESOLUTION;
+
+	return used;
+}
+
+size_t
+track_codec_encode(const track_codec_point_s *points, unsigned int count, void *out, size_t out_size)
+{
+	uint8_t buffer[TRACK_CODEC_MAX_POINT_SIZE];
+	track_codec_header_s *header = (track_codec_header_s *)out;
+	track_codec_state_s state;
+	size_t size = sizeof(track_codec_header_s);
+	unsigned int i;
+
+	if (out_size < sizeof(track_codec_header_s))
+		return 0;
+
+	track_codec_state_init(&state);
+
+	for (i = 0; i < count; i++) {
+		track_codec_state_s next = state;
+		size_t point_size = track_codec_encode_point(&next, &points[i], buffer);
+
+		if (size + point_size > out_size)
+			break;
+
+		memcpy((uint8_t *)out + size, buffer, point_size);
+		size += point_size;
+		state = next;
+	}
+
+	header->magic = TRACK_CODEC_MAGIC;
+	header->version = TRACK_CODEC_VERSION;
+	header->reserved = 0;
+	header->count = i;
+
+	return size;
+}
+
+const track_codec_header_s *
+track_codec_decode_header(const void *bytes, size_t size)
+{
+	const track_codec_header_s *header = (const track_codec_header_s *)bytes;
+
+	if (!bytes || size < sizeof(track_codec_header_s))
+		return NULL;
+
+	if (header->magic != TRACK_CODEC_MAGIC || header->version != TRACK_CODEC_VERSION)
+		return NULL;
+
+	return header;
+}
+
+unsigned int
+track_codec_decode(const void *bytes, size_t size, track_codec_point_s *points, unsigned int max_points)
+{
+	const track_codec_header_s *header = track_codec_decode_header(bytes, size);
+	uint32_t latitudes[TRACK_CODEC_CHUNK];
+	uint32_t longitudes[TRACK_CODEC_CHUNK];
+	double values[TRACK_CODEC_CHUNK];
+	track_codec_state_s state;
+	unsigned int count, decoded = 0;
+	size_t offset = sizeof(track_codec_header_s);
+	bool damaged = false;
+
+	if (!header)
+		return 0;
+
+	count = header->count < max_points ? header->count : max_points;
+	track_codec_state_init(&state);
+
+	/* Varints are parsed one by one, the coordinate deltas of a chunk are then summed up at once */
+	while (decoded < count && !damaged) {
+		track_codec_point_s *chunk = &points[decoded];
+		unsigned int n = count - decoded < TRACK_CODEC_CHUNK ? count - decoded : TRACK_CODEC_CHUNK;
+		unsigned int i;
+
+		for (i = 0; i < n; i++) {
+			size_t used = __decode_fields(&state, (const uint8_t *)bytes + offset, size - offset,
+					&chunk[i], &latitudes[i], &longitudes[i]);
+
+			if (!used) {
+				damaged = true;
+				break;
+			}
+			offset += used;
+		}
+
+		n = i;
+
+		__accumulate(latitudes, n, &state.latitude, values);
+		for (i = 0; i < n; i++)
+			chunk[i].latitude = values[i];
+
+		__accumulate(longitudes, n, &state.longitude, values);
+		for (i = 0; i < n; i++)
+			chunk[i].longitude = values[i];
+
+		decoded += n;
+	}
+
+	return decoded;
+}
+
+static size_t
+__put_varint(uint8_t *out, uint64_t value)
+{
+	size_t size = 0;
+
+	while (value >= 0x80) {
+		out[size++] = (uint8_t)(value | 0x80);
+		value >>= 7;
+	}
+	out[size++] = (uint8_t)value;
+
+	return size;
+}
+
+static size_t
+__get_varint(const uint8_t *bytes, size_t size, uint64_t *value)
+{
+	uint64_t result = 0;
+	size_t i;
+
+	for (i = 0; i < size && i < TRACK_CODEC_MAX_VARINT_SIZE; i++) {
+		result |= (uint64_t)(bytes[i] & 0x7f) << (7 * i);
+
+		if (!(bytes[i] & 0x80)) {
+			*value = result;
+			return i + 1;
+		}
+	}
+
+	return 0;
+}
+
+static size_t
+__get_varint32(const uint8_t *bytes, size_t size, uint32_t *value)
+{
+	uint64_t result;
+	size_t used = __get_varint(bytes, size, &result);
+
+	if (!used || result > UINT32_MAX)
+		return 0;
+
+	*value = (uint32_t)result;
+
+	return used;
+}
+
+static uint64_t
+__zigzag64(int64_t value)
+{
+	return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+}
+
+static int64_t
+__unzigzag64(uint64_t value)
+{
+	return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+}
+
+static uint32_t
+__zigzag32(int32_t value)
+{
+	return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+static int32_t
+__unzigzag32(uint32_t value)
+{
+	return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+}
+
+static uint32_t
+__to_fixed(double value, double scale)
+{
+	return (uint32_t)(int32_t)lround(value * scale);
+}
+
+/*
+ * Decode all fields of a point except latitude and longitude, which are returned as
+ * zig-zag deltas. Returns number of bytes consumed, 0 if the point is incomplete.
+ */
+static size_t
+__decode_fields(track_codec_state_s *state, const uint8_t *bytes, size_t size,
+		track_codec_point_s *point, uint32_t *latitude, uint32_t *longitude)
+{
+	uint64_t time_delta;
+	uint32_t altitude, accuracy, flags;
+	size_t used, offset = 0;
+
+	if (!(used = __get_varint(bytes, size, &time_delta)))
+		return 0;
+	offset += used;
+
+	if (!(used = __get_varint32(bytes + offset, size - offset, latitude)))
+		return 0;
+	offset += used;
+
+	if (!(used = __get_varint32(bytes + offset, size - offset, longitude)))
+		return 0;
+	offset += used;
+
+	if (!(used = __get_varint32(bytes + offset, size - offset, &altitude)))
+		return 0;
+	offset += used;
+
+	if (!(used = __get_varint32(bytes + offset, size - offset, &accuracy)))
+		return 0;
+	offset += used;
+
+	if (!(used = __get_varint32(bytes + offset, size - offset, &flags)))
+		return 0;
+	offset += used;
+
+	state->time_delta += __unzigzag64(time_delta);
+	state->timestamp += state->time_delta;
+	state->altitude += (uint32_t)__unzigzag32(altitude);
+
+	point->timestamp = state->timestamp;
+	point->altitude = (float)((int32_t)state->altitude / 10.0);
+	point->horizontal_accuracy = (float)(accuracy / 10.0);
+	point->flags = flags;
+
+	return offset;
+}
+
+/*
+ * Undo zig-zag encoding of count deltas, add them up starting from base and convert the
+ * running values to degrees. base is left at the last value.
+ */
+static void
+__accumulate(const uint32_t *deltas, unsigned int count, uint32_t *base, double *out)
+{
+	unsigned int i = 0;
+	uint32_t value = *base;
+
+#if defined(TRACK_CODEC_SSE2)
+	const __m128i one = _mm_set1_epi32(1);
+	const __m128d scale = _mm_set1_pd(TRACK_CODEC_RESOLUTION);
+	__m128i carry = _mm_set1_epi32((int32_t)value);
+
+	for (; i + 4 <= count; i += 4) {
+		__m128i v = _mm_loadu_si128((const __m128i *)(deltas + i));
+		__m128i d = _mm_xor_si128(_mm_srli_epi32(v, 1), _mm_sub_epi32(_mm_setzero_si128(), _mm_and_si128(v, one)));
+
+		/* Prefix sum of four lanes in two shifted adds */
+		d = _mm_add_epi32(d, _mm_slli_si128(d, 4));
+		d = _mm_add_epi32(d, _mm_slli_si128(d, 8));
+		d = _mm_add_epi32(d, carry);
+		carry = _mm_shuffle_epi32(d, _MM_SHUFFLE(3, 3, 3, 3));
+
+		_mm_storeu_pd(out + i, _mm_mul_pd(_mm_cvtepi32_pd(d), scale));
+		_mm_storeu_pd(out + i + 2, _mm_mul_pd(_mm_cvtepi32_pd(_mm_unpackhi_epi64(d, d)), scale));
+	}
+
+	value = (uint32_t)_mm_cvtsi128_si32(carry);
+#elif defined(TRACK_CODEC_NEON)
+	const uint32x4_t one = vdupq_n_u32(1);
+	const int32x4_t zero = vdupq_n_s32(0);
+	int32x4_t carry = vdupq_n_s32((int32_t)value);
+	int32_t lanes[4];
+
+	for (; i + 4 <= count; i += 4) {
+		uint32x4_t v = vld1q_u32(deltas + i);
+		int32x4_t d = veorq_s32(vreinterpretq_s32_u32(vshrq_n_u32(v, 1)),
+				vnegq_s32(vreinterpretq_s32_u32(vandq_u32(v, one))));
+
+		/* Prefix sum of four lanes in two shifted adds */
+		d = vaddq_s32(d, vextq_s32(zero, d, 3));
+		d = vaddq_s32(d, vextq_s32(zero, d, 2));
+		d = vaddq_s32(d, carry);
+		carry = vdupq_n_s32(vgetq_lane_s32(d, 3));
+
+		/* 32-bit NEON has no double lanes */
+		vst1q_s32(lanes, d);
+		out[i] = lanes[0] * TRACK_CODEC_RESOLUTION;
+		out[i + 1] = lanes[1] * TRACK_CODEC_RESOLUTION;
+		out[i + 2] = lanes[2] * TRACK_CODEC_RESOLUTION;
+		out[i + 3] = lanes[3] * TRACK_CODEC_RESOLUTION;
+	}
+
+	value = (uint32_t)vgetq_lane_s32(carry, 0);
+#endif
+
+	for (; i < count; i++) {
+		value += (uint32_t)__unzigzag32(deltas[i]);
+		out[i] = (int32_t)value * TRACK_CODEC_RESOLUTION;
+	}
+
+	*base = value;
+}
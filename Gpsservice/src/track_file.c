@@ -0,0 +1,557 @@
+#define _GNU_SOURCE
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "track_file.h"
+
+#define LINE_SIZE 1024
+#define GPX_BUFFER_SIZE 8192
+#define NMEA_MAX_FIELDS 32
+#define SECONDS_PER_DAY 86400.0
+
+#define KNOTS_TO_KMH 1.852
+#define MS_TO_KMH 3.6
+#define HDOP_TO_METERS 5.0			/* typical user equivalent range error */
+
+struct track_file_s
+{
+	FILE *fp;
+	track_file_format_e format;
+	unsigned int errors;
+	char line[LINE_SIZE];
+
+	/* GPX: text from the current <trkpt up to its end */
+	char gpx[GPX_BUFFER_SIZE];
+	size_t gpx_length;
+
+	/* NMEA: GGA waiting for the RMC of the same epoch */
+	track_file_fix_s gga;
+	double gga_time_of_day;
+	bool has_gga;
+	bool seen_rmc;
+	double date;					/* midnight of the last RMC date */
+	double last_time_of_day;
+
+	/* CSV */
+	bool seen_csv_data;
+};
+
+static track_file_format_e __detect_format(FILE *fp);
+static bool __next_gpx(track_file_s *file, track_file_fix_s *fix);
+static bool __parse_gpx_point(const char *point, track_file_fix_s *fix);
+static bool __gpx_attribute(const char *point, const char *name, double *value);
+static bool __gpx_element(const char *point, const char *name, char *value, size_t size);
+static bool __next_nmea(track_file_s *file, track_file_fix_s *fix);
+static int __split_nmea(char *sentence, char **fields);
+static bool __nmea_checksum_valid(const char *sentence);
+static bool __nmea_coordinate(const char *value, const char *hemisphere, double *degrees);
+static double __nmea_time_of_day(const char *value);
+static bool __next_csv(track_file_s *file, track_file_fix_s *fix);
+static bool __parse_iso8601(const char *value, double *timestamp);
+static void __clear_fix(track_file_fix_s *fix);
+
+
+track_file_s *
+track_file_open(const char *path)
+{
+	track_file_s *file;
+	FILE *fp = fopen(path, "r");
+
+	if (!fp)
+		return NULL;
+
+	file = calloc(1, sizeof(track_file_s));
+	if (!file) {
+		fclose(fp);
+		return NULL;
+	}
+
+	file->fp = fp;
+	file->format = __detect_format(fp);
+
+	if (file->format == TRACK_FILE_UNKNOWN) {
+		track_file_close(file);
+		return NULL;
+	}
+
+	return file;
+}
+
+bool
+track_file_next(track_file_s *file, track_file_fix_s *fix)
+{
+	switch (file->format) {
+	case TRACK_FILE_GPX:
+		return __next_gpx(file, fix);
+	case TRACK_FILE_NMEA:
+		return __next_nmea(file, fix);
+	case TRACK_FILE_CSV:
+		return __next_csv(file, fix);
+	default:
+		return false;
+	}
+}
+
+track_file_format_e
+track_file_get_format(const track_file_s *file)
+{
+	return file->format;
+}
+
+unsigned int
+track_file_get_errors(const track_file_s *file)
+{
+	return file->errors;
+}
+
+void
+track_file_close(track_file_s *file)
+{
+	if (!file)
+		return;
+
+	if (file->fp)
+		fclose(file->fp);
+
+	free(file);
+}
+
+static track_file_format_e
+__detect_format(FILE *fp)
+{
+	char line[LINE_SIZE];
+	track_file_format_e format = TRACK_FILE_UNKNOWN;
+
+	while (fgets(line, sizeof(line), fp)) {
+		const char *p = line;
+
+		while (isspace((unsigned char)*p))
+			p++;
+
+		if (*p == '\0')
+			continue;
+
+		if (*p == '<')
+			format = TRACK_FILE_GPX;
+		else if (*p == '$')
+			format = TRACK_FILE_NMEA;
+		else
+			format = TRACK_FILE_CSV;
+		break;
+	}
+
+	rewind(fp);
+
+	return format;
+}
+
+static bool
+__next_gpx(track_file_s *file, track_file_fix_s *fix)
+{
+	for (;;) {
+		char *start = strstr(file->gpx, "<trkpt");
+		char *end = NULL;
+
+		if (start) {
+			char *tag_end = strchr(start, '>');
+
+			if (tag_end && tag_end[-1] == '/')
+				end = tag_end + 1;
+			else if (tag_end && (end = strstr(tag_end, "</trkpt>")) != NULL)
+				end += strlen("</trkpt>");
+		}
+
+		if (end) {
+			char saved = *end;
+			bool ok;
+
+			*end = '\0';
+			ok = __parse_gpx_point(start, fix);
+			*end = saved;
+
+			/* Keep the text after this point for the next call */
+			file->gpx_length -= (size_t)(end - file->gpx);
+			memmove(file->gpx, end, file->gpx_length + 1);
+
+			if (ok)
+				return true;
+
+			file->errors++;
+			continue;
+		}
+
+		if (!fgets(file->line, LINE_SIZE, file->fp))
+			return false;
+
+		/* Drop text before the point start, and a point that does not fit the buffer */
+		if (!start && file->gpx_length > strlen("<trkpt")) {
+			size_t keep = strlen("<trkpt");
+
+			memmove(file->gpx, file->gpx + file->gpx_length - keep, keep + 1);
+			file->gpx_length = keep;
+		} else if (start && start != file->gpx) {
+			file->gpx_length -= (size_t)(start - file->gpx);
+			memmove(file->gpx, start, file->gpx_length + 1);
+		}
+
+		if (file->gpx_length + strlen(file->line) >= GPX_BUFFER_SIZE) {
+			file->errors++;
+			file->gpx_length = 0;
+		}
+
+		memcpy(file->gpx + file->gpx_length, file->line, strlen(file->line) + 1);
+		file->gpx_length += strlen(file->line);
+	}
+}
+
+static bool
+__parse_gpx_point(const char *point, track_file_fix_s *fix)
+{
+	char value[64];
+	const char *tag_end = strchr(point, '>');
+	char attributes[256];
+	size_t length;
+
+	__clear_fix(fix);
+
+	/* Attributes are only searched in the start tag */
+	length = tag_end ? (size_t)(tag_end - point) : strlen(point);
+	if (length >= sizeof(attributes))
+		length = sizeof(attributes) - 1;
+
+	memcpy(attributes, point, length);
+	attributes[length] = '\0';
+
+	if (!__gpx_attribute(attributes, "lat", &fix->latitude) || !__gpx_attribute(attributes, "lon", &fix->longitude))
+		return false;
+
+	if (!__gpx_element(point, "time", value, sizeof(value)) || !__parse_iso8601(value, &fix->timestamp))
+		return false;
+
+	if (__gpx_element(point, "ele", value, sizeof(value)))
+		fix->altitude = strtod(value, NULL);
+
+	if (__gpx_element(point, "speed", value, sizeof(value)))
+		fix->speed = strtod(value, NULL) * MS_TO_KMH;
+
+	if (__gpx_element(point, "course", value, sizeof(value)))
+		fix->heading = strtod(value, NULL);
+
+	if (__gpx_element(point, "hdop", value, sizeof(value)))
+		fix->horizontal_accuracy = strtod(value, NULL) * HDOP_TO_METERS;
+
+	if (__gpx_element(point, "vdop", value, sizeof(value)))
+		fix->vertical_accuracy = strtod(value, NULL) * HDOP_TO_METERS;
+
+	if (__gpx_element(point, "sat", value, sizeof(value)))
+		fix->satellites = atoi(value);
+
+	return true;
+}
+
+static bool
+__gpx_attribute(const char *point, const char *name, double *value)
+{
+	const char *p = point;
+	size_t length = strlen(name);
+
+	while ((p = strstr(p, name)) != NULL) {
+		const char *q = p + length;
+
+		/* Must be a whole attribute name followed by ="value" or ='value' */
+		if (isspace((unsigned char)p[-1]) && q[0] == '=' && (q[1] == '"' || q[1] == '\'')) {
+			char *end;
+
+			*value = strtod(q + 2, &end);
+			return end != q + 2;
+		}
+
+		p = q;
+	}
+
+	return false;
+}
+
+static bool
+__gpx_element(const char *point, const char *name, char *value, size_t size)
+{
+	char open_tag[32];
+	const char *start;
+	const char *end;
+	size_t length;
+
+	snprintf(open_tag, sizeof(open_tag), "<%s>", name);
+
+	start = strstr(point, open_tag);
+	if (!start)
+		return false;
+
+	start += strlen(open_tag);
+	end = strchr(start, '<');
+	if (!end)
+		return false;
+
+	length = (size_t)(end - start);
+	if (length >= size)
+		length = size - 1;
+
+	memcpy(value, start, length);
+	value[length] = '\0';
+
+	return true;
+}
+
+static bool
+__next_nmea(track_file_s *file, track_file_fix_s *fix)
+{
+	char *fields[NMEA_MAX_FIELDS];
+
+	while (fgets(file->line, LINE_SIZE, file->fp)) {
+		double time_of_day;
+		int count;
+
+		if (file->line[0] != '$')
+			continue;
+
+		if (!__nmea_checksum_valid(file->line)) {
+			file->errors++;
+			continue;
+		}
+
+		count = __split_nmea(file->line, fields);
+		if (count < 1 || strlen(fields[0]) != 5)
+			continue;
+
+		/* Sentence id without the talker, e.g. $GPRMC and $GNRMC are both RMC */
+		if (!strcmp(fields[0] + 2, "RMC") && count >= 10) {
+			int day, month, year;
+
+			file->seen_rmc = true;
+
+			if (fields[2][0] != 'A')
+				continue;
+
+			if (sscanf(fields[9], "%2d%2d%2d", &day, &month, &year) != 3) {
+				file->errors++;
+				continue;
+			}
+
+			struct tm date = { .tm_mday = day, .tm_mon = month - 1, .tm_year = year < 80 ? year + 100 : year };
+			file->date = (double)timegm(&date);
+			time_of_day = __nmea_time_of_day(fields[1]);
+
+			/* Start from the GGA of the same epoch, if any, for altitude and satellites */
+			if (file->has_gga && file->gga_time_of_day == time_of_day)
+				*fix = file->gga;
+			else
+				__clear_fix(fix);
+			file->has_gga = false;
+
+			if (!__nmea_coordinate(fields[3], fields[4], &fix->latitude) ||
+					!__nmea_coordinate(fields[5], fields[6], &fix->longitude)) {
+				file->errors++;
+				continue;
+			}
+
+			fix->timestamp = file->date + time_of_day;
+			fix->speed = strtod(fields[7], NULL) * KNOTS_TO_KMH;
+			fix->heading = strtod(fields[8], NULL);
+
+			return true;
+		} else if (!strcmp(fields[0] + 2, "GGA") && count >= 10) {
+			track_file_fix_s previous = file->gga;
+			bool emit_previous = file->has_gga && !file->seen_rmc;
+
+			if (atoi(fields[6]) == 0)
+				continue;
+
+			time_of_day = __nmea_time_of_day(fields[1]);
+
+			/* Without RMC there is no date - count days from the time of day wrapping */
+			if (!file->seen_rmc && time_of_day < file->last_time_of_day)
+				file->date += SECONDS_PER_DAY;
+			file->last_time_of_day = time_of_day;
+
+			__clear_fix(&file->gga);
+			if (!__nmea_coordinate(fields[2], fields[3], &file->gga.latitude) ||
+					!__nmea_coordinate(fields[4], fields[5], &file->gga.longitude)) {
+				file->errors++;
+				file->has_gga = false;
+				continue;
+			}
+
+			file->gga.timestamp = file->date + time_of_day;
+			file->gga.satellites = atoi(fields[7]);
+			file->gga.horizontal_accuracy = strtod(fields[8], NULL) * HDOP_TO_METERS;
+			file->gga.altitude = strtod(fields[9], NULL);
+			file->gga_time_of_day = time_of_day;
+			file->has_gga = true;
+
+			/* A stream without RMC sentences is replayed from GGA alone */
+			if (emit_previous) {
+				*fix = previous;
+				return true;
+			}
+		}
+	}
+
+	if (file->has_gga && !file->seen_rmc) {
+		*fix = file->gga;
+		file->has_gga = false;
+		return true;
+	}
+
+	return false;
+}
+
+static int
+__split_nmea(char *sentence, char **fields)
+{
+	char *p = sentence + 1;
+	int count = 0;
+
+	/* Empty fields are kept, so field indexes match the sentence definition */
+	fields[count++] = p;
+	for (; *p && *p != '*' && *p != '\r' && *p != '\n'; p++) {
+		if (*p == ',') {
+			*p = '\0';
+			if (count < NMEA_MAX_FIELDS)
+				fields[count++] = p + 1;
+		}
+	}
+	*p = '\0';
+
+	return count;
+}
+
+static bool
+__nmea_checksum_valid(const char *sentence)
+{
+	const char *p = sentence + 1;
+	unsigned int checksum = 0;
+	unsigned int expected;
+
+	for (; *p && *p != '*'; p++)
+		checksum ^= (unsigned char)*p;
+
+	/* Checksum is optional */
+	if (*p != '*')
+		return true;
+
+	if (sscanf(p + 1, "%2x", &expected) != 1)
+		return false;
+
+	return checksum == expected;
+}
+
+static bool
+__nmea_coordinate(const char *value, const char *hemisphere, double *degrees)
+{
+	char *end;
+	double raw = strtod(value, &end);
+	double whole;
+
+	if (end == value)
+		return false;
+
+	/* ddmm.mmmm or dddmm.mmmm */
+	whole = (double)(int)(raw / 100.0);
+	*degrees = whole + (raw - whole * 100.0) / 60.0;
+
+	if (hemisphere[0] == 'S' || hemisphere[0] == 'W')
+		*degrees = -*degrees;
+
+	return true;
+}
+
+static double
+__nmea_time_of_day(const char *value)
+{
+	int hours = 0, minutes = 0;
+	double seconds = 0.0;
+
+	sscanf(value, "%2d%2d%lf", &hours, &minutes, &seconds);
+
+	return hours * 3600.0 + minutes * 60.0 + seconds;
+}
+
+static bool
+__next_csv(track_file_s *file, track_file_fix_s *fix)
+{
+	while (fgets(file->line, LINE_SIZE, file->fp)) {
+		char *fields[7] = { NULL, };
+		char *save = NULL;
+		char *token;
+		char *end;
+		int count = 0;
+
+		if (file->line[0] == '#' || file->line[0] == '\n' || file->line[0] == '\r')
+			continue;
+
+		for (token = strtok_r(file->line, ",\r\n", &save); token && count < 7; token = strtok_r(NULL, ",\r\n", &save))
+			fields[count++] = token;
+
+		__clear_fix(fix);
+
+		if (count < 3 || (!__parse_iso8601(fields[0], &fix->timestamp) &&
+				((fix->timestamp = strtod(fields[0], &end)), end == fields[0]))) {
+			/* The first line that is not data is a header */
+			if (file->seen_csv_data)
+				file->errors++;
+			file->seen_csv_data = true;
+			continue;
+		}
+
+		file->seen_csv_data = true;
+		fix->latitude = strtod(fields[1], NULL);
+		fix->longitude = strtod(fields[2], NULL);
+		if (count > 3)
+			fix->altitude = strtod(fields[3], NULL);
+		if (count > 4)
+			fix->speed = strtod(fields[4], NULL);
+		if (count > 5)
+			fix->heading = strtod(fields[5], NULL);
+		if (count > 6)
+			fix->horizontal_accuracy = strtod(fields[6], NULL);
+
+		return true;
+	}
+
+	return false;
+}
+
+static bool
+__parse_iso8601(const char *value, double *timestamp)
+{
+	struct tm tm = { 0, };
+	double seconds = 0.0;
+	int consumed = 0;
+	int offset_hours = 0, offset_minutes = 0;
+	char sign;
+	const char *p;
+
+	if (sscanf(value, "%4d-%2d-%2dT%2d:%2d:%lf%n", &tm.tm_year, &tm.tm_mon, &tm.tm_mday,
+			&tm.tm_hour, &tm.tm_min, &seconds, &consumed) != 6)
+		return false;
+
+	tm.tm_year -= 1900;
+	tm.tm_mon -= 1;
+	*timestamp = (double)timegm(&tm) + seconds;
+
+	/* Z or no suffix is UTC, otherwise apply +hh:mm / -hh:mm offset */
+	p = value + consumed;
+	if (sscanf(p, "%c%2d:%2d", &sign, &offset_hours, &offset_minutes) == 3 && (sign == '+' || sign == '-')) {
+		double offset = offset_hours * 3600.0 + offset_minutes * 60.0;
+		*timestamp += sign == '+' ? -offset : offset;
+	}
+
+	return true;
+}
+
+static void
+__clear_fix(track_file_fix_s *fix)
+{
+	memset(fix, 0, sizeof(*fix));
+}
@@ -0,0 +1,750 @@
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <zlib.h>
+#include "track_journal.h"
+
+#define JOURNAL_VERSION 1
+#define SEGMENT_MAGIC 0x534b5254	/* "TRKS" */
+#define BLOCK_MAGIC 0x424b5254		/* "TRKB" */
+#define ARCHIVE_MAGIC 0x414b5254	/* "TRKA" */
+
+#define SEGMENT_NAME_FORMAT "seg-%08u.trk"
+#define ARCHIVE_NAME_FORMAT "arc-%08u.trz"
+#define ARCHIVE_TMP_NAME_FORMAT "arc-%08u.trz.tmp"
+#define ARCHIVE_COMPRESSION "wb6"
+#define PATH_SIZE 512
+#define DIR_SIZE (PATH_SIZE - 32)
+
+typedef struct
+{
+	uint32_t magic;
+	uint16_t version;
+	uint16_t record_size;
+	uint32_t block_records;
+	uint32_t block_count;
+	uint32_t sequence;
+	uint32_t reserved;
+	int64_t first_timestamp;
+	int64_t last_timestamp;			/* may be ahead of the last committed record after a crash */
+	uint8_t padding[24];
+} segment_header_s;
+
+typedef struct
+{
+	uint32_t magic;
+	uint32_t reserved;
+	uint64_t state;					/* record count << 32 | CRC-32 of the records */
+} block_header_s;
+
+typedef struct
+{
+	block_header_s header;
+	track_record_s records[TRACK_BLOCK_RECORDS];
+} block_s;
+
+typedef struct
+{
+	uint32_t magic;
+	uint16_t version;
+	uint16_t record_size;
+	uint32_t sequence;
+	uint32_t count;
+	int64_t first_timestamp;
+	int64_t last_timestamp;
+} archive_header_s;
+
+typedef struct
+{
+	unsigned int sequence;
+	bool archive;
+} journal_file_s;
+
+typedef struct
+{
+	int64_t from;
+	int64_t to;
+	track_journal_record_cb cb;
+	void *user_data;
+	int count;
+	bool stop;
+} scan_context_s;
+
+#define SEGMENT_SIZE (sizeof(segment_header_s) + TRACK_SEGMENT_BLOCKS * sizeof(block_s))
+
+typedef char __segment_header_size_check[(sizeof(segment_header_s) == 64) ? 1 : -1];
+typedef char __block_size_check[(sizeof(block_s) % 8 == 0) ? 1 : -1];
+
+static struct
+{
+	char dir[DIR_SIZE];
+	segment_header_s *segment;
+
+	int fd;
+	unsigned int sequence;
+	unsigned int block;
+	int64_t last_timestamp;
+	bool has_last;
+	unsigned int dropped;
+} s_journal_data = {
+	.segment = NULL,
+
+	.fd = -1,
+	.sequence = 0,
+	.block = 0,
+	.last_timestamp = 0,
+	.has_last = false,
+	.dropped = 0
+};
+
+static bool __create_segment(unsigned int sequence);
+static bool __recover_segment(unsigned int sequence);
+static void __close_segment(void);
+static block_s *__segment_block(segment_header_s *segment, unsigned int index);
+static void __init_block(block_s *block);
+static bool __block_valid(const block_s *block, unsigned int *count);
+static bool __segment_header_valid(const segment_header_s *header);
+static segment_header_s *__map_segment(const char *path, int flags, int *fd_out);
+static int __list_files(const char *dir, journal_file_s **files);
+static void __remove_temporary_files(const char *dir);
+static int __compare_files(const void *a, const void *b);
+static bool __compact_segment(const char *dir, unsigned int sequence);
+static void __scan_segment(const char *path, scan_context_s *ctx);
+static void __scan_archive(const char *path, scan_context_s *ctx);
+static void __scan_records(const track_record_s *records, unsigned int count, scan_context_s *ctx);
+
+
+bool
+track_journal_open(const char *dir)
+{
+	journal_file_s *files = NULL;
+	unsigned int last_sequence = 0;
+	bool last_is_segment = false;
+	int count;
+
+	track_journal_close();
+
+	if (mkdir(dir, 0700) != 0 && errno != EEXIST)
+		return false;
+
+	if (strlen(dir) >= DIR_SIZE)
+		return false;
+
+	snprintf(s_journal_data.dir, DIR_SIZE, "%s", dir);
+
+	/* Archives left unfinished by a crash during compaction, their segments are still there */
+	__remove_temporary_files(dir);
+
+	count = __list_files(dir, &files);
+	if (count < 0)
+		return false;
+
+	if (count > 0) {
+		last_sequence = files[count - 1].sequence;
+		last_is_segment = !files[count - 1].archive;
+	}
+	free(files);
+
+	s_journal_data.has_last = false;
+	s_journal_data.dropped = 0;
+
+	/* Continue the newest segment if it is still open, otherwise start a new one */
+	if (last_is_segment && __recover_segment(last_sequence))
+		return true;
+
+	return __create_segment(last_sequence + 1);
+}
+
+void
+track_journal_close(void)
+{
+	__close_segment();
+	s_journal_data.sequence = 0;
+}
+
+bool
+track_journal_append(const position_frame_s *frame)
+{
+	segment_header_s *segment = s_journal_data.segment;
+	block_s *block;
+	track_record_s *record;
+	uint64_t state;
+	unsigned int count;
+	uint32_t crc;
+
+	if (!segment)
+		return false;
+
+	if (s_journal_data.has_last && frame->timestamp < s_journal_data.last_timestamp) {
+		s_journal_data.dropped++;
+		return false;
+	}
+
+	if (s_journal_data.block >= TRACK_SEGMENT_BLOCKS) {
+		if (!__create_segment(s_journal_data.sequence + 1))
+			return false;
+
+		segment = s_journal_data.segment;
+	}
+
+	block = __segment_block(segment, s_journal_data.block);
+	state = block->header.state;
+	count = (unsigned int)(state >> 32);
+	crc = (uint32_t)state;
+
+	record = &block->records[count];
+	record->timestamp = frame->timestamp;
+	record->latitude = frame->latitude;
+	record->longitude = frame->longitude;
+	record->altitude = (float)frame->altitude;
+	record->horizontal_accuracy = frame->horizontal_accuracy;
+	record->speed = frame->speed;
+	record->heading = frame->heading;
+	record->flags = frame->flags;
+	record->reserved = 0;
+
+	crc = crc32(crc, (const Bytef *)record, sizeof(track_record_s));
+
+	if (s_journal_data.block == 0 && count == 0)
+		segment->first_timestamp = frame->timestamp;
+	segment->last_timestamp = frame->timestamp;
+
+	/* Publish the record - count and CRC change together in one aligned store */
+	__atomic_store_n(&block->header.state, ((uint64_t)(count + 1) << 32) | crc, __ATOMIC_RELEASE);
+
+	s_journal_data.last_timestamp = frame->timestamp;
+	s_journal_data.has_last = true;
+
+	if (count + 1 == TRACK_BLOCK_RECORDS) {
+		/* Block is complete - schedule write back and start the next one */
+		uintptr_t page = (uintptr_t)sysconf(_SC_PAGESIZE);
+		uintptr_t start = (uintptr_t)block & ~(page - 1);
+
+		msync((void *)start, (uintptr_t)(block + 1) - start, MS_ASYNC);
+
+		if (++s_journal_data.block < TRACK_SEGMENT_BLOCKS)
+			__init_block(__segment_block(segment, s_journal_data.block));
+	}
+
+	return true;
+}
+
+unsigned int
+track_journal_current_segment(void)
+{
+	return s_journal_data.segment ? s_journal_data.sequence : 0;
+}
+
+unsigned int
+track_journal_dropped_count(void)
+{
+	return s_journal_data.dropped;
+}
+
+int
+track_journal_compact(const char *dir, unsigned int before_segment, unsigned int keep_segments)
+{
+	journal_file_s *files = NULL;
+	int compacted = 0;
+	int count;
+	int i;
+
+	count = __list_files(dir, &files);
+	if (count < 0)
+		return -1;
+
+	for (i = 0; i < count; i++) {
+		if (files[i].archive || files[i].sequence + keep_segments >= before_segment)
+			continue;
+
+		if (__compact_segment(dir, files[i].sequence))
+			compacted++;
+	}
+
+	free(files);
+
+	return compacted;
+}
+
+int
+track_journal_scan(const char *dir, int64_t from, int64_t to, track_journal_record_cb cb, void *user_data)
+{
+	scan_context_s ctx = { .from = from, .to = to, .cb = cb, .user_data = user_data, .count = 0, .stop = false };
+	journal_file_s *files = NULL;
+	char path[PATH_SIZE];
+	int count;
+	int i;
+
+	count = __list_files(dir, &files);
+	if (count < 0)
+		return -1;
+
+	for (i = 0; i < count && !ctx.stop; i++) {
+		/* Archive and segment with the same sequence exist if compaction was interrupted
+		 * before the segment was removed - the archive is complete, skip the segment */
+		if (i > 0 && files[i].sequence == files[i - 1].sequence)
+			continue;
+
+		if (files[i].archive) {
+			snprintf(path, PATH_SIZE, "%s/" ARCHIVE_NAME_FORMAT, dir, files[i].sequence);
+			__scan_archive(path, &ctx);
+		} else {
+			snprintf(path, PATH_SIZE, "%s/" SEGMENT_NAME_FORMAT, dir, files[i].sequence);
+			__scan_segment(path, &ctx);
+		}
+	}
+
+	free(files);
+
+	return ctx.count;
+}
+
+static bool
+__create_segment(unsigned int sequence)
+{
+	char path[PATH_SIZE];
+	segment_header_s *segment;
+	int fd;
+
+	__close_segment();
+
+	snprintf(path, PATH_SIZE, "%s/" SEGMENT_NAME_FORMAT, s_journal_data.dir, sequence);
+
+	fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0600);
+	if (fd < 0)
+		return false;
+
+	/* Reserve disk space now, a full disk must not turn into SIGBUS on a mapped write */
+	if (posix_fallocate(fd, 0, SEGMENT_SIZE) != 0) {
+		close(fd);
+		unlink(path);
+		return false;
+	}
+
+	segment = mmap(NULL, SEGMENT_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (segment == MAP_FAILED) {
+		close(fd);
+		unlink(path);
+		return false;
+	}
+
+	memset(segment, 0, sizeof(segment_header_s));
+	segment->magic = SEGMENT_MAGIC;
+	segment->version = JOURNAL_VERSION;
+	segment->record_size = sizeof(track_record_s);
+	segment->block_records = TRACK_BLOCK_RECORDS;
+	segment->block_count = TRACK_SEGMENT_BLOCKS;
+	segment->sequence = sequence;
+
+	__init_block(__segment_block(segment, 0));
+
+	s_journal_data.segment = segment;
+	s_journal_data.fd = fd;
+	s_journal_data.sequence = sequence;
+	s_journal_data.block = 0;
+
+	return true;
+}
+
+static bool
+__recover_segment(unsigned int sequence)
+{
+	char path[PATH_SIZE];
+	segment_header_s *segment;
+	unsigned int index;
+	unsigned int count;
+	int fd;
+
+	snprintf(path, PATH_SIZE, "%s/" SEGMENT_NAME_FORMAT, s_journal_data.dir, sequence);
+
+	segment = __map_segment(path, O_RDWR, &fd);
+	if (!segment)
+		return false;
+
+	s_journal_data.segment = segment;
+	s_journal_data.fd = fd;
+	s_journal_data.sequence = sequence;
+
+	/* Find the first block that is not full. A damaged partial block is left as it is,
+	 * readers skip it by its CRC and writing continues in the next block. */
+	for (index = 0; index < TRACK_SEGMENT_BLOCKS; index++) {
+		block_s *block = __segment_block(segment, index);
+
+		if (block->header.magic != BLOCK_MAGIC) {
+			__init_block(block);
+			break;
+		}
+
+		count = (unsigned int)(block->header.state >> 32);
+		if (count == 0 || (count < TRACK_BLOCK_RECORDS && __block_valid(block, &count)))
+			break;
+	}
+
+	s_journal_data.block = index;
+
+	if (segment->last_timestamp != 0 || segment->first_timestamp != 0) {
+		s_journal_data.last_timestamp = segment->last_timestamp;
+		s_journal_data.has_last = true;
+	}
+
+	return true;
+}
+
+static void
+__close_segment(void)
+{
+	if (s_journal_data.segment) {
+		msync(s_journal_data.segment, SEGMENT_SIZE, MS_SYNC);
+		munmap(s_journal_data.segment, SEGMENT_SIZE);
+		s_journal_data.segment = NULL;
+	}
+
+	if (s_journal_data.fd >= 0) {
+		close(s_journal_data.fd);
+		s_journal_data.fd = -1;
+	}
+}
+
+static block_s *
+__segment_block(segment_header_s *segment, unsigned int index)
+{
+	return (block_s *)((char *)segment + sizeof(segment_header_s)) + index;
+}
+
+static void
+__init_block(block_s *block)
+{
+	block->header.state = 0;
+	block->header.reserved = 0;
+	block->header.magic = BLOCK_MAGIC;
+}
+
+static bool
+__block_valid(const block_s *block, unsigned int *count)
+{
+	uint64_t state = __atomic_load_n(&block->header.state, __ATOMIC_ACQUIRE);
+	unsigned int n = (unsigned int)(state >> 32);
+
+	if (block->header.magic != BLOCK_MAGIC || n == 0 || n > TRACK_BLOCK_RECORDS)
+		return false;
+
+	if (crc32(0L, (const Bytef *)block->records, n * sizeof(track_record_s)) != (uint32_t)state)
+		return false;
+
+	*count = n;
+
+	return true;
+}
+
+static bool
+__segment_header_valid(const segment_header_s *header)
+{
+	return header->magic == SEGMENT_MAGIC && header->version == JOURNAL_VERSION &&
+			header->record_size == sizeof(track_record_s) &&
+			header->block_records == TRACK_BLOCK_RECORDS && header->block_count == TRACK_SEGMENT_BLOCKS;
+}
+
+static segment_header_s *
+__map_segment(const char *path, int flags, int *fd_out)
+{
+	segment_header_s *segment;
+	struct stat st;
+	int prot = (flags & O_RDWR) ? PROT_READ | PROT_WRITE : PROT_READ;
+	int fd = open(path, flags);
+
+	if (fd < 0)
+		return NULL;
+
+	if (fstat(fd, &st) != 0 || st.st_size != (off_t)SEGMENT_SIZE) {
+		close(fd);
+		return NULL;
+	}
+
+	segment = mmap(NULL, SEGMENT_SIZE, prot, MAP_SHARED, fd, 0);
+	if (segment == MAP_FAILED) {
+		close(fd);
+		return NULL;
+	}
+
+	if (!__segment_header_valid(segment)) {
+		munmap(segment, SEGMENT_SIZE);
+		close(fd);
+		return NULL;
+	}
+
+	*fd_out = fd;
+
+	return segment;
+}
+
+static int
+__list_files(const char *dir, journal_file_s **files)
+{
+	DIR *d = opendir(dir);
+	struct dirent *entry;
+	journal_file_s *list = NULL;
+	int capacity = 0;
+	int count = 0;
+
+	if (!d)
+		return -1;
+
+	while ((entry = readdir(d)) != NULL) {
+		journal_file_s file;
+		char suffix[8];
+
+		if (sscanf(entry->d_name, "seg-%8u.%7s", &file.sequence, suffix) == 2 && !strcmp(suffix, "trk"))
+			file.archive = false;
+		else if (sscanf(entry->d_name, "arc-%8u.%7s", &file.sequence, suffix) == 2 && !strcmp(suffix, "trz"))
+			file.archive = true;
+		else
+			continue;
+
+		if (count == capacity) {
+			journal_file_s *grown = realloc(list, (capacity ? capacity * 2 : 16) * sizeof(journal_file_s));
+			if (!grown) {
+				free(list);
+				closedir(d);
+				return -1;
+			}
+
+			list = grown;
+			capacity = capacity ? capacity * 2 : 16;
+		}
+
+		list[count++] = file;
+	}
+
+	closedir(d);
+
+	if (count > 1)
+		qsort(list, count, sizeof(journal_file_s), __compare_files);
+
+	*files = list;
+
+	return count;
+}
+
+static void
+__remove_temporary_files(const char *dir)
+{
+	DIR *d = opendir(dir);
+	struct dirent *entry;
+	char path[PATH_SIZE];
+	unsigned int sequence;
+	char suffix[8];
+
+	if (!d)
+		return;
+
+	while ((entry = readdir(d)) != NULL) {
+		if (sscanf(entry->d_name, "arc-%8u.%7s", &sequence, suffix) != 2 || strcmp(suffix, "trz.tmp"))
+			continue;
+
+		snprintf(path, PATH_SIZE, "%s/" ARCHIVE_TMP_NAME_FORMAT, dir, sequence);
+		unlink(path);
+	}
+
+	closedir(d);
+}
+
+static int
+__compare_files(const void *a, const void *b)
+{
+	const journal_file_s *fa = a;
+	const journal_file_s *fb = b;
+
+	if (fa->sequence != fb->sequence)
+		return fa->sequence < fb->sequence ? -1 : 1;
+
+	/* Archive first, see track_journal_scan() */
+	return (int)fb->archive - (int)fa->archive;
+}
+
+static bool
+__compact_segment(const char *dir, unsigned int sequence)
+{
+	char path[PATH_SIZE], tmp_path[PATH_SIZE], archive_path[PATH_SIZE];
+	archive_header_s header = { .magic = ARCHIVE_MAGIC, .version = JOURNAL_VERSION,
+			.record_size = sizeof(track_record_s), .sequence = sequence, .count = 0 };
+	segment_header_s *segment;
+	unsigned int index, count;
+	bool ok = true;
+	gzFile gz;
+	int fd;
+
+	snprintf(path, PATH_SIZE, "%s/" SEGMENT_NAME_FORMAT, dir, sequence);
+	snprintf(tmp_path, PATH_SIZE, "%s/" ARCHIVE_TMP_NAME_FORMAT, dir, sequence);
+	snprintf(archive_path, PATH_SIZE, "%s/" ARCHIVE_NAME_FORMAT, dir, sequence);
+
+	segment = __map_segment(path, O_RDONLY, &fd);
+	if (!segment)
+		return false;
+
+	/* Count valid records first, the archive header carries count and time range */
+	for (index = 0; index < TRACK_SEGMENT_BLOCKS; index++) {
+		block_s *block = __segment_block(segment, index);
+
+		if (!__block_valid(block, &count))
+			continue;
+
+		if (header.count == 0)
+			header.first_timestamp = block->records[0].timestamp;
+		header.last_timestamp = block->records[count - 1].timestamp;
+		header.count += count;
+	}
+
+	gz = gzopen(tmp_path, ARCHIVE_COMPRESSION);
+	if (!gz) {
+		munmap(segment, SEGMENT_SIZE);
+		close(fd);
+		return false;
+	}
+
+	ok = gzwrite(gz, &header, sizeof(header)) == (int)sizeof(header);
+
+	for (index = 0; ok && index < TRACK_SEGMENT_BLOCKS; index++) {
+		block_s *block = __segment_block(segment, index);
+		int size;
+
+		if (!__block_valid(block, &count))
+			continue;
+
+		size = (int)(count * sizeof(track_record_s));
+		ok = gzwrite(gz, block->records, size) == size;
+	}
+
+	ok = (gzclose(gz) == Z_OK) && ok;
+
+	munmap(segment, SEGMENT_SIZE);
+	close(fd);
+
+	/* Archive becomes visible only when complete, the segment is removed after that */
+	if (!ok || rename(tmp_path, archive_path) != 0) {
+		unlink(tmp_path);
+		return false;
+	}
+
+	unlink(path);
+
+	return true;
+}
+
+static void
+__scan_segment(const char *path, scan_context_s *ctx)
+{
+	segment_header_s *segment;
+	unsigned int low = 0, high = TRACK_SEGMENT_BLOCKS;
+	unsigned int index, count;
+	int fd;
+
+	segment = __map_segment(path, O_RDONLY, &fd);
+	if (!segment)
+		return;
+
+	if (segment->last_timestamp < ctx->from || segment->first_timestamp > ctx->to) {
+		if (segment->first_timestamp > ctx->to)
+			ctx->stop = true;
+
+		munmap(segment, SEGMENT_SIZE);
+		close(fd);
+		return;
+	}
+
+	/* Binary search for the first block that ends at or after ctx->from. Records are sorted,
+	 * an unused block sorts last. Only blocks on the search path are touched. */
+	while (low < high) {
+		unsigned int mid = low + (high - low) / 2;
+		const block_s *block = __segment_block(segment, mid);
+		unsigned int n = (unsigned int)(block->header.state >> 32);
+
+		if (block->header.magic == BLOCK_MAGIC && n > 0 && n <= TRACK_BLOCK_RECORDS &&
+				block->records[n - 1].timestamp < ctx->from)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+
+	for (index = low; index < TRACK_SEGMENT_BLOCKS && !ctx->stop; index++) {
+		const block_s *block = __segment_block(segment, index);
+
+		if (block->header.magic != BLOCK_MAGIC)
+			break;
+
+		if (__block_valid(block, &count))
+			__scan_records(block->records, count, ctx);
+	}
+
+	munmap(segment, SEGMENT_SIZE);
+	close(fd);
+}
+
+static void
+__scan_archive(const char *path, scan_context_s *ctx)
+{
+	track_record_s records[TRACK_BLOCK_RECORDS];
+	archive_header_s header;
+	unsigned int remaining;
+	gzFile gz = gzopen(path, "rb");
+
+	if (!gz)
+		return;
+
+	if (gzread(gz, &header, sizeof(header)) != (int)sizeof(header) || header.magic != ARCHIVE_MAGIC ||
+			header.version != JOURNAL_VERSION || header.record_size != sizeof(track_record_s)) {
+		gzclose(gz);
+		return;
+	}
+
+	/* Whole archive is outside of the range - nothing is decompressed */
+	if (header.count == 0 || header.last_timestamp < ctx->from || header.first_timestamp > ctx->to) {
+		if (header.count > 0 && header.first_timestamp > ctx->to)
+			ctx->stop = true;
+
+		gzclose(gz);
+		return;
+	}
+
+	remaining = header.count;
+	while (remaining > 0 && !ctx->stop) {
+		unsigned int n = remaining < TRACK_BLOCK_RECORDS ? remaining : TRACK_BLOCK_RECORDS;
+		int size = (int)(n * sizeof(track_record_s));
+
+		if (gzread(gz, records, size) != size)
+			break;
+
+		__scan_records(records, n, ctx);
+		remaining -= n;
+	}
+
+	gzclose(gz);
+}
+
+static void
+__scan_records(const track_record_s *records, unsigned int count, scan_context_s *ctx)
+{
+	unsigned int i;
+
+	for (i = 0; i < count; i++) {
+		if (records[i].timestamp < ctx->from)
+			continue;
+
+		if (records[i].timestamp > ctx->to) {
+			ctx->stop = true;
+			return;
+		}
+
+		ctx->count++;
+
+		if (!ctx->cb(&records[i], ctx->user_data)) {
+			ctx->stop = true;
+			return;
+		}
+	}
+}
@@ -0,0 +1,431 @@
+#include <math.h>
+#include <stdlib.h>
+#include "zone_index.h"
+
+#define EARTH_RADIUS_M 6371008.8
+#define DEG_TO_RAD (M_PI / 180.0)
+#define METERS_PER_DEG (EARTH_RADIUS_M * DEG_TO_RAD)
+
+/* Rings of cells around the point searched for the nearest zone */
+#define ZONE_INDEX_SEARCH_RINGS 3
+#define ZONE_INDEX_MIN_COS 0.01
+
+typedef struct
+{
+	int32_t x;
+	int32_t y;
+	uint32_t zone;
+} cell_entry_s;
+
+typedef struct
+{
+	double min_latitude;
+	double min_longitude;
+	double max_latitude;
+	double max_longitude;
+	double cos_latitude;			/* at the center of a circle */
+	bool valid;
+	bool large;						/* too many cells, tested by every query */
+} zone_bounds_s;
+
+struct zone_index_s
+{
+	const hazard_zone_s *zones;
+	const hazard_zone_vertex_s *vertices;
+	unsigned int count;
+
+	zone_bounds_s *bounds;
+	cell_entry_s *entries;
+	uint32_t *buckets;				/* bucket_mask + 2 offsets into entries */
+	uint32_t bucket_mask;
+	uint32_t *large;				/* zones tested by every query */
+	unsigned int large_count;
+};
+
+static void __clear(zone_index_s *index);
+static bool __zone_bounds(const hazard_zone_s *zone, const hazard_zone_vertex_s *vertices, zone_bounds_s *bounds);
+static int32_t __cell(double degrees);
+static uint32_t __hash(int32_t x, int32_t y);
+static bool __contains(const zone_index_s *index, unsigned int zone, double latitude, double longitude);
+static bool __polygon_contains(const hazard_zone_vertex_s *vertices, unsigned int count, double latitude, double longitude);
+static double __polygon_edge_m(const hazard_zone_vertex_s *vertices, unsigned int count, double latitude, double longitude);
+static double __circle_center_m(const zone_index_s *index, unsigned int zone, double latitude, double longitude);
+static double __nearest_in_cell(const zone_index_s *index, int32_t x, int32_t y, double latitude, double longitude, double best);
+
+
+zone_index_s *
+zone_index_create(void)
+{
+	return calloc(1, sizeof(zone_index_s));
+}
+
+void
+zone_index_destroy(zone_index_s *index)
+{
+	if (!index)
+		return;
+
+	__clear(index);
+	free(index);
+}
+
+bool
+zone_index_build(zone_index_s *index, const hazard_zone_s *zones, unsigned int count,
+		const hazard_zone_vertex_s *vertices)
+{
+	unsigned int total = 0;
+	unsigned int large = 0;
+	uint32_t bucket_count = 16;
+	unsigned int i;
+
+	__clear(index);
+
+	if (count == 0)
+		return true;
+
+	index->bounds = calloc(count, sizeof(zone_bounds_s));
+	index->large = malloc(count * sizeof(uint32_t));
+	if (!index->bounds || !index->large) {
+		__clear(index);
+		return false;
+	}
+
+	/* First pass - bounds and number of cells of every zone */
+	for (i = 0; i < count; i++) {
+		zone_bounds_s *bounds = &index->bounds[i];
+		double cells;
+
+		if (!__zone_bounds(&zones[i], vertices, bounds))
+			continue;
+
+		cells = ((double)__cell(bounds->max_longitude) - __cell(bounds->min_longitude) + 1) *
+				((double)__cell(bounds->max_latitude) - __cell(bounds->min_latitude) + 1);
+
+		bounds->large = cells > ZONE_INDEX_MAX_CELLS;
+		if (bounds->large)
+			index->large[large++] = i;
+		else
+			total += (unsigned int)cells;
+	}
+
+	while (bucket_count < total)
+		bucket_count <<= 1;
+
+	index->entries = malloc((total ? total : 1) * sizeof(cell_entry_s));
+	index->buckets = calloc(bucket_count + 1, sizeof(uint32_t));
+	if (!index->entries || !index->buckets) {
+		__clear(index);
+		return false;
+	}
+
+	index->zones = zones;
+	index->vertices = vertices;
+	index->count = count;
+	index->bucket_mask = bucket_count - 1;
+	index->large_count = large;
+
+	/* Counting sort of cell entries by bucket - count, prefix sum, place */
+	for (i = 0; i < count; i++) {
+		const zone_bounds_s *bounds = &index->bounds[i];
+		int32_t x, y;
+
+		if (!bounds->valid || bounds->large)
+			continue;
+
+		for (y = __cell(bounds->min_latitude); y <= __cell(bounds->max_latitude); y++)
+			for (x = __cell(bounds->min_longitude); x <= __cell(bounds->max_longitude); x++)
+				index->buckets[__hash(x, y) & index->bucket_mask]++;
+	}
+
+	for (i = 0, total = 0; i <= index->bucket_mask; i++) {
+		uint32_t bucket_size = index->buckets[i];
+
+		index->buckets[i] = total;
+		total += bucket_size;
+	}
+	index->buckets[bucket_count] = total;
+
+	for (i = 0; i < count; i++) {
+		const zone_bounds_s *bounds = &index->bounds[i];
+		int32_t x, y;
+
+		if (!bounds->valid || bounds->large)
+			continue;
+
+		for (y = __cell(bounds->min_latitude); y <= __cell(bounds->max_latitude); y++) {
+			for (x = __cell(bounds->min_longitude); x <= __cell(bounds->max_longitude); x++) {
+				cell_entry_s *entry = &index->entries[index->buckets[__hash(x, y) & index->bucket_mask]++];
+
+				entry->x = x;
+				entry->y = y;
+				entry->zone = i;
+			}
+		}
+	}
+
+	/* Placing moved every start to the end of its bucket, which is the start of the next one */
+	for (i = bucket_count; i > 0; i--)
+		index->buckets[i] = index->buckets[i - 1];
+	index->buckets[0] = 0;
+
+	return true;
+}
+
+unsigned int
+zone_index_query(const zone_index_s *index, double latitude, double longitude,
+		uint32_t *out, unsigned int max_zones)
+{
+	int32_t x = __cell(longitude);
+	int32_t y = __cell(latitude);
+	unsigned int written = 0;
+	uint32_t bucket, i;
+
+	if (index->count == 0)
+		return 0;
+
+	bucket = __hash(x, y) & index->bucket_mask;
+
+	for (i = index->buckets[bucket]; i < index->buckets[bucket + 1] && written < max_zones; i++) {
+		const cell_entry_s *entry = &index->entries[i];
+
+		if (entry->x == x && entry->y == y && __contains(index, entry->zone, latitude, longitude))
+			out[written++] = entry->zone;
+	}
+
+	for (i = 0; i < index->large_count && written < max_zones; i++) {
+		if (__contains(index, index->large[i], latitude, longitude))
+			out[written++] = index->large[i];
+	}
+
+	return written;
+}
+
+double
+zone_index_edge_distance_m(const zone_index_s *index, unsigned int zone, double latitude, double longitude)
+{
+	const hazard_zone_s *entry = &index->zones[zone];
+	const hazard_zone_vertex_s *vertices;
+	double distance;
+
+	if (entry->type == HAZARD_ZONE_TYPE_CIRCLE)
+		return __circle_center_m(index, zone, latitude, longitude) - entry->radius_m;
+
+	vertices = &index->vertices[entry->first_vertex];
+	distance = __polygon_edge_m(vertices, entry->vertex_count, latitude, longitude);
+
+	return __polygon_contains(vertices, entry->vertex_count, latitude, longitude) ? -distance : distance;
+}
+
+double
+zone_index_event_distance_m(const zone_index_s *index, unsigned int zone, double latitude, double longitude)
+{
+	const hazard_zone_s *entry = &index->zones[zone];
+
+	if (entry->type == HAZARD_ZONE_TYPE_CIRCLE)
+		return __circle_center_m(index, zone, latitude, longitude);
+
+	return __polygon_edge_m(&index->vertices[entry->first_vertex], entry->vertex_count, latitude, longitude);
+}
+
+double
+zone_index_nearest_m(const zone_index_s *index, double latitude, double longitude)
+{
+	double cos_latitude = fmax(cos(latitude * DEG_TO_RAD), ZONE_INDEX_MIN_COS);
+	double cell_m = ZONE_INDEX_CELL_DEG * METERS_PER_DEG * cos_latitude;
+	double best = INFINITY;
+	int32_t x0 = __cell(longitude);
+	int32_t y0 = __cell(latitude);
+	int32_t ring, i;
+	unsigned int j;
+
+	if (index->count == 0)
+		return -1.0;
+
+	for (j = 0; j < index->large_count; j++)
+		best = fmin(best, fmax(zone_index_edge_distance_m(index, index->large[j], latitude, longitude), 0.0));
+
+	for (ring = 0; ring <= ZONE_INDEX_SEARCH_RINGS; ring++) {
+		if (ring == 0) {
+			best = __nearest_in_cell(index, x0, y0, latitude, longitude, best);
+		} else {
+			for (i = -ring; i <= ring; i++) {
+				best = __nearest_in_cell(index, x0 + i, y0 - ring, latitude, longitude, best);
+				best = __nearest_in_cell(index, x0 + i, y0 + ring, latitude, longitude, best);
+			}
+			for (i = -ring + 1; i < ring; i++) {
+				best = __nearest_in_cell(index, x0 - ring, y0 + i, latitude, longitude, best);
+				best = __nearest_in_cell(index, x0 + ring, y0 + i, latitude, longitude, best);
+			}
+		}
+
+		/* Zones not seen yet are at least this many whole cells away */
+		if (best <= ring * cell_m)
+			return best;
+	}
+
+	return fmin(best, ZONE_INDEX_SEARCH_RINGS * cell_m);
+}
+
+static void
+__clear(zone_index_s *index)
+{
+	free(index->bounds);
+	free(index->entries);
+	free(index->buckets);
+	free(index->large);
+
+	index->zones = NULL;
+	index->vertices = NULL;
+	index->count = 0;
+	index->bounds = NULL;
+	index->entries = NULL;
+	index->buckets = NULL;
+	index->bucket_mask = 0;
+	index->large = NULL;
+	index->large_count = 0;
+}
+
+static bool
+__zone_bounds(const hazard_zone_s *zone, const hazard_zone_vertex_s *vertices, zone_bounds_s *bounds)
+{
+	unsigned int i;
+
+	bounds->valid = false;
+
+	if (zone->type == HAZARD_ZONE_TYPE_CIRCLE) {
+		double cos_latitude = fmax(cos(zone->latitude * DEG_TO_RAD), ZONE_INDEX_MIN_COS);
+		double half_latitude = zone->radius_m / METERS_PER_DEG;
+		double half_longitude = half_latitude / cos_latitude;
+
+		if (zone->radius_m <= 0.0f)
+			return false;
+
+		bounds->min_latitude = zone->latitude - half_latitude;
+		bounds->max_latitude = zone->latitude + half_latitude;
+		bounds->min_longitude = zone->longitude - half_longitude;
+		bounds->max_longitude = zone->longitude + half_longitude;
+		bounds->cos_latitude = cos_latitude;
+	} else if (zone->type == HAZARD_ZONE_TYPE_POLYGON) {
+		/* Vertex references were validated when the zones were stored */
+		const hazard_zone_vertex_s *vertex = &vertices[zone->first_vertex];
+
+		bounds->min_latitude = bounds->max_latitude = vertex->latitude;
+		bounds->min_longitude = bounds->max_longitude = vertex->longitude;
+
+		for (i = 1; i < zone->vertex_count; i++) {
+			bounds->min_latitude = fmin(bounds->min_latitude, vertex[i].latitude);
+			bounds->max_latitude = fmax(bounds->max_latitude, vertex[i].latitude);
+			bounds->min_longitude = fmin(bounds->min_longitude, vertex[i].longitude);
+			bounds->max_longitude = fmax(bounds->max_longitude, vertex[i].longitude);
+		}
+	} else {
+		return false;
+	}
+
+	bounds->valid = true;
+
+	return true;
+}
+
+static int32_t
+__cell(double degrees)
+{
+	return (int32_t)floor(degrees / ZONE_INDEX_CELL_DEG);
+}
+
+static uint32_t
+__hash(int32_t x, int32_t y)
+{
+	return ((uint32_t)x * 73856093u) ^ ((uint32_t)y * 19349663u);
+}
+
+static bool
+__contains(const zone_index_s *index, unsigned int zone, double latitude, double longitude)
+{
+	const zone_bounds_s *bounds = &index->bounds[zone];
+	const hazard_zone_s *entry = &index->zones[zone];
+	double dx, dy;
+
+	if (latitude < bounds->min_latitude || latitude > bounds->max_latitude ||
+			longitude < bounds->min_longitude || longitude > bounds->max_longitude)
+		return false;
+
+	if (entry->type == HAZARD_ZONE_TYPE_POLYGON)
+		return __polygon_contains(&index->vertices[entry->first_vertex], entry->vertex_count, latitude, longitude);
+
+	/* Squared distance, no square root and no trigonometry on the hot path */
+	dx = (longitude - entry->longitude) * bounds->cos_latitude;
+	dy = latitude - entry->latitude;
+
+	return (dx * dx + dy * dy) * (METERS_PER_DEG * METERS_PER_DEG) <= (double)entry->radius_m * entry->radius_m;
+}
+
+static bool
+__polygon_contains(const hazard_zone_vertex_s *vertices, unsigned int count, double latitude, double longitude)
+{
+	bool inside = false;
+	unsigned int i, j;
+
+	/* Even-odd rule, a ray towards east crosses the edges */
+	for (i = 0, j = count - 1; i < count; j = i++) {
+		const hazard_zone_vertex_s *a = &vertices[i];
+		const hazard_zone_vertex_s *b = &vertices[j];
+
+		if ((a->latitude > latitude) != (b->latitude > latitude) &&
+				longitude < (b->longitude - a->longitude) * (latitude - a->latitude) / (b->latitude - a->latitude) + a->longitude)
+			inside = !inside;
+	}
+
+	return inside;
+}
+
+static double
+__polygon_edge_m(const hazard_zone_vertex_s *vertices, unsigned int count, double latitude, double longitude)
+{
+	double cos_latitude = fmax(cos(latitude * DEG_TO_RAD), ZONE_INDEX_MIN_COS);
+	double best = INFINITY;
+	unsigned int i, j;
+
+	/* Segments in meters relative to the point */
+	for (i = 0, j = count - 1; i < count; j = i++) {
+		double ax = (vertices[j].longitude - longitude) * cos_latitude * METERS_PER_DEG;
+		double ay = (vertices[j].latitude - latitude) * METERS_PER_DEG;
+		double bx = (vertices[i].longitude - longitude) * cos_latitude * METERS_PER_DEG;
+		double by = (vertices[i].latitude - latitude) * METERS_PER_DEG;
+		double ex = bx - ax;
+		double ey = by - ay;
+		double length = ex * ex + ey * ey;
+		double t = length > 0.0 ? -(ax * ex + ay * ey) / length : 0.0;
+
+		t = fmin(fmax(t, 0.0), 1.0);
+		best = fmin(best, hypot(ax + t * ex, ay + t * ey));
+	}
+
+	return best;
+}
+
+static double
+__circle_center_m(const zone_index_s *index, unsigned int zone, double latitude, double longitude)
+{
+	const hazard_zone_s *entry = &index->zones[zone];
+	double dx = (longitude - entry->longitude) * index->bounds[zone].cos_latitude;
+	double dy = latitude - entry->latitude;
+
+	return sqrt(dx * dx + dy * dy) * METERS_PER_DEG;
+}
+
+static double
+__nearest_in_cell(const zone_index_s *index, int32_t x, int32_t y, double latitude, double longitude, double best)
+{
+	uint32_t bucket = __hash(x, y) & index->bucket_mask;
+	uint32_t i;
+
+	for (i = index->buckets[bucket]; i < index->buckets[bucket + 1]; i++) {
+		const cell_entry_s *entry = &index->entries[i];
+
+		if (entry->x == x && entry->y == y)
+			best = fmin(best, fmax(zone_index_edge_distance_m(index, entry->zone, latitude, longitude), 0.0));
+	}
+
+	return best;
+}
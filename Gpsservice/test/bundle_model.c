@@ -0,0 +1,203 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bundle_model.h"
+
+#define ENTRY_STR 1
+#define ENTRY_BYTE 2
+
+typedef struct entry_s
+{
+	struct entry_s *next;
+	char *key;
+	void *value;
+	uint32_t size;
+	uint8_t type;
+} entry_s;
+
+struct bundle_model_s
+{
+	entry_s *first;
+	entry_s *last;
+	unsigned int count;
+};
+
+static bool __add(bundle_model_s *b, uint8_t type, const char *key, size_t key_size, const void *value, size_t size);
+static const entry_s *__find(const bundle_model_s *b, const char *key, uint8_t type);
+
+
+bundle_model_s *
+bundle_model_create(void)
+{
+	return calloc(1, sizeof(bundle_model_s));
+}
+
+void
+bundle_model_free(bundle_model_s *b)
+{
+	entry_s *entry, *next;
+
+	if (!b)
+		return;
+
+	for (entry = b->first; entry; entry = next) {
+		next = entry->next;
+		free(entry->key);
+		free(entry->value);
+		free(entry);
+	}
+
+	free(b);
+}
+
+bool
+bundle_model_add_str(bundle_model_s *b, const char *key, const char *str)
+{
+	return __add(b, ENTRY_STR, key, strlen(key) + 1, str, strlen(str) + 1);
+}
+
+bool
+bundle_model_add_byte(bundle_model_s *b, const char *key, const void *bytes, size_t size)
+{
+	return __add(b, ENTRY_BYTE, key, strlen(key) + 1, bytes, size);
+}
+
+const char *
+bundle_model_get_str(const bundle_model_s *b, const char *key)
+{
+	const entry_s *entry = __find(b, key, ENTRY_STR);
+
+	return entry ? entry->value : NULL;
+}
+
+bool
+bundle_model_get_byte(const bundle_model_s *b, const char *key, const void **bytes, size_t *size)
+{
+	const entry_s *entry = __find(b, key, ENTRY_BYTE);
+
+	if (!entry)
+		return false;
+
+	*bytes = entry->value;
+	*size = entry->size;
+
+	return true;
+}
+
+size_t
+bundle_model_encode(const bundle_model_s *b, unsigned char **raw)
+{
+	const entry_s *entry;
+	size_t size = sizeof(uint32_t);
+	unsigned char *out;
+	uint32_t key_size;
+
+	for (entry = b->first; entry; entry = entry->next)
+		size += 1 + 2 * sizeof(uint32_t) + strlen(entry->key) + 1 + entry->size;
+
+	out = malloc(size);
+	if (!out)
+		return 0;
+
+	*raw = out;
+	memcpy(out, &b->count, sizeof(uint32_t));
+	out += sizeof(uint32_t);
+
+	/* Entry: type, key size, value size, key, value */
+	for (entry = b->first; entry; entry = entry->next) {
+		key_size = (uint32_t)strlen(entry->key) + 1;
+		*out++ = entry->type;
+		memcpy(out, &key_size, sizeof(uint32_t));
+		memcpy(out + sizeof(uint32_t), &entry->size, sizeof(uint32_t));
+		out += 2 * sizeof(uint32_t);
+		memcpy(out, entry->key, key_size);
+		out += key_size;
+		memcpy(out, entry->value, entry->size);
+		out += entry->size;
+	}
+
+	return size;
+}
+
+bundle_model_s *
+bundle_model_decode(const unsigned char *raw, size_t size)
+{
+	bundle_model_s *b = bundle_model_create();
+	const unsigned char *end = raw + size;
+	uint32_t count, key_size, value_size;
+
+	if (!b || size < sizeof(uint32_t))
+		goto damaged;
+
+	memcpy(&count, raw, sizeof(uint32_t));
+	raw += sizeof(uint32_t);
+
+	while (count-- > 0) {
+		if ((size_t)(end - raw) < 1 + 2 * sizeof(uint32_t))
+			goto damaged;
+
+		memcpy(&key_size, raw + 1, sizeof(uint32_t));
+		memcpy(&value_size, raw + 1 + sizeof(uint32_t), sizeof(uint32_t));
+		if ((size_t)(end - raw) - 1 - 2 * sizeof(uint32_t) < (size_t)key_size + value_size || key_size == 0)
+			goto damaged;
+
+		if (!__add(b, raw[0], (const char *)raw + 1 + 2 * sizeof(uint32_t), key_size,
+				raw + 1 + 2 * sizeof(uint32_t) + key_size, value_size))
+			goto damaged;
+
+		raw += 1 + 2 * sizeof(uint32_t) + key_size + value_size;
+	}
+
+	return b;
+
+damaged:
+	bundle_model_free(b);
+
+	return NULL;
+}
+
+static bool
+__add(bundle_model_s *b, uint8_t type, const char *key, size_t key_size, const void *value, size_t size)
+{
+	entry_s *entry = calloc(1, sizeof(entry_s));
+
+	if (!entry)
+		return false;
+
+	entry->key = malloc(key_size);
+	entry->value = malloc(size ? size : 1);
+	if (!entry->key || !entry->value) {
+		free(entry->key);
+		free(entry->value);
+		free(entry);
+		return false;
+	}
+
+	memcpy(entry->key, key, key_size);
+	entry->key[key_size - 1] = '\0';
+	memcpy(entry->value, value, size);
+	entry->size = (uint32_t)size;
+	entry->type = type;
+
+	if (b->last)
+		b->last->next = entry;
+	else
+		b->first = entry;
+	b->last = entry;
+	b->count++;
+
+	return true;
+}
+
+static const entry_s *
+__find(const bundle_model_s *b, const char *key, uint8_t type)
+{
+	const entry_s *entry;
+
+	for (entry = b->first; entry; entry = entry->next) {
+		if (entry->type == type && !strcmp(entry->key, key))
+			return entry;
+	}
+
+	return NULL;
+}
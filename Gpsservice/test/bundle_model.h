@@ -0,0 +1,57 @@
+#ifndef __bundle_model_H__
+#define __bundle_model_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Host stand-in for a Tizen bundle carried over the message port, for benchmarks only.
+ *
+ * Like libbundle, every entry allocates its key and value, lookups walk the entries and
+ * comparing keys, and a message crosses the port encoded into one buffer that the receiver
+ * decodes into a new bundle with copies of every entry. The message port daemon hop itself
+ * is not modelled, so the real cost of the bundle path is higher.
+ */
+
+typedef struct bundle_model_s bundle_model_s;
+
+/*
+ * Create empty bundle, NULL if memory could not be allocated
+ */
+bundle_model_s *bundle_model_create(void);
+
+/*
+ * Free bundle and its entries
+ */
+void bundle_model_free(bundle_model_s *b);
+
+/*
+ * Add string entry
+ */
+bool bundle_model_add_str(bundle_model_s *b, const char *key, const char *str);
+
+/*
+ * Add byte entry
+ */
+bool bundle_model_add_byte(bundle_model_s *b, const char *key, const void *bytes, size_t size);
+
+/*
+ * Get string entry, valid until the bundle is freed
+ */
+const char *bundle_model_get_str(const bundle_model_s *b, const char *key);
+
+/*
+ * Get byte entry in place, valid until the bundle is freed
+ */
+bool bundle_model_get_byte(const bundle_model_s *b, const char *key, const void **bytes, size_t *size);
+
+/*
+ * Encode bundle into a new buffer the caller frees. Returns its size, 0 on failure.
+ */
+size_t bundle_model_encode(const bundle_model_s *b, unsigned char **raw);
+
+/*
+ * Decode encoded buffer into a new bundle, NULL if it is damaged
+ */
+bundle_model_s *bundle_model_decode(const unsigned char *raw, size_t size);
+
+#endif /* __bundle_model_H__ */
@@ -0,0 +1,205 @@
+/* Messages a background consumer gets per hour from in-service geofencing, and its cost per fix.
+ *
+ * A device spends a working day at 1 Hz among a few hundred circle and polygon hazard zones:
+ * walking stretches with a slowly turning heading between long stops, every fix with GPS noise.
+ * Each fix goes through geofence_update() and the heartbeat rule of the service. Only transitions
+ * and heartbeats cross the message port, against one message per fix without geofencing.
+ * Re-entries shortly after an exit are counted, they show the exit margin catching edge jitter.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "geofence.h"
+
+#define HOURS 8
+#define FIXES (HOURS * 3600)
+#define HEARTBEAT_INTERVAL 300		/* as in geolocation_manager.c */
+#define WALK_S 1200
+#define STOP_S 2400
+#define WALK_SPEED_MPS 1.4
+#define NOISE_M 5.0
+#define CIRCLES 240
+#define POLYGONS 60
+#define POLYGON_SIDES 6
+#define ZONES (CIRCLES + POLYGONS)
+#define AREA_M 6000.0
+#define DWELL_S 600
+#define FLAP_S 30					/* re-entry this soon after an exit counts as a flap */
+#define CENTER_LATITUDE 23.8103
+#define CENTER_LONGITUDE 90.4125
+#define METERS_PER_DEG 111195.08
+#define OWNER "org.example.bench"
+
+static struct
+{
+	unsigned char list[sizeof(hazard_zone_list_s) + ZONES * sizeof(hazard_zone_s) +
+			POLYGONS * POLYGON_SIDES * sizeof(hazard_zone_vertex_s)];
+	int64_t last_exit[ZONES];
+	unsigned int events[4];			/* by transition */
+	unsigned int heartbeats;
+	unsigned int flaps;
+} s_bench_data;
+
+static double
+__now(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+static double
+__uniform(double low, double high)
+{
+	return low + (high - low) * rand() / (double)RAND_MAX;
+}
+
+static hazard_zone_vertex_s
+__offset(double north_m, double east_m)
+{
+	hazard_zone_vertex_s point;
+
+	point.latitude = CENTER_LATITUDE + north_m / METERS_PER_DEG;
+	point.longitude = CENTER_LONGITUDE + east_m / (METERS_PER_DEG * cos(CENTER_LATITUDE * M_PI / 180.0));
+
+	return point;
+}
+
+static size_t
+__build_zones(void)
+{
+	hazard_zone_list_s *list = (hazard_zone_list_s *)s_bench_data.list;
+	hazard_zone_s *zones = (hazard_zone_s *)(list + 1);
+	hazard_zone_vertex_s *vertices = (hazard_zone_vertex_s *)(zones + ZONES);
+	unsigned int i, v;
+
+	hazard_zone_list_init(list, ZONES);
+
+	for (i = 0; i < ZONES; i++) {
+		hazard_zone_s *zone = &zones[i];
+		double north = __uniform(-AREA_M / 2, AREA_M / 2);
+		double east = __uniform(-AREA_M / 2, AREA_M / 2);
+		double radius = __uniform(20.0, 150.0);
+		hazard_zone_vertex_s center = __offset(north, east);
+
+		memset(zone, 0, sizeof(*zone));
+		zone->id = i + 1;
+		zone->dwell_s = DWELL_S;
+		zone->latitude = center.latitude;
+		zone->longitude = center.longitude;
+		zone->radius_m = (float)radius;
+
+		if (i < CIRCLES) {
+			zone->type = HAZARD_ZONE_TYPE_CIRCLE;
+			continue;
+		}
+
+		zone->type = HAZARD_ZONE_TYPE_POLYGON;
+		zone->first_vertex = (i - CIRCLES) * POLYGON_SIDES;
+		zone->vertex_count = POLYGON_SIDES;
+		for (v = 0; v < POLYGON_SIDES; v++) {
+			double angle = 2.0 * M_PI * v / POLYGON_SIDES;
+
+			vertices[zone->first_vertex + v] = __offset(north + radius * cos(angle), east + radius * sin(angle));
+		}
+	}
+
+	return sizeof(s_bench_data.list);
+}
+
+static void
+__count_events(const geofence_event_s *events, unsigned int count)
+{
+	unsigned int i;
+
+	for (i = 0; i < count; i++) {
+		const hazard_zone_event_s *event = &events[i].event;
+		unsigned int zone = event->id - 1;
+
+		if (event->transition >= 4 || zone >= ZONES)
+			continue;
+
+		s_bench_data.events[event->transition]++;
+
+		if (event->transition == HAZARD_ZONE_EXIT)
+			s_bench_data.last_exit[zone] = event->timestamp;
+		else if (event->transition == HAZARD_ZONE_ENTER && s_bench_data.last_exit[zone] > 0 &&
+				event->timestamp - s_bench_data.last_exit[zone] < FLAP_S)
+			s_bench_data.flaps++;
+	}
+}
+
+int
+main(void)
+{
+	static geofence_event_s events[GEOFENCE_MAX_EVENTS];
+	double north = 0.0, east = 0.0, heading = 0.0;
+	int64_t timestamp = 1700000000;
+	int64_t last_heartbeat = 0;
+	unsigned int stored, total_events;
+	double elapsed = 0.0, start;
+	int i;
+
+	srand(1);
+	geofence_init();
+	stored = geofence_set_zones(OWNER, (const hazard_zone_list_s *)s_bench_data.list, __build_zones());
+	if (stored != ZONES) {
+		printf("FAIL %u of %d zones stored\n", stored, ZONES);
+		return 1;
+	}
+
+	for (i = 0; i < FIXES; i++, timestamp++) {
+		position_frame_s frame;
+		hazard_zone_vertex_s position;
+
+		if (i % (WALK_S + STOP_S) < WALK_S) {
+			/* Turn slowly, back towards the middle near the edge of the area */
+			heading += __uniform(-0.2, 0.2);
+			if (hypot(north, east) > AREA_M / 2 - 200.0)
+				heading = atan2(-east, -north);
+
+			north += WALK_SPEED_MPS * cos(heading);
+			east += WALK_SPEED_MPS * sin(heading);
+		}
+
+		position = __offset(north + __uniform(-NOISE_M, NOISE_M), east + __uniform(-NOISE_M, NOISE_M));
+		position_frame_init(&frame, position.latitude, position.longitude, 10.0, timestamp);
+		frame.horizontal_accuracy = (float)NOISE_M;
+		position_frame_set_quality(&frame, POSITION_FRAME_QUALITY_GOOD);
+
+		start = __now();
+		__count_events(events, geofence_update(&frame, events, GEOFENCE_MAX_EVENTS));
+		elapsed += __now() - start;
+
+		if (frame.timestamp - last_heartbeat >= HEARTBEAT_INTERVAL) {
+			last_heartbeat = frame.timestamp;
+			s_bench_data.heartbeats++;
+		}
+	}
+
+	geofence_destroy();
+
+	total_events = s_bench_data.events[HAZARD_ZONE_ENTER] + s_bench_data.events[HAZARD_ZONE_EXIT] +
+			s_bench_data.events[HAZARD_ZONE_DWELL];
+
+	printf("Geofence, %d h at 1 Hz among %d circles and %d polygons, walking %d of every %d min:\n", HOURS, CIRCLES,
+			POLYGONS, WALK_S / 60, (WALK_S + STOP_S) / 60);
+	printf("  per hour: %.1f enter, %.1f exit, %.1f dwell, %.1f heartbeats\n",
+			(double)s_bench_data.events[HAZARD_ZONE_ENTER] / HOURS, (double)s_bench_data.events[HAZARD_ZONE_EXIT] / HOURS,
+			(double)s_bench_data.events[HAZARD_ZONE_DWELL] / HOURS, (double)s_bench_data.heartbeats / HOURS);
+	printf("  messages per hour: %.1f instead of %d, %u re-entries within %d s of an exit\n",
+			(double)(total_events + s_bench_data.heartbeats) / HOURS, 3600, s_bench_data.flaps, FLAP_S);
+	printf("  %.0f ns per fix\n", elapsed * 1e9 / FIXES);
+
+	if (total_events == 0) {
+		printf("FAIL no zone was crossed\n");
+		return 1;
+	}
+
+	return 0;
+}
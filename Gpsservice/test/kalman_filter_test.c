@@ -0,0 +1,122 @@
+/* Kalman filter on tracks crossing the antimeridian.
+ *
+ * Estimates must stay in [-180, 180), close to the true position and at a plausible speed while
+ * the track goes from 179.99 to -179.99 degrees of longitude and back, also when the filter
+ * re-anchors its tangent plane on the other side.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "kalman_filter.h"
+
+#define METERS_PER_DEG 111195.08
+#define ACCURACY_M 5.0
+#define MAX_ERROR_M 30.0
+#define MAX_SPEED_FACTOR 1.5			/* of the true speed, after settling */
+#define SETTLE_FIXES 20
+
+static unsigned int s_failures;
+
+static double
+__noise(void)
+{
+	return (rand() / (double)RAND_MAX - 0.5) * 2.0 * ACCURACY_M;
+}
+
+static double
+__distance_m(double latitude1, double longitude1, double latitude2, double longitude2)
+{
+	double dlon = fmod(longitude2 - longitude1 + 540.0, 360.0) - 180.0;
+
+	return hypot((latitude2 - latitude1) * METERS_PER_DEG, dlon * METERS_PER_DEG * cos(latitude1 * M_PI / 180.0));
+}
+
+static void
+__fail(const char *track, int fix, const char *reason, double value)
+{
+	if (s_failures++ < 10)
+		printf("FAIL %s, fix %d: %s %.7g\n", track, fix, reason, value);
+}
+
+static void
+__test_track(const char *track, double latitude, double longitude, double speed_mps, double heading_deg, int fixes)
+{
+	kalman_filter_s kf;
+	kalman_estimate_s estimate;
+	double worst_error = 0.0, worst_speed = 0.0;
+	double dlat = speed_mps * cos(heading_deg * M_PI / 180.0) / METERS_PER_DEG;
+	double dlon = speed_mps * sin(heading_deg * M_PI / 180.0) / (METERS_PER_DEG * cos(latitude * M_PI / 180.0));
+	int i;
+
+	kalman_filter_init(&kf, 0.0);
+	for (i = 0; i < fixes; i++) {
+		double true_latitude = latitude + i * dlat;
+		double true_longitude = fmod(longitude + i * dlon + 540.0, 360.0) - 180.0;
+		double measured_longitude = true_longitude + __noise() / (METERS_PER_DEG * cos(true_latitude * M_PI / 180.0));
+		double error;
+
+		/* Receivers report longitudes in [-180, 180] */
+		if (measured_longitude >= 180.0)
+			measured_longitude -= 360.0;
+		else if (measured_longitude < -180.0)
+			measured_longitude += 360.0;
+
+		kalman_filter_update(&kf, true_latitude + __noise() / METERS_PER_DEG, measured_longitude, ACCURACY_M,
+				1700000000 + i, &estimate);
+
+		if (estimate.longitude < -180.0 || estimate.longitude >= 180.0)
+			__fail(track, i, "longitude out of range", estimate.longitude);
+
+		error = __distance_m(true_latitude, true_longitude, estimate.latitude, estimate.longitude);
+		worst_error = fmax(worst_error, error);
+		if (error > MAX_ERROR_M)
+			__fail(track, i, "estimate off by meters", error);
+
+		if (i >= SETTLE_FIXES) {
+			worst_speed = fmax(worst_speed, estimate.speed);
+			if (estimate.speed > MAX_SPEED_FACTOR * speed_mps + 1.0)
+				__fail(track, i, "speed m/s", estimate.speed);
+		}
+	}
+
+	printf("  %-36s worst error %5.1f m, worst speed %6.1f m/s of %.1f\n", track, worst_error, worst_speed, speed_mps);
+}
+
+static void
+__test_alternating(void)
+{
+	kalman_filter_s kf;
+	kalman_estimate_s estimate;
+	int i;
+
+	/* Two fixes 22 m apart on either side of the antimeridian */
+	kalman_filter_init(&kf, 0.0);
+	for (i = 0; i < 10; i++) {
+		kalman_filter_update(&kf, 0.0, i % 2 ? -179.9999 : 179.9999, ACCURACY_M, 1700000000 + i, &estimate);
+
+		if (fabs(fabs(estimate.longitude) - 180.0) > 0.001)
+			__fail("179.9999 / -179.9999", i, "longitude", estimate.longitude);
+		if (estimate.speed > 50.0)
+			__fail("179.9999 / -179.9999", i, "speed m/s", estimate.speed);
+	}
+
+	printf("  %-36s last longitude %.5f, speed %.1f m/s\n", "179.9999 / -179.9999", estimate.longitude, estimate.speed);
+}
+
+int
+main(void)
+{
+	srand(1);
+
+	printf("Kalman filter across the antimeridian:\n");
+	__test_alternating();
+	__test_track("walking east over 180", 10.0, 179.998, 1.4, 90.0, 600);
+	__test_track("walking west over 180", -35.0, -179.998, 1.4, 270.0, 600);
+	__test_track("driving north-east, re-anchoring", 60.0, 179.8, 30.0, 60.0, 1200);
+	__test_track("driving west, re-anchoring", 0.0, -179.7, 30.0, 270.0, 1200);
+
+	printf("kalman_filter_test: %s\n", s_failures ? "FAILED" : "passed");
+
+	return s_failures ? 1 : 0;
+}
@@ -0,0 +1,199 @@
+/* Cost per fix of sending a position as a binary frame versus as the legacy string keys.
+ *
+ * Both paths build a message, encode it, decode it on the receiving side and read the position
+ * back, through the bundle stand-in of bundle_model.h. The legacy path formats latitude and
+ * longitude with "%f" and parses them with strtod(), the frame path adds one position_frame_s
+ * and reads it in place with position_frame_decode(). The format/parse and init/decode steps
+ * are also timed alone, without the bundle.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "bundle_model.h"
+#include "position_frame.h"
+
+#define FIXES 1000000
+#define TYPE_KEY "msg_type"
+#define TYPE_POSITION "POSITION_UPDATE"
+#define COORDINATE_SIZE 32
+
+static struct
+{
+	double latitudes[FIXES];
+	double longitudes[FIXES];
+	double sum;						/* keeps the decoded values alive */
+	double worst_error;				/* degrees, legacy path */
+	unsigned int failures;
+} s_bench_data;
+
+static double
+__now(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+static bool
+__send_legacy(double latitude, double longitude)
+{
+	char latitude_str[COORDINATE_SIZE], longitude_str[COORDINATE_SIZE];
+	bundle_model_s *b = bundle_model_create();
+	bundle_model_s *received;
+	const char *value;
+	unsigned char *raw;
+	size_t size;
+	double decoded;
+
+	snprintf(latitude_str, COORDINATE_SIZE, "%f", latitude);
+	snprintf(longitude_str, COORDINATE_SIZE, "%f", longitude);
+	bundle_model_add_str(b, TYPE_KEY, TYPE_POSITION);
+	bundle_model_add_str(b, "latitude", latitude_str);
+	bundle_model_add_str(b, "longitude", longitude_str);
+
+	size = bundle_model_encode(b, &raw);
+	bundle_model_free(b);
+	received = bundle_model_decode(raw, size);
+	free(raw);
+	if (!received)
+		return false;
+
+	if (!bundle_model_get_str(received, TYPE_KEY) || !(value = bundle_model_get_str(received, "latitude"))) {
+		bundle_model_free(received);
+		return false;
+	}
+
+	decoded = strtod(value, NULL);
+	s_bench_data.worst_error = fmax(s_bench_data.worst_error, fabs(decoded - latitude));
+	s_bench_data.sum += decoded;
+
+	if ((value = bundle_model_get_str(received, "longitude")))
+		s_bench_data.sum += strtod(value, NULL);
+
+	bundle_model_free(received);
+
+	return value != NULL;
+}
+
+static bool
+__send_frame(double latitude, double longitude, int64_t timestamp)
+{
+	bundle_model_s *b = bundle_model_create();
+	bundle_model_s *received;
+	const position_frame_s *decoded;
+	position_frame_s frame;
+	const void *bytes;
+	unsigned char *raw;
+	size_t size;
+
+	position_frame_init(&frame, latitude, longitude, 10.0, timestamp);
+	frame.horizontal_accuracy = 5.0f;
+	bundle_model_add_str(b, TYPE_KEY, TYPE_POSITION);
+	bundle_model_add_byte(b, POSITION_FRAME_KEY, &frame, sizeof(frame));
+
+	size = bundle_model_encode(b, &raw);
+	bundle_model_free(b);
+	received = bundle_model_decode(raw, size);
+	free(raw);
+	if (!received)
+		return false;
+
+	if (!bundle_model_get_str(received, TYPE_KEY) || !bundle_model_get_byte(received, POSITION_FRAME_KEY, &bytes, &size) ||
+			!(decoded = position_frame_decode(bytes, size)) || decoded->latitude != latitude) {
+		bundle_model_free(received);
+		return false;
+	}
+
+	s_bench_data.sum += decoded->latitude + decoded->longitude;
+	bundle_model_free(received);
+
+	return true;
+}
+
+static double
+__format_parse(void)
+{
+	char latitude_str[COORDINATE_SIZE], longitude_str[COORDINATE_SIZE];
+	double start = __now();
+	int i;
+
+	for (i = 0; i < FIXES; i++) {
+		snprintf(latitude_str, COORDINATE_SIZE, "%f", s_bench_data.latitudes[i]);
+		snprintf(longitude_str, COORDINATE_SIZE, "%f", s_bench_data.longitudes[i]);
+		s_bench_data.sum += strtod(latitude_str, NULL) + strtod(longitude_str, NULL);
+	}
+
+	return (__now() - start) * 1e9 / FIXES;
+}
+
+static double
+__init_decode(void)
+{
+	/* volatile keeps the compiler from folding the frame away */
+	static volatile unsigned char buffer[sizeof(position_frame_s)];
+	const position_frame_s *decoded;
+	position_frame_s frame;
+	double start = __now();
+	unsigned int j;
+	int i;
+
+	for (i = 0; i < FIXES; i++) {
+		position_frame_init(&frame, s_bench_data.latitudes[i], s_bench_data.longitudes[i], 10.0, i);
+		for (j = 0; j < sizeof(frame); j++)
+			buffer[j] = ((unsigned char *)&frame)[j];
+
+		decoded = position_frame_decode((const void *)buffer, sizeof(buffer));
+		if (decoded)
+			s_bench_data.sum += decoded->latitude + decoded->longitude;
+	}
+
+	return (__now() - start) * 1e9 / FIXES;
+}
+
+static double
+__bench(bool frame)
+{
+	double start = __now();
+	int i;
+
+	for (i = 0; i < FIXES; i++) {
+		bool sent = frame ? __send_frame(s_bench_data.latitudes[i], s_bench_data.longitudes[i], i) :
+				__send_legacy(s_bench_data.latitudes[i], s_bench_data.longitudes[i]);
+
+		if (!sent && s_bench_data.failures++ == 0)
+			printf("FAIL %s message %d not received\n", frame ? "frame" : "legacy", i);
+	}
+
+	return (__now() - start) * 1e9 / FIXES;
+}
+
+int
+main(void)
+{
+	double legacy, frame;
+	int i;
+
+	srand(1);
+	for (i = 0; i < FIXES; i++) {
+		s_bench_data.latitudes[i] = -90.0 + 180.0 * (rand() / (double)RAND_MAX);
+		s_bench_data.longitudes[i] = -180.0 + 360.0 * (rand() / (double)RAND_MAX);
+	}
+
+	printf("Per fix, %d fixes:\n", FIXES);
+	printf("  format + parse \"%%f\"          %6.0f ns\n", __format_parse());
+	printf("  frame init + decode          %6.0f ns\n", __init_decode());
+
+	legacy = __bench(false);
+	frame = __bench(true);
+	printf("  legacy keys through bundle   %6.0f ns, latitude off by up to %.1e degrees (%.2f m)\n", legacy,
+			s_bench_data.worst_error, s_bench_data.worst_error * 111195.0);
+	printf("  frame through bundle         %6.0f ns, exact, %u bytes\n", frame, (unsigned int)sizeof(position_frame_s));
+
+	printf("position_frame_bench: %s (checksum %.0f)\n", s_bench_data.failures ? "FAILED" : "passed", s_bench_data.sum);
+
+	return s_bench_data.failures ? 1 : 0;
+}
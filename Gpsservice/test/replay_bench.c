@@ -0,0 +1,162 @@
+/* Throughput of the position pipeline of the service on a plain host.
+ *
+ * Replays a track file as fast as possible through the location source interface and runs
+ * every fix through the host-portable stages of __position_updated_cb: fix quality check,
+ * Kalman smoothing, deadband and batching. Without a track argument a random walk CSV track
+ * is generated first.
+ *
+ * Usage: replay_bench [track file] [speed]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include "location_replay.h"
+#include "fix_quality.h"
+#include "kalman_filter.h"
+#include "deadband_filter.h"
+#include "position_batch.h"
+
+#define GENERATED_FIXES 200000
+
+typedef struct
+{
+	kalman_filter_s kalman;
+	position_frame_s batch[POSITION_BATCH_CAPACITY];
+	unsigned int accepted;
+	unsigned int sent;
+	unsigned int batches;
+} pipeline_s;
+
+static double
+__now(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+static bool
+__generate_track(char *path)
+{
+	int fd = mkstemp(path);
+	FILE *file;
+	double latitude = 23.8103;
+	double longitude = 90.4125;
+	long timestamp = 1700000000;
+	int i;
+
+	if (fd < 0)
+		return false;
+
+	file = fdopen(fd, "w");
+	if (!file) {
+		close(fd);
+		return false;
+	}
+
+	srand(1);
+	fprintf(file, "time,latitude,longitude,altitude,speed,heading,accuracy\n");
+	for (i = 0; i < GENERATED_FIXES; i++) {
+		latitude += (rand() % 201 - 100) * 1e-6;
+		longitude += (rand() % 201 - 100) * 1e-6;
+		fprintf(file, "%ld,%.7f,%.7f,%.1f,%.1f,%d,%d\n", timestamp++, latitude, longitude,
+				10.0 + rand() % 50 / 10.0, rand() % 300 / 10.0, rand() % 360, 3 + rand() % 40);
+	}
+
+	return fclose(file) == 0;
+}
+
+static void
+__position_cb(double latitude, double longitude, double altitude, time_t timestamp, void *user_data)
+{
+	pipeline_s *pipeline = user_data;
+	location_source_fix_s fix;
+	position_frame_s frame;
+	kalman_estimate_s estimate;
+	int active;
+	int inview;
+
+	if (!location_replay_source.get_last_fix(&fix))
+		return;
+
+	position_frame_init(&frame, latitude, longitude, altitude, timestamp);
+	frame.horizontal_accuracy = fix.horizontal_accuracy;
+	frame.vertical_accuracy = fix.vertical_accuracy;
+	frame.speed = fix.speed;
+	frame.heading = fix.heading;
+
+	if (!location_replay_source.get_satellites(&active, &inview))
+		active = FIX_QUALITY_SATELLITES_NONE;
+
+	if (fix_quality_check(&frame, active, timestamp) != FIX_ACCEPTED)
+		return;
+
+	pipeline->accepted++;
+
+	kalman_filter_update(&pipeline->kalman, frame.latitude, frame.longitude, frame.horizontal_accuracy,
+			frame.timestamp, &estimate);
+	frame.latitude = estimate.latitude;
+	frame.longitude = estimate.longitude;
+
+	if (deadband_filter_check(&frame) == DEADBAND_SUPPRESSED)
+		return;
+
+	pipeline->sent++;
+
+	if (position_batch_push(&frame)) {
+		position_batch_drain(pipeline->batch, POSITION_BATCH_CAPACITY);
+		pipeline->batches++;
+	}
+}
+
+int
+main(int argc, char *argv[])
+{
+	char generated[] = "/tmp/replay_bench_XXXXXX";
+	const char *path = argc > 1 ? argv[1] : generated;
+	double speed = argc > 2 ? atof(argv[2]) : LOCATION_REPLAY_AS_FAST;
+	static pipeline_s pipeline;
+	location_replay_stats_s stats;
+	double delay;
+
+	if (argc < 2 && !__generate_track(generated)) {
+		fprintf(stderr, "Failed to generate track\n");
+		return 1;
+	}
+
+	if (!location_replay_open(path, speed)) {
+		fprintf(stderr, "Failed to open track %s\n", path);
+		return 1;
+	}
+
+	fix_quality_init(NULL);
+	deadband_filter_init(NULL);
+	position_batch_init(16);
+	kalman_filter_init(&pipeline.kalman, 0.0);
+
+	location_replay_source.create();
+	location_replay_source.set_position_cb(__position_cb, 1, &pipeline);
+	location_replay_source.start();
+
+	while ((delay = location_replay_poll(__now())) >= 0.0) {
+		if (delay > 0.0)
+			usleep(delay * 1e6);
+	}
+
+	location_replay_get_stats(&stats, __now());
+	location_replay_source.destroy();
+
+	if (argc < 2)
+		unlink(generated);
+
+	printf("read %u, delivered %u, skipped %u, parse errors %u\n", stats.fixes_read, stats.fixes_delivered,
+			stats.fixes_skipped, stats.parse_errors);
+	printf("accepted %u, sent %u in %u batches\n", pipeline.accepted, pipeline.sent, pipeline.batches);
+	printf("%.3f s, %.0f fixes/s\n", stats.elapsed_s, stats.fixes_per_second);
+
+	return stats.fixes_delivered > 0 ? 0 : 1;
+}
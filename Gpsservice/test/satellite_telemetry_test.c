@@ -0,0 +1,211 @@
+/* Round trip of satellite telemetry: every encoded frame must fit the encoder buffer, pass
+ * satellite_frame_decode() and bring the receiver table to the encoded update.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "satellite_telemetry.h"
+
+#define GUARD_SIZE 64
+#define GUARD_BYTE 0xa5
+#define RANDOM_UPDATES 10000
+
+typedef struct
+{
+	unsigned int prn;
+	unsigned int azimuth;
+	unsigned int elevation;
+	int snr;
+	bool in_use;
+} satellite_s;
+
+static struct
+{
+	unsigned char buffer[SATELLITE_TELEMETRY_BUFFER_SIZE + GUARD_SIZE];
+	satellite_entry_s table[SATELLITE_FRAME_MAX];
+	unsigned int count;
+	uint16_t sequence;
+	unsigned int failures;
+} s_test_data;
+
+static void
+__fail(const char *update, const char *reason)
+{
+	printf("FAIL %s: %s\n", update, reason);
+	s_test_data.failures++;
+}
+
+static const satellite_frame_s *
+__encode(const char *update, const satellite_s *satellites, unsigned int count)
+{
+	const satellite_frame_s *frame;
+	unsigned int i;
+	size_t size;
+
+	satellite_telemetry_begin(count, count, 1700000000);
+	for (i = 0; i < count; i++)
+		satellite_telemetry_add(satellites[i].prn, satellites[i].azimuth, satellites[i].elevation,
+				satellites[i].snr, satellites[i].in_use);
+
+	memset(s_test_data.buffer, GUARD_BYTE, sizeof(s_test_data.buffer));
+	size = satellite_telemetry_encode(s_test_data.buffer);
+
+	if (size > SATELLITE_TELEMETRY_BUFFER_SIZE)
+		__fail(update, "frame larger than the buffer");
+	for (i = SATELLITE_TELEMETRY_BUFFER_SIZE; i < sizeof(s_test_data.buffer); i++) {
+		if (s_test_data.buffer[i] != GUARD_BYTE) {
+			__fail(update, "write past the buffer");
+			break;
+		}
+	}
+
+	frame = satellite_frame_decode(s_test_data.buffer, size);
+	if (!frame) {
+		__fail(update, "frame does not decode");
+		return NULL;
+	}
+
+	if (!satellite_frame_apply(frame, s_test_data.table, &s_test_data.count, &s_test_data.sequence))
+		__fail(update, "delta to another sequence");
+
+	return frame;
+}
+
+static void
+__check_table(const char *update, const satellite_s *satellites, unsigned int count)
+{
+	unsigned int i, j;
+
+	if (s_test_data.count != count) {
+		__fail(update, "wrong number of satellites");
+		return;
+	}
+
+	for (i = 0; i < count; i++) {
+		for (j = 0; j < s_test_data.count && s_test_data.table[j].prn != satellites[i].prn; j++)
+			;
+
+		if (j == s_test_data.count || s_test_data.table[j].snr != satellites[i].snr ||
+				s_test_data.table[j].azimuth != satellites[i].azimuth ||
+				!(s_test_data.table[j].flags & SATELLITE_ENTRY_FLAG_IN_USE) != !satellites[i].in_use) {
+			__fail(update, "satellite missing or different");
+			return;
+		}
+	}
+}
+
+static unsigned int
+__fill(satellite_s *satellites, unsigned int first_prn, unsigned int count)
+{
+	unsigned int i;
+
+	for (i = 0; i < count; i++) {
+		satellites[i].prn = first_prn + i;
+		satellites[i].azimuth = (i * 37) % 360;
+		satellites[i].elevation = i % 90;
+		satellites[i].snr = 20 + i % 30;
+		satellites[i].in_use = i % 3 == 0;
+	}
+
+	return count;
+}
+
+static void
+__test_disjoint(void)
+{
+	satellite_s satellites[SATELLITE_FRAME_MAX];
+	const satellite_frame_s *frame;
+	unsigned int count;
+
+	satellite_telemetry_init();
+	s_test_data.count = 0;
+
+	count = __fill(satellites, 1, 40);
+	__encode("PRN 1-40", satellites, count);
+	__check_table("PRN 1-40", satellites, count);
+
+	/* 40 removed and 40 new satellites would be 80 delta entries */
+	count = __fill(satellites, 41, 40);
+	frame = __encode("PRN 41-80", satellites, count);
+	__check_table("PRN 41-80", satellites, count);
+	if (frame && !(frame->flags & SATELLITE_FRAME_FLAG_KEY))
+		__fail("PRN 41-80", "delta longer than the update");
+
+	count = __fill(satellites, 100, SATELLITE_FRAME_MAX);
+	__encode("PRN 100-163", satellites, count);
+	__check_table("PRN 100-163", satellites, count);
+
+	count = __fill(satellites, 200, SATELLITE_FRAME_MAX);
+	__encode("PRN 200-263", satellites, count);
+	__check_table("PRN 200-263", satellites, count);
+
+	count = __fill(satellites, 1, 0);
+	__encode("no satellites", satellites, count);
+	__check_table("no satellites", satellites, count);
+}
+
+static void
+__test_random(void)
+{
+	satellite_s satellites[SATELLITE_FRAME_MAX];
+	bool used[256] = { false };
+	unsigned int count = 0;
+	unsigned int update, i;
+	satellite_telemetry_stats_s stats;
+
+	satellite_telemetry_init();
+	s_test_data.count = 0;
+	srand(1);
+
+	for (update = 0; update < RANDOM_UPDATES; update++) {
+		/* Mostly small changes, sometimes a different sky */
+		if (rand() % 50 == 0) {
+			memset(used, 0, sizeof(used));
+			count = 0;
+		}
+
+		for (i = 0; i < count; i++) {
+			if (rand() % 10 == 0) {
+				used[satellites[i].prn] = false;
+				satellites[i--] = satellites[--count];
+			} else if (rand() % 4 == 0) {
+				satellites[i].snr = rand() % 50;
+				satellites[i].in_use = rand() % 2;
+			}
+		}
+
+		while (count < SATELLITE_FRAME_MAX && rand() % 3) {
+			unsigned int prn = 1 + rand() % 255;
+
+			if (used[prn])
+				continue;
+
+			used[prn] = true;
+			satellites[count].prn = prn;
+			satellites[count].azimuth = rand() % 360;
+			satellites[count].elevation = rand() % 91;
+			satellites[count].snr = rand() % 50;
+			satellites[count].in_use = rand() % 2;
+			count++;
+		}
+
+		__encode("random", satellites, count);
+		__check_table("random", satellites, count);
+	}
+
+	satellite_telemetry_get_stats(&stats);
+	printf("%u random updates: %u key frames, %u of %u entries sent\n", stats.frames, stats.key_frames,
+			stats.entries_sent, stats.entries_in_view);
+}
+
+int
+main(void)
+{
+	__test_disjoint();
+	__test_random();
+
+	printf("satellite_telemetry_test: %s\n", s_test_data.failures ? "FAILED" : "passed");
+
+	return s_test_data.failures ? 1 : 0;
+}
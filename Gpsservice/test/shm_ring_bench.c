@@ -0,0 +1,328 @@
+/* Position frames through the shared memory ring versus through bundles, between two threads.
+ *
+ * The bundle path models the message port transport: the producer adds the frame to a bundle,
+ * encodes it and writes it into a pipe, the consumer reads it, decodes a new bundle and takes
+ * the frame out of it (see bundle_model.h, the message port daemon hop is not modelled). The
+ * ring path writes the same frames into shm_ring and reads them in place. Both are run flat out
+ * for throughput and paced for the write to read latency of a single frame.
+ */
+
+#include <limits.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "bundle_model.h"
+#include "position_frame.h"
+#include "shm_ring.h"
+
+#define FLOOD_FRAMES 200000
+#define PACED_FRAMES 20000
+#define PACED_INTERVAL_NS 50000
+#define FIRST_TIMESTAMP 1700000000
+#define TYPE_KEY "msg_type"
+#define TYPE_POSITION "POSITION_UPDATE"
+#define FRAME_KEY "position_frame"
+
+typedef struct
+{
+	const char *name;
+	bool (*open)(void);
+	void (*close)(void);
+	bool (*send)(const position_frame_s *frame);
+	bool (*receive)(position_frame_s *frame);	/* waits for the next frame */
+} transport_s;
+
+static struct
+{
+	int64_t sent_ns[FLOOD_FRAMES];
+	double latency_ns[FLOOD_FRAMES];
+	const transport_s *transport;
+	unsigned int frames;
+	unsigned int errors;
+	shm_ring_s *producer;
+	shm_ring_s *consumer;
+	char ring_name[SHM_RING_NAME_SIZE];
+	int pipe_fd[2];
+} s_bench_data;
+
+static int64_t
+__now_ns(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return (int64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+static int
+__compare_latency(const void *a, const void *b)
+{
+	double x = *(const double *)a, y = *(const double *)b;
+
+	return (x > y) - (x < y);
+}
+
+static bool
+__ring_open(void)
+{
+	snprintf(s_bench_data.ring_name, SHM_RING_NAME_SIZE, "/shm_ring_bench-%d", (int)getpid());
+
+	s_bench_data.producer = shm_ring_create(s_bench_data.ring_name);
+	if (!s_bench_data.producer)
+		return false;
+
+	s_bench_data.consumer = shm_ring_attach(s_bench_data.ring_name);
+
+	return s_bench_data.consumer != NULL;
+}
+
+static void
+__ring_close(void)
+{
+	if (s_bench_data.consumer)
+		shm_ring_close(s_bench_data.consumer);
+	if (s_bench_data.producer)
+		shm_ring_close(s_bench_data.producer);
+
+	s_bench_data.consumer = NULL;
+	s_bench_data.producer = NULL;
+}
+
+static bool
+__ring_send(const position_frame_s *frame)
+{
+	bool doorbell;
+
+	/* Full ring, wait for the consumer instead of dropping the frame */
+	while (!shm_ring_write(s_bench_data.producer, SHM_RING_RECORD_POSITION, frame, sizeof(*frame), &doorbell))
+		sched_yield();
+
+	return true;
+}
+
+static bool
+__ring_receive(position_frame_s *frame)
+{
+	const shm_ring_record_s *record;
+
+	while (!(record = shm_ring_peek(s_bench_data.consumer)))
+		sched_yield();
+
+	if (record->type != SHM_RING_RECORD_POSITION || record->size != sizeof(*frame)) {
+		shm_ring_release(s_bench_data.consumer);
+		return false;
+	}
+
+	memcpy(frame, record->payload, sizeof(*frame));
+	shm_ring_release(s_bench_data.consumer);
+
+	return true;
+}
+
+static bool
+__bundle_open(void)
+{
+	return pipe(s_bench_data.pipe_fd) == 0;
+}
+
+static void
+__bundle_close(void)
+{
+	close(s_bench_data.pipe_fd[0]);
+	close(s_bench_data.pipe_fd[1]);
+}
+
+static bool
+__read_all(void *buffer, size_t size)
+{
+	unsigned char *p = buffer;
+
+	while (size > 0) {
+		ssize_t n = read(s_bench_data.pipe_fd[0], p, size);
+
+		if (n <= 0)
+			return false;
+
+		p += n;
+		size -= (size_t)n;
+	}
+
+	return true;
+}
+
+static bool
+__bundle_send(const position_frame_s *frame)
+{
+	bundle_model_s *b = bundle_model_create();
+	unsigned char message[PIPE_BUF];
+	unsigned char *raw;
+	uint32_t size;
+	bool ok;
+
+	if (!b)
+		return false;
+
+	bundle_model_add_str(b, TYPE_KEY, TYPE_POSITION);
+	bundle_model_add_byte(b, FRAME_KEY, frame, sizeof(*frame));
+	size = (uint32_t)bundle_model_encode(b, &raw);
+	bundle_model_free(b);
+
+	if (size == 0 || size + sizeof(size) > PIPE_BUF) {
+		free(raw);
+		return false;
+	}
+
+	/* One write up to PIPE_BUF is atomic, the consumer never sees half a message */
+	memcpy(message, &size, sizeof(size));
+	memcpy(message + sizeof(size), raw, size);
+	free(raw);
+
+	ok = write(s_bench_data.pipe_fd[1], message, sizeof(size) + size) == (ssize_t)(sizeof(size) + size);
+
+	return ok;
+}
+
+static bool
+__bundle_receive(position_frame_s *frame)
+{
+	unsigned char raw[PIPE_BUF];
+	bundle_model_s *b;
+	const void *bytes;
+	uint32_t size;
+	size_t frame_size;
+	bool ok;
+
+	if (!__read_all(&size, sizeof(size)) || size > PIPE_BUF || !__read_all(raw, size))
+		return false;
+
+	b = bundle_model_decode(raw, size);
+	if (!b)
+		return false;
+
+	ok = bundle_model_get_str(b, TYPE_KEY) && bundle_model_get_byte(b, FRAME_KEY, &bytes, &frame_size) &&
+			frame_size == sizeof(*frame);
+	if (ok)
+		memcpy(frame, bytes, sizeof(*frame));
+
+	bundle_model_free(b);
+
+	return ok;
+}
+
+static const transport_s s_transports[] = {
+	{ "bundle", __bundle_open, __bundle_close, __bundle_send, __bundle_receive },
+	{ "shm_ring", __ring_open, __ring_close, __ring_send, __ring_receive },
+};
+
+static double
+__latitude(unsigned int index)
+{
+	return 23.8103 + index * 1e-7;
+}
+
+static void *
+__consumer_thread(void *data)
+{
+	position_frame_s frame;
+	unsigned int i;
+
+	for (i = 0; i < s_bench_data.frames; i++) {
+		unsigned int index;
+
+		if (!s_bench_data.transport->receive(&frame)) {
+			s_bench_data.errors++;
+			continue;
+		}
+
+		index = (unsigned int)(frame.timestamp - FIRST_TIMESTAMP);
+		if (index >= s_bench_data.frames || index != i || frame.latitude != __latitude(index)) {
+			s_bench_data.errors++;
+			continue;
+		}
+
+		s_bench_data.latency_ns[index] = (double)(__now_ns() - s_bench_data.sent_ns[index]);
+	}
+
+	return data;
+}
+
+static bool
+__run(const transport_s *transport, unsigned int frames, int64_t interval_ns, double *elapsed_s)
+{
+	position_frame_s frame;
+	pthread_t consumer;
+	int64_t start;
+	unsigned int i;
+
+	s_bench_data.transport = transport;
+	s_bench_data.frames = frames;
+	memset(s_bench_data.latency_ns, 0, sizeof(s_bench_data.latency_ns));
+
+	if (!transport->open()) {
+		printf("FAIL %s: could not open the transport\n", transport->name);
+		transport->close();
+		return false;
+	}
+
+	if (pthread_create(&consumer, NULL, __consumer_thread, NULL) != 0) {
+		transport->close();
+		return false;
+	}
+
+	start = __now_ns();
+	for (i = 0; i < frames; i++) {
+		/* Yield while pacing, the consumer may share the CPU */
+		while (__now_ns() < start + i * interval_ns)
+			sched_yield();
+
+		position_frame_init(&frame, __latitude(i), 90.4125, 10.0, FIRST_TIMESTAMP + i);
+		frame.horizontal_accuracy = 5.0f;
+
+		s_bench_data.sent_ns[i] = __now_ns();
+		if (!transport->send(&frame))
+			s_bench_data.errors++;
+	}
+
+	pthread_join(consumer, NULL);
+	*elapsed_s = (__now_ns() - start) / 1e9;
+	transport->close();
+
+	return true;
+}
+
+int
+main(void)
+{
+	double elapsed_s;
+	unsigned int t;
+
+	printf("Position frames between two threads, %d flat out and %d paced at %d us:\n", FLOOD_FRAMES,
+			PACED_FRAMES, PACED_INTERVAL_NS / 1000);
+
+	for (t = 0; t < sizeof(s_transports) / sizeof(s_transports[0]); t++) {
+		const transport_s *transport = &s_transports[t];
+		double *latency = s_bench_data.latency_ns;
+
+		if (!__run(transport, FLOOD_FRAMES, 0, &elapsed_s))
+			return 1;
+
+		printf("  %-8s %9.0f frames/s, %6.0f ns per frame\n", transport->name, FLOOD_FRAMES / elapsed_s,
+				elapsed_s * 1e9 / FLOOD_FRAMES);
+
+		if (!__run(transport, PACED_FRAMES, PACED_INTERVAL_NS, &elapsed_s))
+			return 1;
+
+		qsort(latency, PACED_FRAMES, sizeof(double), __compare_latency);
+		printf("  %-8s latency median %6.0f ns, p99 %6.0f ns, max %8.0f ns\n", "", latency[PACED_FRAMES / 2],
+				latency[PACED_FRAMES * 99 / 100], latency[PACED_FRAMES - 1]);
+	}
+
+	printf("shm_ring_bench: %s\n", s_bench_data.errors ? "FAILED" : "passed");
+
+	return s_bench_data.errors ? 1 : 0;
+}
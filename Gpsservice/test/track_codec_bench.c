@@ -0,0 +1,229 @@
+/* Size and speed of track_codec on a recorded track, and agreement of its two decoders.
+ *
+ * Reads every fix of a track file (GPX, NMEA or CSV, see track_file.h), encodes them as one
+ * track payload and decodes it point by point with the streaming decoder and at once with the
+ * bulk decoder. Both outputs must be identical and within the codec resolution of the input.
+ * Without a track argument a 1 Hz walk with a slowly turning heading and GPS noise is generated.
+ *
+ * Usage: track_codec_bench [track file]
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "track_codec.h"
+#include "track_file.h"
+#include "position_frame.h"
+
+#define GENERATED_FIXES 100000
+#define ROUNDS 20
+#define METERS_PER_DEG 111195.08
+
+static struct
+{
+	track_codec_point_s *points;
+	track_codec_point_s *streamed;
+	track_codec_point_s *bulk;
+	unsigned char *payload;
+	unsigned int count;
+	unsigned int failures;
+} s_bench_data;
+
+static double
+__now(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+static bool
+__generate_track(char *path)
+{
+	int fd = mkstemp(path);
+	FILE *file;
+	double north = 0.0, east = 0.0, heading = 0.0;
+	double latitude = 23.8103;
+	double longitude = 90.4125;
+	long timestamp = 1700000000;
+	int i;
+
+	if (fd < 0)
+		return false;
+
+	file = fdopen(fd, "w");
+	if (!file) {
+		close(fd);
+		return false;
+	}
+
+	srand(1);
+	fprintf(file, "time,latitude,longitude,altitude,speed,heading,accuracy\n");
+	for (i = 0; i < GENERATED_FIXES; i++) {
+		double noise_north = (rand() % 61 - 30) / 10.0;
+		double noise_east = (rand() % 61 - 30) / 10.0;
+
+		heading += (rand() % 21 - 10) / 100.0;
+		north += 1.4 * cos(heading);
+		east += 1.4 * sin(heading);
+
+		fprintf(file, "%ld,%.7f,%.7f,%.1f,%.1f,%.0f,%d\n", timestamp++, latitude + (north + noise_north) / METERS_PER_DEG,
+				longitude + (east + noise_east) / (METERS_PER_DEG * cos(latitude * M_PI / 180.0)),
+				10.0 + rand() % 20 / 10.0, 5.0, fmod(heading * 180.0 / M_PI + 360000.0, 360.0), 3 + rand() % 10);
+	}
+
+	return fclose(file) == 0;
+}
+
+static bool
+__read_track(const char *path)
+{
+	track_file_s *file = track_file_open(path);
+	track_file_fix_s fix;
+	unsigned int capacity = 0;
+
+	if (!file)
+		return false;
+
+	while (track_file_next(file, &fix)) {
+		track_codec_point_s *point;
+
+		if (s_bench_data.count == capacity) {
+			capacity = capacity ? capacity * 2 : 4096;
+			s_bench_data.points = realloc(s_bench_data.points, capacity * sizeof(track_codec_point_s));
+			if (!s_bench_data.points) {
+				track_file_close(file);
+				return false;
+			}
+		}
+
+		point = &s_bench_data.points[s_bench_data.count++];
+		point->timestamp = (int64_t)llround(fix.timestamp);
+		point->latitude = fix.latitude;
+		point->longitude = fix.longitude;
+		point->altitude = (float)fix.altitude;
+		point->horizontal_accuracy = (float)fix.horizontal_accuracy;
+		point->flags = POSITION_FRAME_QUALITY_GOOD << POSITION_FRAME_QUALITY_SHIFT;
+	}
+
+	track_file_close(file);
+
+	return s_bench_data.count > 0;
+}
+
+static void
+__fail(unsigned int index, const char *what)
+{
+	if (s_bench_data.failures++ < 10)
+		printf("FAIL point %u: %s\n", index, what);
+}
+
+static void
+__compare(void)
+{
+	unsigned int i;
+
+	for (i = 0; i < s_bench_data.count; i++) {
+		const track_codec_point_s *input = &s_bench_data.points[i];
+		const track_codec_point_s *streamed = &s_bench_data.streamed[i];
+		const track_codec_point_s *bulk = &s_bench_data.bulk[i];
+
+		if (streamed->timestamp != bulk->timestamp || streamed->latitude != bulk->latitude ||
+				streamed->longitude != bulk->longitude || streamed->altitude != bulk->altitude ||
+				streamed->horizontal_accuracy != bulk->horizontal_accuracy || streamed->flags != bulk->flags)
+			__fail(i, "bulk and streaming decoders differ");
+
+		if (streamed->timestamp != input->timestamp || fabs(streamed->latitude - input->latitude) > TRACK_CODEC_RESOLUTION ||
+				fabs(streamed->longitude - input->longitude) > TRACK_CODEC_RESOLUTION ||
+				fabs(streamed->altitude - input->altitude) > 0.06 || streamed->flags != input->flags)
+			__fail(i, "decoded point differs from the input");
+	}
+}
+
+int
+main(int argc, char *argv[])
+{
+	char generated[] = "/tmp/track_codec_bench_XXXXXX";
+	const char *path = argc > 1 ? argv[1] : generated;
+	size_t capacity, size = 0, offset;
+	track_codec_state_s state;
+	double start, encode_s, stream_s, bulk_s;
+	unsigned int count, decoded = 0;
+	int round;
+
+	if (argc < 2 && !__generate_track(generated)) {
+		fprintf(stderr, "Failed to generate track\n");
+		return 1;
+	}
+
+	if (!__read_track(path)) {
+		fprintf(stderr, "Failed to read track %s\n", path);
+		return 1;
+	}
+
+	if (argc < 2)
+		unlink(generated);
+
+	count = s_bench_data.count;
+	capacity = sizeof(track_codec_header_s) + (size_t)count * TRACK_CODEC_MAX_POINT_SIZE;
+	s_bench_data.payload = malloc(capacity);
+	s_bench_data.streamed = calloc(count, sizeof(track_codec_point_s));
+	s_bench_data.bulk = calloc(count, sizeof(track_codec_point_s));
+	if (!s_bench_data.payload || !s_bench_data.streamed || !s_bench_data.bulk) {
+		fprintf(stderr, "Out of memory\n");
+		return 1;
+	}
+
+	start = __now();
+	for (round = 0; round < ROUNDS; round++)
+		size = track_codec_encode(s_bench_data.points, count, s_bench_data.payload, capacity);
+	encode_s = (__now() - start) / ROUNDS;
+
+	start = __now();
+	for (round = 0; round < ROUNDS; round++) {
+		track_codec_state_init(&state);
+		offset = sizeof(track_codec_header_s);
+		for (decoded = 0; decoded < count; decoded++) {
+			size_t used = track_codec_decode_point(&state, s_bench_data.payload + offset, size - offset,
+					&s_bench_data.streamed[decoded]);
+
+			if (used == 0)
+				break;
+			offset += used;
+		}
+	}
+	stream_s = (__now() - start) / ROUNDS;
+
+	if (decoded != count)
+		__fail(decoded, "streaming decoder stopped early");
+
+	start = __now();
+	for (round = 0; round < ROUNDS; round++)
+		decoded = track_codec_decode(s_bench_data.payload, size, s_bench_data.bulk, count);
+	bulk_s = (__now() - start) / ROUNDS;
+
+	if (decoded != count)
+		__fail(decoded, "bulk decoder stopped early");
+
+	__compare();
+
+	printf("Track codec, %u points of %s:\n", count, argc > 1 ? path : "a generated walk");
+	printf("  %.2f bytes per point, %u bytes instead of %u as position frames\n",
+			(double)(size - sizeof(track_codec_header_s)) / count, (unsigned int)size,
+			(unsigned int)(count * sizeof(position_frame_s)));
+	printf("  encode %6.1f M points/s, streaming decode %6.1f M points/s, bulk decode %6.1f M points/s\n",
+			count / encode_s / 1e6, count / stream_s / 1e6, count / bulk_s / 1e6);
+	printf("track_codec_bench: %s\n", s_bench_data.failures ? "FAILED" : "passed");
+
+	free(s_bench_data.points);
+	free(s_bench_data.streamed);
+	free(s_bench_data.bulk);
+	free(s_bench_data.payload);
+
+	return s_bench_data.failures ? 1 : 0;
+}
@@ -0,0 +1,159 @@
+/* Cost of track_journal_append, which runs on the main loop for every position.
+ *
+ * Appends a few segments worth of fixes to a journal in a temporary directory, timing every
+ * call, then compacts the closed segments and scans the whole journal back. An append should
+ * stay under a microsecond; segment rotation is the slow path and shows up as the maximum.
+ *
+ * Usage: track_journal_bench [directory]
+ */
+
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "track_journal.h"
+
+#define SEGMENTS 8
+#define APPENDS (SEGMENTS * TRACK_SEGMENT_BLOCKS * TRACK_BLOCK_RECORDS)
+#define KEEP_SEGMENTS 2
+#define TARGET_NS 1000.0
+
+static struct
+{
+	double latency[APPENDS];
+	unsigned int scanned;
+	int64_t last_timestamp;
+	bool in_order;
+} s_bench_data = {
+	.scanned = 0,
+	.last_timestamp = 0,
+	.in_order = true
+};
+
+static double
+__now(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+static int
+__compare_latency(const void *a, const void *b)
+{
+	double x = *(const double *)a, y = *(const double *)b;
+
+	return (x > y) - (x < y);
+}
+
+static bool
+__record_cb(const track_record_s *record, void *user_data)
+{
+	int64_t *from = user_data;
+
+	if (record->timestamp < *from || record->timestamp < s_bench_data.last_timestamp)
+		s_bench_data.in_order = false;
+
+	s_bench_data.last_timestamp = record->timestamp;
+	s_bench_data.scanned++;
+
+	return true;
+}
+
+static void
+__remove_dir(const char *dir)
+{
+	char path[1024];
+	struct dirent *entry;
+	DIR *d = opendir(dir);
+
+	if (!d)
+		return;
+
+	while ((entry = readdir(d))) {
+		if (entry->d_name[0] == '.')
+			continue;
+
+		snprintf(path, sizeof(path), "%s/%s", dir, entry->d_name);
+		unlink(path);
+	}
+
+	closedir(d);
+	rmdir(dir);
+}
+
+int
+main(int argc, char *argv[])
+{
+	char generated[] = "/tmp/track_journal_bench_XXXXXX";
+	const char *dir = argc > 1 ? argv[1] : generated;
+	double latitude = 23.8103;
+	double longitude = 90.4125;
+	double total = 0.0, start, compact_s, scan_s;
+	int64_t from = 1700000000;
+	position_frame_s frame;
+	int compacted;
+	int i;
+
+	if (argc < 2 && !mkdtemp(generated)) {
+		fprintf(stderr, "Failed to create journal directory\n");
+		return 1;
+	}
+
+	if (!track_journal_open(dir)) {
+		fprintf(stderr, "Failed to open journal in %s\n", dir);
+		return 1;
+	}
+
+	srand(1);
+	for (i = 0; i < APPENDS; i++) {
+		latitude += (rand() % 201 - 100) * 1e-6;
+		longitude += (rand() % 201 - 100) * 1e-6;
+		position_frame_init(&frame, latitude, longitude, 10.0, from + i);
+		frame.horizontal_accuracy = 5.0f;
+
+		start = __now();
+		if (!track_journal_append(&frame)) {
+			fprintf(stderr, "Append %d failed\n", i);
+			return 1;
+		}
+		s_bench_data.latency[i] = (__now() - start) * 1e9;
+		total += s_bench_data.latency[i];
+	}
+
+	start = __now();
+	compacted = track_journal_compact(dir, track_journal_current_segment(), KEEP_SEGMENTS);
+	compact_s = __now() - start;
+
+	start = __now();
+	track_journal_scan(dir, from, INT64_MAX, __record_cb, &from);
+	scan_s = __now() - start;
+
+	track_journal_close();
+	if (argc < 2)
+		__remove_dir(generated);
+
+	qsort(s_bench_data.latency, APPENDS, sizeof(double), __compare_latency);
+
+	printf("track_journal_append, %d fixes over %d segments:\n", APPENDS, SEGMENTS);
+	printf("  mean %.0f ns, median %.0f ns, p99 %.0f ns, p99.9 %.0f ns, max %.0f ns (segment rotation)\n",
+			total / APPENDS, s_bench_data.latency[APPENDS / 2], s_bench_data.latency[APPENDS * 99 / 100],
+			s_bench_data.latency[APPENDS * 999 / 1000], s_bench_data.latency[APPENDS - 1]);
+	printf("  compacted %d segments in %.1f ms, scanned %u records in %.1f ms\n", compacted, compact_s * 1e3,
+			s_bench_data.scanned, scan_s * 1e3);
+
+	if (s_bench_data.scanned != APPENDS || !s_bench_data.in_order) {
+		printf("FAIL scan returned %u of %d records%s\n", s_bench_data.scanned, APPENDS,
+				s_bench_data.in_order ? "" : ", out of order");
+		return 1;
+	}
+
+	if (total / APPENDS > TARGET_NS)
+		printf("  mean append is over the %.0f ns target\n", TARGET_NS);
+
+	return 0;
+}
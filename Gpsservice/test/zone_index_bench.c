@@ -0,0 +1,228 @@
+/* Per-fix cost of zone_index against a linear scan of all zones, with the same answers.
+ *
+ * Ten thousand circle and polygon zones are spread over a city-sized area and a 1 Hz fix stream
+ * of a vehicle driving through it is run through both. For every fix the index answers which
+ * zones contain it and how far the nearest zone edge is, as geofence_update() asks; the linear
+ * scan computes the same from zone_index_edge_distance_m() of every zone. Containing zones
+ * must match exactly, the nearest distance where the index searches.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "zone_index.h"
+
+#define CIRCLES 8000
+#define POLYGONS 2000
+#define POLYGON_SIDES 8
+#define ZONES (CIRCLES + POLYGONS)
+#define AREA_M 40000.0
+#define FIXES 10000
+#define SPEED_MPS 10.0
+#define NOISE_M 5.0
+#define MAX_HITS 64
+#define EXACT_NEAREST_M 1000.0		/* within one cell the index finds the nearest edge exactly */
+#define CENTER_LATITUDE 23.8103
+#define CENTER_LONGITUDE 90.4125
+#define METERS_PER_DEG 111195.08
+
+static struct
+{
+	hazard_zone_s zones[ZONES];
+	hazard_zone_vertex_s vertices[POLYGONS * POLYGON_SIDES];
+	hazard_zone_vertex_s fixes[FIXES];
+	unsigned int hits;
+	unsigned int failures;
+	double checksum;				/* keeps the results alive */
+} s_bench_data;
+
+static double
+__now(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+static double
+__uniform(double low, double high)
+{
+	return low + (high - low) * rand() / (double)RAND_MAX;
+}
+
+static hazard_zone_vertex_s
+__offset(double north_m, double east_m)
+{
+	hazard_zone_vertex_s point;
+
+	point.latitude = CENTER_LATITUDE + north_m / METERS_PER_DEG;
+	point.longitude = CENTER_LONGITUDE + east_m / (METERS_PER_DEG * cos(CENTER_LATITUDE * M_PI / 180.0));
+
+	return point;
+}
+
+static void
+__build_zones(void)
+{
+	unsigned int i, v;
+
+	for (i = 0; i < ZONES; i++) {
+		hazard_zone_s *zone = &s_bench_data.zones[i];
+		double north = __uniform(-AREA_M / 2, AREA_M / 2);
+		double east = __uniform(-AREA_M / 2, AREA_M / 2);
+		double radius = __uniform(20.0, 300.0);
+		hazard_zone_vertex_s center = __offset(north, east);
+
+		memset(zone, 0, sizeof(*zone));
+		zone->id = i + 1;
+		zone->latitude = center.latitude;
+		zone->longitude = center.longitude;
+		zone->radius_m = (float)radius;
+
+		if (i < CIRCLES) {
+			zone->type = HAZARD_ZONE_TYPE_CIRCLE;
+			continue;
+		}
+
+		/* Irregular, but simple: vertices in angle order at varying distance */
+		zone->type = HAZARD_ZONE_TYPE_POLYGON;
+		zone->first_vertex = (i - CIRCLES) * POLYGON_SIDES;
+		zone->vertex_count = POLYGON_SIDES;
+		for (v = 0; v < POLYGON_SIDES; v++) {
+			double angle = 2.0 * M_PI * v / POLYGON_SIDES;
+			double distance = radius * __uniform(0.5, 1.0);
+
+			s_bench_data.vertices[zone->first_vertex + v] = __offset(north + distance * cos(angle), east + distance * sin(angle));
+		}
+	}
+}
+
+static void
+__build_fixes(void)
+{
+	double north = 0.0, east = 0.0, heading = 0.0;
+	unsigned int i;
+
+	for (i = 0; i < FIXES; i++) {
+		heading += __uniform(-0.1, 0.1);
+		if (hypot(north, east) > AREA_M / 2 - 1000.0)
+			heading = atan2(-east, -north);
+
+		north += SPEED_MPS * cos(heading);
+		east += SPEED_MPS * sin(heading);
+		s_bench_data.fixes[i] = __offset(north + __uniform(-NOISE_M, NOISE_M), east + __uniform(-NOISE_M, NOISE_M));
+	}
+}
+
+static unsigned int
+__scan(const zone_index_s *index, double latitude, double longitude, uint32_t *out, double *nearest)
+{
+	unsigned int written = 0;
+	unsigned int i;
+
+	*nearest = INFINITY;
+
+	for (i = 0; i < ZONES; i++) {
+		double distance = zone_index_edge_distance_m(index, i, latitude, longitude);
+
+		if (distance <= 0.0 && written < MAX_HITS)
+			out[written++] = i;
+
+		*nearest = fmin(*nearest, fmax(distance, 0.0));
+	}
+
+	return written;
+}
+
+static int
+__compare_zone(const void *a, const void *b)
+{
+	uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+
+	return (x > y) - (x < y);
+}
+
+static void
+__check(unsigned int fix, uint32_t *indexed, unsigned int indexed_count, double indexed_nearest,
+		uint32_t *scanned, unsigned int scanned_count, double scanned_nearest)
+{
+	qsort(indexed, indexed_count, sizeof(uint32_t), __compare_zone);
+
+	if (indexed_count != scanned_count || memcmp(indexed, scanned, indexed_count * sizeof(uint32_t))) {
+		if (s_bench_data.failures++ < 10)
+			printf("FAIL fix %u: index finds %u zones, scan %u\n", fix, indexed_count, scanned_count);
+		return;
+	}
+
+	/* Beyond the searched cells the index gives a lower bound */
+	if (indexed_nearest > scanned_nearest + 1e-6 ||
+			(scanned_nearest < EXACT_NEAREST_M && fabs(indexed_nearest - scanned_nearest) > 1e-6)) {
+		if (s_bench_data.failures++ < 10)
+			printf("FAIL fix %u: nearest edge %.3f m by the index, %.3f m by the scan\n", fix, indexed_nearest,
+					scanned_nearest);
+	}
+}
+
+int
+main(void)
+{
+	static uint32_t indexed[FIXES][MAX_HITS];
+	static unsigned int indexed_count[FIXES];
+	static double indexed_nearest[FIXES];
+	zone_index_s *index = zone_index_create();
+	double start, build_s, index_s, scan_s;
+	unsigned int i;
+
+	if (!index) {
+		fprintf(stderr, "Failed to create index\n");
+		return 1;
+	}
+
+	srand(1);
+	__build_zones();
+	__build_fixes();
+
+	start = __now();
+	if (!zone_index_build(index, s_bench_data.zones, ZONES, s_bench_data.vertices)) {
+		fprintf(stderr, "Failed to build index\n");
+		return 1;
+	}
+	build_s = __now() - start;
+
+	start = __now();
+	for (i = 0; i < FIXES; i++) {
+		const hazard_zone_vertex_s *fix = &s_bench_data.fixes[i];
+
+		indexed_count[i] = zone_index_query(index, fix->latitude, fix->longitude, indexed[i], MAX_HITS);
+		indexed_nearest[i] = zone_index_nearest_m(index, fix->latitude, fix->longitude);
+	}
+	index_s = __now() - start;
+
+	start = __now();
+	for (i = 0; i < FIXES; i++) {
+		const hazard_zone_vertex_s *fix = &s_bench_data.fixes[i];
+		uint32_t scanned[MAX_HITS];
+		double nearest;
+		unsigned int count = __scan(index, fix->latitude, fix->longitude, scanned, &nearest);
+
+		s_bench_data.hits += count;
+		s_bench_data.checksum += nearest;
+		__check(i, indexed[i], indexed_count[i], indexed_nearest[i], scanned, count, nearest);
+	}
+	scan_s = __now() - start;
+
+	zone_index_destroy(index);
+
+	printf("Zone index, %d circles and %d polygons, %d fixes at 1 Hz driving %.0f m/s:\n", CIRCLES, POLYGONS, FIXES,
+			SPEED_MPS);
+	printf("  built in %.1f ms, %u fix-in-zone hits\n", build_s * 1e3, s_bench_data.hits);
+	printf("  per fix: index %.2f us, linear scan %.2f us (x%.0f)\n", index_s * 1e6 / FIXES, scan_s * 1e6 / FIXES,
+			scan_s / index_s);
+	printf("zone_index_bench: %s\n", s_bench_data.failures ? "FAILED" : "passed");
+
+	return s_bench_data.failures ? 1 : 0;
+}
@@ -0,0 +1,56 @@
+#ifndef __log_ring_H__
+#define __log_ring_H__
+
+#include <stdarg.h>
+
+/* Fixed capacity log of text lines, the model of the debug console.
+ *
+ * Lines are formatted straight into one of LOG_RING_CAPACITY slots of LOG_RING_LINE_SIZE bytes,
+ * longer lines are truncated. When all slots are used the oldest line is overwritten, so memory
+ * and the cost of adding a line stay the same however long the log runs.
+ *
+ * Every line gets a sequence number, counting up from 0 and never reused, also not after
+ * log_ring_clear(). A view keeps sequence numbers instead of text and asks for the lines it shows.
+ * Numbers wrap after 2^32 lines; compare them by difference to log_ring_next().
+ *
+ * A zeroed log_ring_s is empty. Depends on the C library only.
+ */
+
+#define LOG_RING_CAPACITY 512			/* power of two */
+#define LOG_RING_LINE_SIZE 256
+
+typedef struct
+{
+	char lines[LOG_RING_CAPACITY][LOG_RING_LINE_SIZE];
+	unsigned int next;				/* sequence number of the next line */
+	unsigned int count;				/* lines kept, ending at next - 1 */
+	unsigned int dropped;			/* lines overwritten */
+} log_ring_s;
+
+/*
+ * Format line into the ring, trailing line breaks are left out. Returns its sequence number.
+ */
+unsigned int log_ring_vprintf(log_ring_s *ring, const char *format, va_list args);
+
+/*
+ * Get line of sequence number, NULL if it was dropped or cleared, or is not added yet.
+ * The text is valid until LOG_RING_CAPACITY more lines are added.
+ */
+const char *log_ring_get(const log_ring_s *ring, unsigned int sequence);
+
+/*
+ * Get sequence number of the oldest line kept
+ */
+unsigned int log_ring_first(const log_ring_s *ring);
+
+/*
+ * Get sequence number the next line will get
+ */
+unsigned int log_ring_next(const log_ring_s *ring);
+
+/*
+ * Remove all lines, sequence numbers go on
+ */
+void log_ring_clear(log_ring_s *ring);
+
+#endif /* __log_ring_H__ */
@@ -23,16 +23,16 @@
 #include <efl_extension.h>
 #include <locations.h>
 
-#define _PRINT_MSG_LOG_BUFFER_SIZE_ 1024
-#define PRINT_MSG(fmt, args...) do { char _log_[_PRINT_MSG_LOG_BUFFER_SIZE_]; \
-    snprintf(_log_, _PRINT_MSG_LOG_BUFFER_SIZE_, fmt, ##args); _add_entry_text(_log_); } while (0)
+/* Lines go to a fixed size ring and are shown once per frame, see log_ring.h */
+#define PRINT_MSG(fmt, args...) _add_log_text(fmt, ##args)
 
 typedef struct {
     Evas_Object *win;
     Evas_Object *navi;
 } appdata_s;
 
-void _add_entry_text(const char *text);
+void _add_log_text(const char *format, ...) __attribute__((format(printf, 1, 2)));
+void _log_deinitialize(void);
 Evas_Object *_new_button(appdata_s *ad, Evas_Object *display, char *name, void *cb);
 Evas_Object *_create_new_cd_display(appdata_s *ad, char *name, void *cb);
 Eina_Bool _pop_cb(void *data, Elm_Object_Item *item);
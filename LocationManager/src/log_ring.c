@@ -0,0 +1,59 @@
+#include <stdio.h>
+#include <string.h>
+#include "log_ring.h"
+
+typedef char __log_ring_capacity_check[(LOG_RING_CAPACITY & (LOG_RING_CAPACITY - 1)) == 0 ? 1 : -1];
+
+
+unsigned int
+log_ring_vprintf(log_ring_s *ring, const char *format, va_list args)
+{
+	char *line = ring->lines[ring->next & (LOG_RING_CAPACITY - 1)];
+	int length = vsnprintf(line, LOG_RING_LINE_SIZE, format, args);
+
+	if (length < 0) {
+		line[0] = '\0';
+		length = 0;
+	} else if (length >= LOG_RING_LINE_SIZE) {
+		length = LOG_RING_LINE_SIZE - 1;
+	}
+
+	/* A line is one row of the view */
+	while (length > 0 && (line[length - 1] == '\n' || line[length - 1] == ' '))
+		line[--length] = '\0';
+
+	if (ring->count == LOG_RING_CAPACITY)
+		ring->dropped++;
+	else
+		ring->count++;
+
+	return ring->next++;
+}
+
+const char *
+log_ring_get(const log_ring_s *ring, unsigned int sequence)
+{
+	/* Wraps to a large number for lines not added yet */
+	if (ring->next - 1 - sequence >= ring->count)
+		return NULL;
+
+	return ring->lines[sequence & (LOG_RING_CAPACITY - 1)];
+}
+
+unsigned int
+log_ring_first(const log_ring_s *ring)
+{
+	return ring->next - ring->count;
+}
+
+unsigned int
+log_ring_next(const log_ring_s *ring)
+{
+	return ring->next;
+}
+
+void
+log_ring_clear(log_ring_s *ring)
+{
+	ring->count = 0;
+}
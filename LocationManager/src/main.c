@@ -14,20 +14,97 @@
  * limitations under the License.
  */
 
+#include <stdint.h>
 #include "main.h"
 #include "user_callbacks.h"
+#include "log_ring.h"
 
 Evas_Object *GLOBAL_DEBUG_BOX;
 
-void _add_entry_text(const char *text)
+static log_ring_s log_ring;
+static Elm_Genlist_Item_Class *log_itc = NULL;
+static Ecore_Animator *log_animator = NULL;
+static unsigned int log_shown = 0;     // sequence number of the next line to add to the list
+
+static Eina_Bool _log_flush_cb(void *data)
+{
+    unsigned int first = log_ring_first(&log_ring);
+    unsigned int next = log_ring_next(&log_ring);
+    unsigned int sequence;
+    Elm_Object_Item *item;
+
+    log_animator = NULL;
+
+    // Lines dropped from the ring leave the list, so it never has more than LOG_RING_CAPACITY items
+    while ((item = elm_genlist_first_item_get(GLOBAL_DEBUG_BOX)) &&
+           next - (unsigned int)(uintptr_t)elm_object_item_data_get(item) > next - first)
+        elm_object_item_del(item);
+
+    // Lines added and dropped again since the last frame are skipped
+    if (next - log_shown > next - first)
+        log_shown = first;
+
+    if (log_shown == next)
+        return ECORE_CALLBACK_CANCEL;
+
+    // Items hold sequence numbers only, the list realizes text of the visible ones
+    for (sequence = log_shown; sequence != next; sequence++)
+        item = elm_genlist_item_append(GLOBAL_DEBUG_BOX, log_itc, (void *)(uintptr_t)sequence, NULL,
+                                       ELM_GENLIST_ITEM_NONE, NULL, NULL);
+
+    log_shown = next;
+    elm_genlist_item_show(item, ELM_GENLIST_ITEM_SCROLLTO_IN);
+
+    return ECORE_CALLBACK_CANCEL;
+}
+
+static char *_log_text_get_cb(void *data, Evas_Object *obj, const char *part)
 {
-    Evas_Coord c_y;
+    const char *text = log_ring_get(&log_ring, (unsigned int)(uintptr_t)data);
 
-    elm_entry_entry_append(GLOBAL_DEBUG_BOX, text);
-    elm_entry_entry_append(GLOBAL_DEBUG_BOX, "<br>");
-    elm_entry_cursor_end_set(GLOBAL_DEBUG_BOX);
-    elm_entry_cursor_geometry_get(GLOBAL_DEBUG_BOX, NULL, &c_y, NULL, NULL);
-    elm_scroller_region_show(GLOBAL_DEBUG_BOX, 0, c_y, 0, 0);
+    return strdup(text ? text : "");
+}
+
+static void _log_list_del_cb(void *data, Evas *e, Evas_Object *obj, void *event_info)
+{
+    if (GLOBAL_DEBUG_BOX != obj)
+        return;
+
+    GLOBAL_DEBUG_BOX = NULL;
+
+    if (log_animator) {
+        ecore_animator_del(log_animator);
+        log_animator = NULL;
+    }
+}
+
+void _add_log_text(const char *format, ...)
+{
+    va_list args;
+
+    va_start(args, format);
+    log_ring_vprintf(&log_ring, format, args);
+    va_end(args);
+
+    // However many lines arrive, the list is updated once per frame
+    if (GLOBAL_DEBUG_BOX && !log_animator)
+        log_animator = ecore_animator_add(_log_flush_cb, NULL);
+}
+
+void _log_deinitialize(void)
+{
+    dlog_print(DLOG_INFO, LOG_TAG, "Debug log: %u lines, %u dropped",
+               log_ring_next(&log_ring), log_ring.dropped);
+
+    if (log_animator) {
+        ecore_animator_del(log_animator);
+        log_animator = NULL;
+    }
+
+    if (log_itc) {
+        elm_genlist_item_class_free(log_itc);
+        log_itc = NULL;
+    }
 }
 
 static void win_delete_request_cb(void *data, Evas_Object *obj, void *event_info)
@@ -56,7 +133,11 @@ Evas_Object *_new_button(appdata_s *ad, Evas_Object *display, char *name, void *
 
 static void _btn_clear_cb(void *data, Evas_Object *btn, void *ev)
 {
-    elm_entry_entry_set(GLOBAL_DEBUG_BOX, "");
+    log_ring_clear(&log_ring);
+    log_shown = log_ring_next(&log_ring);
+
+    if (GLOBAL_DEBUG_BOX)
+        elm_genlist_clear(GLOBAL_DEBUG_BOX);
 }
 
 Evas_Object *_create_new_cd_display(appdata_s *ad, char *name, void *cb)
@@ -104,19 +185,33 @@ Evas_Object *_create_new_cd_display(appdata_s *ad, char *name, void *cb)
     evas_object_size_hint_weight_set(ebox, EVAS_HINT_EXPAND, EVAS_HINT_EXPAND);
     evas_object_show(ebox);
 
-    // Create a message box
-    Evas_Object *display_window = elm_entry_add(ebox);
+    // Create a message list, one item per line of the log
+    if (!log_itc) {
+        log_itc = elm_genlist_item_class_new();
+        log_itc->item_style = "default";
+        log_itc->func.text_get = _log_text_get_cb;
+    }
+
+    Evas_Object *display_window = elm_genlist_add(ebox);
     evas_object_size_hint_align_set(display_window, EVAS_HINT_FILL, EVAS_HINT_FILL);
     evas_object_size_hint_weight_set(display_window, EVAS_HINT_EXPAND, EVAS_HINT_EXPAND);
     evas_object_show(display_window);
 
-    elm_entry_editable_set(display_window, EINA_FALSE);
-    elm_entry_scrollable_set(display_window, EINA_TRUE);
+    // All lines have the same height, so scrolling does not need to realize items to measure them
+    elm_genlist_homogeneous_set(display_window, EINA_TRUE);
+    elm_genlist_mode_set(display_window, ELM_LIST_COMPRESS);
+    elm_genlist_select_mode_set(display_window, ELM_OBJECT_SELECT_MODE_NONE);
+    evas_object_event_callback_add(display_window, EVAS_CALLBACK_DEL, _log_list_del_cb, NULL);
 
     GLOBAL_DEBUG_BOX = display_window;
     elm_scroller_policy_set(GLOBAL_DEBUG_BOX, ELM_SCROLLER_POLICY_OFF, ELM_SCROLLER_POLICY_ON);
     elm_box_pack_end(ebox, display_window);
 
+    // A new display shows the lines kept so far
+    log_shown = log_ring_first(&log_ring);
+    if (!log_animator)
+        log_animator = ecore_animator_add(_log_flush_cb, NULL);
+
     elm_box_pack_end(box, bbox);
     elm_box_pack_end(box, ebox);
     elm_box_pack_end(box, bt);
@@ -174,6 +269,7 @@ static bool app_create(void *data)
 static void app_terminate(void *data)
 {
     _location_deinitialize();
+    _log_deinitialize();
 }
 
 int main(int argc, char *argv[])
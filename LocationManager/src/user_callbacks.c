@@ -16,6 +16,7 @@
 
 #include "user_callbacks.h"
 #include "main.h"
+#include "satellite_stats.h"
 
 static int numofactive = 0;
 static int numofinview = 0;
@@ -24,7 +25,7 @@ static double user_longitude = 0.0;
 static double user_speed = 0.0;
 static double user_direction = 0.0;
 static double user_climb = 0.0;
-static int cur_azimuth, cur_elevation, cur_prn, cur_snr;
+static satellite_stats_s sat_stats;
 location_manager_h manager = NULL;
 location_bounds_h bounds_poly = NULL;
 Evas_Object *start, *stop;
@@ -134,10 +135,7 @@ static bool poly_coords_cb(location_coords_s coords, void *user_data)
 static bool gps_get_satellites_cb(unsigned int azimuth, unsigned int elevation, unsigned int prn,
                                   int snr, bool is_in_use, void *user_data)
 {
-    cur_azimuth = azimuth;
-    cur_elevation = elevation;
-    cur_prn = prn;
-    cur_snr = snr;
+    satellite_stats_add(&sat_stats, azimuth, elevation, snr, is_in_use);
     PRINT_MSG("azimuth: %d, elevation: %d, prn: %d, snr: %d", azimuth, elevation, prn, snr);
     dlog_print(DLOG_DEBUG, LOG_TAG, "azimuth: %d, elevation: %d, prn: %d, snr: %d", azimuth,
                elevation, prn, snr);
@@ -153,11 +151,21 @@ static void gps_satellite_updated_cb(int num_of_active, int num_of_inview, time_
     dlog_print(DLOG_DEBUG, LOG_TAG, "Satellites: active: %d, view: %d", numofactive, numofinview);
 
     if (num_of_inview > 0) {
+        satellite_stats_begin(&sat_stats);
         int ret = gps_status_foreach_satellites_in_view(manager, gps_get_satellites_cb, NULL);
         if (LOCATIONS_ERROR_NONE != ret) {
             PRINT_MSG("gps_status_foreach_satellites_in_view failed : %d", ret);
             dlog_print(DLOG_ERROR, LOG_TAG, "gps_status_foreach_satellites_in_view failed : %d", ret);
+            return;
         }
+        satellite_stats_end(&sat_stats);
+
+        PRINT_MSG("Mean SNR: %.1f (%.1f), in use: %.0f%%, sky spread: %.2f%s",
+                  sat_stats.mean_snr, sat_stats.window_mean_snr, sat_stats.in_use_ratio * 100.0,
+                  sat_stats.window_sky_spread, satellite_stats_is_degraded(&sat_stats) ? ", degraded" : "");
+        dlog_print(DLOG_DEBUG, LOG_TAG, "Mean SNR: %.1f (%.1f), in use: %.2f, sky spread: %.2f (%.2f), octants: %u",
+                   sat_stats.mean_snr, sat_stats.window_mean_snr, sat_stats.in_use_ratio,
+                   sat_stats.sky_spread, sat_stats.window_sky_spread, sat_stats.octants);
     }
 }
 
@@ -277,6 +285,9 @@ void _get_satellite_information_cb(appdata_s *ad, Evas_Object *obj, void *event_
         return;
     }
 
+    /* Statistics window starts with the first update */
+    satellite_stats_init(&sat_stats);
+
     /* Register the callback */
     int ret = gps_status_set_satellite_updated_cb(manager, gps_satellite_updated_cb, 10, NULL);
     if (LOCATIONS_ERROR_NONE != ret) {
@@ -0,0 +1,161 @@
+/* Log throughput and memory of the debug console over a long tracking session.
+ *
+ * Simulates a day of position_updated, velocity_updated and satellite lines at the rates of
+ * user_callbacks.c going through log_ring, and a view showing the newest rows once per 60 Hz
+ * frame the way the genlist animator does. Reports the cost per line of every simulated hour
+ * and the memory growth of the process, both must stay flat. For comparison, the size of the
+ * markup the old elm_entry would have held is summed up.
+ */
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "log_ring.h"
+
+#define HOURS 24
+#define SATELLITES 10				/* lines per second from the satellite callback */
+#define FRAME_RATE 60
+#define VISIBLE_ROWS 20
+#define ENTRY_BREAK "<br>"
+#define MAX_RSS_GROWTH_KB 64
+
+static struct
+{
+	log_ring_s ring;
+	double hour_ns[HOURS];
+	unsigned long long entry_bytes;	/* markup the elm_entry would hold */
+	unsigned int shown;				/* sequence number the view shows up to */
+	unsigned int rows_fetched;
+	unsigned int failures;
+} s_bench_data;
+
+static double
+__now(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+static long
+__rss_kb(void)
+{
+	long pages = 0, resident = 0;
+	FILE *statm = fopen("/proc/self/statm", "r");
+
+	if (!statm)
+		return 0;
+
+	if (fscanf(statm, "%ld %ld", &pages, &resident) != 2)
+		resident = 0;
+	fclose(statm);
+
+	return resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+static void
+__print_msg(const char *format, ...)
+{
+	va_list args;
+	unsigned int sequence;
+
+	va_start(args, format);
+	sequence = log_ring_vprintf(&s_bench_data.ring, format, args);
+	va_end(args);
+
+	s_bench_data.entry_bytes += strlen(log_ring_get(&s_bench_data.ring, sequence)) + strlen(ENTRY_BREAK);
+}
+
+static void
+__frame(void)
+{
+	unsigned int next = log_ring_next(&s_bench_data.ring);
+	unsigned int kept = next - log_ring_first(&s_bench_data.ring);
+	unsigned int row;
+
+	if (next == s_bench_data.shown)
+		return;
+
+	/* After bringing in the last line only the rows on screen fetch their text */
+	for (row = next - (kept < VISIBLE_ROWS ? kept : VISIBLE_ROWS); row != next; row++) {
+		if (!log_ring_get(&s_bench_data.ring, row) && s_bench_data.failures++ < 10)
+			printf("FAIL visible line %u is gone\n", row);
+		s_bench_data.rows_fetched++;
+	}
+
+	s_bench_data.shown = next;
+}
+
+static void
+__second(unsigned int second)
+{
+	double latitude = 23.8103 + second * 1e-6;
+	double longitude = 90.4125 + second * 1e-6;
+	int i;
+
+	__print_msg("latitude: %f, longitude: %f", latitude, longitude);
+	__print_msg("speed: %f, direction: %f, climb: %f", 1.4, (double)(second % 360), 0.0);
+	for (i = 0; i < SATELLITES; i++)
+		__print_msg("azimuth: %d, elevation: %d, prn: %d, snr: %d", (int)(second + i * 36) % 360, 10 + i * 8, i + 1, 20 + i);
+
+	for (i = 0; i < FRAME_RATE; i++)
+		__frame();
+}
+
+int
+main(void)
+{
+	unsigned int second = 0;
+	unsigned int hour;
+	long rss_start, rss_end;
+	double first, last, slowest = 0.0;
+	unsigned int start_sequence = 0u - 100000u;
+	unsigned int lines;
+
+	/* Sequence numbers wrap after 2^32 lines, start close to it so the view crosses it */
+	s_bench_data.ring.next = s_bench_data.shown = start_sequence;
+
+	/* Warm up for an hour: every slot written, code, stack, stdio and the clock touched */
+	__rss_kb();
+	__now();
+	for (second = 0; second < 3600; second++)
+		__second(second);
+	rss_start = __rss_kb();
+
+	for (hour = 0; hour < HOURS; hour++) {
+		double start = __now();
+		unsigned int end = second + 3600;
+
+		for (; second < end; second++)
+			__second(second);
+
+		s_bench_data.hour_ns[hour] = (__now() - start) * 1e9 / (3600.0 * (SATELLITES + 2));
+		if (s_bench_data.hour_ns[hour] > slowest)
+			slowest = s_bench_data.hour_ns[hour];
+	}
+
+	rss_end = __rss_kb();
+	lines = log_ring_next(&s_bench_data.ring) - start_sequence;
+	first = s_bench_data.hour_ns[0];
+	last = s_bench_data.hour_ns[HOURS - 1];
+
+	if (!strstr(log_ring_get(&s_bench_data.ring, log_ring_next(&s_bench_data.ring) - 1), "azimuth") && s_bench_data.failures++ < 10)
+		printf("FAIL newest line is not the last one written\n");
+
+	if (rss_end - rss_start > MAX_RSS_GROWTH_KB && s_bench_data.failures++ < 10)
+		printf("FAIL memory grew by %ld KB\n", rss_end - rss_start);
+
+	printf("Debug log, %d h after an hour of warm-up at %d lines/s, %u lines in all, %u kept, %u dropped:\n", HOURS, SATELLITES + 2, lines,
+			s_bench_data.ring.count, s_bench_data.ring.dropped);
+	printf("  per line with the view: first hour %.0f ns, last hour %.0f ns, slowest hour %.0f ns\n", first, last, slowest);
+	printf("  log model %u KB, process grew by %ld KB after warm-up; %u rows fetched by the view\n",
+			(unsigned int)(sizeof(log_ring_s) / 1024), rss_end - rss_start, s_bench_data.rows_fetched);
+	printf("  the elm_entry would hold %.1f MB of markup by now\n", s_bench_data.entry_bytes / 1048576.0);
+	printf("log_ring_bench: %s\n", s_bench_data.failures ? "FAILED" : "passed");
+
+	return s_bench_data.failures ? 1 : 0;
+}
@@ -0,0 +1,338 @@
+#include <math.h>
+#include "geodesy.h"
+
+#define DEG_TO_RAD (M_PI / 180.0)
+#define RAD_TO_DEG (180.0 / M_PI)
+#define MIN_COS_LATITUDE 0.01
+
+/* Lanes of doubles and the few operations the kernels need, one set per instruction set */
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define GEODESY_ISA "avx2"
+#define GEODESY_LANES 4
+typedef __m256d lanes_t;
+typedef __m256d mask_t;
+#define LANES_SET(x) _mm256_set1_pd(x)
+#define LANES_LOAD(p) _mm256_loadu_pd(p)
+#define LANES_STORE(p, v) _mm256_storeu_pd(p, v)
+#define LANES_ADD(a, b) _mm256_add_pd(a, b)
+#define LANES_SUB(a, b) _mm256_sub_pd(a, b)
+#define LANES_MUL(a, b) _mm256_mul_pd(a, b)
+#define LANES_DIV(a, b) _mm256_div_pd(a, b)
+#define LANES_SQRT(a) _mm256_sqrt_pd(a)
+#define LANES_MIN(a, b) _mm256_min_pd(a, b)
+#define LANES_MAX(a, b) _mm256_max_pd(a, b)
+#define LANES_ABS(a) _mm256_andnot_pd(_mm256_set1_pd(-0.0), a)
+#define LANES_COPYSIGN(a, s) _mm256_or_pd(LANES_ABS(a), _mm256_and_pd(s, _mm256_set1_pd(-0.0)))
+#define LANES_ROUND(a) _mm256_round_pd(a, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC)
+#define LANES_LT(a, b) _mm256_cmp_pd(a, b, _CMP_LT_OQ)
+#define LANES_SELECT(m, a, b) _mm256_blendv_pd(b, a, m)
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define GEODESY_ISA "sse2"
+#define GEODESY_LANES 2
+typedef __m128d lanes_t;
+typedef __m128d mask_t;
+#define LANES_SET(x) _mm_set1_pd(x)
+#define LANES_LOAD(p) _mm_loadu_pd(p)
+#define LANES_STORE(p, v) _mm_storeu_pd(p, v)
+#define LANES_ADD(a, b) _mm_add_pd(a, b)
+#define LANES_SUB(a, b) _mm_sub_pd(a, b)
+#define LANES_MUL(a, b) _mm_mul_pd(a, b)
+#define LANES_DIV(a, b) _mm_div_pd(a, b)
+#define LANES_SQRT(a) _mm_sqrt_pd(a)
+#define LANES_MIN(a, b) _mm_min_pd(a, b)
+#define LANES_MAX(a, b) _mm_max_pd(a, b)
+#define LANES_ABS(a) _mm_andnot_pd(_mm_set1_pd(-0.0), a)
+#define LANES_COPYSIGN(a, s) _mm_or_pd(LANES_ABS(a), _mm_and_pd(s, _mm_set1_pd(-0.0)))
+/* SSE2 has no rounding instruction, the conversion rounds to nearest and is exact below 2^31 */
+#define LANES_ROUND(a) _mm_cvtepi32_pd(_mm_cvtpd_epi32(a))
+#define LANES_LT(a, b) _mm_cmplt_pd(a, b)
+#define LANES_SELECT(m, a, b) _mm_or_pd(_mm_and_pd(m, a), _mm_andnot_pd(m, b))
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+/* 32-bit NEON has no double lanes, it takes the scalar path */
+#include <arm_neon.h>
+#define GEODESY_ISA "neon"
+#define GEODESY_LANES 2
+typedef float64x2_t lanes_t;
+typedef uint64x2_t mask_t;
+#define LANES_SET(x) vdupq_n_f64(x)
+#define LANES_LOAD(p) vld1q_f64(p)
+#define LANES_STORE(p, v) vst1q_f64(p, v)
+#define LANES_ADD(a, b) vaddq_f64(a, b)
+#define LANES_SUB(a, b) vsubq_f64(a, b)
+#define LANES_MUL(a, b) vmulq_f64(a, b)
+#define LANES_DIV(a, b) vdivq_f64(a, b)
+#define LANES_SQRT(a) vsqrtq_f64(a)
+#define LANES_MIN(a, b) vminq_f64(a, b)
+#define LANES_MAX(a, b) vmaxq_f64(a, b)
+#define LANES_ABS(a) vabsq_f64(a)
+#define LANES_COPYSIGN(a, s) vbslq_f64(vdupq_n_u64(0x8000000000000000ULL), s, a)
+#define LANES_ROUND(a) vrndnq_f64(a)
+#define LANES_LT(a, b) vcltq_f64(a, b)
+#define LANES_SELECT(m, a, b) vbslq_f64(m, a, b)
+#else
+#define GEODESY_ISA "scalar"
+#define GEODESY_LANES 1
+#endif
+
+static double __wrap_longitude(double longitude);
+
+#if GEODESY_LANES > 1
+static inline lanes_t __wrap_lanes(lanes_t longitude);
+static inline lanes_t __sin_lanes(lanes_t x);
+static inline lanes_t __cos_lanes(lanes_t x);
+static inline lanes_t __atan_lanes(lanes_t t);
+static inline lanes_t __atan2_lanes(lanes_t y, lanes_t x);
+#endif
+
+
+double
+geodesy_haversine_m(double latitude1, double longitude1, double latitude2, double longitude2)
+{
+	double s1 = sin((latitude2 - latitude1) * DEG_TO_RAD / 2.0);
+	double s2 = sin(__wrap_longitude(longitude2 - longitude1) * DEG_TO_RAD / 2.0);
+	double a = s1 * s1 + cos(latitude1 * DEG_TO_RAD) * cos(latitude2 * DEG_TO_RAD) * s2 * s2;
+
+	a = fmin(fmax(a, 0.0), 1.0);
+
+	/* Unlike asin of sqrt(a), exact for all distances */
+	return 2.0 * GEODESY_EARTH_RADIUS_M * atan2(sqrt(a), sqrt(1.0 - a));
+}
+
+double
+geodesy_equirectangular_m(double latitude1, double longitude1, double latitude2, double longitude2)
+{
+	double x = __wrap_longitude(longitude2 - longitude1) * cos((latitude1 + latitude2) * DEG_TO_RAD / 2.0);
+	double y = latitude2 - latitude1;
+
+	return sqrt(x * x + y * y) * GEODESY_METERS_PER_DEG;
+}
+
+double
+geodesy_bearing_deg(double latitude1, double longitude1, double latitude2, double longitude2)
+{
+	double latitude1_rad = latitude1 * DEG_TO_RAD;
+	double latitude2_rad = latitude2 * DEG_TO_RAD;
+	double delta = __wrap_longitude(longitude2 - longitude1) * DEG_TO_RAD;
+	double y = sin(delta) * cos(latitude2_rad);
+	double x = cos(latitude1_rad) * sin(latitude2_rad) - sin(latitude1_rad) * cos(latitude2_rad) * cos(delta);
+	double bearing = atan2(y, x) * RAD_TO_DEG;
+
+	if (bearing < 0.0)
+		bearing += 360.0;
+
+	/* Tiny negative angles round up to 360 */
+	return bearing < 360.0 ? bearing : bearing - 360.0;
+}
+
+double
+geodesy_longitude_span_deg(double meters, double latitude)
+{
+	return meters / (GEODESY_METERS_PER_DEG * fmax(cos(latitude * DEG_TO_RAD), MIN_COS_LATITUDE));
+}
+
+void
+geodesy_haversine_batch(double latitude, double longitude, const double *latitudes, const double *longitudes,
+		unsigned int count, double *distances_m)
+{
+	unsigned int i = 0;
+
+#if GEODESY_LANES > 1
+	const lanes_t origin_latitude = LANES_SET(latitude);
+	const lanes_t origin_longitude = LANES_SET(longitude);
+	const lanes_t origin_cos = LANES_SET(cos(latitude * DEG_TO_RAD));
+	const lanes_t half_deg_to_rad = LANES_SET(DEG_TO_RAD / 2.0);
+	const lanes_t deg_to_rad = LANES_SET(DEG_TO_RAD);
+	const lanes_t zero = LANES_SET(0.0);
+	const lanes_t one = LANES_SET(1.0);
+	const lanes_t diameter = LANES_SET(2.0 * GEODESY_EARTH_RADIUS_M);
+
+	for (; i + GEODESY_LANES <= count; i += GEODESY_LANES) {
+		lanes_t latitude2 = LANES_LOAD(latitudes + i);
+		lanes_t delta = __wrap_lanes(LANES_SUB(LANES_LOAD(longitudes + i), origin_longitude));
+		lanes_t s1 = __sin_lanes(LANES_MUL(LANES_SUB(latitude2, origin_latitude), half_deg_to_rad));
+		lanes_t s2 = __sin_lanes(LANES_MUL(delta, half_deg_to_rad));
+		lanes_t cos2 = __cos_lanes(LANES_MUL(latitude2, deg_to_rad));
+		lanes_t a = LANES_ADD(LANES_MUL(s1, s1), LANES_MUL(LANES_MUL(origin_cos, cos2), LANES_MUL(s2, s2)));
+
+		a = LANES_MIN(LANES_MAX(a, zero), one);
+
+		LANES_STORE(distances_m + i, LANES_MUL(diameter, __atan2_lanes(LANES_SQRT(a), LANES_SQRT(LANES_SUB(one, a)))));
+	}
+#endif
+
+	for (; i < count; i++)
+		distances_m[i] = geodesy_haversine_m(latitude, longitude, latitudes[i], longitudes[i]);
+}
+
+void
+geodesy_equirectangular_batch(double latitude, double longitude, const double *latitudes, const double *longitudes,
+		unsigned int count, double *distances_m)
+{
+	unsigned int i = 0;
+
+#if GEODESY_LANES > 1
+	const lanes_t origin_latitude = LANES_SET(latitude);
+	const lanes_t origin_longitude = LANES_SET(longitude);
+	const lanes_t half_deg_to_rad = LANES_SET(DEG_TO_RAD / 2.0);
+	const lanes_t meters_per_deg = LANES_SET(GEODESY_METERS_PER_DEG);
+
+	for (; i + GEODESY_LANES <= count; i += GEODESY_LANES) {
+		lanes_t latitude2 = LANES_LOAD(latitudes + i);
+		lanes_t delta = __wrap_lanes(LANES_SUB(LANES_LOAD(longitudes + i), origin_longitude));
+		lanes_t x = LANES_MUL(delta, __cos_lanes(LANES_MUL(LANES_ADD(latitude2, origin_latitude), half_deg_to_rad)));
+		lanes_t y = LANES_SUB(latitude2, origin_latitude);
+
+		LANES_STORE(distances_m + i, LANES_MUL(LANES_SQRT(LANES_ADD(LANES_MUL(x, x), LANES_MUL(y, y))), meters_per_deg));
+	}
+#endif
+
+	for (; i < count; i++)
+		distances_m[i] = geodesy_equirectangular_m(latitude, longitude, latitudes[i], longitudes[i]);
+}
+
+void
+geodesy_bearing_batch(double latitude, double longitude, const double *latitudes, const double *longitudes,
+		unsigned int count, double *bearings_deg)
+{
+	unsigned int i = 0;
+
+#if GEODESY_LANES > 1
+	const lanes_t origin_longitude = LANES_SET(longitude);
+	const lanes_t origin_sin = LANES_SET(sin(latitude * DEG_TO_RAD));
+	const lanes_t origin_cos = LANES_SET(cos(latitude * DEG_TO_RAD));
+	const lanes_t half_deg_to_rad = LANES_SET(DEG_TO_RAD / 2.0);
+	const lanes_t deg_to_rad = LANES_SET(DEG_TO_RAD);
+	const lanes_t rad_to_deg = LANES_SET(RAD_TO_DEG);
+	const lanes_t zero = LANES_SET(0.0);
+	const lanes_t one = LANES_SET(1.0);
+	const lanes_t two = LANES_SET(2.0);
+	const lanes_t full_circle = LANES_SET(360.0);
+
+	for (; i + GEODESY_LANES <= count; i += GEODESY_LANES) {
+		lanes_t latitude2 = LANES_MUL(LANES_LOAD(latitudes + i), deg_to_rad);
+		lanes_t half_delta = LANES_MUL(__wrap_lanes(LANES_SUB(LANES_LOAD(longitudes + i), origin_longitude)), half_deg_to_rad);
+		lanes_t sin2 = __sin_lanes(latitude2);
+		lanes_t cos2 = __cos_lanes(latitude2);
+		lanes_t sin_half = __sin_lanes(half_delta);
+
+		/* Sine and cosine of the full difference from its half, which stays within the polynomial's range */
+		lanes_t sin_delta = LANES_MUL(two, LANES_MUL(sin_half, __cos_lanes(half_delta)));
+		lanes_t cos_delta = LANES_SUB(one, LANES_MUL(two, LANES_MUL(sin_half, sin_half)));
+		lanes_t y = LANES_MUL(sin_delta, cos2);
+		lanes_t x = LANES_SUB(LANES_MUL(origin_cos, sin2), LANES_MUL(LANES_MUL(origin_sin, cos2), cos_delta));
+		lanes_t bearing = LANES_MUL(__atan2_lanes(y, x), rad_to_deg);
+
+		bearing = LANES_SELECT(LANES_LT(bearing, zero), LANES_ADD(bearing, full_circle), bearing);
+		bearing = LANES_SELECT(LANES_LT(bearing, full_circle), bearing, LANES_SUB(bearing, full_circle));
+
+		LANES_STORE(bearings_deg + i, bearing);
+	}
+#endif
+
+	for (; i < count; i++)
+		bearings_deg[i] = geodesy_bearing_deg(latitude, longitude, latitudes[i], longitudes[i]);
+}
+
+const char *
+geodesy_batch_isa(void)
+{
+	return GEODESY_ISA;
+}
+
+/*
+ * Bring longitude difference to [-180, 180]
+ */
+static double
+__wrap_longitude(double longitude)
+{
+	return longitude - 360.0 * nearbyint(longitude / 360.0);
+}
+
+#if GEODESY_LANES > 1
+static inline lanes_t
+__wrap_lanes(lanes_t longitude)
+{
+	const lanes_t full_circle = LANES_SET(360.0);
+
+	return LANES_SUB(longitude, LANES_MUL(full_circle, LANES_ROUND(LANES_DIV(longitude, full_circle))));
+}
+
+/*
+ * Sine of |x| <= pi / 2 by its Taylor series up to x^19, the first term left out is below 3e-16
+ */
+static inline lanes_t
+__sin_lanes(lanes_t x)
+{
+	lanes_t w = LANES_MUL(x, x);
+	lanes_t p = LANES_SET(-1.0 / 121645100408832000.0);
+
+	p = LANES_ADD(LANES_MUL(p, w), LANES_SET(1.0 / 355687428096000.0));
+	p = LANES_ADD(LANES_MUL(p, w), LANES_SET(-1.0 / 1307674368000.0));
+	p = LANES_ADD(LANES_MUL(p, w), LANES_SET(1.0 / 6227020800.0));
+	p = LANES_ADD(LANES_MUL(p, w), LANES_SET(-1.0 / 39916800.0));
+	p = LANES_ADD(LANES_MUL(p, w), LANES_SET(1.0 / 362880.0));
+	p = LANES_ADD(LANES_MUL(p, w), LANES_SET(-1.0 / 5040.0));
+	p = LANES_ADD(LANES_MUL(p, w), LANES_SET(1.0 / 120.0));
+	p = LANES_ADD(LANES_MUL(p, w), LANES_SET(-1.0 / 6.0));
+
+	return LANES_ADD(x, LANES_MUL(LANES_MUL(x, w), p));
+}
+
+/*
+ * Cosine of |x| <= pi / 2
+ */
+static inline lanes_t
+__cos_lanes(lanes_t x)
+{
+	return __sin_lanes(LANES_SUB(LANES_SET(M_PI / 2.0), LANES_ABS(x)));
+}
+
+/*
+ * Arctangent of 0 <= t <= 1. Halving the angle twice brings t below tan(pi / 16), where the
+ * series up to t^21 leaves out less than 1e-16.
+ */
+static inline lanes_t
+__atan_lanes(lanes_t t)
+{
+	const lanes_t one = LANES_SET(1.0);
+	lanes_t w, p;
+
+	t = LANES_DIV(t, LANES_ADD(one, LANES_SQRT(LANES_ADD(one, LANES_MUL(t, t)))));
+	t = LANES_DIV(t, LANES_ADD(one, LANES_SQRT(LANES_ADD(one, LANES_MUL(t, t)))));
+
+	w = LANES_MUL(t, t);
+	p = LANES_SET(-1.0 / 21.0);
+	p = LANES_ADD(LANES_MUL(p, w), LANES_SET(1.0 / 19.0));
+	p = LANES_ADD(LANES_MUL(p, w), LANES_SET(-1.0 / 17.0));
+	p = LANES_ADD(LANES_MUL(p, w), LANES_SET(1.0 / 15.0));
+	p = LANES_ADD(LANES_MUL(p, w), LANES_SET(-1.0 / 13.0));
+	p = LANES_ADD(LANES_MUL(p, w), LANES_SET(1.0 / 11.0));
+	p = LANES_ADD(LANES_MUL(p, w), LANES_SET(-1.0 / 9.0));
+	p = LANES_ADD(LANES_MUL(p, w), LANES_SET(1.0 / 7.0));
+	p = LANES_ADD(LANES_MUL(p, w), LANES_SET(-1.0 / 5.0));
+	p = LANES_ADD(LANES_MUL(p, w), LANES_SET(1.0 / 3.0));
+	p = LANES_SUB(one, LANES_MUL(p, w));
+
+	return LANES_MUL(LANES_SET(4.0), LANES_MUL(t, p));
+}
+
+static inline lanes_t
+__atan2_lanes(lanes_t y, lanes_t x)
+{
+	const lanes_t zero = LANES_SET(0.0);
+	lanes_t ax = LANES_ABS(x);
+	lanes_t ay = LANES_ABS(y);
+	lanes_t larger = LANES_MAX(ax, ay);
+
+	/* Both zero gives 0 like atan2() */
+	lanes_t t = LANES_SELECT(LANES_LT(zero, larger), LANES_DIV(LANES_MIN(ax, ay), larger), zero);
+	lanes_t angle = __atan_lanes(t);
+
+	angle = LANES_SELECT(LANES_LT(ax, ay), LANES_SUB(LANES_SET(M_PI / 2.0), angle), angle);
+	angle = LANES_SELECT(LANES_LT(x, zero), LANES_SUB(LANES_SET(M_PI), angle), angle);
+
+	return LANES_COPYSIGN(angle, y);
+}
+#endif
@@ -0,0 +1,71 @@
+#ifndef __geodesy_H__
+#define __geodesy_H__
+
+/* Distances and bearings between coordinates on a spherical earth, shared by gpsservice-consumer
+ * and Maps. Keep this file and geodesy.c identical in both projects.
+ *
+ * Scalar functions use the C library and are the reference. Batch functions measure from one
+ * origin to count points given as separate latitude and longitude arrays (structure of arrays),
+ * and run AVX2 (4 lanes), SSE2 or AArch64 NEON (2 lanes) when the compiler targets them. Lanes
+ * evaluate sine and arctangent as polynomials after range reduction; distances are within 1e-12
+ * relative of the scalar functions and bearings within 1e-7 degrees, except within 10 km of the
+ * antipode, where the distance is ill-conditioned and the bearing undefined anyway.
+ * test/geodesy_bench.c of gpsservice-consumer checks these bounds and measures points per
+ * second of the scalar and batch functions, run it with 'make bench' in that directory.
+ *
+ * The sphere of GEODESY_EARTH_RADIUS_M is within 0.6% of the WGS84 ellipsoid. Equirectangular
+ * distance is a flat earth around the mean latitude: within 0.01% of haversine below 100 km and
+ * |latitude| below 70 degrees, use it for ranking and culling.
+ *
+ * Latitudes are degrees in [-90, 90], longitudes any degrees, differences are taken the short way
+ * around. Depends on the C library only.
+ */
+
+#define GEODESY_EARTH_RADIUS_M 6371008.8		/* mean radius */
+#define GEODESY_METERS_PER_DEG 111195.08		/* of latitude, and of longitude at the equator */
+
+/*
+ * Get great circle distance in meters
+ */
+double geodesy_haversine_m(double latitude1, double longitude1, double latitude2, double longitude2);
+
+/*
+ * Get flat earth distance in meters, see the error bound above
+ */
+double geodesy_equirectangular_m(double latitude1, double longitude1, double latitude2, double longitude2);
+
+/*
+ * Get initial bearing from the first to the second coordinate, degrees clockwise from north in [0, 360)
+ */
+double geodesy_bearing_deg(double latitude1, double longitude1, double latitude2, double longitude2);
+
+/*
+ * Get degrees of longitude spanning meters east-west at latitude. Near the poles it is capped at
+ * the span at 89.4 degrees.
+ */
+double geodesy_longitude_span_deg(double meters, double latitude);
+
+/*
+ * Write great circle distances in meters from the origin to count points
+ */
+void geodesy_haversine_batch(double latitude, double longitude, const double *latitudes, const double *longitudes,
+		unsigned int count, double *distances_m);
+
+/*
+ * Write flat earth distances in meters from the origin to count points
+ */
+void geodesy_equirectangular_batch(double latitude, double longitude, const double *latitudes, const double *longitudes,
+		unsigned int count, double *distances_m);
+
+/*
+ * Write initial bearings in degrees from the origin to count points
+ */
+void geodesy_bearing_batch(double latitude, double longitude, const double *latitudes, const double *longitudes,
+		unsigned int count, double *bearings_deg);
+
+/*
+ * Get name of the instruction set of the batch functions: "avx2", "sse2", "neon" or "scalar"
+ */
+const char *geodesy_batch_isa(void);
+
+#endif /* __geodesy_H__ */
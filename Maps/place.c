@@ -2,14 +2,47 @@
 #include "place.h"
 #include "main_view.h"
 #include "search_view.h"
-#include <locations.h>
+#include "geodesy.h"
 #include <dlog.h>
 
 #define POI_REQ_ID_IDLE -1
 #define POI_SERVICE_CATEGORY_SEARCH_RADIUS 5000	/* meters */
+#define POI_MAX_RESULTS 100	/* size of the result arrays of the views */
 
 int __request_id = -1;
 
+/* Coordinates of the results as they arrive, their distances are computed in one batch */
+static double __place_latitudes[POI_MAX_RESULTS];
+static double __place_longitudes[POI_MAX_RESULTS];
+static double __place_distances[POI_MAX_RESULTS];
+
+static void
+__rank_places(place_s **place_result, int count, double latitude, double longitude)
+{
+	int i, j;
+
+	if (count > POI_MAX_RESULTS)
+		count = POI_MAX_RESULTS;
+
+	geodesy_haversine_batch(latitude, longitude, __place_latitudes, __place_longitudes, count, __place_distances);
+
+	/* Nearest first - insertion sort, a request has a few dozen results */
+	for (i = 0; i < count; i++) {
+		place_s *place = place_result[i];
+		double distance = __place_distances[i];
+
+		place->__distance = distance * 0.001;
+
+		for (j = i; j > 0 && __place_distances[j - 1] > distance; j--) {
+			place_result[j] = place_result[j - 1];
+			__place_distances[j] = __place_distances[j - 1];
+		}
+
+		place_result[j] = place;
+		__place_distances[j] = distance;
+	}
+}
+
 char*
 __get_category_name(place_type category)
 {
@@ -40,7 +73,6 @@ __maps_service_search_place_cb(maps_error_e error, int request_id , int index, i
 
 	maps_coordinates_h coordinates;
 	static double cur_lat, cur_lon;
-	double distance = 0.0;
 
 	if (error != MAPS_ERROR_NONE) {
 		__request_id = POI_REQ_ID_IDLE;
@@ -66,15 +98,19 @@ __maps_service_search_place_cb(maps_error_e error, int request_id , int index, i
 	maps_coordinates_get_longitude(coordinates, &longitude);
 	place_result[index]->__lat = latitude;
 	place_result[index]->__lon = longitude;
+	place_result[index]->__distance = 0.0;
 	maps_coordinates_destroy(coordinates);
 
-	/* Distance Calculation */
-	location_manager_get_distance(cur_lat, cur_lon, latitude, longitude, &distance);
-	distance = distance * 0.001;
-	place_result[index]->__distance = distance;
+	if (index < POI_MAX_RESULTS) {
+		__place_latitudes[index] = latitude;
+		__place_longitudes[index] = longitude;
+	}
 
-	if (index == (length-1))
+	/* Distance Calculation and ranking */
+	if (index == (length-1)) {
+		__rank_places(place_result, length, cur_lat, cur_lon);
 		on_poi_result(length);
+	}
 
 	__request_id = POI_REQ_ID_IDLE;
 